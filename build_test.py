@@ -19,7 +19,7 @@ OptionList = [
 #	'SUPPORT_ORACLE', 
 	'SUPPORT_POSTGRESQL',
 	'SUPPORT_SCTP',
-	'USE_GSL',
+	'CONNECTION_FILTER',
 #	'USE_PCAPMMAP',
 #	'USE_PFRING',
 	'WITH_TESTS',
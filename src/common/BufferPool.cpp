@@ -0,0 +1,97 @@
+/*
+ * Vermont Buffer Pool
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "BufferPool.h"
+
+
+/**
+ * @param maxFree maximum number of unused buffers kept per size
+ */
+BufferPool::BufferPool(uint32_t maxFree)
+	: maxFree(maxFree),
+	  statAllocated(0),
+	  statRecycled(0)
+{
+}
+
+BufferPool::~BufferPool()
+{
+	for (uint32_t i = 0; i < CLASSES; i++) {
+		for (size_t j = 0; j < freeBuffers[i].size(); j++) {
+			delete[] freeBuffers[i][j];
+		}
+	}
+}
+
+/**
+ * @returns buffer of at least size bytes, its content is undefined
+ */
+boost::shared_array<uint8_t> BufferPool::allocate(uint32_t size)
+{
+	uint32_t sizeClass = 0;
+	while (sizeClass < CLASSES && ((uint32_t)1 << (MIN_BITS+sizeClass)) < size) sizeClass++;
+	if (sizeClass == CLASSES) {
+		return boost::shared_array<uint8_t>(new uint8_t[size]);
+	}
+
+	uint8_t* buffer = NULL;
+	mutex.lock();
+	if (!freeBuffers[sizeClass].empty()) {
+		buffer = freeBuffers[sizeClass].back();
+		freeBuffers[sizeClass].pop_back();
+		statRecycled++;
+	} else {
+		statAllocated++;
+	}
+	mutex.unlock();
+
+	if (!buffer) buffer = new uint8_t[(uint32_t)1 << (MIN_BITS+sizeClass)];
+
+	Releaser releaser;
+	releaser.pool = shared_from_this();
+	releaser.sizeClass = sizeClass;
+	return boost::shared_array<uint8_t>(buffer, releaser);
+}
+
+void BufferPool::release(uint8_t* buffer, uint32_t sizeClass)
+{
+	mutex.lock();
+	if (freeBuffers[sizeClass].size() < maxFree) {
+		freeBuffers[sizeClass].push_back(buffer);
+		buffer = NULL;
+	}
+	mutex.unlock();
+	delete[] buffer;
+}
+
+void BufferPool::Releaser::operator()(uint8_t* buffer) const
+{
+	pool->release(buffer, sizeClass);
+}
+
+uint64_t BufferPool::getAllocatedBuffers()
+{
+	return statAllocated;
+}
+
+uint64_t BufferPool::getRecycledBuffers()
+{
+	return statRecycled;
+}
@@ -0,0 +1,77 @@
+/*
+ * Vermont Buffer Pool
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef BUFFERPOOL_H_
+#define BUFFERPOOL_H_
+
+#include "Mutex.h"
+
+#include <stdint.h>
+#include <vector>
+#include <boost/smart_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+/**
+ * recycles byte buffers, e.g. for received messages which are referenced by records
+ * for an unknown time
+ *
+ * Buffers are handed out as boost::shared_array and are put back into the pool when
+ * their last reference is released, which may happen in any thread. Requested sizes
+ * are rounded up to the next power of two (at least 2^MIN_BITS), at most maxFree unused
+ * buffers are kept for each size. Larger buffers than 2^MAX_BITS are not recycled.
+ * The pool must be owned by a boost::shared_ptr, buffers keep it alive until they
+ * have been returned.
+ */
+class BufferPool : public boost::enable_shared_from_this<BufferPool>
+{
+public:
+	BufferPool(uint32_t maxFree = 1024);
+	~BufferPool();
+
+	boost::shared_array<uint8_t> allocate(uint32_t size);
+
+	uint64_t getAllocatedBuffers();
+	uint64_t getRecycledBuffers();
+
+private:
+	static const uint32_t MIN_BITS = 8;
+	static const uint32_t MAX_BITS = 16;
+	static const uint32_t CLASSES = MAX_BITS-MIN_BITS+1;
+
+	/**
+	 * deleter of handed out buffers
+	 */
+	struct Releaser {
+		boost::shared_ptr<BufferPool> pool;
+		uint32_t sizeClass;
+
+		void operator()(uint8_t* buffer) const;
+	};
+
+	Mutex mutex;
+	std::vector<uint8_t*> freeBuffers[CLASSES];
+	uint32_t maxFree;
+	uint64_t statAllocated; /**< number of buffers which had to be allocated */
+	uint64_t statRecycled; /**< number of buffers which were taken from the pool */
+
+	void release(uint8_t* buffer, uint32_t sizeClass);
+};
+
+#endif /*BUFFERPOOL_H_*/
@@ -14,15 +14,39 @@
 
 #include <queue>
 #include <string>
+#include <vector>
 #include "Mutex.h"
 #include "TimeoutSemaphore.h"
+#include "LockFreeQueue.h"
 #include "msg.h"
 
+/**
+ * releases an element which could not be pushed, elements without reference counting are left alone
+ */
+template<class T>
+inline auto releaseQueueElement(T t, int) -> decltype(t->removeReference(), void())
+{
+	t->removeReference();
+}
+
+template<class T>
+inline void releaseQueueElement(T, long)
+{
+}
+
 template<class T>
 class ConcurrentQueue
 {
 	private:
 
+	/**
+	 * releases the elements of batch from index first on, which were not pushed
+	 */
+	inline void releaseFrom(const std::vector<T>& batch, size_t first)
+	{
+		for (size_t i = first; i < batch.size(); i++) releaseQueueElement(batch[i], 0);
+	}
+
 	inline bool do_pop(T* res)
 	{
 		lock.lock();
@@ -39,23 +63,59 @@ class ConcurrentQueue
 		return true;
 	}
 
+	/**
+	 * removes up to max elements from the queue and appends them to res
+	 * the caller must already hold one element of popSemaphore, the
+	 * remaining ones are acquired without blocking
+	 */
+	inline void do_popBatch(std::vector<T>& res, size_t max)
+	{
+		size_t n = 1;
+		while (n < max && popSemaphore.tryWait()) n++;
+
+		lock.lock();
+		for (size_t i = 0; i < n; i++) {
+			res.push_back(queue.front());
+			queue.pop();
+		}
+		poppedCount += n;
+		count -= n;
+		lock.unlock();
+
+		pushSemaphore.post(n);
+
+		DPRINTF_DEBUG( "(%s) %zu elements popped", ownerName.c_str(), n);
+	}
+
 	public:
 		/**
 		 * default queue size
 		 */
 		static const int DEFAULT_QUEUE_SIZE = 1000;
 
-		ConcurrentQueue(int maxEntries = DEFAULT_QUEUE_SIZE) 
-			: pushedCount(0), poppedCount(0), queue(), count(0), lock(), popSemaphore(), pushSemaphore(maxEntries)
+		/**
+		 * LOCKED: std::queue protected by a mutex, any number of producers and consumers
+		 * SPSC:   lock-free ring for exactly one producer and one consumer thread
+		 * MPSC:   lock-free ring for several producers and one consumer thread
+		 * the ring capacity is maxEntries rounded up to the next power of two
+		 */
+		enum Implementation { LOCKED, SPSC, MPSC };
+
+		ConcurrentQueue(int maxEntries = DEFAULT_QUEUE_SIZE, Implementation impl = LOCKED)
+			: pushedCount(0), poppedCount(0), queue(), count(0), lock(), popSemaphore(), pushSemaphore(maxEntries), ring(NULL)
 		{
 			this->maxEntries = maxEntries;
+			if (impl != LOCKED) {
+				ring = new LockFreeQueue<T>(maxEntries, impl == MPSC);
+			}
 		};
 
 		~ConcurrentQueue()
 		{
-			if(count != 0) {
-				msg(LOG_INFO, "WARNING: freeing non-empty queue - got count: %d", count);
+			if(getCount() != 0) {
+				msg(LOG_INFO, "WARNING: freeing non-empty queue - got count: %d", getCount());
 			}
+			delete ring;
 		};
 
 		void setOwner(std::string name)
@@ -65,6 +125,11 @@ class ConcurrentQueue
 
 		inline void push(T t)
 		{
+			if (ring) {
+				ring->push(t);
+				return;
+			}
+
 			DPRINTF_DEBUG( "(%s) trying to push element (%d elements in queue)", ownerName.c_str(), count);
 #if defined(DEBUG)
 			bool waiting = false;
@@ -91,8 +156,49 @@ class ConcurrentQueue
 			DPRINTF_DEBUG( "(%s) element pushed (%d elements in queue)", ownerName.c_str(), maxEntries-pushSemaphore.getCount());
 		};
 
+		/**
+		 * pushes all elements of batch with one lock operation per chunk of free slots
+		 * blocks while the queue is full, like push()
+		 * the elements stay in batch, it is the caller's job to clear it
+		 * elements which cannot be pushed because the program is shut down are released
+		 */
+		inline void pushBatch(const std::vector<T>& batch)
+		{
+			if (ring) {
+				releaseFrom(batch, ring->pushBatch(batch));
+				return;
+			}
+
+			size_t pushed = 0;
+			while (pushed < batch.size()) {
+				// block for the first free slot only, never wait while holding
+				// reserved slots so that concurrent producers cannot deadlock
+				if (!pushSemaphore.wait()) {
+					DPRINTF_INFO("(%s) failed to push %zu elements, program is being shut down?", ownerName.c_str(), batch.size()-pushed);
+					releaseFrom(batch, pushed);
+					return;
+				}
+				size_t n = 1;
+				while (pushed + n < batch.size() && pushSemaphore.tryWait()) n++;
+
+				lock.lock();
+				for (size_t i = 0; i < n; i++) {
+					queue.push(batch[pushed+i]);
+				}
+				pushedCount += n;
+				count += n;
+				lock.unlock();
+
+				popSemaphore.post(n);
+				pushed += n;
+			}
+			DPRINTF_DEBUG( "(%s) %zu elements pushed", ownerName.c_str(), batch.size());
+		}
+
 		inline bool pop(T* res)
 		{
+			if (ring) return ring->pop(res);
+
 			if (!popSemaphore.wait()) {
 				return false;
 			}
@@ -104,6 +210,12 @@ class ConcurrentQueue
 		// of the timeout has been reached, res will be set to NULL and false will be returned
 		inline bool pop(long timeout_ms, T *res)
 		{
+			if (ring) {
+				struct timespec timeout;
+				addToCurTime(&timeout, timeout_ms);
+				return ring->pop(res, &timeout);
+			}
+
 			if(!popSemaphore.wait(timeout_ms)) {
 				return false;
 			}
@@ -114,6 +226,12 @@ class ConcurrentQueue
 		// use this instead of the above, makes things easier!
 		inline bool popAbs(const struct timespec& timeout, T *res)
 		{
+			if (ring) {
+				if (ring->pop(res, &timeout)) return true;
+				*res = 0;
+				return false;
+			}
+
 			if (popSemaphore.waitAbs(timeout)) {
 				return do_pop(res);
 			}
@@ -124,8 +242,36 @@ class ConcurrentQueue
 			}
 		}
 
+		/**
+		 * pops up to max elements into res, waits until at least one element is available
+		 * @returns false if the queue was shut down
+		 */
+		inline bool popBatch(std::vector<T>& res, size_t max)
+		{
+			if (ring) return ring->popBatch(res, max);
+
+			if (!popSemaphore.wait()) {
+				return false;
+			}
+			do_popBatch(res, max);
+			return true;
+		}
+
+		// like popBatch above, but gives up at the absolute time timeout
+		inline bool popBatchAbs(const struct timespec& timeout, std::vector<T>& res, size_t max)
+		{
+			if (ring) return ring->popBatch(res, max, &timeout);
+
+			if (!popSemaphore.waitAbs(timeout)) {
+				return false;
+			}
+			do_popBatch(res, max);
+			return true;
+		}
+
 		inline int getCount() const
 		{
+			if (ring) return ring->getCount();
 			return count;
 		};
 		
@@ -137,6 +283,7 @@ class ConcurrentQueue
 		 */
 		void notifyShutdown() 
 		{
+			if (ring) ring->notifyShutdown();
 			popSemaphore.notifyShutdown();
 			pushSemaphore.notifyShutdown();
 		}
@@ -147,10 +294,12 @@ class ConcurrentQueue
 		 */
 		void restart()
 		{
+			if (ring) ring->restart();
 			popSemaphore.restart();
 			pushSemaphore.restart();
 		}
 
+		// only maintained by the LOCKED implementation
 		int pushedCount;
 		int poppedCount;
 		int maxEntries;
@@ -162,6 +311,7 @@ class ConcurrentQueue
 		TimeoutSemaphore popSemaphore;
 		TimeoutSemaphore pushSemaphore;
 		std::string ownerName;
+		LockFreeQueue<T>* ring; /**< used instead of queue if not NULL */
 };
 
 #endif
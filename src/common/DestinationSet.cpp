@@ -0,0 +1,195 @@
+/*
+ * Vermont host state tables
+ * Copyright (C) 2014 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "DestinationSet.h"
+
+#include <math.h>
+
+
+DestinationSet::DestinationSet()
+	: count(0),
+	  hasZero(false),
+	  registerSum(0),
+	  zeroRegisters(0)
+{
+}
+
+/**
+ * 64 bit finalizer of MurmurHash3, distributes all bits of the address
+ */
+uint64_t DestinationSet::mix(uint32_t addr)
+{
+	uint64_t h = addr;
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/**
+ * adds address to the set
+ * @returns true if the address was not contained before. Once the number of addresses is
+ * estimated, true is returned as long as fewer addresses were reported as new than estimated,
+ * so that the number of addresses counted by callers follows size().
+ */
+bool DestinationSet::insert(uint32_t addr)
+{
+	if (!registers.empty()) {
+		sketchInsert(addr);
+		if (count >= size()) return false;
+		count++;
+		return true;
+	}
+
+	if (table.empty()) {
+		for (uint32_t i = 0; i < count; i++) {
+			if (small[i] == addr) return false;
+		}
+		if (count < SMALL_SIZE) {
+			small[count++] = addr;
+			return true;
+		}
+		// switch to hash set
+		table.assign(4*SMALL_SIZE, 0);
+		uint32_t n = count;
+		count = 0;
+		for (uint32_t i = 0; i < n; i++) tableInsert(small[i]);
+	}
+
+	if (!tableInsert(addr)) return false;
+	if (count <= MAX_EXACT) return true;
+
+	// switch to HyperLogLog, count keeps the number of addresses reported so far
+	registers.assign(1 << HLL_BITS, 0);
+	registerSum = registers.size();
+	zeroRegisters = registers.size();
+	for (uint32_t i = 0; i < table.size(); i++) {
+		if (table[i]) sketchInsert(table[i]);
+	}
+	if (hasZero) sketchInsert(0);
+	std::vector<uint32_t>().swap(table);
+	hasZero = false;
+	return true;
+}
+
+bool DestinationSet::tableInsert(uint32_t addr)
+{
+	if (addr == 0) {
+		if (hasZero) return false;
+		hasZero = true;
+		count++;
+		return true;
+	}
+	uint32_t mask = table.size()-1;
+	uint32_t s = (uint32_t)mix(addr) & mask;
+	while (table[s]) {
+		if (table[s] == addr) return false;
+		s = (s+1) & mask;
+	}
+	table[s] = addr;
+	count++;
+	if (count*2 > table.size()) growTable();
+	return true;
+}
+
+void DestinationSet::growTable()
+{
+	std::vector<uint32_t> old;
+	old.swap(table);
+	table.assign(old.size()*2, 0);
+	uint32_t mask = table.size()-1;
+	for (uint32_t i = 0; i < old.size(); i++) {
+		if (!old[i]) continue;
+		uint32_t s = (uint32_t)mix(old[i]) & mask;
+		while (table[s]) s = (s+1) & mask;
+		table[s] = old[i];
+	}
+}
+
+/**
+ * updates the register selected by the first HLL_BITS bits of the hash with the
+ * position of the first set bit in the remaining bits
+ */
+void DestinationSet::sketchInsert(uint32_t addr)
+{
+	uint64_t h = mix(addr);
+	uint32_t index = h >> (64-HLL_BITS);
+	uint64_t rest = (h << HLL_BITS) | ((uint64_t)1 << (HLL_BITS-1));
+	uint8_t rank = __builtin_clzll(rest)+1;
+	if (rank <= registers[index]) return;
+	if (registers[index] == 0) zeroRegisters--;
+	registerSum += ldexp(1.0, -rank)-ldexp(1.0, -registers[index]);
+	registers[index] = rank;
+}
+
+/**
+ * @returns number of addresses, estimated if isExact() returns false
+ */
+uint32_t DestinationSet::size() const
+{
+	if (registers.empty()) return count;
+
+	const double m = 1 << HLL_BITS;
+	double estimate = 0.7213/(1+1.079/m)*m*m/registerSum;
+	if (estimate <= 2.5*m && zeroRegisters > 0) {
+		// linear counting for small cardinalities
+		estimate = m*log(m/zeroRegisters);
+	}
+	return (uint32_t)(estimate+0.5);
+}
+
+/**
+ * @returns true if addresses are stored exactly and can be enumerated
+ */
+bool DestinationSet::isExact() const
+{
+	return registers.empty();
+}
+
+/**
+ * appends all addresses to result, nothing is added if the set is not exact any more
+ */
+void DestinationSet::getAddresses(std::vector<uint32_t>& result) const
+{
+	if (!registers.empty()) return;
+	if (table.empty()) {
+		result.insert(result.end(), small, small+count);
+		return;
+	}
+	if (hasZero) result.push_back(0);
+	for (uint32_t i = 0; i < table.size(); i++) {
+		if (table[i]) result.push_back(table[i]);
+	}
+}
+
+/**
+ * removes all addresses and releases memory of hash set or sketch
+ */
+void DestinationSet::clear()
+{
+	count = 0;
+	hasZero = false;
+	registerSum = 0;
+	zeroRegisters = 0;
+	std::vector<uint32_t>().swap(table);
+	std::vector<uint8_t>().swap(registers);
+}
@@ -0,0 +1,66 @@
+/*
+ * Vermont host state tables
+ * Copyright (C) 2014 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef DESTINATIONSET_H_
+#define DESTINATIONSET_H_
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * set of IPv4 addresses contacted by a host
+ *
+ * The representation grows with the number of addresses:
+ *  - up to SMALL_SIZE addresses are stored inline in an array
+ *  - up to MAX_EXACT addresses are stored in an open-addressed hash set
+ *  - beyond that, the number of addresses is estimated with a HyperLogLog sketch of
+ *    2^HLL_BITS registers (standard error about 3%), addresses cannot be enumerated any more
+ */
+class DestinationSet
+{
+public:
+	static const uint32_t SMALL_SIZE = 4;
+	static const uint32_t MAX_EXACT = 4096;
+	static const uint32_t HLL_BITS = 10;
+
+	DestinationSet();
+
+	bool insert(uint32_t addr);
+	uint32_t size() const;
+	bool isExact() const;
+	void getAddresses(std::vector<uint32_t>& result) const;
+	void clear();
+
+private:
+	uint32_t count; /**< number of addresses while exact, afterwards number of addresses insert() reported as new */
+	uint32_t small[SMALL_SIZE];
+	std::vector<uint32_t> table; /**< hash set, 0 marks empty slots */
+	bool hasZero; /**< address 0 is contained in hash set */
+	std::vector<uint8_t> registers; /**< HyperLogLog registers */
+	double registerSum; /**< sum of 2^-register over all registers */
+	uint32_t zeroRegisters; /**< number of registers which are 0 */
+
+	static uint64_t mix(uint32_t addr);
+	bool tableInsert(uint32_t addr);
+	void sketchInsert(uint32_t addr);
+	void growTable();
+};
+
+#endif /*DESTINATIONSET_H_*/
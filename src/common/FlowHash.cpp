@@ -0,0 +1,270 @@
+/*
+ * Vermont Flow Hashing
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "FlowHash.h"
+
+#include "crc.hpp"
+#include "msg.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define FLOWHASH_HAVE_SSE42_CODE
+#endif
+
+
+FlowHash::FlowHash(Engine engine)
+	: engine(engine)
+{
+	switch (engine) {
+		case CRC32:
+			func = hashCRC32;
+			break;
+		case CRC32C:
+			func = isCRC32CAccelerated() ? hashCRC32CSSE42 : hashCRC32CSoft;
+			break;
+		case MIX64:
+			func = hashMix64;
+			break;
+		case XXHASH:
+			func = hashXX;
+			break;
+		default:
+			THROWEXCEPTION("FlowHash: unknown hash engine %d", engine);
+	}
+}
+
+FlowHash::Engine FlowHash::getEngine() const
+{
+	return engine;
+}
+
+std::string FlowHash::getDescription() const
+{
+	switch (engine) {
+		case CRC32:
+			return "crc32";
+		case CRC32C:
+			return func == hashCRC32CSSE42 ? "crc32c (SSE4.2)" : "crc32c (software)";
+		case MIX64:
+			return "mix64";
+		case XXHASH:
+			return "xxhash";
+	}
+	return "unknown";
+}
+
+/**
+ * converts name of hash function as used in configuration to engine
+ */
+FlowHash::Engine FlowHash::parseEngine(const std::string& name)
+{
+	if (name == "crc32") return CRC32;
+	if (name == "crc32c") return CRC32C;
+	if (name == "mix64") return MIX64;
+	if (name == "xxhash") return XXHASH;
+	THROWEXCEPTION("unknown hash function '%s', use one of crc32, crc32c, mix64, xxhash", name.c_str());
+	return DEFAULT_ENGINE;
+}
+
+/**
+ * @returns true if the CPU supports the SSE4.2 crc32 instruction
+ */
+bool FlowHash::isCRC32CAccelerated()
+{
+#if defined(FLOWHASH_HAVE_SSE42_CODE)
+	static bool supported = __builtin_cpu_supports("sse4.2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+static inline uint32_t rotl32(uint32_t x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+uint32_t FlowHash::hashCRC32(const void* data, uint32_t length)
+{
+	return crc32(0xAAAAAAAA, length, data);
+}
+
+namespace {
+	/**
+	 * lookup table for CRC32C (polynomial 0x1EDC6F41, reflected 0x82F63B78)
+	 */
+	struct CRC32CTable {
+		uint32_t entry[256];
+
+		CRC32CTable()
+		{
+			for (uint32_t i = 0; i < 256; i++) {
+				uint32_t crc = i;
+				for (int j = 0; j < 8; j++) {
+					crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : (crc >> 1);
+				}
+				entry[i] = crc;
+			}
+		}
+	};
+}
+
+uint32_t FlowHash::hashCRC32CSoft(const void* data, uint32_t length)
+{
+	static const CRC32CTable table;
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+	uint32_t crc = ~0U;
+	while (length--) {
+		crc = table.entry[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+#if defined(FLOWHASH_HAVE_SSE42_CODE)
+__attribute__((target("sse4.2")))
+uint32_t FlowHash::hashCRC32CSSE42(const void* data, uint32_t length)
+{
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+	uint32_t crc = ~0U;
+#if defined(__x86_64__)
+	uint64_t crc64 = crc;
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, p, sizeof(word));
+		crc64 = _mm_crc32_u64(crc64, word);
+		p += 8;
+		length -= 8;
+	}
+	crc = (uint32_t)crc64;
+#endif
+	while (length >= 4) {
+		uint32_t word;
+		memcpy(&word, p, sizeof(word));
+		crc = _mm_crc32_u32(crc, word);
+		p += 4;
+		length -= 4;
+	}
+	while (length--) {
+		crc = _mm_crc32_u8(crc, *p++);
+	}
+	return ~crc;
+}
+#else
+uint32_t FlowHash::hashCRC32CSSE42(const void* data, uint32_t length)
+{
+	return hashCRC32CSoft(data, length);
+}
+#endif
+
+uint32_t FlowHash::hashMix64(const void* data, uint32_t length)
+{
+	uint64_t h = hash64(data, length);
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+/**
+ * 64 bit variant of MIX64, different seeds yield independent hash functions
+ */
+uint64_t FlowHash::hash64(const void* data, uint32_t length, uint64_t seed)
+{
+	static const uint64_t M1 = 0x87C37B91114253D5ULL;
+	static const uint64_t M2 = 0x4CF5AD432745937FULL;
+
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+	uint64_t h = 0x9E3779B97F4A7C15ULL ^ (length * 0xC2B2AE3D27D4EB4FULL) ^ seed;
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, p, sizeof(word));
+		h ^= rotl64(word * M1, 31) * M2;
+		h = rotl64(h, 27) * 5 + 0x52DCE729;
+		p += 8;
+		length -= 8;
+	}
+	if (length > 0) {
+		uint64_t word = 0;
+		memcpy(&word, p, length);
+		h ^= rotl64(word * M1, 31) * M2;
+	}
+
+	// final avalanche (MurmurHash3 fmix64)
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+uint32_t FlowHash::hashXX(const void* data, uint32_t length)
+{
+	static const uint32_t P1 = 2654435761U;
+	static const uint32_t P2 = 2246822519U;
+	static const uint32_t P3 = 3266489917U;
+	static const uint32_t P4 = 668265263U;
+	static const uint32_t P5 = 374761393U;
+
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+	uint32_t total = length;
+	uint32_t h;
+	uint32_t word;
+
+	if (length >= 16) {
+		uint32_t v1 = P1 + P2;
+		uint32_t v2 = P2;
+		uint32_t v3 = 0;
+		uint32_t v4 = 0 - P1;
+		while (length >= 16) {
+			memcpy(&word, p, 4); v1 = rotl32(v1 + word * P2, 13) * P1;
+			memcpy(&word, p+4, 4); v2 = rotl32(v2 + word * P2, 13) * P1;
+			memcpy(&word, p+8, 4); v3 = rotl32(v3 + word * P2, 13) * P1;
+			memcpy(&word, p+12, 4); v4 = rotl32(v4 + word * P2, 13) * P1;
+			p += 16;
+			length -= 16;
+		}
+		h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+	} else {
+		h = P5;
+	}
+
+	h += total;
+	while (length >= 4) {
+		memcpy(&word, p, 4);
+		h = rotl32(h + word * P3, 17) * P4;
+		p += 4;
+		length -= 4;
+	}
+	while (length--) {
+		h = rotl32(h + (*p++) * P5, 11) * P1;
+	}
+
+	h ^= h >> 15;
+	h *= P2;
+	h ^= h >> 13;
+	h *= P3;
+	h ^= h >> 16;
+	return h;
+}
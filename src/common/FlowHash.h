@@ -0,0 +1,74 @@
+/*
+ * Vermont Flow Hashing
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef FLOWHASH_H_
+#define FLOWHASH_H_
+
+#include <stdint.h>
+#include <string>
+
+/**
+ * hash functions for flow keys of variable length
+ *
+ * The implementation is chosen once during construction, so that hash() is a single
+ * indirect call. CRC32C uses the SSE4.2 crc32 instruction if the CPU supports it,
+ * else a table-driven software version with identical results.
+ */
+class FlowHash
+{
+public:
+	enum Engine {
+		CRC32,	/**< table-driven CRC32 as in common/crc.hpp, processes one byte per step */
+		CRC32C,	/**< CRC32C (Castagnoli), processes 8 bytes per instruction with SSE4.2 */
+		MIX64,	/**< multiply and xor-shift of 64 bit words with final avalanche */
+		XXHASH	/**< xxHash32 */
+	};
+
+	static const Engine DEFAULT_ENGINE = CRC32C;
+
+	FlowHash(Engine engine = DEFAULT_ENGINE);
+
+	inline uint32_t hash(const void* data, uint32_t length) const
+	{
+		return func(data, length);
+	}
+
+	Engine getEngine() const;
+	std::string getDescription() const;
+
+	static uint64_t hash64(const void* data, uint32_t length, uint64_t seed = 0);
+
+	static Engine parseEngine(const std::string& name);
+	static bool isCRC32CAccelerated();
+
+private:
+	typedef uint32_t (*HashFunc)(const void* data, uint32_t length);
+
+	Engine engine;
+	HashFunc func;
+
+	static uint32_t hashCRC32(const void* data, uint32_t length);
+	static uint32_t hashCRC32CSoft(const void* data, uint32_t length);
+	static uint32_t hashCRC32CSSE42(const void* data, uint32_t length);
+	static uint32_t hashMix64(const void* data, uint32_t length);
+	static uint32_t hashXX(const void* data, uint32_t length);
+};
+
+#endif /*FLOWHASH_H_*/
@@ -0,0 +1,235 @@
+/*
+ * Vermont host state tables
+ * Copyright (C) 2014 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef HOSTTABLE_H_
+#define HOSTTABLE_H_
+
+#include <stdint.h>
+#include <vector>
+#include <utility>
+
+/**
+ * hash table which maps IPv4 addresses to per-host state of analysis modules
+ *
+ * Entries are stored densely in insertion order, an open-addressed slot array with
+ * linear probing maps addresses to entries. A slot contains address and entry index,
+ * so lookups only touch the slot array until the entry is found. Erased slots are
+ * filled by shifting back following slots, erased entries by moving the last entry,
+ * so no tombstones are needed and iteration only visits used entries.
+ * The slot array is doubled when it gets filled to three quarters.
+ *
+ * sweep() visits a bounded number of entries per call, so modules can remove expired
+ * hosts incrementally instead of iterating over the whole table at once.
+ *
+ * Attention: references and pointers to entries are invalidated by get() if a new
+ * entry is created, by erase() and by sweep().
+ */
+template <typename T>
+class HostTable
+{
+public:
+	struct Entry {
+		uint32_t key; /**< IPv4 address as used by the caller */
+		T data;
+	};
+
+	/** number of entries visited by sweep() if not specified otherwise */
+	static const uint32_t SWEEP_STEP = 64;
+
+	/**
+	 * @param bits log2 of initial number of slots
+	 */
+	HostTable(uint32_t bits = 10)
+		: sweepPos(0)
+	{
+		if (bits < 4) bits = 4;
+		if (bits > 31) bits = 31;
+		resize(bits);
+	}
+
+	/**
+	 * @returns data of host with given address, NULL if there is none
+	 */
+	T* find(uint32_t key)
+	{
+		uint32_t s = findSlot(key);
+		if (!slots[s].index) return NULL;
+		return &entries[slots[s].index-1].data;
+	}
+
+	/**
+	 * returns data of host with given address, a default constructed entry is created if there is none
+	 * @param created is set to true if entry was created
+	 */
+	T& get(uint32_t key, bool* created = NULL)
+	{
+		uint32_t s = findSlot(key);
+		if (slots[s].index) {
+			if (created) *created = false;
+			return entries[slots[s].index-1].data;
+		}
+		if ((entries.size()+1)*4 > slots.size()*3) {
+			resize(bits+1);
+			s = findSlot(key);
+		}
+		entries.push_back(Entry());
+		entries.back().key = key;
+		slots[s].key = key;
+		slots[s].index = entries.size();
+		if (created) *created = true;
+		return entries.back().data;
+	}
+
+	/**
+	 * removes host with given address
+	 * @returns false if there was no such entry
+	 */
+	bool erase(uint32_t key)
+	{
+		uint32_t s = findSlot(key);
+		if (!slots[s].index) return false;
+		removeAt(s);
+		return true;
+	}
+
+	void clear()
+	{
+		entries.clear();
+		for (typename std::vector<Slot>::iterator it = slots.begin(); it != slots.end(); it++) it->index = 0;
+		sweepPos = 0;
+	}
+
+	uint32_t size() const
+	{
+		return entries.size();
+	}
+
+	/**
+	 * @returns entry with given index (0 <= index < size()), used for iteration
+	 */
+	Entry& at(uint32_t index)
+	{
+		return entries[index];
+	}
+
+	const Entry& at(uint32_t index) const
+	{
+		return entries[index];
+	}
+
+	/**
+	 * visits the next entries of the current sweep over the table
+	 * @param maxEntries maximum number of entries to visit
+	 * @param visit functor called as visit(key, data), entry is erased if it returns true
+	 * @returns true if all entries were visited and a new sweep is started with the next call
+	 */
+	template <class Visitor>
+	bool sweep(uint32_t maxEntries, Visitor visit)
+	{
+		for (uint32_t n = 0; n < maxEntries && sweepPos < entries.size(); n++) {
+			Entry& e = entries[sweepPos];
+			if (visit(e.key, e.data)) {
+				// last entry is moved to sweepPos and visited next
+				removeAt(findSlot(e.key));
+			} else {
+				sweepPos++;
+			}
+		}
+		if (sweepPos < entries.size()) return false;
+		sweepPos = 0;
+		return true;
+	}
+
+private:
+	struct Slot {
+		uint32_t key;
+		uint32_t index; /**< index of entry + 1, 0 marks an empty slot */
+	};
+
+	std::vector<Slot> slots;
+	std::vector<Entry> entries;
+	uint32_t bits;
+	uint32_t mask;
+	uint32_t sweepPos; /**< next entry visited by sweep() */
+
+	inline uint32_t home(uint32_t key) const
+	{
+		// multiplicative hashing, upper bits of the product depend on all bits of the address
+		return (uint32_t)(((uint64_t)key*0x9E3779B97F4A7C15ULL) >> (64-bits));
+	}
+
+	/**
+	 * @returns slot containing key, or the empty slot where it would be inserted
+	 */
+	inline uint32_t findSlot(uint32_t key) const
+	{
+		uint32_t s = home(key);
+		while (slots[s].index && slots[s].key != key) s = (s+1) & mask;
+		return s;
+	}
+
+	void resize(uint32_t newbits)
+	{
+		bits = newbits;
+		mask = (1U << bits)-1;
+		Slot empty;
+		empty.key = 0;
+		empty.index = 0;
+		slots.assign(mask+1, empty);
+		for (uint32_t i = 0; i < entries.size(); i++) {
+			uint32_t s = findSlot(entries[i].key);
+			slots[s].key = entries[i].key;
+			slots[s].index = i+1;
+		}
+	}
+
+	/**
+	 * erases entry referenced by slot s
+	 */
+	void removeAt(uint32_t s)
+	{
+		uint32_t index = slots[s].index-1;
+
+		// shift back following slots which would not be found any more
+		uint32_t hole = s;
+		uint32_t j = s;
+		while (true) {
+			j = (j+1) & mask;
+			if (!slots[j].index) break;
+			uint32_t h = home(slots[j].key);
+			// move slot j if its home is not cyclically in (hole, j]
+			if (((j-h) & mask) >= ((j-hole) & mask)) {
+				slots[hole] = slots[j];
+				hole = j;
+			}
+		}
+		slots[hole].index = 0;
+
+		// fill gap in entries with the last one
+		uint32_t last = entries.size()-1;
+		if (index != last) {
+			entries[index] = std::move(entries[last]);
+			slots[findSlot(entries[index].key)].index = index+1;
+		}
+		entries.pop_back();
+	}
+};
+
+#endif /*HOSTTABLE_H_*/
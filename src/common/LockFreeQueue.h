@@ -0,0 +1,351 @@
+/*
+ * Vermont Lock-free Queue
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <pthread.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include "msg.h"
+#include "Time.h"
+
+#define CACHE_LINE_SIZE 64
+
+/**
+ * lets threads sleep until some condition on lock-free data might have changed
+ * the mutex is only touched if a thread actually sleeps, so notify() is a
+ * memory fence plus a load as long as nobody waits
+ *
+ * usage by a waiting thread:
+ *   key = prepareWait(); if (condition) cancelWait(); else wait(key, timeout);
+ * usage by a notifying thread:
+ *   make condition true; notify();
+ */
+class EventCount
+{
+public:
+	EventCount() : epoch(0), waiters(0)
+	{
+		pthread_mutex_init(&mutex, 0);
+		pthread_cond_init(&cond, 0);
+	}
+
+	~EventCount()
+	{
+		pthread_cond_destroy(&cond);
+		pthread_mutex_destroy(&mutex);
+	}
+
+	inline uint32_t prepareWait()
+	{
+		waiters.fetch_add(1, std::memory_order_seq_cst);
+		return epoch.load(std::memory_order_seq_cst);
+	}
+
+	inline void cancelWait()
+	{
+		waiters.fetch_sub(1, std::memory_order_seq_cst);
+	}
+
+	/**
+	 * sleeps until notify() was called after prepareWait() returned key,
+	 * or until the absolute time abstime has been reached
+	 */
+	void wait(uint32_t key, const struct timespec& abstime)
+	{
+		pthread_mutex_lock(&mutex);
+		int retval = 0;
+		while (epoch.load(std::memory_order_relaxed) == key && retval != ETIMEDOUT) {
+			retval = pthread_cond_timedwait(&cond, &mutex, &abstime);
+		}
+		pthread_mutex_unlock(&mutex);
+		waiters.fetch_sub(1, std::memory_order_seq_cst);
+	}
+
+	inline void notify()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiters.load(std::memory_order_relaxed) == 0) return;
+		notifyAll();
+	}
+
+	void notifyAll()
+	{
+		pthread_mutex_lock(&mutex);
+		epoch.fetch_add(1, std::memory_order_seq_cst);
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&mutex);
+	}
+
+private:
+	std::atomic<uint32_t> epoch;
+	std::atomic<int32_t> waiters;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+
+/**
+ * bounded lock-free queue for a single consumer thread and either one (SPSC)
+ * or several (MPSC) producer threads
+ *
+ * Elements are stored in a ring of cells carrying sequence numbers (D. Vyukov's
+ * bounded queue), so producers and the consumer never write to the same cache
+ * line except for the cell they hand over. With a single producer the tail is
+ * advanced without compare-and-swap.
+ * Threads waiting for a free cell or an element first spin for an adaptive
+ * number of rounds and then sleep on an EventCount, so the blocking and
+ * shutdown behaviour equals ConcurrentQueue.
+ * The capacity is maxEntries rounded up to the next power of two.
+ */
+template<class T>
+class LockFreeQueue
+{
+public:
+	LockFreeQueue(uint32_t maxEntries, bool multiProducer)
+		: multiProducer(multiProducer), exitFlag(false), producerSpin(MIN_SPIN), consumerSpin(MIN_SPIN)
+	{
+		capacity = 2;
+		while (capacity < maxEntries) capacity <<= 1;
+		mask = capacity - 1;
+
+		cells = new Cell[capacity];
+		for (size_t i = 0; i < capacity; i++) {
+			cells[i].seq.store(i, std::memory_order_relaxed);
+		}
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+	}
+
+	~LockFreeQueue()
+	{
+		delete[] cells;
+	}
+
+	inline bool push(T t)
+	{
+		while (!tryPush(t)) {
+			if (!await(notFull, producerSpin, [this]() { return !full(); }, NULL)) {
+				DPRINTF_INFO("failed to push element, program is being shut down?");
+				return false;
+			}
+		}
+		notEmpty.notify();
+		return true;
+	}
+
+	/**
+	 * pushes all elements, the consumer is notified once per run of free cells
+	 * @returns number of pushed elements, less than batch.size() if the program is shut down
+	 */
+	inline size_t pushBatch(const std::vector<T>& batch)
+	{
+		size_t pushed = 0;
+		while (pushed < batch.size()) {
+			while (pushed < batch.size() && tryPush(batch[pushed])) pushed++;
+			notEmpty.notify();
+			if (pushed == batch.size()) break;
+
+			if (!await(notFull, producerSpin, [this]() { return !full(); }, NULL)) {
+				DPRINTF_INFO("failed to push %zu elements, program is being shut down?", batch.size()-pushed);
+				return pushed;
+			}
+		}
+		return pushed;
+	}
+
+	/**
+	 * waits until an element is available, or until abstime if given
+	 */
+	inline bool pop(T* res, const struct timespec* abstime = NULL)
+	{
+		while (!tryPop(res)) {
+			if (!await(notEmpty, consumerSpin, [this]() { return !empty(); }, abstime))
+				return false;
+		}
+		notFull.notify();
+		return true;
+	}
+
+	inline bool popBatch(std::vector<T>& res, size_t max, const struct timespec* abstime = NULL)
+	{
+		T element;
+		if (!pop(&element, abstime)) return false;
+		res.push_back(element);
+		while (res.size() < max && tryPop(&element)) {
+			res.push_back(element);
+		}
+		notFull.notify();
+		return true;
+	}
+
+	inline int getCount() const
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		size_t h = head.load(std::memory_order_relaxed);
+		return (t > h) ? (int)(t - h) : 0;
+	}
+
+	void notifyShutdown()
+	{
+		exitFlag.store(true, std::memory_order_seq_cst);
+		notEmpty.notifyAll();
+		notFull.notifyAll();
+	}
+
+	void restart()
+	{
+		exitFlag.store(false, std::memory_order_seq_cst);
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> seq;
+		T data;
+	};
+
+	static const uint32_t MIN_SPIN = 16;
+	static const uint32_t MAX_SPIN = 4096;
+	static const int STANDARD_TIMEOUT = 100; // ms between checks of exitFlag while sleeping
+
+	// members written by producers, consumer and both are kept on separate cache lines
+	char pad0[CACHE_LINE_SIZE];
+	std::atomic<size_t> tail;
+	char pad1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> head;
+	char pad2[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+
+	Cell* cells;
+	size_t capacity;
+	size_t mask;
+	bool multiProducer;
+	std::atomic<bool> exitFlag;
+	std::atomic<uint32_t> producerSpin;
+	std::atomic<uint32_t> consumerSpin;
+	EventCount notEmpty;
+	EventCount notFull;
+
+	inline bool tryPush(const T& t)
+	{
+		size_t pos = tail.load(std::memory_order_relaxed);
+		Cell* cell;
+		while (true) {
+			cell = &cells[pos & mask];
+			intptr_t dif = (intptr_t)cell->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+			if (dif < 0) return false; // queue is full
+			if (dif == 0) {
+				if (!multiProducer) {
+					tail.store(pos + 1, std::memory_order_relaxed);
+					break;
+				}
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else {
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+		cell->data = t;
+		cell->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	inline bool tryPop(T* res)
+	{
+		size_t pos = head.load(std::memory_order_relaxed);
+		Cell* cell = &cells[pos & mask];
+		if (cell->seq.load(std::memory_order_acquire) != pos + 1)
+			return false; // queue is empty (or element is not yet completely written)
+		*res = cell->data;
+		cell->seq.store(pos + capacity, std::memory_order_release);
+		head.store(pos + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	inline bool empty() const
+	{
+		size_t pos = head.load(std::memory_order_relaxed);
+		return cells[pos & mask].seq.load(std::memory_order_acquire) != pos + 1;
+	}
+
+	inline bool full() const
+	{
+		size_t pos = tail.load(std::memory_order_relaxed);
+		return (intptr_t)cells[pos & mask].seq.load(std::memory_order_acquire) - (intptr_t)pos < 0;
+	}
+
+	static inline void cpuRelax()
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		__builtin_ia32_pause();
+#else
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+	}
+
+	/**
+	 * waits until ready() returns true: spins first, then sleeps on event
+	 * spinLimit grows when spinning was successful and shrinks when we had to sleep
+	 * @returns false on shutdown or if abstime has been reached
+	 */
+	template<typename Predicate>
+	bool await(EventCount& event, std::atomic<uint32_t>& spinLimit, Predicate ready, const struct timespec* abstime)
+	{
+		if (exitFlag.load(std::memory_order_relaxed)) return false;
+
+		uint32_t spins = spinLimit.load(std::memory_order_relaxed);
+		for (uint32_t i = 0; i < spins; i++) {
+			if (ready()) {
+				if (spins < MAX_SPIN) spinLimit.store(spins * 2, std::memory_order_relaxed);
+				return true;
+			}
+			cpuRelax();
+		}
+		if (spins > MIN_SPIN) spinLimit.store(spins / 2, std::memory_order_relaxed);
+
+		while (true) {
+			uint32_t key = event.prepareWait();
+			if (ready()) {
+				event.cancelWait();
+				return true;
+			}
+			if (exitFlag.load(std::memory_order_relaxed)) {
+				event.cancelWait();
+				return false;
+			}
+
+			struct timespec deadline;
+			addToCurTime(&deadline, STANDARD_TIMEOUT);
+			bool last = false;
+			if (abstime && compareTime(*abstime, deadline) <= 0) {
+				deadline = *abstime;
+				last = true;
+			}
+			event.wait(key, deadline);
+
+			if (last) return ready();
+		}
+	}
+};
+
+#endif
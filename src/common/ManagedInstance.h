@@ -24,6 +24,8 @@
 #include "common/msg.h"
 #include "core/InstanceManager.h"
 
+#include <atomic>
+
 /**
  * represents an instance which can be managed by ResourceManager
  * this class does not have much functionality, whole management process
@@ -36,7 +38,7 @@ class ManagedInstance
 
 	private:
 		InstanceManager<T>* myInstanceManager;
-		volatile int32_t referenceCount;
+		std::atomic<int32_t> referenceCount; /**< modified by InstanceManager from several threads */
 #if defined(DEBUG)
         bool deletedByManager;
 #endif
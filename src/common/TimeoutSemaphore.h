@@ -207,6 +207,30 @@ public:
 	}
 
 
+	/**
+	 * decreases the semaphore's value by 1 if this is possible without blocking
+	 * @returns true if the semaphore was acquired
+	 */
+	inline bool tryWait()
+	{
+		if (exitFlag) return false;
+#ifdef __APPLE__
+		return sem_timedwait_mach(sem, 0) == 0;
+#else
+		return sem_trywait(sem) == 0;
+#endif
+	}
+
+	/**
+	 * increases the semaphore's value by count
+	 */
+	inline void post(int count)
+	{
+		for (int i = 0; i < count; i++) {
+			post();
+		}
+	}
+
 	/**
 	 * increases the semaphore's value by 1
 	 */
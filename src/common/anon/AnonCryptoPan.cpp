@@ -28,6 +28,7 @@
 AnonCryptoPan::AnonCryptoPan (char* _key)
 : cryptopan ((const UINT8*)_key)
 {
+	msg(LOG_INFO, "CryptoPan: using %s implementation of AES", cryptopan.usesAesNi() ? "AES-NI" : "software");
 }
 
 AnonCryptoPan::~AnonCryptoPan ()
@@ -22,7 +22,7 @@ void AgeArray::resize(size_t size)
 {
 	free(array);
 	array_size = size;
-	array = (agetime_t*)malloc(size*sizeof(agetime_t));
+	array = (agetime_t*)allocFilterStorage(size*sizeof(agetime_t));
 	clear();
 }
 
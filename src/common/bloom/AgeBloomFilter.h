@@ -40,6 +40,7 @@ class AgeArray {
 		}
 
 		typedef agetime_t ValueType;
+		static const size_t CELLS_PER_LINE = 64/sizeof(ValueType);
 
 		void resize(size_t size);
 		void clear();
@@ -35,7 +35,7 @@ void Bitmap::resize(size_t size)
     free(bitmap);
     len_bits = size;
     len_octets = (size+7)/8;
-    bitmap = (uint8_t*)(malloc(len_octets));
+    bitmap = (uint8_t*)allocFilterStorage(len_octets);
     memset(bitmap, 0, len_octets);
 }
 
@@ -71,26 +71,27 @@ std::ostream & operator<< (std::ostream & os, const Bitmap & b)
 }
 
 void BloomFilter::set(const uint8_t* input, size_t len, bool) 
+{
+    set(hash(input, len));
+}
+
+void BloomFilter::set(const BloomHash& h)
 {
     for(unsigned i=0; i < hfList->len; i++) {
-    	if (CMS_)
-            filter_[0].set(hashU(input, len, filterSize(), hfList->seed[i]));
-	else 
-	    filter_[i].set(hashU(input, len, filterSize(), hfList->seed[i]));
+	filter(i).set(index(h, i));
     }
 }
 
 bool BloomFilter::get(const uint8_t* input, size_t len) const
+{
+    return get(hash(input, len));
+}
+
+bool BloomFilter::get(const BloomHash& h) const
 {
     for(unsigned i=0; i < hfList->len; i++) {
-        if (CMS_) {
-	    if (filter_[0].get(hashU(input, len, filterSize(), hfList->seed[i])) == false)
-	        return false;
-        } else {
-            if (filter_[i].get(hashU(input, len, filterSize(), hfList->seed[i])) == false)
-	        return false;
-	}
+	if (filter(i).get(index(h, i)) == false)
+	    return false;
     }
     return true;
 }
-
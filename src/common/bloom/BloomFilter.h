@@ -40,6 +40,7 @@ class Bitmap {
 	}
 
 	typedef bool ValueType;
+	static const size_t CELLS_PER_LINE = 512;
 
 	void resize(size_t size);
 	void clear();
@@ -62,12 +63,15 @@ class BloomFilter : public BloomFilterBase<Bitmap>
     friend std::ostream & operator << (std::ostream &, const BloomFilter &);
 
     public:
-	BloomFilter(HashParams* hashParams, size_t size, bool CMS = true) : BloomFilterBase<Bitmap>(hashParams, size, CMS) {}
+	BloomFilter(HashParams* hashParams, size_t size, bool CMS = true, BloomFilterLayout layout = BLOOM_LAYOUT_STANDARD)
+		: BloomFilterBase<Bitmap>(hashParams, size, CMS, layout) {}
 
 	virtual ~BloomFilter() {}
 
 	virtual bool get(const uint8_t* input, size_t len) const;
 	virtual void set(const uint8_t* input, size_t len, bool v = true);
+	bool get(const BloomHash& h) const;
+	void set(const BloomHash& h);
 };
 
 #endif // _BLOOMFILTER_H_
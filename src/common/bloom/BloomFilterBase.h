@@ -19,15 +19,14 @@
 #ifndef _BLOOMFILTER_BASE_H_
 #define _BLOOMFILTER_BASE_H_
 
-#ifdef HAVE_GSL
-#include <gsl/gsl_rng.h>
-#endif
-
 #include <stdint.h>
+#include <stdlib.h>
 #include <cstring>
 #include <ctime>
+#include <new>
 
 #include <modules/packet/Packet.h>
+#include <common/FlowHash.h>
 
 /* GenericKey class holding uint8_t* input for BloomFilter hash functions */
 template<unsigned size> class GenericKey
@@ -143,6 +142,17 @@ class QuintupleKey
 		}
 };
 
+/**
+ * allocates storage of filters aligned to cache lines
+ */
+inline void* allocFilterStorage(size_t size)
+{
+	void* p;
+	if (posix_memalign(&p, 64, size > 0 ? size : 64) != 0)
+		throw std::bad_alloc();
+	return p;
+}
+
 struct HashParams
 {
 	HashParams(size_t l, unsigned startSeed = time(0)) : len(l) {
@@ -160,6 +170,25 @@ struct HashParams
 	uint32_t* seed;
 };
 
+/**
+ * hash value of a key, all positions of the key in a filter are derived from it
+ * (double hashing as described by Kirsch and Mitzenmacher)
+ */
+struct BloomHash
+{
+	uint32_t h1;
+	uint32_t h2;
+};
+
+/**
+ * arrangement of the positions of a key in a filter
+ */
+enum BloomFilterLayout
+{
+	BLOOM_LAYOUT_STANDARD, /**< positions are spread over the whole filter */
+	BLOOM_LAYOUT_BLOCKED /**< all positions of a key are in the same cache line of a single filter */
+};
+
 /**
  * BloomFilterBase provides hash functions for filters and is the interface for all type of 
  * BloomFilters. The class needs a template parameter which has to provide the following
@@ -169,27 +198,43 @@ struct HashParams
  * public:
  * 	MyT(size_t size);
  *	typedef ValueType myDesiredType;
+ *	static const size_t CELLS_PER_LINE; // number of values in a cache line
+ *	void resize(size_t size); // storage must be aligned to cache lines
  *	void clear();
- *	myDesiredType get(uint8_t* data, size_t len);
- *	void set(uint8_t* data, size_t len, myDesiredType value);
+ *	myDesiredType get(size_t index);
+ *	void set(size_t index, myDesiredType value);
  * }
+ *
+ * A key is hashed once with a 64 bit hash function, its upper and lower half are combined
+ * to the positions of the i-th hash function as h1 + i*h2. Filters which share the same
+ * HashParams also share hash values, so a value computed with hash() can be used to access
+ * all of them.
+ * In the blocked layout only one filter is used and a key is mapped to a single cache line
+ * of it, which saves cache misses at the price of a somewhat higher false positive rate.
  */
 template <class T>
 class BloomFilterBase
 {
 	public:
-		BloomFilterBase(HashParams* hashParams, unsigned filterSize, bool CMS = true) : hfList(hashParams),
-			filterSize_(filterSize), CMS_(CMS)
+		BloomFilterBase(HashParams* hashParams, unsigned filterSize, bool CMS = true,
+				BloomFilterLayout layout = BLOOM_LAYOUT_STANDARD)
+			: hfList(hashParams), filterSize_(filterSize), CMS_(CMS || layout == BLOOM_LAYOUT_BLOCKED),
+			  layout_(layout)
 		{
-#ifdef HAVE_GSL
-			r = gsl_rng_alloc (gsl_rng_fishman18);
-#endif
 			if (CMS_) {
 				filterCount_ = 1;
 			} else {
 				filterCount_ = hashParams->len;
 			}
 
+			if (layout_ == BLOOM_LAYOUT_BLOCKED) {
+				blockCount_ = (filterSize_+T::CELLS_PER_LINE-1)/T::CELLS_PER_LINE;
+				if (blockCount_ == 0) blockCount_ = 1;
+				filterSize_ = blockCount_*T::CELLS_PER_LINE;
+			} else {
+				blockCount_ = 0;
+			}
+
 			filter_ = new T[filterCount_];
 			for (unsigned i = 0; i != filterCount_; ++i) {
 				filter_[i].resize(filterSize_);
@@ -200,9 +245,6 @@ class BloomFilterBase
 
 		virtual ~BloomFilterBase()
 		{
-#ifdef HAVE_GSL
-			gsl_rng_free(r);
-#endif
 			delete[] filter_;
 		}
 
@@ -213,36 +255,44 @@ class BloomFilterBase
 			return filterSize_;
 		}
 
+		BloomFilterLayout layout() const {
+			return layout_;
+		}
+
+		BloomHash hash(const uint8_t* input, size_t len) const
+		{
+			uint64_t h = FlowHash::hash64(input, len, hfList->len > 0 ? hfList->seed[0] : 0);
+			BloomHash result;
+			result.h1 = (uint32_t)h;
+			result.h2 = (uint32_t)(h >> 32);
+			return result;
+		}
+
 
 	protected:
 
-#ifdef HAVE_GSL
-		uint32_t hashU(const uint8_t* input, uint16_t len, uint32_t max, uint32_t seed) const
+		/**
+		 * @returns position of the key in the filter of the i-th hash function
+		 */
+		inline size_t index(const BloomHash& h, unsigned i) const
 		{
-			uint32_t result = 0;
-			gsl_rng_set(r, seed);
-			for (unsigned i = 0; i < len; i++) {
-				result += input[i] * gsl_rng_get(r);
+			// 32 bit values are mapped to [0, n) by multiplication instead of the slower modulo
+			if (layout_ == BLOOM_LAYOUT_BLOCKED) {
+				// CELLS_PER_LINE is a power of two, so odd steps yield distinct cells
+				uint32_t step = (h.h2 >> 16) | 1;
+				size_t block = ((uint64_t)h.h1*blockCount_) >> 32;
+				return block*T::CELLS_PER_LINE + ((h.h2 + i*step) & (T::CELLS_PER_LINE-1));
 			}
-			return result % max;
-		}
-#else
-		uint32_t hashU(const uint8_t* input, uint16_t len, uint32_t max, uint32_t seed) const
-		{
-			// TODO: create a function that does not need gsl
-			return 0;
+			uint32_t x = h.h1 + i*h.h2;
+			return ((uint64_t)x*filterSize_) >> 32;
 		}
-#endif
 
-		int32_t ggT(uint32_t m, uint32_t n)
+		/**
+		 * @returns the filter used for the i-th hash function
+		 */
+		inline T& filter(unsigned i) const
 		{
-			uint32_t z;
-			while (n>0) {
-				z=n;
-				n=m%n;
-				m=z;
-			}
-			return m;
+			return filter_[CMS_ ? 0 : i];
 		}
 
 		void clear()
@@ -252,16 +302,14 @@ class BloomFilterBase
 			}
 		}
 
-#ifdef HAVE_GSL
-		gsl_rng * r;
-#endif
-
 		const HashParams* hfList;
 
 		size_t filterSize_;
 		T* filter_;
 		size_t filterCount_;
 		bool CMS_;
+		BloomFilterLayout layout_;
+		size_t blockCount_;
 };
 
 #endif
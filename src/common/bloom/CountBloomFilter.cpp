@@ -22,7 +22,7 @@ void CountArray::resize(size_t size)
 {
 	free(array);
 	array_size = size;
-	array = (ValueType*)(malloc(size*sizeof(ValueType)));
+	array = (ValueType*)allocFilterStorage(size*sizeof(ValueType));
 	clear();
 }
 
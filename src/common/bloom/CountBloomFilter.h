@@ -35,6 +35,7 @@ class CountArray {
 		}
 
 		typedef int ValueType;
+		static const size_t CELLS_PER_LINE = 64/sizeof(ValueType);
 
 		void resize(size_t size);
 		void clear();
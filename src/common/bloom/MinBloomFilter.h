@@ -32,25 +32,26 @@ template <class T>
 class MinBloomFilter : public BloomFilterBase<T>
 {
 	public:
-		MinBloomFilter(HashParams* hashParams, size_t filterSize, bool CMS = true)
-			: BloomFilterBase<T>(hashParams, filterSize, CMS) {}
+		MinBloomFilter(HashParams* hashParams, size_t filterSize, bool CMS = true,
+				BloomFilterLayout layout = BLOOM_LAYOUT_STANDARD)
+			: BloomFilterBase<T>(hashParams, filterSize, CMS, layout) {}
 
 		virtual ~MinBloomFilter() {}
 
 
 		virtual typename T::ValueType  get(const uint8_t* input, size_t len) const {
+			return get(BloomFilterBase<T>::hash(input, len));
+		}
+
+		virtual void set(const uint8_t* input, size_t len, typename T::ValueType v) {
+			set(BloomFilterBase<T>::hash(input, len), v);
+		}
+
+		typename T::ValueType get(const BloomHash& h) const {
 			typename T::ValueType  ret = INT_MAX;
 			typename T::ValueType  current;
 			for(unsigned i=0; i != BloomFilterBase<T>::hfList->len; i++) {   
-				if (BloomFilterBase<T>::CMS_) {
-					current = BloomFilterBase<T>::filter_[0].get(
-						BloomFilterBase<T>::hashU(input, len, 
-							BloomFilterBase<T>::filterSize(), BloomFilterBase<T>::hfList->seed[i]));
-				} else {
-					current = BloomFilterBase<T>::filter_[i].get(
-						BloomFilterBase<T>::hashU(input, len,
-							BloomFilterBase<T>::filterSize(), BloomFilterBase<T>::hfList->seed[i]));
-				}
+				current = BloomFilterBase<T>::filter(i).get(BloomFilterBase<T>::index(h, i));
 				if (current < ret)
 					ret = current;
 			}
@@ -58,18 +59,10 @@ class MinBloomFilter : public BloomFilterBase<T>
 			return ret;
 		}
 
-		virtual void set(const uint8_t* input, size_t len, typename T::ValueType v) {
+		void set(const BloomHash& h, typename T::ValueType v) {
 			//msg(LOG_INFO, "MinBloomFilter.set(): %i", v);
 			for(unsigned i=0; i != BloomFilterBase<T>::hfList->len; i++) {
-				if (BloomFilterBase<T>::CMS_) {
-					BloomFilterBase<T>::filter_[0].set(BloomFilterBase<T>::hashU(input, len,
-						BloomFilterBase<T>::filterSize(), 
-						BloomFilterBase<T>::hfList->seed[i]), v);
-				} else {
-					BloomFilterBase<T>::filter_[i].set(BloomFilterBase<T>::hashU(input, len,
-						BloomFilterBase<T>::filterSize(), 
-						BloomFilterBase<T>::hfList->seed[i]), v);
-				}
+				BloomFilterBase<T>::filter(i).set(BloomFilterBase<T>::index(h, i), v);
 			}
 		}
 };
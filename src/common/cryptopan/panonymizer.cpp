@@ -10,37 +10,127 @@
 #include <string.h>
 #include "panonymizer.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PANONYMIZER_AESNI
+#include <cpuid.h>
+#include <wmmintrin.h>
+#endif
+
+#ifdef PANONYMIZER_AESNI
+//AES-NI helpers, compiled for the aes target only and called only if the CPU supports it
+static bool cpuSupportsAesNi() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    return (ecx & bit_AES) != 0;
+}
+
+__attribute__((target("aes,sse2")))
+static inline __m128i aesniExpandStep(__m128i key, __m128i keygened) {
+    keygened = _mm_shuffle_epi32(keygened, _MM_SHUFFLE(3,3,3,3));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, keygened);
+}
+
+#define AESNI_EXPAND(i, rcon) \
+    rk[i] = aesniExpandStep(rk[i-1], _mm_aeskeygenassist_si128(rk[i-1], rcon))
+
+//AES-128 key expansion, equivalent to Rijndael::init with Key16Bytes
+__attribute__((target("aes,sse2")))
+static void aesniExpandKey(const UINT8 * key, UINT8 * roundKeys) {
+    __m128i rk[11];
+    rk[0] = _mm_loadu_si128((const __m128i*) key);
+    AESNI_EXPAND(1, 0x01);
+    AESNI_EXPAND(2, 0x02);
+    AESNI_EXPAND(3, 0x04);
+    AESNI_EXPAND(4, 0x08);
+    AESNI_EXPAND(5, 0x10);
+    AESNI_EXPAND(6, 0x20);
+    AESNI_EXPAND(7, 0x40);
+    AESNI_EXPAND(8, 0x80);
+    AESNI_EXPAND(9, 0x1b);
+    AESNI_EXPAND(10, 0x36);
+    for (int i = 0; i < 11; i++) {
+	_mm_storeu_si128((__m128i*) (roundKeys + 16*i), rk[i]);
+    }
+}
+
+//Encrypts count blocks at once, the rounds of all blocks are interleaved so that they
+//run in parallel in the pipeline. Only the first byte of each output block is returned.
+__attribute__((target("aes,sse2")))
+static void aesniEncryptFirstBytes(const UINT8 * roundKeys, UINT8 blocks[][16], int count, UINT8 * firstBytes) {
+    __m128i rk[11];
+    __m128i state[32];
+    for (int r = 0; r < 11; r++) {
+	rk[r] = _mm_loadu_si128((const __m128i*) (roundKeys + 16*r));
+    }
+    for (int i = 0; i < count; i++) {
+	state[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i*) blocks[i]), rk[0]);
+    }
+    for (int r = 1; r < 10; r++) {
+	for (int i = 0; i < count; i++) {
+	    state[i] = _mm_aesenc_si128(state[i], rk[r]);
+	}
+    }
+    for (int i = 0; i < count; i++) {
+	state[i] = _mm_aesenclast_si128(state[i], rk[10]);
+	firstBytes[i] = (UINT8) _mm_cvtsi128_si32(state[i]);
+    }
+}
+#endif
+
 //Constructor
-PAnonymizer::PAnonymizer(const UINT8 * key) {
+PAnonymizer::PAnonymizer(const UINT8 * key, bool allowAesNi)
+    : m_aesni(false),
+      m_prefixPad(1<<16),
+      m_prefixValid((1<<16)/32, 0),
+      m_cache(1<<CACHE_BITS) {
   //initialize the 128-bit secret key.
   memcpy(m_key, key, 16);
   //initialize the Rijndael cipher. 
   m_rin.init(Rijndael::ECB, Rijndael::Encrypt, key, Rijndael::Key16Bytes);
   //initialize the 128-bit secret pad. The pad is encrypted before being used for padding.
   m_rin.blockEncrypt(key + 16, 128, m_pad);  
+
+  memset(m_roundKeys, 0, sizeof(m_roundKeys));
+#ifdef PANONYMIZER_AESNI
+  if (allowAesNi && cpuSupportsAesNi()) {
+    aesniExpandKey(m_key, m_roundKeys);
+    m_aesni = true;
+  }
+#endif
+  for (size_t i = 0; i < m_cache.size(); i++) {
+    m_cache[i].valid = false;
+  }
 }
 
 //Destructor
 PAnonymizer::~PAnonymizer() {
 }
 
-//Anonymization funtion
-UINT32 PAnonymizer::anonymize(const UINT32 orig_addr) {
-    UINT8 rin_output[16];
-    UINT8 rin_input[16];
+bool PAnonymizer::usesAesNi() const {
+    return m_aesni;
+}
+
+//Computes the bits of the pseudorandom one-time-pad for the prefix lengths from..31
+UINT32 PAnonymizer::computePad(const UINT32 orig_addr, int from) {
+    UINT8 rin_input[32][16];
+    UINT8 first_bytes[32];
 
     UINT32 result = 0;
     UINT32 first4bytes_pad, first4bytes_input;
     int pos;
 
-    memcpy(rin_input, m_pad, 16);
     first4bytes_pad = (((UINT32) m_pad[0]) << 24) + (((UINT32) m_pad[1]) << 16) +
 	(((UINT32) m_pad[2]) << 8) + (UINT32) m_pad[3]; 
 
     // For each prefixes with length from 0 to 31, generate a bit using the Rijndael cipher,
     // which is used as a pseudorandom function here. The bits generated in every rounds
     // are combineed into a pseudorandom one-time-pad.
-    for (pos = 0; pos <= 31 ; pos++) { 
+    for (pos = from; pos <= 31 ; pos++) { 
+	UINT8 * input = rin_input[pos-from];
+	memcpy(input, m_pad, 16);
 
 	//Padding: The most significant pos bits are taken from orig_addr. The other 128-pos 
         //bits are taken from m_pad. The variables first4bytes_pad and first4bytes_input are used
@@ -51,18 +141,54 @@ UINT32 PAnonymizer::anonymize(const UINT32 orig_addr) {
 	else {
 	  first4bytes_input = ((orig_addr >> (32-pos)) << (32-pos)) | ((first4bytes_pad<<pos) >> pos);
 	}
-	rin_input[0] = (UINT8) (first4bytes_input >> 24);
-	rin_input[1] = (UINT8) ((first4bytes_input << 8) >> 24);
-	rin_input[2] = (UINT8) ((first4bytes_input << 16) >> 24);
-	rin_input[3] = (UINT8) ((first4bytes_input << 24) >> 24);
+	input[0] = (UINT8) (first4bytes_input >> 24);
+	input[1] = (UINT8) ((first4bytes_input << 8) >> 24);
+	input[2] = (UINT8) ((first4bytes_input << 16) >> 24);
+	input[3] = (UINT8) ((first4bytes_input << 24) >> 24);
+    }
+
+    //Encryption: The Rijndael cipher is used as pseudorandom function. During each 
+    //round, only the first bit of rin_output is used.
+#ifdef PANONYMIZER_AESNI
+    if (m_aesni) {
+	aesniEncryptFirstBytes(m_roundKeys, rin_input, 32-from, first_bytes);
+    } else
+#endif
+    {
+	UINT8 rin_output[16];
+	for (pos = from; pos <= 31; pos++) {
+	    m_rin.blockEncrypt(rin_input[pos-from], 128, rin_output);
+	    first_bytes[pos-from] = rin_output[0];
+	}
+    }
+
+    //Combination: the bits are combined into a pseudorandom one-time-pad
+    for (pos = from; pos <= 31; pos++) {
+	result |=  (first_bytes[pos-from] >> 7) << (31-pos);
+    }
+    return result;
+}
 
-	//Encryption: The Rijndael cipher is used as pseudorandom function. During each 
-	//round, only the first bit of rin_output is used.
-	m_rin.blockEncrypt(rin_input, 128, rin_output);	
+//Anonymization funtion
+UINT32 PAnonymizer::anonymize(const UINT32 orig_addr) {
+    CacheEntry & entry = m_cache[(orig_addr * 2654435761U) >> (32-CACHE_BITS)];
+    if (entry.valid && entry.addr == orig_addr) {
+	return entry.result;
+    }
 
-	//Combination: the bits are combined into a pseudorandom one-time-pad
-	result |=  (rin_output[0] >> 7) << (31-pos);
+    UINT32 prefix = orig_addr >> 16;
+    UINT32 pad;
+    if (m_prefixValid[prefix/32] & (1U << (prefix%32))) {
+	pad = ((UINT32) m_prefixPad[prefix] << 16) | computePad(orig_addr, 16);
+    } else {
+	pad = computePad(orig_addr, 0);
+	m_prefixPad[prefix] = (UINT16) (pad >> 16);
+	m_prefixValid[prefix/32] |= 1U << (prefix%32);
     }
+
     //XOR the orginal address with the pseudorandom one-time-pad
-    return result ^ orig_addr;
+    entry.addr = orig_addr;
+    entry.result = pad ^ orig_addr;
+    entry.valid = true;
+    return entry.result;
 }
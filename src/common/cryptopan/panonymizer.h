@@ -6,6 +6,7 @@
 #ifndef _PANONYMIZER_H_
 #define _PANONYMIZER_H_
 
+#include <vector>
 #include "rijndael.h"
 
 class PAnonymizer { //Prefix-preserving anonymizer
@@ -13,15 +14,36 @@ class PAnonymizer { //Prefix-preserving anonymizer
     // Contructor need a 256-bit key
     // The first 128 bits of the key are used as the secret key for rijndael cipher
     // The second 128 bits of the key are used as the secret pad for padding
-    PAnonymizer(const UINT8 * key);
+    // AES-NI instructions are used if allowAesNi is set and the CPU supports them
+    PAnonymizer(const UINT8 * key, bool allowAesNi = true);
     ~PAnonymizer();
  protected:
     UINT8 m_key[16]; //128 bit secret key
     UINT8 m_pad[16]; //128 bit secret pad
     Rijndael m_rin;  //Rijndael cipher as pseudorandom function
+    bool m_aesni;    //use AES-NI instead of m_rin
+    UINT8 m_roundKeys[11*16]; //expanded key for AES-NI
+
+    // The pseudorandom bit for prefix length pos only depends on the first pos bits of the
+    // address, so the first 16 bits of the one-time-pad are the same for all addresses with
+    // the same first 16 bits. They are computed once per prefix and kept in m_prefixPad.
+    // Results for complete addresses are kept in a direct mapped cache.
+    // Both caches depend on the key and are therefore members of each instance.
+    static const UINT32 CACHE_BITS = 12;
+    struct CacheEntry {
+	UINT32 addr;
+	UINT32 result;
+	bool valid;
+    };
+    std::vector<UINT16> m_prefixPad;   //first 16 bits of one-time-pad, indexed by first 16 bits of address
+    std::vector<UINT32> m_prefixValid; //bitmap of valid entries in m_prefixPad
+    std::vector<CacheEntry> m_cache;
+
+    UINT32 computePad(const UINT32 orig_addr, int from);
 
  public:
-    UINT32 anonymize( const UINT32 orig_addr);   
+    UINT32 anonymize( const UINT32 orig_addr);
+    bool usesAesNi() const;
 };
 
 #endif //_PANONYMIZER_H_ 
@@ -86,6 +86,18 @@
  */
 #define IS_DEFAULT_SCTP_RECONNECTINTERVAL 30
 
+/**
+ * defines how many IPFIX messages IpfixExporter sends to an UDP collector with
+ * one system call. 0 disables batching.
+ */
+#define IS_DEFAULT_UDPBATCHSIZE 0
+
+/**
+ * defines in milliseconds, how long IpfixExporter may delay IPFIX messages to
+ * UDP collectors for batching
+ */
+#define IS_DEFAULT_UDPBATCHDELAY 10
+
 /**
  * defines interval in seconds, how often IpfixExporter resends an IPFIX template
  */
@@ -39,6 +39,10 @@
  jan@petranek.de
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* sendmmsg() */
+#endif
+
 #include "ipfixlolib.h"
 #include "ipfixlolib_private.h"
 #include "encoding.h"
@@ -81,6 +85,7 @@ static int ipfix_find_template(ipfix_exporter *exporter, uint16_t template_id);
 static int ipfix_init_sendbuffer(export_protocol_version export_protocol, ipfix_sendbuffer **sendbufn);
 static int ipfix_reset_sendbuffer(ipfix_sendbuffer *sendbuf);
 static int ipfix_deinit_sendbuffer(ipfix_sendbuffer **sendbuf);
+static void ipfix_release_copied_entry(ipfix_sendbuffer *sendbuf, struct iovec *entry);
 static int ipfix_init_collector_array(ipfix_receiving_collector **col, int col_capacity);
 static void remove_collector(ipfix_receiving_collector *collector);
 static int ipfix_deinit_collector_array(ipfix_receiving_collector **col);
@@ -91,6 +96,8 @@ static int ipfix_deinit_template_array(ipfix_exporter *exporter);
 static int ipfix_update_template_sendbuffer(ipfix_exporter *exporter);
 static int ipfix_send_templates(ipfix_exporter* exporter);
 static int ipfix_send_data(ipfix_exporter* exporter);
+static int ipfix_udp_batch_queue(ipfix_exporter *exporter, int collector_index, int *message);
+static bool ipfix_udp_batch_expired(ipfix_udp_batch *batch);
 static int ipfix_new_file(ipfix_receiving_collector* recvcoll);
 static int get_mtu(const int s);
 static int ipfix_enterprise_flag_set(uint16_t id);
@@ -99,6 +106,9 @@ static int ipfix_enterprise_flag_set(uint16_t id);
  * \brief Should be called on a regular basis.
  */
 int ipfix_beat(ipfix_exporter *exporter) {
+    if (exporter->udp_batch && ipfix_udp_batch_expired(exporter->udp_batch)) {
+	ipfix_flush(exporter);
+    }
 #ifdef SUPPORT_DTLS
     return ipfix_dtls_advance_connections(exporter);
 #else
@@ -397,6 +407,7 @@ int ipfix_init_exporter(export_protocol_version export_protocol, uint32_t observ
 	tmp->max_message_size = IPFIX_MTU_CONSERVATIVE_DEFAULT;
 
         tmp->collector_max_num = 0;
+        tmp->udp_batch = NULL;
 #ifdef SUPPORT_DTLS
 	ipfix_init_dtls_certificate(&tmp->certificate);
 #endif
@@ -474,8 +485,12 @@ out:
 int ipfix_deinit_exporter(ipfix_exporter **exporter_p) {
         ipfix_exporter *exporter = *exporter_p;
         // Cleanup processes
-        // close sockets etc.
-        // (currently, nothing to do)
+        // send messages which are still queued
+        ipfix_flush(exporter);
+        if (exporter->udp_batch) {
+                free(exporter->udp_batch->sets);
+                free(exporter->udp_batch);
+        }
 
         // free all children
 
@@ -905,6 +920,8 @@ static void remove_collector(ipfix_receiving_collector *collector) {
  */
 int ipfix_remove_collector(ipfix_exporter *exporter, const char *coll_ip_addr, uint16_t coll_port) {
     int i;
+    // the slot of the collector must not keep any queued messages
+    ipfix_flush(exporter);
     for(i=0;i<exporter->collector_max_num;i++) {
 	ipfix_receiving_collector *collector = &exporter->collector_arr[i];
 	if( ( strcmp( collector->ipaddress, coll_ip_addr) == 0 )
@@ -1155,6 +1172,8 @@ static int ipfix_init_sendbuffer(export_protocol_version export_protocol, ipfix_
         tmp->marker = HEADER_USED_IOVEC_COUNT;
         tmp->committed_data_length = 0;
         tmp->record_count = 0;
+        tmp->copy_buffer = NULL;
+        tmp->copy_buffer_used = 0;
 
 	// link the appropriate message header to the start of the buffer
 	switch(export_protocol) {
@@ -1200,6 +1219,7 @@ static int ipfix_reset_sendbuffer(ipfix_sendbuffer *sendbuf)
         sendbuf->marker = HEADER_USED_IOVEC_COUNT;
         sendbuf->committed_data_length = 0;
         sendbuf->record_count = 0;
+        sendbuf->copy_buffer_used = 0;
 
         memset(&(sendbuf->ipfix_message_header), 0, sizeof(ipfix_header));
         memset(&(sendbuf->nfv9_message_header), 0, sizeof(nfv9_header));
@@ -1218,6 +1238,7 @@ static int ipfix_reset_sendbuffer(ipfix_sendbuffer *sendbuf)
  */
 static int ipfix_deinit_sendbuffer(ipfix_sendbuffer **sendbuf)
 {
+        free((*sendbuf)->copy_buffer);
         // free the sendbuffer itself:
         free(*sendbuf);
         *sendbuf = NULL;
@@ -1779,6 +1800,8 @@ static int ipfix_send_templates(ipfix_exporter* exporter)
 	case UDP:
 	    if (expired && (exporter->template_sendbuffer->committed_data_length > 0)){
 		exporter->last_template_transmission_time = time_now;
+		// queued Data Sets must be sent first to keep the order of messages
+		ipfix_flush(exporter);
 		// update the sendbuffer header, as we must set the export time & sequence number!
 		ipfix_update_header(exporter, col,
 				    exporter->template_sendbuffer);
@@ -1924,18 +1947,19 @@ static void ipfix_sendbuffer_debug(ipfix_sendbuffer *sendbuffer)
 static int ipfix_send_data(ipfix_exporter* exporter)
 {
     int bytes_sent;
+    int batch_message = -1; // index of this message in the UDP batch
     // send the current data_sendbuffer if there is data
     if (exporter->data_sendbuffer->committed_data_length > 0 ) {
 	// send the sendbuffer to all collectors
 	for (int i = 0; i < exporter->collector_max_num; i++) {
 	    struct msghdr header;
 	    ipfix_receiving_collector *col = &exporter->collector_arr[i];
-	    // update the header in the sendbuffer
-	    ipfix_update_header(exporter, col, exporter->data_sendbuffer);
 	    // is the collector a valid target?
 	    if (col->state != C_CONNECTED) {
 		continue; // No. Continue to next loop iteration.
 	    }
+	    // update the header in the sendbuffer
+	    ipfix_update_header(exporter, col, exporter->data_sendbuffer);
 
 	    char vrf_log[VRF_LOG_LEN] = "";
 	    if (strlen(col->vrf_name) > 0) {
@@ -1947,6 +1971,10 @@ static int ipfix_send_data(ipfix_exporter* exporter)
 #endif
 	    switch(col->protocol){
 	    case UDP:
+		if (exporter->udp_batch) {
+		    ipfix_udp_batch_queue(exporter, i, &batch_message);
+		    break;
+		}
 		header.msg_name = &col->addr;
 		header.msg_namelen = sizeof(col->addr);
 		header.msg_iov = exporter->data_sendbuffer->entries;
@@ -2044,6 +2072,14 @@ static int ipfix_send_data(ipfix_exporter* exporter)
 	// increment sequence number
 	exporter->sequence_number += exporter->sn_increment;
 	exporter->sn_increment = 0;
+
+	if (batch_message >= 0) {
+	    ipfix_udp_batch *batch = exporter->udp_batch;
+	    batch->count++;
+	    if (batch->count >= batch->max_messages || ipfix_udp_batch_expired(batch)) {
+		ipfix_flush(exporter);
+	    }
+	}
     }  // end if
 
     // reset the sendbuffer
@@ -2052,6 +2088,193 @@ static int ipfix_send_data(ipfix_exporter* exporter)
 }
 
 
+/*
+ * Adds the Data Sets in the data sendbuffer to the UDP batch, unless this
+ * has already been done for the current message, and queues the message
+ * with its current header for the given collector.
+ * Parameters:
+ * collector_index: index of the collector in exporter->collector_arr
+ * message: index of the current message in the batch, -1 if it has not been added yet
+ * Returns 0 on success, -1 on failure
+ */
+static int ipfix_udp_batch_queue(ipfix_exporter *exporter, int collector_index, int *message)
+{
+    ipfix_udp_batch *batch = exporter->udp_batch;
+    ipfix_sendbuffer *sendbuf = exporter->data_sendbuffer;
+
+    if (*message < 0) {
+	if (batch->sets_used + sendbuf->committed_data_length > IPFIX_UDP_BATCH_BUFSIZE) {
+	    // the message is not yet queued for any collector, so its header is not affected
+	    ipfix_flush(exporter);
+	}
+	if (batch->count == 0) {
+	    gettimeofday(&batch->first_queued, NULL);
+	}
+	uint8_t *sets = batch->sets + batch->sets_used;
+	unsigned length = 0;
+	for (unsigned i = HEADER_USED_IOVEC_COUNT; i < sendbuf->committed; i++) {
+	    memcpy(sets + length, sendbuf->entries[i].iov_base, sendbuf->entries[i].iov_len);
+	    length += sendbuf->entries[i].iov_len;
+	}
+	batch->set_entries[batch->count].iov_base = sets;
+	batch->set_entries[batch->count].iov_len = length;
+	batch->sets_used += length;
+	*message = batch->count;
+    }
+
+    if (sendbuf->entries[0].iov_len > sizeof(batch->headers[0][0])) {
+	msg(LOG_ERR, "Message header too long for UDP batch");
+	return -1;
+    }
+    memcpy(&batch->headers[collector_index][*message], sendbuf->entries[0].iov_base, sendbuf->entries[0].iov_len);
+    batch->queued[collector_index][*message] = 1;
+    return 0;
+}
+
+/*
+ * Returns true if the oldest message of the UDP batch has been queued for
+ * at least the maximum delay of the batch.
+ */
+static bool ipfix_udp_batch_expired(ipfix_udp_batch *batch)
+{
+    struct timeval now;
+    if (batch->count == 0) return false;
+    gettimeofday(&now, NULL);
+    long elapsed = (now.tv_sec - batch->first_queued.tv_sec) * 1000 + (now.tv_usec - batch->first_queued.tv_usec) / 1000;
+    return elapsed >= (long)batch->max_delay;
+}
+
+/*!
+ * \brief Enable or disable batched transmission to UDP Collectors.
+ *
+ * If enabled, ipfix_send() does not transmit Data Sets to UDP Collectors
+ * immediately. Instead, the resulting IPFIX Messages are queued and sent
+ * using a single call of <tt>sendmmsg()</tt> per Collector as soon as
+ * <tt>max_messages</tt> Messages have been queued, the queue is full, or the
+ * oldest Message has been queued for <tt>max_delay</tt> milliseconds.
+ * The delay is checked whenever ipfix_send() or ipfix_beat() is called.
+ * Queued Messages are always sent before Templates are sent to UDP
+ * Collectors, so that Collectors receive the Messages in order.
+ *
+ * Messages to other Collectors are not affected.
+ *
+ * \param exporter pointer to previously initialized exporter struct
+ * \param max_messages number of Messages per batch, at most
+ * IPFIX_MAX_UDP_BATCH. Values of 0 and 1 disable batching.
+ * \param max_delay maximum time in milliseconds a Message may be queued
+ * \return 0 success
+ * \return -1 failure. Reasons include:<ul><li>memory allocation failed</li></ul>
+ * \sa ipfix_flush()
+ */
+int ipfix_set_udp_batching(ipfix_exporter *exporter, unsigned max_messages, unsigned max_delay)
+{
+    ipfix_flush(exporter);
+
+    if (max_messages <= 1) {
+	if (exporter->udp_batch) {
+	    free(exporter->udp_batch->sets);
+	    free(exporter->udp_batch);
+	    exporter->udp_batch = NULL;
+	}
+	return 0;
+    }
+    if (max_messages > IPFIX_MAX_UDP_BATCH) {
+	msg(LOG_WARNING, "UDP batch size %u too large, using %u", max_messages, IPFIX_MAX_UDP_BATCH);
+	max_messages = IPFIX_MAX_UDP_BATCH;
+    }
+
+    if (!exporter->udp_batch) {
+	ipfix_udp_batch *batch = (ipfix_udp_batch *)calloc(1, sizeof(ipfix_udp_batch));
+	if (!batch) {
+	    msg(LOG_ERR, "Failed to allocate UDP batch");
+	    return -1;
+	}
+	if (!(batch->sets = (uint8_t *)malloc(IPFIX_UDP_BATCH_BUFSIZE))) {
+	    msg(LOG_ERR, "Failed to allocate UDP batch");
+	    free(batch);
+	    return -1;
+	}
+	exporter->udp_batch = batch;
+    }
+    exporter->udp_batch->max_messages = max_messages;
+    exporter->udp_batch->max_delay = max_delay;
+    return 0;
+}
+
+/*!
+ * \brief Send all IPFIX Messages queued for UDP Collectors.
+ *
+ * Messages which fail to be sent are dropped, just like in the case of
+ * unbatched transmission.
+ *
+ * \param exporter pointer to previously initialized exporter struct
+ * \return 0 This value is <em>always</em> returned.
+ * \sa ipfix_set_udp_batching()
+ */
+int ipfix_flush(ipfix_exporter *exporter)
+{
+    ipfix_udp_batch *batch = exporter->udp_batch;
+    if (!batch || batch->count == 0) return 0;
+
+    size_t header_length = exporter->data_sendbuffer->entries[0].iov_len;
+    for (int i = 0; i < exporter->collector_max_num; i++) {
+	ipfix_receiving_collector *col = &exporter->collector_arr[i];
+	struct mmsghdr msgs[IPFIX_MAX_UDP_BATCH];
+	struct iovec iov[IPFIX_MAX_UDP_BATCH][2];
+	unsigned n = 0;
+	unsigned sent = 0;
+
+	if (col->state != C_CONNECTED || col->protocol != UDP) {
+	    continue;
+	}
+	for (unsigned m = 0; m < batch->count; m++) {
+	    if (!batch->queued[i][m]) continue;
+	    iov[n][0].iov_base = &batch->headers[i][m];
+	    iov[n][0].iov_len = header_length;
+	    iov[n][1] = batch->set_entries[m];
+	    memset(&msgs[n], 0, sizeof(msgs[n]));
+	    msgs[n].msg_hdr.msg_name = &col->addr;
+	    msgs[n].msg_hdr.msg_namelen = sizeof(col->addr);
+	    msgs[n].msg_hdr.msg_iov = iov[n];
+	    msgs[n].msg_hdr.msg_iovlen = 2;
+	    n++;
+	}
+
+	char vrf_log[VRF_LOG_LEN] = "";
+	if (strlen(col->vrf_name) > 0) {
+		snprintf(vrf_log, VRF_LOG_LEN, "[%.*s] ", IFNAMSIZ, col->vrf_name);
+	}
+
+	while (sent < n) {
+	    int ret = sendmmsg(col->data_socket, &msgs[sent], n - sent, 0);
+	    batch->syscalls++;
+	    if (ret == -1) {
+		msg(LOG_ERR, "%scould not send data to %s:%d errno: %s  (UDP)", vrf_log, col->ipaddress, col->port_number, strerror(errno));
+		if (errno == EMSGSIZE) {
+		    msg(LOG_ERR, "%sUpdating MTU estimate for collector %s:%d",
+			vrf_log,
+			col->ipaddress,
+			col->port_number);
+		    update_collector_mtu(exporter, col);
+		    if (col->state != C_CONNECTED) break;
+		}
+		// drop the message which could not be sent
+		sent++;
+		continue;
+	    }
+	    msg(LOG_DEBUG, "%s%d data messages sent to UDP collector %s:%d",
+		vrf_log, ret, col->ipaddress, col->port_number);
+	    batch->messages_sent += ret;
+	    sent += ret;
+	}
+    }
+
+    memset(batch->queued, 0, sizeof(batch->queued));
+    batch->count = 0;
+    batch->sets_used = 0;
+    return 0;
+}
+
 /*!
  * \brief Send data to Collectors.
  *
@@ -2254,6 +2477,87 @@ int ipfix_put_data_field(ipfix_exporter *exporter,void *data, unsigned length) {
     return 0;
 }
 
+/*!
+ * \brief Reserve space for a data field inside the send buffer.
+ *
+ * In contrast to ipfix_put_data_field(), the data is stored in a buffer
+ * owned by the exporter. The caller writes <tt>length</tt> bytes to the
+ * returned location before the next call to ipfix_send(). The memory
+ * the data originated from may be released immediately.
+ *
+ * If the previous field of the open data set was also added by this
+ * function, the new field is appended to the same entry, so a Data Record
+ * occupies a single entry regardless of its number of fields. Entries
+ * preceding the data field marker are never extended.
+ *
+ * The same restrictions as for ipfix_put_data_field() apply.
+ *
+ * \param exporter pointer to previously initialized exporter struct
+ * \param length number of bytes to reserve
+ * \return location to write the data field to
+ * \return NULL failure. Reasons include:<ul><li>no open data set</li><li>send
+ * buffer too small</li><li>memory allocation failed</li></ul>
+ * \sa ipfix_put_data_field_copy()
+ */
+void *ipfix_reserve_data_field(ipfix_exporter *exporter, unsigned length) {
+    ipfix_sendbuffer *dsb = exporter->data_sendbuffer;
+    struct iovec *last;
+    uint8_t *field;
+
+    if(dsb->current == dsb->committed) {
+	msg(LOG_ERR, "ipfix_reserve_data_field called but there is no started set.");
+	return NULL;
+    }
+    if (dsb->copy_buffer_used + length > IPFIX_MAX_PACKETSIZE) {
+	msg(LOG_ERR, "Copy buffer too small to handle %u bytes!\n", dsb->copy_buffer_used + length);
+	return NULL;
+    }
+    if (!dsb->copy_buffer) {
+	if (!(dsb->copy_buffer = (uint8_t *)malloc(IPFIX_MAX_PACKETSIZE))) {
+	    msg(LOG_ERR, "Failed to allocate copy buffer of sendbuffer");
+	    return NULL;
+	}
+    }
+    field = dsb->copy_buffer + dsb->copy_buffer_used;
+
+    last = &dsb->entries[dsb->current - 1];
+    if (dsb->current > dsb->marker && (uint8_t *)last->iov_base + last->iov_len == field) {
+	last->iov_len += length;
+    } else {
+	if (dsb->current >= IPFIX_MAX_SENDBUFSIZE) {
+	    msg(LOG_ERR, "Sendbuffer too small to handle  %i entries!\n", dsb->current );
+	    return NULL;
+	}
+	dsb->entries[ dsb->current ].iov_base = field;
+	dsb->entries[ dsb->current ].iov_len = length;
+	dsb->current++;
+    }
+    dsb->copy_buffer_used += length;
+    dsb->set_manager.data_length += length;
+    return field;
+}
+
+/*!
+ * \brief Add a copy of a data field to the send buffer.
+ *
+ * Like ipfix_put_data_field(), but the data is copied to the send buffer
+ * using ipfix_reserve_data_field(). Hence, it does not have to stay valid
+ * until ipfix_send() is called.
+ *
+ * \param exporter pointer to previously initialized exporter struct
+ * \param data pointer to data that should be added to the send buffer
+ * \param length length of data pointed to by <tt>data</tt>
+ * \return 0 success
+ * \return -1 failure. See ipfix_reserve_data_field()
+ * \sa ipfix_put_data_field()
+ */
+int ipfix_put_data_field_copy(ipfix_exporter *exporter, const void *data, unsigned length) {
+    void *field = ipfix_reserve_data_field(exporter, length);
+    if (!field) return -1;
+    memcpy(field, data, length);
+    return 0;
+}
+
 /*!
  * \brief Marks the end of a data set
  *
@@ -2304,6 +2608,18 @@ int ipfix_end_data_set(ipfix_exporter *exporter, uint16_t number_of_records)
 }
 
 
+/*
+ * Returns the bytes of an entry pointing into the copy buffer to it.
+ * Only the most recently added entries may be released.
+ */
+static void ipfix_release_copied_entry(ipfix_sendbuffer *sendbuf, struct iovec *entry)
+{
+	uint8_t *base = (uint8_t *)entry->iov_base;
+	if (sendbuf->copy_buffer && base >= sendbuf->copy_buffer && base < sendbuf->copy_buffer + IPFIX_MAX_PACKETSIZE) {
+		sendbuf->copy_buffer_used -= entry->iov_len;
+	}
+}
+
 /*!
  * \brief Cancel a previously started data set
  *
@@ -2339,6 +2655,7 @@ int ipfix_cancel_data_set(ipfix_exporter *exporter)
 
         // clean up entries
 	for(i=exporter->data_sendbuffer->committed; i<exporter->data_sendbuffer->current; i++) {
+	    ipfix_release_copied_entry(exporter->data_sendbuffer, &exporter->data_sendbuffer->entries[i]);
 	    exporter->data_sendbuffer->entries[i].iov_base = NULL;
 	    exporter->data_sendbuffer->entries[i].iov_len = 0;
 	}
@@ -2387,6 +2704,7 @@ int ipfix_delete_data_fields_upto_marker(ipfix_exporter *exporter)
 	    for(i=exporter->data_sendbuffer->marker; i<exporter->data_sendbuffer->current; i++) {
 		// decrease data_length
 		manager->data_length -= exporter->data_sendbuffer->entries[i].iov_len;
+		ipfix_release_copied_entry(exporter->data_sendbuffer, &exporter->data_sendbuffer->entries[i]);
 		exporter->data_sendbuffer->entries[i].iov_base = NULL;
 		exporter->data_sendbuffer->entries[i].iov_len = 0;
 	    }
@@ -81,6 +81,11 @@ See ipfixlolib.h for details on how to use this library.
     ipfix_end_data_set() are used to append Data Sets to the send buffer. Again,
     there is only a single send buffer per exporter. As soon as ipfix_send() is
     called, all Data Sets will be sent to all Collectors in parallel.
+    ipfix_put_data_field() only stores a pointer to the data, which must stay
+    valid until ipfix_send() has been called. ipfix_put_data_field_copy() and
+    ipfix_reserve_data_field() instead place the data into a buffer of the
+    send buffer, so it may be released immediately. Consecutive fields added
+    this way are sent as a single block.
     - Depending on the transport protocols used and the network infrastructure
     (e.g., the Maximum Transmission Unit (MTU)), IPFIX Messages might be
     limited to a certain length. As a result, the application has to ensure
@@ -508,8 +513,47 @@ typedef struct {
 	ipfix_set_manager set_manager; /* Only relevant when sendbuffer used
 					  for data. Not relevant if used for
 					  template sets. */
+	uint8_t *copy_buffer; /* storage of data fields added by copying
+			       * (see ipfix_reserve_data_field()), holds
+			       * IPFIX_MAX_PACKETSIZE bytes and is allocated
+			       * on first use. Consecutive copied fields of
+			       * a set share a single entry in .entries */
+	unsigned copy_buffer_used; /* number of bytes used in .copy_buffer */
 } ipfix_sendbuffer;
 
+/*
+ * maximum number of IPFIX Messages which are sent to UDP Collectors in one
+ * batch (see ipfix_set_udp_batching())
+ */
+#define IPFIX_MAX_UDP_BATCH 64
+
+/*
+ * size of the buffer holding the Data Sets of all Messages of a batch
+ */
+#define IPFIX_UDP_BATCH_BUFSIZE (256 * 1024)
+
+/*
+ * IPFIX Messages containing Data Sets which are queued for UDP Collectors.
+ * The Sets of a Message are stored once, the Message header is stored per
+ * Collector as sequence numbers may differ between Collectors.
+ */
+typedef struct {
+	unsigned max_messages; /* number of Messages which trigger transmission */
+	unsigned max_delay; /* maximum time in milliseconds a Message is delayed */
+	unsigned count; /* number of queued Messages */
+	struct timeval first_queued; /* time the oldest queued Message was added */
+	uint8_t *sets; /* Data Sets of queued Messages, IPFIX_UDP_BATCH_BUFSIZE bytes */
+	unsigned sets_used; /* number of bytes used in .sets */
+	struct iovec set_entries[IPFIX_MAX_UDP_BATCH]; /* Data Sets of each queued Message */
+	union {
+		ipfix_header ipfix;
+		nfv9_header nfv9;
+	} headers[IPFIX_MAX_COLLECTORS][IPFIX_MAX_UDP_BATCH]; /* Message headers per Collector */
+	uint8_t queued[IPFIX_MAX_COLLECTORS][IPFIX_MAX_UDP_BATCH]; /* 1 if Message is to be sent to Collector */
+	uint64_t messages_sent; /* statistics: number of Messages passed to sendmmsg() */
+	uint64_t syscalls; /* statistics: number of calls of sendmmsg() */
+} ipfix_udp_batch;
+
 /*
  * A collector receiving messages from this exporter
  */
@@ -587,6 +631,7 @@ typedef struct {
 		       * longer than that. That's a TODO */
 	ipfix_sendbuffer *template_sendbuffer;
 	ipfix_sendbuffer *sctp_template_sendbuffer;
+	ipfix_udp_batch *udp_batch; /* NULL unless batched transmission to UDP Collectors is enabled */
 	ipfix_sendbuffer *data_sendbuffer;
 	int collector_max_num; // maximum available collector
 	ipfix_receiving_collector *collector_arr; // array of (collector_max_num) collectors
@@ -630,12 +675,16 @@ int ipfix_end_template(ipfix_exporter *exporter, uint16_t template_id );
 int ipfix_start_data_set(ipfix_exporter *exporter, uint16_t template_id);
 uint16_t ipfix_get_remaining_space(ipfix_exporter *exporter);
 int ipfix_put_data_field(ipfix_exporter *exporter,void *data, unsigned length);
+void *ipfix_reserve_data_field(ipfix_exporter *exporter, unsigned length);
+int ipfix_put_data_field_copy(ipfix_exporter *exporter, const void *data, unsigned length);
 int ipfix_end_data_set(ipfix_exporter *exporter, uint16_t number_of_records);
 int ipfix_cancel_data_set(ipfix_exporter *exporter);
 int ipfix_set_data_field_marker(ipfix_exporter *exporter);
 int ipfix_delete_data_fields_upto_marker(ipfix_exporter *exporter);
 int ipfix_remove_template(ipfix_exporter *exporter, uint16_t template_id);
 int ipfix_send(ipfix_exporter *exporter);
+int ipfix_set_udp_batching(ipfix_exporter *exporter, unsigned max_messages, unsigned max_delay);
+int ipfix_flush(ipfix_exporter *exporter);
 int ipfix_set_template_transmission_timer(ipfix_exporter *exporter, uint32_t timer); 	 
 int ipfix_set_sctp_lifetime(ipfix_exporter *exporter, uint32_t lifetime);
 int ipfix_set_sctp_reconnect_timer(ipfix_exporter *exporter, uint32_t timer);
@@ -19,6 +19,9 @@
 #include <sstream>
 #include <cstring>
 #include <stdlib.h>
+#include <atomic>
+#include <vector>
+#include <algorithm>
 #include "msg.h"
 
 #ifdef __cplusplus
@@ -43,6 +46,74 @@ extern "C" {
 	// mutex for logging function
 	static pthread_mutex_t msg_mutex;
 
+	/** number of messages buffered per thread in asynchronous mode */
+	static const uint32_t MSG_RING_SIZE = 128;
+	/** maximum length of a buffered message, longer messages are truncated */
+	static const int MSG_ENTRY_MAXLEN = 512;
+	/** messages per second logged by one call site in asynchronous mode, further ones are suppressed */
+	static const uint32_t MSG_SITE_RATE = 10;
+	/** interval in which the logger thread writes buffered messages, in milliseconds */
+	static const long MSG_DRAIN_INTERVAL = 10;
+	/** interval in which dropped and suppressed messages are reported, in seconds */
+	static const time_t MSG_REPORT_INTERVAL = 10;
+
+	struct msg_entry {
+		struct timeval tv;
+		int level;
+		int textstart; /**< start of the message behind the source location */
+		char text[MSG_ENTRY_MAXLEN];
+	};
+
+	/**
+	 * messages of one thread in asynchronous mode
+	 * single producer single consumer ring, written by the owning thread and read by the logger thread
+	 */
+	struct msg_ring {
+		msg_entry entries[MSG_RING_SIZE];
+		std::atomic<uint32_t> head; /**< next entry to be written, only changed by owning thread */
+		std::atomic<uint32_t> tail; /**< next entry to be read, only changed by logger thread */
+		std::atomic<bool> orphaned; /**< owning thread exited, ring is freed by logger thread once it is empty */
+		pthread_t thread;
+		msg_ring* next;
+	};
+
+	/**
+	 * set when ring_owner of the thread was destroyed, later messages of the exiting thread
+	 * are written synchronously (trivially destructible, so it is valid until the thread exits)
+	 */
+	static thread_local bool ring_owner_destroyed = false;
+
+	/**
+	 * marks the ring of a thread as orphaned when the thread exits
+	 */
+	struct msg_ring_owner {
+		msg_ring* ring;
+
+		msg_ring_owner() : ring(NULL) {}
+		~msg_ring_owner()
+		{
+			if (ring) ring->orphaned.store(true, std::memory_order_release);
+			// the logger thread frees the ring as soon as it is empty
+			ring = NULL;
+			ring_owner_destroyed = true;
+		}
+	};
+
+	static thread_local msg_ring_owner ring_owner;
+	static msg_ring* msg_rings = NULL; // list of all rings, protected by ring_mutex
+	static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+	static std::atomic<bool> async_enabled(false);
+	static pthread_t logger_thread;
+	static pthread_mutex_t logger_mutex = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t logger_cond = PTHREAD_COND_INITIALIZER;
+	static bool logger_running = false; // protected by logger_mutex
+	static bool logger_exit = false; // protected by logger_mutex
+
+	static std::atomic<uint64_t> stat_written(0);
+	static std::atomic<uint64_t> stat_dropped(0);
+	static std::atomic<uint64_t> stat_suppressed(0);
+
 	static const char *level_to_string (int level)
 	{
 		switch (level) {
@@ -124,6 +195,9 @@ extern "C" {
 	 */
 	void msg_shutdown()
 	{
+		// write messages buffered in asynchronous mode
+		msg_set_async(false);
+
 		if (msg_get_syslog()) {
 			closelog();
 		}
@@ -134,6 +208,38 @@ extern "C" {
 		}
 	}
 
+#if defined(DEBUG)
+	/**
+	 * returns a simple id of the given thread for logging, msg_mutex must be locked
+	 */
+	static int msg_threadid(pthread_t pt)
+	{
+		static std::map<pthread_t, int> threadids; // we want simple thread ids for logging, here is the map to do that
+		static int nothreads = 0; // how many threads access this function?
+		std::map<pthread_t, int>::iterator iter = threadids.find(pt);
+		if (iter == threadids.end()) {
+			threadids[pt] = nothreads;
+			return nothreads++;
+		}
+		return iter->second;
+	}
+#endif
+
+	/**
+	 * prints time, thread and level of a log line, msg_mutex must be locked
+	 */
+	static void msg_print_prefix(const struct timeval* tv, pthread_t thread, const int level)
+	{
+		time_t sec = tv->tv_sec;
+		struct tm* tform = localtime(&sec);
+#if defined(DEBUG)
+		printf("%02d:%02d:%02d.%03ld[%d] %6s", tform->tm_hour, tform->tm_min, tform->tm_sec, tv->tv_usec/1000, msg_threadid(thread), level_to_string(level));
+#else
+		(void)thread;
+		printf("%02d/%02d %02d:%02d:%02d %6s", tform->tm_mday, tform->tm_mon +1, tform->tm_hour, tform->tm_min, tform->tm_sec, level_to_string(level));
+#endif
+	}
+
 	/**
 	 * internal function which logs given string via printf and returns the logged string in
 	 * parameter logtext if it is != 0
@@ -150,23 +256,9 @@ extern "C" {
 		gettimeofday(&tv, 0);
 		struct tm* tform = localtime(reinterpret_cast<time_t*>(&tv.tv_sec));
 
+		msg_print_prefix(&tv, pthread_self(), level);
 #if defined(DEBUG)
-		// determine thread id
-		static std::map<pthread_t, int> threadids; // we want simple thread ids for logging, here is the map to do that
-		static int nothreads = 0; // how many threads access this function?
-		pthread_t pt = pthread_self();
-		std::map<pthread_t, int>::iterator iter = threadids.find(pt);
-		int threadid;
-		if (iter == threadids.end()) {
-			threadid = nothreads;
-			threadids[pt] = nothreads++;
-		} else {
-			threadid = iter->second;
-		}
-
-		printf("%02d:%02d:%02d.%03ld[%d] %6s", tform->tm_hour, tform->tm_min, tform->tm_sec, tv.tv_usec/1000, threadid, level_to_string(level));
-#else
-		printf("%02d/%02d %02d:%02d:%02d %6s", tform->tm_mday, tform->tm_mon +1, tform->tm_hour, tform->tm_min, tform->tm_sec, level_to_string(level));
+		int threadid = msg_threadid(pthread_self());
 #endif
 		// need helper variable here because va_list parameter of vprintf is undefined after function call
 		va_list my_args;
@@ -238,6 +330,278 @@ extern "C" {
 		va_end(args);
 	}
 
+	/**
+	 * appends formatted text to the message of entry at position pos, the text is truncated
+	 * if the entry is full
+	 */
+	static void msg_vappend(msg_entry* e, int* pos, const char* fmt, va_list args)
+	{
+		if (*pos >= MSG_ENTRY_MAXLEN-1) return;
+		int n = vsnprintf(e->text+*pos, MSG_ENTRY_MAXLEN-*pos, fmt, args);
+		if (n > 0) *pos = std::min(*pos+n, MSG_ENTRY_MAXLEN-1);
+	}
+
+	static void msg_append(msg_entry* e, int* pos, const char* fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		msg_vappend(e, pos, fmt, args);
+		va_end(args);
+	}
+
+	/**
+	 * returns ring of the calling thread, it is created on the first call
+	 */
+	static msg_ring* msg_get_ring()
+	{
+		if (ring_owner.ring) return ring_owner.ring;
+
+		msg_ring* ring = new msg_ring;
+		ring->head.store(0);
+		ring->tail.store(0);
+		ring->orphaned.store(false);
+		ring->thread = pthread_self();
+		pthread_mutex_lock(&ring_mutex);
+		ring->next = msg_rings;
+		msg_rings = ring;
+		pthread_mutex_unlock(&ring_mutex);
+		ring_owner.ring = ring;
+		return ring;
+	}
+
+	static void msg_output(const msg_entry* e, pthread_t thread);
+
+	/**
+	 * called by macro msg in asynchronous mode
+	 * the message is formatted into the ring of the calling thread and written by the logger
+	 * thread, so the caller never waits for locks or I/O. Messages are dropped if the ring is
+	 * full, and suppressed if the call site logs more than MSG_SITE_RATE messages per second.
+	 * Messages of threads which are being torn down are written synchronously.
+	 */
+	void msg_async(struct msg_site* site, const int line, const char* filename, const char* funcname, const char* simplefunc, const int level, const char *fmt, ...)
+	{
+		// call sites are shared by all threads, so counters are updated atomically
+		uint32_t now = time(NULL);
+		uint32_t window = __atomic_load_n(&site->window, __ATOMIC_RELAXED);
+		if (window != now && __atomic_compare_exchange_n(&site->window, &window, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			__atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+		}
+		if (__atomic_fetch_add(&site->count, 1, __ATOMIC_RELAXED) >= MSG_SITE_RATE) {
+			__atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+			stat_suppressed++;
+			return;
+		}
+
+		msg_ring* ring = NULL;
+		uint32_t head = 0;
+		msg_entry local;
+		msg_entry* e = &local;
+		if (!ring_owner_destroyed) {
+			ring = msg_get_ring();
+			head = ring->head.load(std::memory_order_relaxed);
+			if (head-ring->tail.load(std::memory_order_acquire) >= MSG_RING_SIZE) {
+				stat_dropped++;
+				return;
+			}
+			e = &ring->entries[head%MSG_RING_SIZE];
+		}
+
+		gettimeofday(&e->tv, 0);
+		e->level = level;
+		int pos = 0;
+		e->text[0] = 0;
+#if defined(PRINT_FILELOCATION)
+		msg_append(e, &pos, " %s:%d", filename, line);
+#endif
+#if defined(PRINT_WHOLEFUNCTIONNAME)
+		msg_append(e, &pos, " %s", funcname);
+#endif
+#if defined(PRINT_NICELOCATION)
+		msg_append(e, &pos, " %s::%s", filename, simplefunc);
+#endif
+		(void)line; (void)filename; (void)funcname; (void)simplefunc;
+		msg_append(e, &pos, ": ");
+		e->textstart = pos;
+
+		va_list args;
+		va_start(args, fmt);
+		msg_vappend(e, &pos, fmt, args);
+		va_end(args);
+
+		uint32_t suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+		if (suppressed) msg_append(e, &pos, " (%u similar messages suppressed)", suppressed);
+
+		if (ring) {
+			ring->head.store(head+1, std::memory_order_release);
+		} else {
+			msg_output(e, pthread_self());
+			stat_written++;
+		}
+	}
+
+	/**
+	 * writes a buffered message to all enabled log destinations
+	 */
+	static void msg_output(const msg_entry* e, pthread_t thread)
+	{
+		if (syslog_enabled) {
+			syslog(e->level, "%s", e->text+e->textstart);
+		}
+		if (journald_enabled) {
+			sd_journal_print(e->level, "%s", e->text+e->textstart);
+		}
+		if (!quiet) {
+			pthread_mutex_lock(&msg_mutex);
+			msg_print_prefix(&e->tv, thread, e->level);
+			printf("%s\n", e->text);
+			pthread_mutex_unlock(&msg_mutex);
+		}
+	}
+
+	struct msg_pending {
+		const msg_entry* entry;
+		pthread_t thread;
+
+		bool operator<(const msg_pending& other) const
+		{
+			return timercmp(&entry->tv, &other.entry->tv, <);
+		}
+	};
+
+	/**
+	 * writes messages of all rings in the order they were logged and frees rings of exited threads
+	 */
+	static void msg_drain()
+	{
+		std::vector<msg_ring*> rings;
+		pthread_mutex_lock(&ring_mutex);
+		for (msg_ring* r = msg_rings; r != NULL; r = r->next) rings.push_back(r);
+		pthread_mutex_unlock(&ring_mutex);
+
+		// orphaned must be read before head, so that no message can follow the determined head
+		std::vector<bool> orphaned(rings.size());
+		std::vector<uint32_t> heads(rings.size());
+		std::vector<msg_pending> pending;
+		for (size_t i = 0; i < rings.size(); i++) {
+			orphaned[i] = rings[i]->orphaned.load(std::memory_order_acquire);
+			heads[i] = rings[i]->head.load(std::memory_order_acquire);
+			for (uint32_t j = rings[i]->tail.load(std::memory_order_relaxed); j != heads[i]; j++) {
+				msg_pending p = { &rings[i]->entries[j%MSG_RING_SIZE], rings[i]->thread };
+				pending.push_back(p);
+			}
+		}
+
+		std::stable_sort(pending.begin(), pending.end());
+		for (size_t i = 0; i < pending.size(); i++) msg_output(pending[i].entry, pending[i].thread);
+		stat_written += pending.size();
+
+		for (size_t i = 0; i < rings.size(); i++) {
+			rings[i]->tail.store(heads[i], std::memory_order_release);
+			if (!orphaned[i]) continue;
+			pthread_mutex_lock(&ring_mutex);
+			msg_ring** r = &msg_rings;
+			while (*r != rings[i]) r = &(*r)->next;
+			*r = rings[i]->next;
+			pthread_mutex_unlock(&ring_mutex);
+			delete rings[i];
+		}
+	}
+
+	/**
+	 * main function of the logger thread in asynchronous mode
+	 */
+	static void* msg_logger(void*)
+	{
+		time_t lastreport = time(NULL);
+		uint64_t reporteddropped = 0;
+		uint64_t reportedsuppressed = 0;
+
+		pthread_mutex_lock(&logger_mutex);
+		while (!logger_exit) {
+			pthread_mutex_unlock(&logger_mutex);
+
+			msg_drain();
+
+			time_t now = time(NULL);
+			if (now-lastreport >= MSG_REPORT_INTERVAL) {
+				uint64_t dropped = stat_dropped;
+				uint64_t suppressed = stat_suppressed;
+				if (dropped != reporteddropped || suppressed != reportedsuppressed) {
+					msg(LOG_WARNING, "msg: %" PRIu64 " log messages were dropped because of full buffers, %" PRIu64 " were suppressed by rate limiting",
+							dropped-reporteddropped, suppressed-reportedsuppressed);
+					reporteddropped = dropped;
+					reportedsuppressed = suppressed;
+				}
+				lastreport = now;
+			}
+
+			struct timespec ts;
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += MSG_DRAIN_INTERVAL*1000000;
+			if (ts.tv_nsec >= 1000000000) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000;
+			}
+			pthread_mutex_lock(&logger_mutex);
+			if (!logger_exit) pthread_cond_timedwait(&logger_cond, &logger_mutex, &ts);
+		}
+		pthread_mutex_unlock(&logger_mutex);
+
+		msg_drain();
+		return NULL;
+	}
+
+	/**
+	 * enables or disables asynchronous mode
+	 * in asynchronous mode, msg() only buffers messages and a logger thread writes them.
+	 * When disabled, the logger thread writes all buffered messages before it exits.
+	 * Must not be called before the process forks, as the logger thread does not survive fork().
+	 */
+	void msg_set_async(bool set_async)
+	{
+		pthread_mutex_lock(&logger_mutex);
+		if (set_async && !logger_running) {
+			logger_exit = false;
+			int retval = pthread_create(&logger_thread, NULL, msg_logger, NULL);
+			if (retval != 0) {
+				fprintf(stderr, "!!! msg: pthread_create returned error code %d (%s)\n", retval, strerror(retval));
+			} else {
+				logger_running = true;
+				async_enabled.store(true);
+			}
+		} else if (!set_async && logger_running) {
+			async_enabled.store(false);
+			logger_exit = true;
+			pthread_cond_signal(&logger_cond);
+			pthread_mutex_unlock(&logger_mutex);
+			pthread_join(logger_thread, NULL);
+			pthread_mutex_lock(&logger_mutex);
+			logger_running = false;
+			// messages of threads which were in msg_async() while the logger thread exited
+			msg_drain();
+		}
+		pthread_mutex_unlock(&logger_mutex);
+	}
+
+	/**
+	 * return true if messages are written by the logger thread
+	 */
+	bool msg_get_async()
+	{
+		return async_enabled.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * returns counters of asynchronous mode: messages written, dropped
+	 * because the ring of a thread was full, and suppressed by rate limiting of call sites
+	 */
+	void msg_get_async_stats(uint64_t* written, uint64_t* dropped, uint64_t* suppressed)
+	{
+		*written = stat_written;
+		*dropped = stat_dropped;
+		*suppressed = stat_suppressed;
+	}
+
 	/**
 	 * sets verbosity level of vermont
 	 */
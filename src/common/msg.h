@@ -42,9 +42,17 @@ typedef void (*LOGFUNCTION)(void *);
 	//#define PRINT_WHOLEFUNCTIONNAME
 #endif
 
+/** state of a msg() call site, used for rate limiting in asynchronous mode */
+struct msg_site {
+	uint32_t window; /**< second to which count refers */
+	uint32_t count; /**< number of messages in this second */
+	uint32_t suppressed; /**< number of messages suppressed since the last logged one */
+};
+
 void msg_init(void);
 void msg_shutdown(void);
 void msg2(const int, const char*, const char*, const char*, const int, const char *, ...);
+void msg_async(struct msg_site*, const int, const char*, const char*, const char*, const int, const char *, ...);
 int parse_log_level (const char *arg);
 void msg_setlevel(int);
 int msg_getlevel();
@@ -54,6 +62,9 @@ void msg_set_journald(bool);
 bool msg_get_journald();
 void msg_set_syslog(bool);
 bool msg_get_syslog();
+void msg_set_async(bool);
+bool msg_get_async();
+void msg_get_async_stats(uint64_t* written, uint64_t* dropped, uint64_t* suppressed);
 int msg_stat(const char *fmt, ...);
 int msg_stat_setup(int mode, FILE *f);
 
@@ -99,14 +110,19 @@ void vermont_exception(const int, const char*, const char*, const char*, const c
 	__extension__ \
 	({ \
 		if (msg_getlevel() & LOG_MASK(lvl)) { \
-			if (msg_get_syslog()) { \
-				syslog(lvl, __VA_ARGS__); \
-			} \
-			if (msg_get_journald()) { \
-				sd_journal_print(lvl, __VA_ARGS__); \
-			} \
-			if (!msg_getquiet()) { \
-				msg2(__LINE__, __FILE__, __PRETTY_FUNCTION__, __func__, lvl, __VA_ARGS__); \
+			if (msg_get_async()) { \
+				static struct msg_site _msg_site; \
+				msg_async(&_msg_site, __LINE__, __FILE__, __PRETTY_FUNCTION__, __func__, lvl, __VA_ARGS__); \
+			} else { \
+				if (msg_get_syslog()) { \
+					syslog(lvl, __VA_ARGS__); \
+				} \
+				if (msg_get_journald()) { \
+					sd_journal_print(lvl, __VA_ARGS__); \
+				} \
+				if (!msg_getquiet()) { \
+					msg2(__LINE__, __FILE__, __PRETTY_FUNCTION__, __func__, lvl, __VA_ARGS__); \
+				} \
 			} \
 		} \
 	})
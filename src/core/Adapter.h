@@ -55,6 +55,11 @@ public:
 		Source<T>::send(element);
 	}
 
+	virtual void receiveBatch(std::vector<T>& batch)
+	{
+		Source<T>::sendBatch(batch);
+	}
+
 	virtual void notifyQueueRunning() {
 		Source<T>::sendQueueRunningNotification();
 	}
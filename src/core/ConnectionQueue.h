@@ -37,8 +37,15 @@ template <class T>
 class ConnectionQueue : public Adapter<T>, public Timer
 {
 public:
-	ConnectionQueue(uint32_t maxEntries = 1)
-		: queue(maxEntries), thread(threadWrapper, "ConnectionQueue"), statQueueEntries(0), statTotalReceived(0)
+	/**
+	 * default number of elements which are forwarded to the next module at once
+	 */
+	static const uint32_t DEFAULT_BATCH_SIZE = 64;
+
+	ConnectionQueue(uint32_t maxEntries = 1, uint32_t batchSize = DEFAULT_BATCH_SIZE,
+			typename ConcurrentQueue<T>::Implementation impl = ConcurrentQueue<T>::LOCKED)
+		: queue(maxEntries, impl), thread(threadWrapper, "ConnectionQueue"), batchSize(batchSize > 0 ? batchSize : 1),
+		  statQueueEntries(0), statTotalReceived(0)
 	{
 		initPhase = true;
 		this->Sensor::usedBytes = sizeof(ConnectionQueue);
@@ -56,6 +63,13 @@ public:
 		queue.push(packet);
 	}
 
+	virtual void receiveBatch(std::vector<T>& batch)
+	{
+		DPRINTF_INFO("receiveBatch(%zu)", batch.size());
+		statTotalReceived += batch.size();
+		queue.pushBatch(batch);
+	}
+
 	virtual void performStart()
 	{
 		queue.restart();
@@ -137,9 +151,12 @@ public:
 		list<TimeoutEntry*>::iterator iter = timeouts.begin();
 		while (iter != timeouts.end()) {
 			TimeoutEntry* te = *iter;
-			if (te->dataPtr == dataPtr)
+			if (te->dataPtr == dataPtr) {
 				iter = timeouts.erase(iter);
-			delete te;
+				delete te;
+			} else {
+				iter++;
+			}
 		}
 		mutex.unlock();
 	}
@@ -148,6 +165,7 @@ public:
 private:
 	ConcurrentQueue<T> queue;  /**< contains all elements which were received from previous modules */
 	Thread thread;
+	uint32_t batchSize; /**< maximum number of elements sent to the next module at once */
 	list<TimeoutEntry*> timeouts;
 	Mutex mutex;	/**< controls access to class variable timeouts */
 	uint32_t statQueueEntries;
@@ -226,7 +244,8 @@ private:
 	 */
 	void processLoop()
 	{
-		T element;
+		std::vector<T> batch;
+		batch.reserve(batchSize);
 
 		Module::registerCurrentThread();
 		Source<T>::sendQueueRunningNotification();
@@ -238,16 +257,16 @@ private:
 			}
 			struct timespec nexttimeout;
 			if (!processTimeouts(nexttimeout)) {
-				if (!queue.pop(&element)) {
+				if (!queue.popBatch(batch, batchSize)) {
 					continue;
 				}
 			} else {
-				if (!queue.popAbs(nexttimeout, &element)) {
+				if (!queue.popBatchAbs(nexttimeout, batch, batchSize)) {
 					continue;
 				}
 			}
 
-			if (!Source<T>::send(element)) break;
+			if (!Source<T>::sendBatch(batch)) break;
 		}
 
 		Module::unregisterCurrentThread();
@@ -66,6 +66,28 @@ public:
 		process(packet);
 	}
 
+	virtual void receiveBatch(std::vector<T>& batch)
+	{
+		if (!Source<T>::sleepUntilConnected()) {
+			DPRINTF_INFO("Can't wait for connection, perhaps the program is shutting down?");
+			return;
+		}
+
+		size_t sz = size;
+		if (sz > 1) {
+			for (typename std::vector<T>::iterator it = batch.begin(); it != batch.end(); ++it)
+				(*it)->addReference(sz - 1);
+		}
+
+		// every destination may modify the vector, so all but the last one get a copy
+		for (size_t i = 0; i + 1 < sz; i++) {
+			std::vector<T> copy(batch);
+			destinations[i]->receiveBatch(copy);
+		}
+		if (sz > 0)
+			destinations[sz-1]->receiveBatch(batch);
+	}
+
 	virtual void notifyQueueRunning() {
 		for (size_t i = 0; i < size; i++) {
 			destinations[i]->notifyQueueRunning();
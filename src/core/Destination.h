@@ -10,6 +10,7 @@
 
 #include <cstdio>
 #include <stdexcept>
+#include <vector>
 
 
 template<class T>
@@ -22,6 +23,18 @@ public:
 	
 	virtual void receive(T e) = 0;
 
+	/**
+	 * receives several elements at once, the references of all elements are
+	 * handed over to this module; the vector itself stays owned by the caller
+	 * and may be modified (e.g. filtered) by the receiving module
+	 * modules which can process batches more efficiently should override this
+	 */
+	virtual void receiveBatch(std::vector<T>& batch)
+	{
+		for (typename std::vector<T>::iterator it = batch.begin(); it != batch.end(); ++it)
+			receive(*it);
+	}
+
 	// See Source.h for comments on the queue running notification
 	virtual void notifyQueueRunning() {}
 };
@@ -39,6 +52,11 @@ public:
 		THROWEXCEPTION("this module is no destination!");
 	}
 
+	virtual void receiveBatch(std::vector<NullEmitable*>& batch)
+	{
+		THROWEXCEPTION("this module is no destination!");
+	}
+
 	// See Source.h for comments on the Start Signal
 	virtual void notifyQueueRunning()
 	{
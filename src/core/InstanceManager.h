@@ -28,6 +28,9 @@
 
 #include <queue>
 #include <list>
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <algorithm>
 
 using namespace std;
@@ -36,25 +39,166 @@ using namespace std;
  * manages instances of the given type to avoid news/deletes in program
  * managed types *should* be inherited from ManagedInstance
  * ATTENTION: this class internally handles *pointers* of the given type
+ *
+ * Every thread keeps a small cache (magazine) of free instances per manager,
+ * so that getNewInstance() and removeReference() work without locking most of
+ * the time. Only when a magazine runs empty or full, MAGAZINE_SIZE instances are
+ * moved at once from or to the shared depot, which is protected by a mutex.
+ * Magazines of terminated threads are reclaimed when the depot runs empty.
+ * In DEBUG mode all instances go through the depot to keep track of used instances.
  */
 template<class T>
 class InstanceManager : public Sensor
 {
 	private:
+		static const uint32_t MAGAZINE_SIZE = 64;
+
+		/**
+		 * per-thread cache of free instances, holds up to 2*MAGAZINE_SIZE instances
+		 * only the owning thread accesses the instances, statistics are read by the sensor thread
+		 */
+		struct Magazine {
+			T* instances[2*MAGAZINE_SIZE];
+			uint32_t count;
+			atomic<bool> orphaned; /**< owning thread has terminated */
+			atomic<bool> managerDestroyed;
+			atomic<uint64_t> statHits;
+			atomic<uint64_t> statMisses;
+
+			Magazine() : count(0), orphaned(false), managerDestroyed(false), statHits(0), statMisses(0) {}
+		};
+
+		/**
+		 * magazines of the current thread for all instance managers of type T
+		 */
+		struct ThreadCache {
+			uint64_t lastId;
+			Magazine* last;
+			vector<pair<uint64_t, shared_ptr<Magazine> > > magazines;
+
+			ThreadCache() : lastId(0), last(NULL) {}
+			~ThreadCache()
+			{
+				for (size_t i=0; i<magazines.size(); i++) {
+					magazines[i].second->orphaned.store(true, memory_order_release);
+				}
+			}
+		};
+
+		static atomic<uint64_t> nextId;
+
+		uint64_t id; /**< unique id of this manager, ids are never reused */
 #if defined(DEBUG)
 		list<T*> usedInstances;	// instances with active references (only used for debugging purposes)
 #endif
-		queue<T*> freeInstances;// unused instances
+		vector<T*> freeInstances;// unused instances (depot)
+		vector<shared_ptr<Magazine> > magazines; // magazines of all threads using this manager
 		Mutex mutex;			// we wanna be thread-safe
 		static const int DEFAULT_NO_INSTANCES = 1000;
 		uint32_t statCreatedInstances; /**< number of created instances, used for statistical purposes */
+		uint64_t statRefills; /**< number of bulk transfers from depot to a magazine */
+		uint64_t statReturns; /**< number of bulk transfers from a magazine to depot */
+		uint64_t statHitsOrphaned; /**< cache hits of already reclaimed magazines */
+		uint64_t statMissesOrphaned; /**< cache misses of already reclaimed magazines */
+
+		/**
+		 * returns the magazine of the current thread, creates it if necessary
+		 */
+		inline Magazine* getMagazine()
+		{
+			static thread_local ThreadCache tc;
+			if (tc.lastId == id) return tc.last;
+
+			Magazine* mag = NULL;
+			for (size_t i=0; i<tc.magazines.size(); ) {
+				if (tc.magazines[i].first == id) {
+					mag = tc.magazines[i].second.get();
+					i++;
+				} else if (tc.magazines[i].second->managerDestroyed.load(memory_order_relaxed)) {
+					tc.magazines.erase(tc.magazines.begin()+i);
+				} else {
+					i++;
+				}
+			}
+			if (!mag) {
+				shared_ptr<Magazine> m(new Magazine());
+				mutex.lock();
+				magazines.push_back(m);
+				usedBytes += sizeof(Magazine);
+				mutex.unlock();
+				tc.magazines.push_back(make_pair(id, m));
+				mag = m.get();
+			}
+			tc.lastId = id;
+			tc.last = mag;
+			return mag;
+		}
+
+		/**
+		 * moves instances of terminated threads' magazines into the depot
+		 * mutex must be locked
+		 */
+		void reclaimOrphans()
+		{
+			for (size_t i=0; i<magazines.size(); ) {
+				Magazine* mag = magazines[i].get();
+				if (mag->orphaned.load(memory_order_acquire)) {
+					freeInstances.insert(freeInstances.end(), mag->instances, mag->instances+mag->count);
+					mag->count = 0;
+					statHitsOrphaned += mag->statHits.load(memory_order_relaxed);
+					statMissesOrphaned += mag->statMisses.load(memory_order_relaxed);
+					usedBytes -= sizeof(Magazine);
+					magazines.erase(magazines.begin()+i);
+				} else {
+					i++;
+				}
+			}
+		}
+
+		/**
+		 * fills empty magazine with up to MAGAZINE_SIZE instances from the depot,
+		 * creates one new instance if depot is empty
+		 */
+		void refill(Magazine* mag)
+		{
+			mutex.lock();
+			if (freeInstances.empty()) reclaimOrphans();
+			uint32_t n = min((size_t)MAGAZINE_SIZE, freeInstances.size());
+			if (n > 0) {
+				copy(freeInstances.end()-n, freeInstances.end(), mag->instances);
+				freeInstances.resize(freeInstances.size()-n);
+				mag->count = n;
+				statRefills++;
+			} else {
+				// create new instance
+				statCreatedInstances++;
+				usedBytes += sizeof(T)+4;
+				mag->instances[0] = new T(this);
+				mag->count = 1;
+			}
+			mutex.unlock();
+		}
+
+		/**
+		 * moves MAGAZINE_SIZE instances from a full magazine to the depot
+		 */
+		void flush(Magazine* mag)
+		{
+			mutex.lock();
+			mag->count -= MAGAZINE_SIZE;
+			freeInstances.insert(freeInstances.end(), mag->instances+mag->count, mag->instances+mag->count+MAGAZINE_SIZE);
+			statReturns++;
+			mutex.unlock();
+		}
 
 	public:
 		InstanceManager(string type, int preAllocInstances = DEFAULT_NO_INSTANCES)
-			: statCreatedInstances(0)
+			: id(nextId.fetch_add(1)), statCreatedInstances(0), statRefills(0), statReturns(0),
+			  statHitsOrphaned(0), statMissesOrphaned(0)
 		{
+			freeInstances.reserve(preAllocInstances);
 			for (int i=0; i<preAllocInstances; i++) {
-				freeInstances.push(new T(this));
+				freeInstances.push_back(new T(this));
 			}
 			statCreatedInstances = preAllocInstances;
 			usedBytes += sizeof(InstanceManager<T>)+preAllocInstances*(sizeof(T)+4);
@@ -69,9 +213,15 @@ class InstanceManager : public Sensor
 				DPRINTF_INFO("freeing instance manager, although there are still %zu used instances", usedInstances.size());
 			}
 #endif
-			while (!freeInstances.empty()) {
-				T* obj = freeInstances.front();
-				freeInstances.pop();
+			// magazines may still be referenced by other threads, those only drop them
+			for (size_t i=0; i<magazines.size(); i++) {
+				Magazine* mag = magazines[i].get();
+				freeInstances.insert(freeInstances.end(), mag->instances, mag->instances+mag->count);
+				mag->count = 0;
+				mag->managerDestroyed.store(true, memory_order_relaxed);
+			}
+			for (size_t i=0; i<freeInstances.size(); i++) {
+				T* obj = freeInstances[i];
 #if defined(DEBUG)
 				obj->deletedByManager = true;
 #endif
@@ -87,6 +237,16 @@ class InstanceManager : public Sensor
 		{
 			T* instance;
 #if !defined(IM_DISABLE)
+#if !defined(DEBUG)
+			Magazine* mag = getMagazine();
+			if (mag->count == 0) {
+				mag->statMisses.store(mag->statMisses.load(memory_order_relaxed)+1, memory_order_relaxed);
+				refill(mag);
+			} else {
+				mag->statHits.store(mag->statHits.load(memory_order_relaxed)+1, memory_order_relaxed);
+			}
+			instance = mag->instances[--mag->count];
+#else // DEBUG
 			mutex.lock();
 
 			if (freeInstances.empty()) {
@@ -95,20 +255,18 @@ class InstanceManager : public Sensor
 				instance = new T(this);
 				usedBytes += sizeof(T)+4;
 			} else {
-				instance = freeInstances.front();
-				freeInstances.pop();
+				instance = freeInstances.back();
+				freeInstances.pop_back();
 			}
 
-#if defined(DEBUG)
 			DPRINTF_INFO("adding used instance %p", (void*)instance);
 			usedInstances.push_back(instance);
-#endif
-
-			instance->referenceCount++;
 			mutex.unlock();
+#endif // DEBUG
+			instance->referenceCount.store(1, memory_order_relaxed);
 #else // IM_DISABLE
 			instance = new T(this);
-			instance->referenceCount++;
+			instance->referenceCount.store(1, memory_order_relaxed);
 #endif // IM_DISABLE
 
 			return instance;
@@ -116,42 +274,47 @@ class InstanceManager : public Sensor
 
 		inline void addReference(T* instance, int count)
 		{
-#if defined(DEBUG)
-			mutex.lock();
-#endif
-			instance->referenceCount += count;
+			int32_t previous = instance->referenceCount.fetch_add(count, memory_order_relaxed);
 #if defined(DEBUG)
 #if !defined(IM_DISABLE)
+			mutex.lock();
 			// the referenceCount MUST NEVER be zero and still be used by some code
-			if (instance->referenceCount-count == 0) {
+			if (previous == 0) {
 				THROWEXCEPTION("instance reference counter was zero and was still used");
 			}
 			// this instance should be in the used list, else there is something wrong
 			if (find(usedInstances.begin(), usedInstances.end(), instance) == usedInstances.end()) {
 				THROWEXCEPTION("instance (%p) is not managed by InstanceManager", (void*)instance);
 			}
-#endif // IM_DISABLE
 			mutex.unlock();
+#endif // IM_DISABLE
+#else
+			(void)previous;
 #endif // DEBUG
 		}
 
 		inline void removeReference(T* instance)
 		{
-			instance->referenceCount--;
+			// release ordering makes all changes of this thread visible to the thread which reuses the instance
+			int32_t remaining = instance->referenceCount.fetch_sub(1, memory_order_acq_rel)-1;
 
-			if (instance->referenceCount == 0) {
+			if (remaining == 0) {
 #if !defined(IM_DISABLE)
+#if !defined(DEBUG)
+				Magazine* mag = getMagazine();
+				if (mag->count == 2*MAGAZINE_SIZE) flush(mag);
+				mag->instances[mag->count++] = instance;
+#else // DEBUG
 				mutex.lock();
-				freeInstances.push(instance);
-#if defined(DEBUG)
+				freeInstances.push_back(instance);
 				typename list<T*>::iterator iter = find(usedInstances.begin(), usedInstances.end(), instance);
 				if (iter == usedInstances.end()) {
 					THROWEXCEPTION("instance (%p) is not managed by InstanceManager", (void*)instance);
 				}
 				DPRINTF_INFO("removing used instance %p", (void*)instance);
 				usedInstances.erase(iter);
-#endif
 				mutex.unlock();
+#endif // DEBUG
 #else // IM_DISABLE
 				DPRINTF_INFO("removing used instance %p", (void*)instance);
 				instance->deletedByManager = true;
@@ -159,7 +322,7 @@ class InstanceManager : public Sensor
 #endif // IM_DISABLE
 			}
 #if defined(DEBUG) && !defined(IM_DISABLE)
-			if (instance->referenceCount < 0) {
+			if (remaining < 0) {
 				THROWEXCEPTION("referenceCount of instance is < 0");
 			}
 #endif
@@ -167,11 +330,27 @@ class InstanceManager : public Sensor
 
 		string getStatisticsXML(double interval)
 		{
-			char text[200];
-			snprintf(text, ARRAY_SIZE(text), "<createdInstances>%u</createdInstances>", statCreatedInstances);
+			char text[400];
+			mutex.lock();
+			uint64_t hits = statHitsOrphaned;
+			uint64_t misses = statMissesOrphaned;
+			for (size_t i=0; i<magazines.size(); i++) {
+				hits += magazines[i]->statHits.load(memory_order_relaxed);
+				misses += magazines[i]->statMisses.load(memory_order_relaxed);
+			}
+			snprintf(text, ARRAY_SIZE(text), "<createdInstances>%u</createdInstances><freeInstances>%zu</freeInstances>"
+					"<threadCaches>%zu</threadCaches><cacheHits>%llu</cacheHits><cacheMisses>%llu</cacheMisses>"
+					"<depotRefills>%llu</depotRefills><depotReturns>%llu</depotReturns>",
+					statCreatedInstances, freeInstances.size(), magazines.size(),
+					(unsigned long long)hits, (unsigned long long)misses,
+					(unsigned long long)statRefills, (unsigned long long)statReturns);
+			mutex.unlock();
 			return string(text);
 		}
 };
 
+template<class T>
+atomic<uint64_t> InstanceManager<T>::nextId(1);
+
 
 #endif
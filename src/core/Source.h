@@ -15,6 +15,8 @@
 #include "core/Destination.h"
 #include "core/Emitable.h"
 
+#include <vector>
+
 template <typename T>
 class Source
 {
@@ -105,6 +107,32 @@ public:
 		return true;
 	}
 
+	/**
+	 * sends all elements of batch to the next module with a single call
+	 * batch is empty afterwards
+	 */
+	inline bool sendBatch(std::vector<T>& batch)
+	{
+		if (batch.empty()) return true;
+
+		while (atomic_lock(&syncLock)) {
+			if (!sleepUntilConnected()) {
+				DPRINTF_INFO("Can't wait for connection, perhaps the program is shutting down?");
+				return false;
+			}
+		}
+		if (isConnected()) dest->receiveBatch(batch);
+		else {
+			// we don't have a succeeding module, so clean up these data elements
+			for (typename std::vector<T>::iterator it = batch.begin(); it != batch.end(); ++it)
+				(*it)->removeReference();
+		}
+		atomic_release(&syncLock);
+		batch.clear();
+
+		return true;
+	}
+
 	// Subsequent modules that do not have
 	// their own timer will be informed about the fact that
 	// the queue is now running. It was added to inform
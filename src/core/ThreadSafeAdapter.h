@@ -50,6 +50,13 @@ public:
 		send(element);
 		mutex.unlock();
 	}
+
+	virtual void receiveBatch(std::vector<T>& batch)
+	{
+		mutex.lock();
+		Adapter<T>::sendBatch(batch);
+		mutex.unlock();
+	}
 	
 protected:
 	Mutex mutex;
@@ -54,9 +54,9 @@ public:
 	ConnectionQueue<T>* createInstance()
 	{
 		if (!maxSize) // create a new queue with its default size
-			return CfgHelper<ConnectionQueue<T>, QueueCfg<T> >::instance = new ConnectionQueue<T>();
+			return CfgHelper<ConnectionQueue<T>, QueueCfg<T> >::instance = new ConnectionQueue<T>(1, batchSize, implementation);
 
-		CfgHelper<ConnectionQueue<T>, QueueCfg<T> >::instance = new ConnectionQueue<T>(maxSize);
+		CfgHelper<ConnectionQueue<T>, QueueCfg<T> >::instance = new ConnectionQueue<T>(maxSize, batchSize, implementation);
 		return CfgHelper<ConnectionQueue<T>, QueueCfg<T> >::instance;
 	}
 
@@ -64,13 +64,18 @@ public:
 	{
 		if (this->maxSize != old->maxSize)
 			return false;
+		if (this->batchSize != old->batchSize)
+			return false;
+		if (this->implementation != old->implementation)
+			return false;
 
 		return true;
 	}
 	
 protected:
 	QueueCfg(XMLElement* e)
-		: CfgHelper<ConnectionQueue<T>, QueueCfg<T> >(e, "QueueCfg<unspecified>"), maxSize(0)
+		: CfgHelper<ConnectionQueue<T>, QueueCfg<T> >(e, "QueueCfg<unspecified>"), maxSize(0),
+		  batchSize(ConnectionQueue<T>::DEFAULT_BATCH_SIZE), implementation(ConcurrentQueue<T>::LOCKED)
 	{
 		// set the correct name in CfgHelper
 		this->name = getName();
@@ -79,10 +84,25 @@ protected:
 			return;
 		
 		maxSize = this->getInt("maxSize", 0);
+		batchSize = this->getInt("batchSize", ConnectionQueue<T>::DEFAULT_BATCH_SIZE);
+
+		// spsc must only be used if exactly one module sends elements to this queue
+		std::string impl = this->getOptional("implementation");
+		if (impl.empty() || impl == "locked") {
+			implementation = ConcurrentQueue<T>::LOCKED;
+		} else if (impl == "spsc") {
+			implementation = ConcurrentQueue<T>::SPSC;
+		} else if (impl == "mpsc") {
+			implementation = ConcurrentQueue<T>::MPSC;
+		} else {
+			THROWEXCEPTION("%s: unknown queue implementation '%s', use 'locked', 'spsc' or 'mpsc'", getName().c_str(), impl.c_str());
+		}
 	}
 	
 private:
 	size_t maxSize;
+	uint32_t batchSize;
+	typename ConcurrentQueue<T>::Implementation implementation;
 };
 
 
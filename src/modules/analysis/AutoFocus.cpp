@@ -19,7 +19,6 @@
  */
 
 #include "AutoFocus.h"
-#include "common//crc.hpp"
 #include "common/Misc.h"
 
 #include <arpa/inet.h>
@@ -40,10 +39,11 @@
 	m_minSubbits(subbits),
 	analyzerId(analyzerid),
 	reportfile(reportfile),
-	m_treeRecords(numtrees,NULL)	
+	m_treeRecords(numtrees,NULL),
+	ipRecords(hashbits),
+	extractor(Connection::ADDRESSES|Connection::PROTOCOL|Connection::TIMES|Connection::COUNTERS|Connection::TCP_FLAGS, "AutoFocus")
 
 {
-	hashSize = 1<<hashBits;
 	lastTreeBuilt = time(0);
 	statEntriesAdded = 0;
 
@@ -51,8 +51,6 @@
 	m_treeRecords.clear();
 
 
-
-	listIPRecords = new list<IPRecord*>[hashSize];
 	initiateRecord(m_treeCount % numTrees);
 	msg(LOG_NOTICE,"AutoFocus started");
 }
@@ -64,25 +62,18 @@
  */
 AutoFocus::~AutoFocus()
 {
-	for (uint32_t i=0; i<hashSize; i++) {
-		if (listIPRecords[i].size()==0) continue;
-
-		list<IPRecord*>::iterator iter = listIPRecords[i].begin();
-		while (iter != listIPRecords[i].end()) {
-			std::map<report_enum,af_attribute*>::iterator iter2 = (*iter)->m_attributes.begin();
+	for (uint32_t i=0; i<ipRecords.size(); i++) {
+		IPRecord* te = ipRecords.at(i).data;
+		std::map<report_enum,af_attribute*>::iterator iter2 = te->m_attributes.begin();
 
-			while (iter2 != (*iter)->m_attributes.end())	
-			{
-				delete (iter2->second);	
-				iter2++;
-			}
-			delete *iter;
-			iter++;
+		while (iter2 != te->m_attributes.end())	
+		{
+			delete (iter2->second);	
+			iter2++;
 		}
-		listIPRecords[i].clear();
+		delete te;
 	}
-
-	delete[] listIPRecords;
+	ipRecords.clear();
 
 	for (uint32_t i = 0; i < numTrees;i++)
 	{
@@ -103,7 +94,7 @@ void AutoFocus::onDataRecord(IpfixDataRecord* record)
 	}
 	
 	// convert ipfixrecord to connection struct
-	Connection conn(record);
+	Connection conn(record, extractor);
 
 
 	//hardcoded for uni network
@@ -150,7 +141,6 @@ void AutoFocus::addConnection(Connection* conn)
 IPRecord* AutoFocus::getEntry(Connection* conn)
 {
 	time_t curtime = time(0);
-	uint32_t hash = crc32(0, 4, reinterpret_cast<char*>(&conn->srcIP)) & (hashSize-1);
 
 
 	if (lastTreeBuilt+timeTreeInterval < (uint32_t) curtime) 
@@ -159,19 +149,13 @@ IPRecord* AutoFocus::getEntry(Connection* conn)
 		buildTree();
 	}
 
-	list<IPRecord*>::iterator iter = listIPRecords[hash].begin();
-	while (iter != listIPRecords[hash].end()) {
-		if ((*iter)->subnetIP == conn->srcIP) {
-			// found the entry
-			return *iter;
-		}
-		iter++;
+	bool created;
+	IPRecord*& te = ipRecords.get(conn->srcIP, &created);
+	if (created) {
+		// no entry found, create a new one
+		te = createEntry(conn);
 	}
 
-	// no entry found, create a new one
-	IPRecord* te = createEntry(conn);
-	listIPRecords[hash].push_back(te);
-
 	return te;
 }
 
@@ -383,16 +367,10 @@ void AutoFocus::cleanUp()
 {
 
 	//atrributes are not deleted here, because the data is stll linked in the treeNodes
-	for (uint32_t i=0; i<hashSize; i++) {
-		if (listIPRecords[i].size()==0) continue;
-
-		list<IPRecord*>::iterator iter = listIPRecords[i].begin();
-		while (iter != listIPRecords[i].end()) {
-			delete *iter;
-			iter++;
-		}
-		listIPRecords[i].clear();
+	for (uint32_t i=0; i<ipRecords.size(); i++) {
+		delete ipRecords.at(i).data;
 	}
+	ipRecords.clear();
 	statEntriesAdded = 0;	
 
 }
@@ -439,32 +417,26 @@ void AutoFocus::buildTree ()
 	treeRecord* curTreeRecord = m_treeRecords[m_treeCount % numTrees];
 
 
-	for (uint32_t i=0; i<hashSize; i++) {
-		if (listIPRecords[i].size()==0) continue;
+	for (uint32_t i=0; i<ipRecords.size(); i++) {
+		IPRecord* te = ipRecords.at(i).data;
 
-		list<IPRecord*>::iterator iter = listIPRecords[i].begin();
+		treeNode* entry = new treeNode;
+		entry->data.subnetIP = te->subnetIP;
+		entry->data.subnetBits = te->subnetBits;
+		entry->left = NULL;
+		entry->right = NULL;
+		entry->prio = 0;
+		entry->data.m_attributes = te->m_attributes;
 
-		while (iter != listIPRecords[i].end()) 
-		{
-			treeNode* entry = new treeNode;
-			entry->data.subnetIP = (*iter)->subnetIP;
-			entry->data.subnetBits = (*iter)->subnetBits;
-			entry->left = NULL;
-			entry->right = NULL;
-			entry->prio = 0;
-			entry->data.m_attributes = (*iter)->m_attributes;
 
+		std::map<report_enum,af_attribute*>::iterator iter2 = te->m_attributes.begin();
 
-			std::map<report_enum,af_attribute*>::iterator iter2 = (*iter)->m_attributes.begin();
-
-			while (iter2 != (*iter)->m_attributes.end())
-			{
-				(iter2->second)->delta = (iter2->second)->numCount;
-				iter2++;
-			}
-			tree.push_back(entry);
-			iter++;	
+		while (iter2 != te->m_attributes.end())
+		{
+			(iter2->second)->delta = (iter2->second)->numCount;
+			iter2++;
 		}
+		tree.push_back(entry);
 	}
 	//sort tree, use ip as key 
 	tree.sort(AutoFocus::comp_entries);
@@ -24,6 +24,7 @@
 #include "modules/ipfix/IpfixRecordDestination.h"
 #include "modules/ipfix/Connection.h"
 #include "core/Source.h"
+#include "common/HostTable.h"
 #include "autofocus_iprecord.h"
 #include "autofocus_attribute.h"
 #include "autofocus_report.h"
@@ -50,8 +51,7 @@ class AutoFocus
 
 
 
-		uint32_t hashSize;
-		uint32_t hashBits;	/**< amount of bits used for hashtable */
+		uint32_t hashBits;	/**< log2 of initial number of slots in hashtable */
 		uint32_t timeTreeInterval; // time in seconds when tree is rebuilt
 		uint32_t lastTreeBuilt;
 		uint32_t numMaxResults;
@@ -65,7 +65,8 @@ class AutoFocus
 		vector<treeRecord*> m_treeRecords;
 		uint32_t m_treeCount;
 
-		list<IPRecord*>* listIPRecords;
+		HostTable<IPRecord*> ipRecords;
+		ConnectionExtractor extractor; /**< reads only the fields used by this module */
 	
 
 		uint32_t distance(treeNode*,treeNode*);
@@ -24,7 +24,8 @@
 #include <string.h>
 
 FlowLenAnalyzer::FlowLenAnalyzer(std::string& fFile, std::string& bFile, std::vector<uint64_t>& bs)
-	:  flowFilename(fFile), binsFilename(bFile), bins(bs)
+	:  flowFilename(fFile), binsFilename(bFile), bins(bs),
+	   extractor(Connection::ADDRESSES|Connection::TIMES|Connection::COUNTERS, "FlowLenAnalyzer")
 {
 	// initialize flowsize output file
 	flowOutstream.open(flowFilename.c_str(), ios_base::out | ios_base::trunc);
@@ -60,7 +61,7 @@ void FlowLenAnalyzer::onDataRecord(IpfixDataRecord* record)
 {
 	uint64_t packetCount = 0;
 	uint64_t byteCount = 0;
-	Connection c(record);
+	Connection c(record, extractor);
        
 	if (c.srcIP == 0) {
 		// We have an IPv6 record. Do not record any stats about them
@@ -21,6 +21,7 @@
 #define _FLOWLEN_ANALYZER_H_
 
 #include "modules/ipfix/IpfixRecordDestination.h"
+#include "modules/ipfix/Connection.h"
 
 #include <fstream>
 #include <map>
@@ -42,6 +43,7 @@ private:
 	std::ofstream binsOutstream;
 	std::vector<uint64_t> bins;
 	std::map<uint64_t, uint64_t> binStats;
+	ConnectionExtractor extractor; /**< reads only the fields used by this module */
 };
 
 #endif
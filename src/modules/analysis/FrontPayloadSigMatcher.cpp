@@ -26,7 +26,8 @@
 
 FrontPayloadSigMatcher::FrontPayloadSigMatcher(string sigdir)
 	: signatureDir(sigdir),
-	  sigmatcher(NULL)
+	  sigmatcher(NULL),
+	  extractor(Connection::ALL_FIELDS, "FrontPayloadSigMatcher")
 {
 	msg(LOG_NOTICE, "FrontPayloadSigMatcher started with following parameters:");
 	msg(LOG_NOTICE, "  - signature directory=%s", sigdir.c_str());
@@ -64,7 +65,7 @@ void FrontPayloadSigMatcher::onDataRecord(IpfixDataRecord* record)
 		return;
 	}
 	
-	Connection conn(record);
+	Connection conn(record, extractor);
 	conn.swapIfNeeded();
 
 	matchConnection(&conn);
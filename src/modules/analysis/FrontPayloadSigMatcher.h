@@ -48,6 +48,7 @@ class FrontPayloadSigMatcher
 	private:
 		string signatureDir;
 		Matcher* sigmatcher;
+		ConnectionExtractor extractor; /**< all fields are read as matches are logged with Connection::toString() */
 
 		void matchConnection(Connection* conn);
 		virtual string getStatisticsXML(double interval);
@@ -24,11 +24,13 @@
 
 #include <netdb.h>
 #include <fstream>
+#include <algorithm>
 
 InstanceManager<Host> HostStatistics::hostManager("Host");
 
 HostStatistics::HostStatistics(std::string ipSubnet, std::string addrFilter, std::string logPath)
-	: ipSubnet(ipSubnet), addrFilter(addrFilter), logPath(logPath)
+	: ipSubnet(ipSubnet), addrFilter(addrFilter), logPath(logPath),
+	  extractor(Connection::ADDRESSES|Connection::PORTS|Connection::TIMES|Connection::COUNTERS, "HostStatistics")
 {
 	// check if srcIP or dstIP in the subnet (1.1.1.1/16)
 	// split string at the '/'
@@ -67,29 +69,27 @@ void HostStatistics::onDataRecord(IpfixDataRecord* record)
 		return;
 	}
 	
-	Connection conn(record);
-	HostMap::iterator it;
-
-//	FILE* logFile = fopen("host_stats.log", "a");
+	Connection conn(record, extractor);
 
 	if ((addrFilter == "src" || addrFilter == "both") && ((conn.srcIP&netAddr) == netAddr)) {
-		it = hostMap.find(conn.srcIP);
-		if (it == hostMap.end())	{
-			Host* h = hostManager.getNewInstance();
-			h->setIP(conn.srcIP);
-			it = hostMap.insert(pair<uint32_t, Host*>(conn.srcIP, h)).first;
-		}
-		it->second->addConnection(&conn);
+		addConnection(conn.srcIP, &conn);
 	} 
 	if ((addrFilter == "dst" || addrFilter == "both") && ((conn.dstIP&netAddr) == netAddr)) {
-		it = hostMap.find(conn.dstIP);
-		if (it == hostMap.end()) {
-			Host* h = hostManager.getNewInstance();
-			h->setIP(conn.dstIP);
-			it = hostMap.insert(pair<uint32_t, Host*>(conn.dstIP, h)).first;
-		} 
-		it->second->addConnection(&conn);
+		addConnection(conn.dstIP, &conn);
+	}
+
+	record->removeReference();
+}
+
+void HostStatistics::addConnection(uint32_t ip, Connection* conn)
+{
+	bool created;
+	Host*& h = hostMap.get(ip, &created);
+	if (created) {
+		h = hostManager.getNewInstance();
+		h->setIP(ip);
 	}
+	h->addConnection(conn);
 }
 
 void HostStatistics::onReconfiguration1()
@@ -99,12 +99,19 @@ void HostStatistics::onReconfiguration1()
 
 void HostStatistics::dumpStatistics()
 {
-	HostMap::iterator it;
 	std::fstream outfile(logPath.c_str(), fstream::out);
 	outfile << "# ip answeredFlows unansweredFlows sentBytes sentPackets recBytes recPackets recHighPorts sentHighports recLowPorts sentLowPorts" << std::endl;
 
+	// hosts are written in ascending order of their (network byte order) address
+	std::vector<std::pair<uint32_t, Host*> > hosts;
+	hosts.reserve(hostMap.size());
+	for (uint32_t i = 0; i < hostMap.size(); i++) {
+		hosts.push_back(std::make_pair(hostMap.at(i).key, hostMap.at(i).data));
+	}
+	std::sort(hosts.begin(), hosts.end());
+
 	// for each element in ipList, write an entry like: IP:Bytesum
-	for (it = hostMap.begin(); it != hostMap.end(); it++) {
+	for (std::vector<std::pair<uint32_t, Host*> >::iterator it = hosts.begin(); it != hosts.end(); it++) {
 		Host* h = it->second;
 		outfile << IPToString(it->first).c_str() << " "
 			<< h->answeredFlows << " "
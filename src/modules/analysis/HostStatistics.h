@@ -21,9 +21,9 @@
 #define HOSTSTATISTICS_H_
 
 #include <time.h>
-#include <map>
 
 #include "modules/ipfix/IpfixRecordDestination.h"
+#include "common/HostTable.h"
 #include "Host.h"
 
 
@@ -47,8 +47,10 @@ private:
 	uint32_t netAddr;
 	uint8_t netSize;
 	time_t logTimer;
-	typedef std::map<uint32_t, Host*> HostMap;
-	HostMap hostMap;
+	HostTable<Host*> hostMap;
+	ConnectionExtractor extractor; /**< reads only the fields used by this module */
+
+	void addConnection(uint32_t ip, Connection* conn);
 };
 
 #endif /* HOSTSTATISTICS_H_ */
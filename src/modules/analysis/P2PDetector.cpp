@@ -50,7 +50,8 @@ P2PDetector::P2PDetector(uint32_t intLength, uint32_t subnet, uint32_t subnetmas
 	tcpFailedRateThreshold(tcpFailedRateThreshold),
 	tcpFailedVarianceThreshold(tcpFailedVarianceThreshold),
 	analyzerId(analyzerid),
-	idmefTemplate(tpl)
+	idmefTemplate(tpl),
+	extractor(Connection::ADDRESSES|Connection::PROTOCOL|Connection::TIMES|Connection::COUNTERS|Connection::TCP_FLAGS, "P2PDetector")
 {
 }
 
@@ -72,7 +73,7 @@ void P2PDetector::onDataRecord(IpfixDataRecord* record)
 	
 	
 	// convert ipfixrecord to connection struct
-	Connection conn(record);
+	Connection conn(record, extractor);
 	conn.swapIfNeeded();
 
 	if((conn.srcIP & subnetmask) == (subnet & subnetmask)){
@@ -77,6 +77,7 @@ class P2PDetector
 		//to send idmef messages
 		string analyzerId;
 		string idmefTemplate;
+		ConnectionExtractor extractor; /**< reads only the fields used by this module */
 		// manages instances of IDMEFMessages
 		static InstanceManager<IDMEFMessage> idmefManager;
 
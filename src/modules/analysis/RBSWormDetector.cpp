@@ -19,9 +19,9 @@
  */
 
 #include "RBSWormDetector.h"
-#include "common/crc.hpp"
 #include "common/Misc.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <math.h>
 #include <iostream>
@@ -52,10 +52,12 @@ RBSWormDetector::RBSWormDetector(uint32_t hashbits, uint32_t texppend,
 	analyzerId(analyzerid),
 	idmefTemplate(idmeftemplate),
 	lambda_ratio(lambdaratio),	
-	subnets(subNets)
+	subnets(subNets),
+	rbsEntries(hashbits),
+	cleanupRunning(false),
+	extractor(Connection::ADDRESSES|Connection::TIMES|Connection::TCP_FLAGS, "RBSWormDetector")
 {
 	// make some initialization calculations
-	hashSize = 1<<hashBits;
 	lambda_0 = 0;
 
 
@@ -84,7 +86,6 @@ RBSWormDetector::RBSWormDetector(uint32_t hashbits, uint32_t texppend,
 	statNumWorms = 0;
 	statCurBenign = 0;
 
-	rbsEntries = new list<RBSEntry*>[hashSize];
 	msg(LOG_NOTICE,"RBSWormDetector started");
 }
 /*
@@ -92,7 +93,6 @@ RBSWormDetector::RBSWormDetector(uint32_t hashbits, uint32_t texppend,
  */
 RBSWormDetector::~RBSWormDetector()
 {
-	delete[] rbsEntries;
 }
 
 void RBSWormDetector::onDataRecord(IpfixDataRecord* record)
@@ -105,7 +105,7 @@ void RBSWormDetector::onDataRecord(IpfixDataRecord* record)
 	}
 	
 	// convert ipfixrecord to connection struct
-	Connection conn(record);
+	Connection conn(record, extractor);
 
 	conn.swapIfNeeded();
 	// only use this connection if it was a connection attempt
@@ -140,8 +140,7 @@ void RBSWormDetector::addConnection(Connection* conn)
 	// FOLLOWING CODE IS FOR BENIGN AND PENDING HOSTS
 
 	// only work with this connection, if it wasn't accessed earlier by this host
-	if (find(te->accessedHosts.begin(), te->accessedHosts.end(), conn->dstIP) != te->accessedHosts.end()) return;
-	te->accessedHosts.push_back(conn->dstIP);
+	if (!te->accessedHosts.insert(conn->dstIP)) return;
 
 	//host was moved from benign to pending (for average fanouts)
 	if (te->switched)	
@@ -214,13 +213,18 @@ void RBSWormDetector::addConnection(Connection* conn)
 		msg->setVariable(PAR_FAN_OUT, (uint32_t) te->numFanouts);
 		msg->setVariable(PAR_TOTALTIME, trace_ela);
 		string hosts;
-		list<uint32_t>::iterator iter = te->accessedHosts.begin();
-		while(iter != te->accessedHosts.end()) 
+		vector<uint32_t> accessed;
+		te->accessedHosts.getAddresses(accessed);
+		for (vector<uint32_t>::iterator iter = accessed.begin(); iter != accessed.end(); iter++)
 		{
 		hosts.append(IPToString(*iter));
 		hosts.append(" ");
-		iter++;
-		}	
+		}
+		if (!te->accessedHosts.isExact()) {
+			ostringstream oss;
+			oss << "(about " << te->accessedHosts.size() << " hosts)";
+			hosts.append(oss.str());
+		}
 		msg->setVariable(PAR_HOSTS,hosts.c_str());
 		msg->setVariable(IDMEFMessage::PAR_SOURCE_ADDRESS, IPToString(te->srcIP));
 		msg->applyVariables();
@@ -235,7 +239,6 @@ void RBSWormDetector::addConnection(Connection* conn)
 RBSWormDetector::RBSEntry* RBSWormDetector::getEntry(Connection* conn)
 {
 	time_t curtime = time(0);
-	uint32_t hash = crc32(0, 4, reinterpret_cast<char*>(&conn->srcIP)) & (hashSize-1);
 
 	//regularly adapt new values
 	if (lastAdaption+timeAdaptInterval < (uint32_t) curtime) 
@@ -245,85 +248,62 @@ RBSWormDetector::RBSEntry* RBSWormDetector::getEntry(Connection* conn)
 		
 	}
 
-	// regularly cleanup expired entries in hashtable
+	// regularly cleanup expired entries in hashtable, a few entries per connection
 	if (lastCleanup+timeCleanupInterval < (uint32_t)curtime) {
 		lastCleanup = curtime;
-		cleanupEntries();		
-	}
-
-	list<RBSEntry*>::iterator iter = rbsEntries[hash].begin();
-	while (iter != rbsEntries[hash].end()) {
-		if ((*iter)->srcIP == conn->srcIP) {
-			// found the entry
-			return *iter;
-		}
-		iter++;
+		cleanupRunning = true;
 	}
+	if (cleanupRunning) cleanupRunning = !cleanupEntries(curtime);
 
-	// no entry found, create a new one
-	RBSEntry* rbs = createEntry(conn);
-	rbsEntries[hash].push_back(rbs);
+	bool created;
+	RBSEntry* rbs = &rbsEntries.get(conn->srcIP, &created);
+	if (created) initEntry(rbs, conn);
 
 	return rbs;
 }
 
 /**
- * creates a new rbs entry and sets status to pending
+ * initializes a new rbs entry and sets status to pending
  */
 
-RBSWormDetector::RBSEntry* RBSWormDetector::createEntry(Connection* conn)
+void RBSWormDetector::initEntry(RBSEntry* rbs, Connection* conn)
 {
-	RBSEntry* rbs = new RBSEntry();
 	rbs->srcIP = conn->srcIP;
 	rbs->numFanouts = 0;
 	rbs->totalSSDur = 0;
 	rbs->lastPacket = 0;
 	rbs->startTime = conn->srcTimeStart;
 	rbs->totalSSNum = 0;
+	rbs->switched = false;
 	rbs->timeExpire = time(0) + timeExpirePending;
 	rbs->decision = PENDING;
 	rbs->mean = 0;
 	statEntriesAdded++;
-	return rbs;
 }
 
 /**
- * erases entries in our hashtable which are expired
+ * processes next expired entries in our hashtable
+ * @returns true if all entries were checked
  */	
-void RBSWormDetector::cleanupEntries()
+bool RBSWormDetector::cleanupEntries(time_t curtime)
 {
-	time_t curtime = time(0);
-
-	for (uint32_t i=0; i<hashSize; i++) {
-		if (rbsEntries[i].size()==0) continue;
-
-		list<RBSEntry*>::iterator iter = rbsEntries[i].begin();
-		while (iter != rbsEntries[i].end()) {
-			if (curtime > (*iter)->timeExpire) {
-				RBSEntry* te = *iter;
-				//BENIGN Host are not erased but moved to pending state with all stats reset except the subsecond interarrival times
-				if ((*iter)->decision == BENIGN)
-				{
-				te->decision = PENDING;
-				te->switched = true;
-				te->numFanouts = 0;
-				te->timeExpire = time(0) + timeExpirePending;
-				te->accessedHosts.clear();
-				statCurBenign--;
-				iter++;
-				}
-				else
-				{
-				//Host can be cleaned
-				iter = rbsEntries[i].erase(iter);
-				delete te;
-				statEntriesRemoved++;
-				}
-			} else {
-				iter++;
-			}
+	return rbsEntries.sweep(HostTable<RBSEntry>::SWEEP_STEP, [&](uint32_t, RBSEntry& te) {
+		if (curtime <= te.timeExpire) return false;
+		//BENIGN Host are not erased but moved to pending state with all stats reset except the subsecond interarrival times
+		if (te.decision == BENIGN)
+		{
+		te.decision = PENDING;
+		te.switched = true;
+		te.numFanouts = 0;
+		te.timeExpire = curtime + timeExpirePending;
+		te.accessedHosts.clear();
+		statCurBenign--;
+		return false;
 		}
-	}
+		//Host can be cleaned
+		statEntriesRemoved++;
+		return true;
+	});
 }
 
 /**
@@ -334,32 +314,25 @@ void RBSWormDetector::adaptFrequencies ()
 	uint32_t count = 0;	
 	double temp1 = 0;
 
-	list<RBSEntry*> adaptList;	
+	vector<RBSEntry*> adaptList;	
 	bool first = false;
 	if (lambda_0 == 0) first = true;
 
 	//put all entries in one list to calculate trimmed mean
-	for (uint32_t i=0; i<hashSize; i++) {
-		if (rbsEntries[i].size()==0) continue;
-
-		list<RBSEntry*>::iterator iter = rbsEntries[i].begin();
-
-		while (iter != rbsEntries[i].end()) 
+	for (uint32_t i=0; i<rbsEntries.size(); i++) {
+		RBSEntry* te = &rbsEntries.at(i).data;
+		if (te->mean != 0 && te->decision != WORM)
 		{
-			if ((*iter)->mean != 0 && (*iter)->decision != WORM)
-			{
-			adaptList.push_back(*iter);
-			}
-			iter++;	
+		adaptList.push_back(te);
 		}
 	}
 	//sort list to cut off top and bottom 10 percent
-	adaptList.sort(RBSWormDetector::comp_entries);	
+	std::sort(adaptList.begin(), adaptList.end(), RBSWormDetector::comp_entries);	
 
 	msg(LOG_CRIT,"meta list size %zu",adaptList.size());
 	uint32_t num10 = adaptList.size()/10;
 
-	list<RBSEntry*>::iterator iter = adaptList.begin();
+	vector<RBSEntry*>::iterator iter = adaptList.begin();
 
 	uint32_t valid = 0;
 	while (iter != adaptList.end()) 
@@ -406,20 +379,8 @@ void RBSWormDetector::adaptFrequencies ()
 	if (!first) return;
 
 	//after the first adaption all hosts are cleared no matter what.
-	for (uint32_t i=0; i<hashSize; i++) 
-	{
-		if (rbsEntries[i].size()==0) continue;
-
-		list<RBSEntry*>::iterator iter = rbsEntries[i].begin();
-
-		while (iter != rbsEntries[i].end()) 
-		{
-			RBSEntry* te = *iter;
-			iter=rbsEntries[i].erase(iter);
-			delete te;
-			statEntriesRemoved++;
-		}
-	}
+	statEntriesRemoved += rbsEntries.size();
+	rbsEntries.clear();
 }
 
 /*
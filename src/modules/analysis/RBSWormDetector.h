@@ -24,8 +24,9 @@
 #include "modules/ipfix/IpfixRecordDestination.h"
 #include "modules/ipfix/Connection.h"
 #include "core/Source.h"
+#include "common/HostTable.h"
+#include "common/DestinationSet.h"
 
-#include <list>
 #include <string>
 #include <map>
 
@@ -55,12 +56,11 @@ class RBSWormDetector
 			bool switched;
 			double mean;
 			int32_t timeExpire;
-			list<uint32_t> accessedHosts;
+			DestinationSet accessedHosts;
 			RBSDecision decision;
 		};
 
-		uint32_t hashSize;
-		uint32_t hashBits;	/**< amount of bits used for hashtable */
+		uint32_t hashBits;	/**< log2 of initial number of slots in hashtable */
 		uint32_t timeExpirePending; // time in seconds until pending entries are expired
 		uint32_t timeExpireWorm; // time in seconds until worm entries are expired
 		uint32_t timeExpireBenign; // time in seconds until benign entries are expired
@@ -76,7 +76,7 @@ class RBSWormDetector
 		const static char* PAR_HOSTS; // = "FAN_OUT";
 		
 
-		list<RBSEntry*>* rbsEntries;
+		HostTable<RBSEntry> rbsEntries;
 		uint32_t statEntriesAdded;
 		uint32_t statEntriesRemoved;
 		uint32_t statNumWorms;
@@ -84,17 +84,19 @@ class RBSWormDetector
 		float lambda_0,lambda_1;
 		float slope_0a,slope_0b,slope_1a,slope_1b;
 		time_t lastCleanup,lastAdaption;
+		bool cleanupRunning; /**< expired entries are processed incrementally until all entries were checked */
+		ConnectionExtractor extractor; /**< reads only the fields used by this module */
 		
 		// manages instances of IDMEFMessages
 		static InstanceManager<IDMEFMessage> idmefManager;
 
-		RBSEntry* createEntry(Connection* conn);
+		void initEntry(RBSEntry* rbs, Connection* conn);
 		RBSEntry* getEntry(Connection* conn);
 		void addConnection(Connection* conn);
 		static bool comp_entries(RBSEntry*,RBSEntry*);
 		virtual string getStatistics();
 		virtual std::string getStatisticsXML(double);
-		void cleanupEntries();
+		bool cleanupEntries(time_t curtime);
 		void adaptFrequencies();
 };
 
@@ -18,7 +18,6 @@
  */
 
 #include "TRWPortscanDetector.h"
-#include "common/crc.hpp"
 #include "common/Misc.h"
 
 #include <arpa/inet.h>
@@ -45,10 +44,15 @@ TRWPortscanDetector::TRWPortscanDetector(uint32_t hashbits, uint32_t texppend,
 	  timeExpireBenign(texpben),
 	  timeCleanupInterval(tcleanint),
 	  analyzerId(analyzerid),
-	  idmefTemplate(idmeftemplate)
+	  idmefTemplate(idmeftemplate),
+	  trwEntries(hashbits),
+	  statEntriesAdded(0),
+	  statEntriesRemoved(0),
+	  statNumScanners(0),
+	  cleanupRunning(false),
+	  extractor(Connection::ADDRESSES|Connection::TIMES|Connection::TCP_FLAGS, "TRWPortscanDetector")
 {
 	// make some initialization calculations
-	hashSize = 1<<hashBits;
 	float theta_0 = 0.8; // probability that benign host makes successful connection
 	float theta_1 = 0.2; // probability that malicious host makes successful connection
 	float P_F = 0.00001; // probability of false alarm
@@ -62,17 +66,10 @@ TRWPortscanDetector::TRWPortscanDetector(uint32_t hashbits, uint32_t texppend,
 	X_1 = logf((1-theta_1)/(1-theta_0));
 	msg(LOG_NOTICE, "TRW variables: logeta_0: %f, logeta_1: %f, X_0: %f, X_1: %f", logeta_0, logeta_1, X_0, X_1);
 	lastCleanup = time(0);
-	
-	try {
-		trwEntries = new list<TRWEntry*>[hashSize];
-	} catch(std::bad_alloc& ba) {
-		THROWEXCEPTION("Error allocating TRWEntries in TRWPortscanDetector. Try reducing the number of hashbits: %s", ba.what());
-	}
 }
 
 TRWPortscanDetector::~TRWPortscanDetector()
 {
-	delete[] trwEntries;
 }
 
 void TRWPortscanDetector::onDataRecord(IpfixDataRecord* record)
@@ -85,7 +82,7 @@ void TRWPortscanDetector::onDataRecord(IpfixDataRecord* record)
 	}
 	
 	// convert ipfixrecord to connection struct
-	Connection conn(record);
+	Connection conn(record, extractor);
 	
 	conn.swapIfNeeded();
 
@@ -97,9 +94,8 @@ void TRWPortscanDetector::onDataRecord(IpfixDataRecord* record)
 	record->removeReference();
 }
 
-TRWPortscanDetector::TRWEntry* TRWPortscanDetector::createEntry(Connection* conn)
+void TRWPortscanDetector::initEntry(TRWEntry* trw, Connection* conn)
 {
-	TRWEntry* trw = new TRWEntry();
 	trw->srcIP = conn->srcIP;
 	trw->dstSubnet = 0;
 	trw->dstSubnetMask = 0xFFFFFFFF;
@@ -110,32 +106,19 @@ TRWPortscanDetector::TRWEntry* TRWPortscanDetector::createEntry(Connection* conn
 	trw->S_N = 0;
 
 	statEntriesAdded++;
-
-	return trw;
 }
 
 /**
- * erases entries in our hashtable which are expired
+ * erases next expired entries in our hashtable
+ * @returns true if all entries were checked
  */
-void TRWPortscanDetector::cleanupEntries()
+bool TRWPortscanDetector::cleanupEntries(time_t curtime)
 {
-	time_t curtime = time(0);
-
-	for (uint32_t i=0; i<hashSize; i++) {
-		if (trwEntries[i].size()==0) continue;
-
-		list<TRWEntry*>::iterator iter = trwEntries[i].begin();
-		while (iter != trwEntries[i].end()) {
-			if (curtime > (*iter)->timeExpire) {
-				TRWEntry* te = *iter;
-				iter = trwEntries[i].erase(iter);
-				delete te;
-				statEntriesRemoved++;
-			} else {
-				iter++;
-			}
-		}
-	}
+	return trwEntries.sweep(HostTable<TRWEntry>::SWEEP_STEP, [&](uint32_t, TRWEntry& te) {
+		if (curtime <= te.timeExpire) return false;
+		statEntriesRemoved++;
+		return true;
+	});
 }
 
 /**
@@ -145,26 +128,17 @@ void TRWPortscanDetector::cleanupEntries()
 TRWPortscanDetector::TRWEntry* TRWPortscanDetector::getEntry(Connection* conn)
 {
 	time_t curtime = time(0);
-	uint32_t hash = crc32(0, 2, &reinterpret_cast<char*>(&conn->srcIP)[2]) & (hashSize-1);
 
-	// regularly cleanup expired entries in hashtable
+	// regularly cleanup expired entries in hashtable, a few entries per connection
 	if (lastCleanup+timeCleanupInterval < (uint32_t)curtime) {
-		cleanupEntries();
+		cleanupRunning = true;
 		lastCleanup = curtime;
 	}
+	if (cleanupRunning) cleanupRunning = !cleanupEntries(curtime);
 
-	list<TRWEntry*>::iterator iter = trwEntries[hash].begin();
-	while (iter != trwEntries[hash].end()) {
-		if ((*iter)->srcIP == conn->srcIP) {
-			// found the entry
-			return *iter;
-		}
-		iter++;
-	}
-
-	// no entry found, create a new one
-	TRWEntry* trw = createEntry(conn);
-	trwEntries[hash].push_back(trw);
+	bool created;
+	TRWEntry* trw = &trwEntries.get(conn->srcIP, &created);
+	if (created) initEntry(trw, conn);
 
 	return trw;
 }
@@ -192,9 +166,7 @@ void TRWPortscanDetector::addConnection(Connection* conn)
 	te->timeExpire = time(0) + timeExpirePending;
 
 	// only work with this connection, if it wasn't accessed earlier by this host
-	if (find(te->accessedHosts.begin(), te->accessedHosts.end(), conn->dstIP) != te->accessedHosts.end()) return;
-
-	te->accessedHosts.push_back(conn->dstIP);
+	if (!te->accessedHosts.insert(conn->dstIP)) return;
 
 	te->S_N += (connsuccess ? X_0 : X_1);
 
@@ -24,8 +24,9 @@
 #include "modules/ipfix/IpfixRecordDestination.h"
 #include "modules/ipfix/Connection.h"
 #include "core/Source.h"
+#include "common/HostTable.h"
+#include "common/DestinationSet.h"
 
-#include <list>
 #include <string>
 
 using namespace std;
@@ -51,13 +52,12 @@ class TRWPortscanDetector
 			uint32_t numFailedConns;
 			uint32_t numSuccConns;
 			int32_t timeExpire;
-			list<uint32_t> accessedHosts;
+			DestinationSet accessedHosts;
 			float S_N;
 			TRWDecision decision;
 		};
 
-		uint32_t hashSize;
-		uint32_t hashBits;	/**< amount of bits used for hashtable */
+		uint32_t hashBits;	/**< log2 of initial number of slots in hashtable */
 		uint32_t timeExpirePending; // time in seconds until pending entries are expired
 		uint32_t timeExpireScanner; // time in seconds until scanner entries are expired
 		uint32_t timeExpireBenign; // time in seconds until benign entries are expired
@@ -70,22 +70,24 @@ class TRWPortscanDetector
 		const static char* PAR_SUCC_CONNS; // = "SUCC_CONNS";
 		const static char* PAR_FAILED_CONNS; // = "FAILED_CONNS";
 
-		list<TRWEntry*>* trwEntries;
+		HostTable<TRWEntry> trwEntries;
 		uint32_t statEntriesAdded;
 		uint32_t statEntriesRemoved;
 		uint32_t statNumScanners;
 		float logeta_0, logeta_1;
 		float X_0, X_1;
 		time_t lastCleanup;
+		bool cleanupRunning; /**< expired entries are removed incrementally until all entries were checked */
+		ConnectionExtractor extractor; /**< reads only the fields used by this module */
 		
 		// manages instances of IDMEFMessages
 		static InstanceManager<IDMEFMessage> idmefManager;
 
-		TRWEntry* createEntry(Connection* conn);
+		void initEntry(TRWEntry* trw, Connection* conn);
 		TRWEntry* getEntry(Connection* conn);
 		void addConnection(Connection* conn);
 		virtual string getStatisticsXML(double interval);
-		void cleanupEntries();
+		bool cleanupEntries(time_t curtime);
 };
 
 #endif
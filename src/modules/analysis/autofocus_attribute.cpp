@@ -91,9 +91,8 @@ void atr_failed::aggregate(IPRecord* te,Connection* conn)
 void atr_simult::aggregate(IPRecord* te,Connection* conn)
 {
 
-	if (find(accessedHosts.begin(), accessedHosts.end(), conn->dstIP) != accessedHosts.end()) return;
+	if (!accessedHosts.insert(conn->dstIP)) return;
 
-	accessedHosts.push_back(conn->dstIP);
 	numCount++;
 	m_report->aggregate(1);	
 
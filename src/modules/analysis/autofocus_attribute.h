@@ -3,6 +3,7 @@
 
 #include "modules/ipfix/Connection.h"
 #include "autofocus_iprecord.h"
+#include "common/DestinationSet.h"
 #include <list>
 
 class report;
@@ -87,7 +88,7 @@ class atr_failed : public af_attribute
 class atr_simult : public af_attribute
 {
 	private:
-		list<uint32_t> accessedHosts;
+		DestinationSet accessedHosts;
 	public:	
 		~atr_simult();
 		atr_simult(report* r):af_attribute(r){};
@@ -19,15 +19,15 @@
 
 
 #include "IDMEFExporter.h"
+#include "common/Time.h"
+#include "common/SignalHandler.h"
 
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
 #include <cstring>
-
-uint32_t IDMEFExporter::filenameCounter = 0;
-
-bool IDMEFExporter::filewarningIssued = false;
-Mutex IDMEFExporter::mutex;
-
+#include <errno.h>
 
 
 /**
@@ -38,12 +38,66 @@ Mutex IDMEFExporter::mutex;
  */
 IDMEFExporter::IDMEFExporter(const string destdir, const string sendurl)
 	: destinationDir(destdir),
-	  sendURL(sendurl)
+	  sendURL(sendurl),
+	  mode(FILES),
+	  spoolMaxSize(10*1024*1024),
+	  spoolMaxAge(60),
+	  maxQueued(10000),
+	  writerExit(false),
+	  writerThread(IDMEFExporter::writerThreadWrapper, "IDMEFExporter"),
+	  filenameCounter(0),
+	  filewarningIssued(false),
+	  spoolFile(NULL),
+	  spoolBytes(0),
+	  spoolStart(0),
+	  spoolCounter(0),
+	  spoolWarningIssued(false),
+	  pipeFd(-1),
+	  pipeWarningIssued(false),
+	  statReceived(0),
+	  statWritten(0),
+	  statDropped(0),
+	  statFailed(0),
+	  statSpoolFiles(0),
+	  statQueuePeak(0)
 {
+	pthread_mutex_init(&queueMutex, NULL);
+	pthread_cond_init(&queueCond, NULL);
 }
 
 IDMEFExporter::~IDMEFExporter()
 {
+	pthread_cond_destroy(&queueCond);
+	pthread_mutex_destroy(&queueMutex);
+}
+
+/**
+ * appends messages to spool files instead of writing one file per message
+ * @param maxsize spool files are closed after this number of bytes
+ * @param maxage spool files are closed after this number of seconds
+ */
+void IDMEFExporter::setSpoolOutput(uint64_t maxsize, uint32_t maxage)
+{
+	mode = SPOOL;
+	spoolMaxSize = maxsize;
+	spoolMaxAge = maxage;
+}
+
+/**
+ * writes messages to given named pipe instead of the destination directory
+ */
+void IDMEFExporter::setPipeOutput(const string pipepath)
+{
+	mode = PIPE;
+	pipePath = pipepath;
+}
+
+/**
+ * sets the maximum number of messages waiting to be written
+ */
+void IDMEFExporter::setMaxQueuedMessages(uint32_t count)
+{
+	maxQueued = count;
 }
 
 
@@ -56,7 +110,7 @@ string IDMEFExporter::getFilename()
 {
 	struct stat s;
 	char number[100];
-	snprintf(number, 100, "%010d", filenameCounter);
+	snprintf(number, 100, "%010u", filenameCounter);
 	string filename = destinationDir + "/" + number + ".xml";
 	uint32_t counter = 0;
 	while (stat(filename.c_str(), &s) == 0) {
@@ -65,11 +119,11 @@ string IDMEFExporter::getFilename()
 			filewarningIssued = true;
 		}
 		if (counter == 0xFFFFFFFF) {
-			THROWEXCEPTION("failed to find an accessible file in IDMEF destination directory %s", destinationDir.c_str());
+			return "";
 		}
 		filenameCounter++;
 		counter++;
-		snprintf(number, 100, "%010d", filenameCounter);
+		snprintf(number, 100, "%010u", filenameCounter);
 		filename = destinationDir + "/" + number + ".xml";
 	}
 
@@ -79,40 +133,306 @@ string IDMEFExporter::getFilename()
 }
 
 /**
- * exports an IDMEF message
- * to do this, the internally stored IDMEF template is processed with all keys of the internal
- * parameterMap and then the file is saved in the destination directory
+ * stores an IDMEF message in a new file in the destination directory
  * the external process which sends the IDMEF messages uses the URL given in the first line of
  * the saved message
  */
-void IDMEFExporter::exportMessage(const string idmefmsg)
+bool IDMEFExporter::writeFile(const string& idmefmsg)
 {
-	DPRINTF_INFO("sending IDMEF message");
-
 	string filename = getFilename();
+	if (filename.empty()) {
+		msg(LOG_ERR, "failed to find an accessible file in IDMEF destination directory %s", destinationDir.c_str());
+		return false;
+	}
 
 	// save message to destination directory
 	FILE* f = fopen(filename.c_str(), "w+");
 	if (f == NULL) goto error;
-	flockfile(f);
 	// first line is URL where processing script should send event to
 	if (fwrite(sendURL.c_str(), 1, sendURL.size(), f) != sendURL.size()) goto error;
 	if (fwrite("\n", 1, 1, f) != 1) goto error;
 	if (fwrite(idmefmsg.c_str(), 1, idmefmsg.size(), f) != idmefmsg.size()) goto error;
 	if (fwrite("\n", 1, 1, f) != 1) goto error;
-	funlockfile(f);
-	if (fclose(f) != 0) goto error;
-
-	mutex.unlock();
+	if (fclose(f) != 0) {
+		f = NULL;
+		goto error;
+	}
 
-	return;
+	return true;
 
 error:
-	THROWEXCEPTION("failed to write to file %s, error: %s", filename.c_str(), strerror(errno));
+	msg(LOG_ERR, "failed to write to file %s, error: %s", filename.c_str(), strerror(errno));
+	if (f) fclose(f);
+	return false;
+}
+
+/**
+ * appends an IDMEF message to the current spool file, a new one is opened if necessary
+ */
+bool IDMEFExporter::writeSpool(const string& idmefmsg)
+{
+	if (!spoolFile) {
+		char name[100];
+		time_t now = time(0);
+		snprintf(name, ARRAY_SIZE(name), "%010u-%06u.spool", (uint32_t)now, spoolCounter++);
+		spoolName = name;
+		string tmpname = destinationDir + "/." + spoolName;
+		spoolFile = fopen(tmpname.c_str(), "w");
+		if (!spoolFile) {
+			if (!spoolWarningIssued) {
+				msg(LOG_ERR, "IDMEFExporter: failed to create spool file %s, error: %s", tmpname.c_str(), strerror(errno));
+				spoolWarningIssued = true;
+			}
+			return false;
+		}
+		spoolWarningIssued = false;
+		spoolBytes = 0;
+		spoolStart = now;
+	}
+
+	int len = fprintf(spoolFile, "%zu %s\n", idmefmsg.size(), sendURL.c_str());
+	if (len < 0 || fwrite(idmefmsg.c_str(), 1, idmefmsg.size(), spoolFile) != idmefmsg.size()
+			|| fwrite("\n", 1, 1, spoolFile) != 1) {
+		msg(LOG_ERR, "IDMEFExporter: failed to write to spool file %s, error: %s", spoolName.c_str(), strerror(errno));
+		closeSpool();
+		return false;
+	}
+	spoolBytes += len+idmefmsg.size()+1;
+	if (spoolBytes >= spoolMaxSize) closeSpool();
+
+	return true;
+}
+
+/**
+ * closes the current spool file and hands it over to the sending process by removing the leading dot
+ */
+void IDMEFExporter::closeSpool()
+{
+	if (!spoolFile) return;
+
+	string tmpname = destinationDir + "/." + spoolName;
+	string filename = destinationDir + "/" + spoolName;
+	if (fclose(spoolFile) != 0) {
+		msg(LOG_ERR, "IDMEFExporter: failed to close spool file %s, error: %s", tmpname.c_str(), strerror(errno));
+	}
+	spoolFile = NULL;
+	if (rename(tmpname.c_str(), filename.c_str()) != 0) {
+		msg(LOG_ERR, "IDMEFExporter: failed to rename spool file %s, error: %s", tmpname.c_str(), strerror(errno));
+		return;
+	}
+
+	pthread_mutex_lock(&queueMutex);
+	statSpoolFiles++;
+	pthread_mutex_unlock(&queueMutex);
+}
+
+/**
+ * opens the pipe without waiting for a reader
+ * @returns false if no reader is available
+ */
+bool IDMEFExporter::openPipe()
+{
+	pipeFd = open(pipePath.c_str(), O_WRONLY|O_NONBLOCK);
+	if (pipeFd < 0) {
+		if (!pipeWarningIssued) {
+			msg(LOG_WARNING, "IDMEFExporter: failed to open pipe %s (%s), keeping messages until a reader is available", pipePath.c_str(), strerror(errno));
+			pipeWarningIssued = true;
+		}
+		return false;
+	}
+	// further writes may block this thread as long as the reader is busy
+	int flags = fcntl(pipeFd, F_GETFL);
+	if (flags < 0 || fcntl(pipeFd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+		msg(LOG_ERR, "IDMEFExporter: failed to set flags of pipe %s, error: %s", pipePath.c_str(), strerror(errno));
+		close(pipeFd);
+		pipeFd = -1;
+		return false;
+	}
+	msg(LOG_NOTICE, "IDMEFExporter: opened pipe %s", pipePath.c_str());
+	pipeWarningIssued = false;
+	return true;
+}
+
+bool IDMEFExporter::writeAll(const char* data, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = write(pipeFd, data, len);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data += n;
+		len -= n;
+	}
+	return true;
+}
+
+/**
+ * writes an IDMEF message to the pipe, the pipe is closed if the reader disappeared
+ */
+bool IDMEFExporter::writePipe(const string& idmefmsg)
+{
+	if (pipeFd < 0 && !openPipe()) return false;
+
+	char header[50];
+	snprintf(header, ARRAY_SIZE(header), "%zu ", idmefmsg.size());
+	if (!writeAll(header, strlen(header)) || !writeAll(sendURL.c_str(), sendURL.size()) || !writeAll("\n", 1)
+			|| !writeAll(idmefmsg.c_str(), idmefmsg.size()) || !writeAll("\n", 1)) {
+		msg(LOG_WARNING, "IDMEFExporter: failed to write to pipe %s (%s), reopening it", pipePath.c_str(), strerror(errno));
+		close(pipeFd);
+		pipeFd = -1;
+		return false;
+	}
+	return true;
+}
+
+bool IDMEFExporter::writeMessage(const string& idmefmsg)
+{
+	DPRINTF_INFO("sending IDMEF message");
+
+	switch (mode) {
+		case FILES:
+			return writeFile(idmefmsg);
+		case SPOOL:
+			return writeSpool(idmefmsg);
+		case PIPE:
+			return writePipe(idmefmsg);
+	}
+	return false;
+}
+
+/**
+ * thread which writes all queued messages
+ * messages which cannot be written to the pipe are retried once per second
+ */
+void IDMEFExporter::writer()
+{
+	registerCurrentThread();
+
+	deque<string> batch;
+	pthread_mutex_lock(&queueMutex);
+	while (true) {
+		if (!writerExit && (pending.empty() || !batch.empty())) {
+			struct timespec timeout;
+			addToCurTime(&timeout, 1000);
+			pthread_cond_timedwait(&queueCond, &queueMutex, &timeout);
+		}
+		if (batch.empty()) {
+			batch.swap(pending);
+		} else {
+			for (deque<string>::iterator it = pending.begin(); it != pending.end(); it++) {
+				batch.push_back(string());
+				batch.back().swap(*it);
+			}
+			pending.clear();
+		}
+		bool exiting = writerExit;
+		pthread_mutex_unlock(&queueMutex);
+
+		uint64_t dropped = 0;
+		if (batch.size() > maxQueued) {
+			dropped = batch.size()-maxQueued;
+			batch.erase(batch.begin(), batch.begin()+dropped);
+		}
+		uint64_t written = 0;
+		uint64_t failed = 0;
+		while (!batch.empty()) {
+			if (writeMessage(batch.front())) {
+				written++;
+			} else {
+				if (mode == PIPE) break;
+				failed++;
+			}
+			batch.pop_front();
+		}
+		if (spoolFile && (exiting || time(0)-spoolStart >= (time_t)spoolMaxAge)) {
+			closeSpool();
+		} else if (spoolFile) {
+			fflush(spoolFile);
+		}
+		if (exiting && !batch.empty()) {
+			msg(LOG_ERR, "IDMEFExporter: dropping %zu messages which could not be written to pipe %s", batch.size(), pipePath.c_str());
+			dropped += batch.size();
+			batch.clear();
+		}
+
+		pthread_mutex_lock(&queueMutex);
+		statWritten += written;
+		statDropped += dropped;
+		statFailed += failed;
+		if (exiting && pending.empty()) break;
+	}
+	pthread_mutex_unlock(&queueMutex);
+
+	if (pipeFd >= 0) {
+		close(pipeFd);
+		pipeFd = -1;
+	}
+
+	unregisterCurrentThread();
+}
+
+void* IDMEFExporter::writerThreadWrapper(void* instance)
+{
+	static_cast<IDMEFExporter*>(instance)->writer();
+	return 0;
+}
+
+void IDMEFExporter::performStart()
+{
+	if (mode == PIPE) {
+		// failed writes are handled by writerThread
+		SignalHandler::getInstance().registerSignalHandler(SIGPIPE, this);
+	}
+	writerExit = false;
+	writerThread.run(this);
+}
+
+/**
+ * writes all queued messages and stops writerThread
+ */
+void IDMEFExporter::performShutdown()
+{
+	pthread_mutex_lock(&queueMutex);
+	writerExit = true;
+	pthread_cond_signal(&queueCond);
+	pthread_mutex_unlock(&queueMutex);
+	writerThread.join();
+
+	if (mode == PIPE) {
+		SignalHandler::getInstance().unregisterSignalHandler(SIGPIPE, this);
+	}
+}
+
+void IDMEFExporter::handleSigPipe(int sig)
+{
 }
 
 void IDMEFExporter::receive(IDMEFMessage* m)
 {
-	exportMessage(m->getMessage());
+	string idmefmsg(m->getMessage());
 	m->removeReference();
+
+	pthread_mutex_lock(&queueMutex);
+	if (pending.size() >= maxQueued) {
+		statDropped++;
+	} else {
+		pending.push_back(string());
+		pending.back().swap(idmefmsg);
+		statReceived++;
+		if (pending.size() > statQueuePeak) statQueuePeak = pending.size();
+		pthread_cond_signal(&queueCond);
+	}
+	pthread_mutex_unlock(&queueMutex);
+}
+
+string IDMEFExporter::getStatisticsXML(double interval)
+{
+	char buf[400];
+	pthread_mutex_lock(&queueMutex);
+	snprintf(buf, ARRAY_SIZE(buf), "<receivedMessages>%llu</receivedMessages><writtenMessages>%llu</writtenMessages><droppedMessages>%llu</droppedMessages><failedMessages>%llu</failedMessages><spoolFiles>%u</spoolFiles><queuedMessages>%zu</queuedMessages><queuedMessagesPeak>%u</queuedMessagesPeak>",
+			(long long unsigned)statReceived, (long long unsigned)statWritten, (long long unsigned)statDropped,
+			(long long unsigned)statFailed, statSpoolFiles, pending.size(), statQueuePeak);
+	pthread_mutex_unlock(&queueMutex);
+	return buf;
 }
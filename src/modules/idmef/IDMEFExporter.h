@@ -20,43 +20,100 @@
 #if !defined(IDMEFEXPORTER_H)
 #define IDMEFEXPORTER_H
 
-#include "common/Mutex.h"
 #include "IDMEFMessage.h"
 #include "core/Module.h"
+#include "common/Thread.h"
+#include "common/SignalInterface.h"
 
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
 #include <string>
+#include <deque>
 
 using namespace std;
 
 /**
  * this class is used for exporting IDMEF messages
- * the received IDMEF message is stored in the destination directory with a generated filename
+ *
+ * Received messages are queued and written by a separate thread, so modules generating
+ * IDMEF messages are not blocked by file operations. Output modes:
+ *  - files: each message is stored in the destination directory with a generated filename,
+ *    the first line contains the URL where the message is to be sent to
+ *  - spool: messages are appended to spool files in the destination directory which are
+ *    rotated after a maximum size or age. Files which are still written start with a dot.
+ *  - pipe: messages are written to a named pipe, messages are kept in the queue while no
+ *    reader is available
+ * In spool and pipe mode each message is preceded by a line containing its length in bytes
+ * and the URL, and is followed by a newline.
  */
 class IDMEFExporter
 	: public Module,
 	  public Destination<IDMEFMessage*>,
-	  public Source<NullEmitable*>
+	  public Source<NullEmitable*>,
+	  public SignalInterface
 {
 	public:
+		enum OutputMode { FILES, SPOOL, PIPE };
+
 		IDMEFExporter(const string destdir, const string sendurl);
 		virtual ~IDMEFExporter();
 
+		void setSpoolOutput(uint64_t maxsize, uint32_t maxage);
+		void setPipeOutput(const string pipepath);
+		void setMaxQueuedMessages(uint32_t count);
+
 		virtual void receive(IDMEFMessage* m);
+		virtual void performStart();
+		virtual void performShutdown();
+		virtual string getStatisticsXML(double interval);
+		virtual void handleSigPipe(int sig);
 
 	private:
-		string templateFilename;
 		string destinationDir;
 		string sendURL;
-		string hostname;
-		string ipaddress;
-		string analyzerId;
+		OutputMode mode;
+		string pipePath;
+		uint64_t spoolMaxSize; /**< spool files are rotated after this number of bytes */
+		uint32_t spoolMaxAge; /**< spool files are rotated after this number of seconds */
+		uint32_t maxQueued; /**< messages received while queue is full are dropped */
+
+		pthread_mutex_t queueMutex;
+		pthread_cond_t queueCond;
+		deque<string> pending; /**< messages which were not taken by writerThread yet */
+		bool writerExit;
+		Thread writerThread;
+
+		// state of writerThread
+		uint32_t filenameCounter;
+		bool filewarningIssued;
+		FILE* spoolFile;
+		string spoolName;
+		uint64_t spoolBytes;
+		time_t spoolStart;
+		uint32_t spoolCounter;
+		bool spoolWarningIssued;
+		int pipeFd;
+		bool pipeWarningIssued;
 
-		static uint32_t filenameCounter;
-		static Mutex mutex;
-		static bool filewarningIssued;
+		// statistics, protected by queueMutex
+		uint64_t statReceived;
+		uint64_t statWritten;
+		uint64_t statDropped;
+		uint64_t statFailed;
+		uint32_t statSpoolFiles;
+		uint32_t statQueuePeak;
 
+		void writer();
+		static void* writerThreadWrapper(void* instance);
+		bool writeMessage(const string& idmefmsg);
 		string getFilename();
-		void exportMessage(const string idmefmsg);
+		bool writeFile(const string& idmefmsg);
+		bool writeSpool(const string& idmefmsg);
+		bool writePipe(const string& idmefmsg);
+		void closeSpool();
+		bool openPipe();
+		bool writeAll(const char* data, size_t len);
 };
 
 #endif
@@ -11,7 +11,11 @@ IDMEFExporterCfg* IDMEFExporterCfg::create(XMLElement* e)
 
 IDMEFExporterCfg::IDMEFExporterCfg(XMLElement* elem)
     : CfgHelper<IDMEFExporter, IDMEFExporterCfg>(elem, "idmefExporter"),
-      destDirectory("idmef_work")
+      destDirectory("idmef_work"),
+      mode("files"),
+      spoolSize(10*1024*1024),
+      spoolInterval(60),
+      maxQueued(10000)
 {
     if (!elem) return;
 
@@ -25,6 +29,16 @@ IDMEFExporterCfg::IDMEFExporterCfg(XMLElement* elem)
 			destDirectory = e->getFirstText();
 		} else if (e->matches("sendurl")) {
 			sendURL = e->getFirstText();
+		} else if (e->matches("mode")) {
+			mode = e->getFirstText();
+		} else if (e->matches("pipe")) {
+			pipePath = e->getFirstText();
+		} else if (e->matches("spoolSize")) {
+			spoolSize = getInt64("spoolSize");
+		} else if (e->matches("spoolInterval")) {
+			spoolInterval = getTimeInUnit("spoolInterval", SEC);
+		} else if (e->matches("maxQueuedMessages")) {
+			maxQueued = getUInt32("maxQueuedMessages");
 		} else {
 			msg(LOG_CRIT, "Unknown IDMEFExporter config statement %s\n", e->getName().c_str());
 			continue;
@@ -32,6 +46,12 @@ IDMEFExporterCfg::IDMEFExporterCfg(XMLElement* elem)
 	}
 	
 	if (sendURL == "") THROWEXCEPTION("no destination URL specified for IDMEFExporter");
+	if (mode != "files" && mode != "spool" && mode != "pipe") {
+		THROWEXCEPTION("IDMEFExporter: unknown mode '%s', use files, spool or pipe", mode.c_str());
+	}
+	if (mode == "pipe" && pipePath == "") THROWEXCEPTION("IDMEFExporter: no pipe specified for pipe mode");
+	if (spoolSize == 0) THROWEXCEPTION("IDMEFExporter: spoolSize must be greater than zero");
+	if (maxQueued == 0) THROWEXCEPTION("IDMEFExporter: maxQueuedMessages must be greater than zero");
 }
 
 IDMEFExporterCfg::~IDMEFExporterCfg()
@@ -41,6 +61,12 @@ IDMEFExporterCfg::~IDMEFExporterCfg()
 IDMEFExporter* IDMEFExporterCfg::createInstance()
 {
     instance = new IDMEFExporter(destDirectory, sendURL);
+    if (mode == "spool") {
+        instance->setSpoolOutput(spoolSize, spoolInterval);
+    } else if (mode == "pipe") {
+        instance->setPipeOutput(pipePath);
+    }
+    instance->setMaxQueuedMessages(maxQueued);
     return instance;
 }
 
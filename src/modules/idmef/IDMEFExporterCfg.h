@@ -25,6 +25,11 @@ public:
 protected:	
 	string destDirectory;	/**< directory where idmef message are to be saved temporarily */
 	string sendURL;			/**< URL where IDMEF messages are to be sent */
+	string mode;			/**< files, spool or pipe */
+	string pipePath;		/**< named pipe used in pipe mode */
+	uint64_t spoolSize;		/**< maximum size of a spool file in bytes */
+	uint32_t spoolInterval;	/**< maximum age of a spool file in seconds */
+	uint32_t maxQueued;		/**< maximum number of messages waiting to be written */
 	
 	IDMEFExporterCfg(XMLElement*);
 };
@@ -25,7 +25,8 @@ const char* IDMEFMessage::PAR_NTP_TIME = "NTP_TIME";
 
 
 IDMEFMessage::IDMEFMessage(InstanceManager<IDMEFMessage>* im)
-: ManagedInstance<IDMEFMessage>(im)
+: ManagedInstance<IDMEFMessage>(im),
+  tmpl(NULL)
 {
 
 }
@@ -54,7 +55,9 @@ void IDMEFMessage::init(const string tmplfilename, string analyzerid)
 		msg(LOG_WARNING, "using hostname %s and ip address %s", this->hostname.c_str(), ipAddress.c_str());
 	}
 
-	readTemplate(tmplfilename);
+	tmpl = IDMEFTemplate::get(tmplfilename);
+	values.resize(tmpl->getVariableCount());
+	isSet.assign(tmpl->getVariableCount(), false);
 
 	// set idmef parameters
 	setVariable(PAR_ANALYZER_ID, analyzerId);
@@ -70,33 +73,25 @@ IDMEFMessage::~IDMEFMessage()
 }
 
 /**
- * reads a template into the internal buffer
- * @param tmplfilename template to be used
+ * @returns storage for the value of the given variable, NULL if the template does not contain it
  */
-void IDMEFMessage::readTemplate(const string tmplfilename)
+string* IDMEFMessage::getValue(const string& key)
 {
-	FILE* f = fopen(tmplfilename.c_str(), "r");
-	if (f == NULL) {
-		THROWEXCEPTION("failed to open template file %s, error: %s", tmplfilename.c_str(), strerror(errno));
-	}
-	char temp[1025];
-	message = "";
-	uint32_t bytes;
-	while ((bytes = fread(temp, 1, 1024, f)) > 0) {
-		temp[bytes] = 0;
-		message += temp;
-	}
-	if (fclose(f) != 0) THROWEXCEPTION("failed to close template file %s, error %s", tmplfilename.c_str(), strerror(errno));
+	int index = tmpl->getVariableIndex(key);
+	if (index < 0) return NULL;
+	isSet[index] = true;
+	return &values[index];
 }
 
 /**
- * internally, a map of all possible variables inside the IDMEF template is stored
  * a variable is marked as %KEY% inside the template file and is replaced with the value
  * given in parameter 'value' in this function
+ * variables which are not contained in the template are ignored
  */
 void IDMEFMessage::setVariable(const string key, const string value)
 {
-	parameterValues[key] = value;
+	string* v = getValue(key);
+	if (v) *v = value;
 }
 
 /**
@@ -104,21 +99,27 @@ void IDMEFMessage::setVariable(const string key, const string value)
  */
 void IDMEFMessage::setVariable(const string key, const uint32_t value)
 {
+	string* v = getValue(key);
+	if (!v) return;
 	char valtext[15];
 	snprintf(valtext, 15, "%u", value);
-	parameterValues[key] = valtext;
+	*v = valtext;
 }
 void IDMEFMessage::setVariable(const string key, const uint16_t value)
 {
+	string* v = getValue(key);
+	if (!v) return;
 	char valtext[15];
 	snprintf(valtext, 15, "%u", value);
-	parameterValues[key] = valtext;
+	*v = valtext;
 }
 void IDMEFMessage::setVariable(const string key,const double value)
 {
+	string* v = getValue(key);
+	if (!v) return;
 	char valtext[15];
 	snprintf(valtext,15, "%f",value);
-	parameterValues[key] = valtext;
+	*v = valtext;
 }
 /**
  * returns ntp time string for idmef message
@@ -176,25 +177,13 @@ string IDMEFMessage::createMessageID()
  */
 void IDMEFMessage::applyVariables()
 {
-	// replace all variable values inside the template
-	map<string, string>::iterator iter = parameterValues.begin();
-	while (iter != parameterValues.end()) {
-		string key = string("%") + iter->first + "%";
-		string val = iter->second;
-
-		size_t pos;
-		while ((pos = message.find(key)) != string::npos) {
-			message.replace(pos, key.size(), val);
-		}
-
-		iter++;
-	}
+	tmpl->render(values, isSet, message);
 }
 
 /**
  * @returns IDMEFMessage
  */
-string IDMEFMessage::getMessage()
+const string& IDMEFMessage::getMessage() const
 {
 	return message;
 }
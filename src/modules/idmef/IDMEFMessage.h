@@ -3,9 +3,10 @@
 
 #include "common/ManagedInstance.h"
 #include "core/Emitable.h"
+#include "IDMEFTemplate.h"
 
 #include <string>
-#include <map>
+#include <vector>
 
 using namespace std;
 
@@ -25,7 +26,7 @@ public:
 	void setVariable(const string key, const uint16_t value);
 	void setVariable(const string key, const double value);
 	void applyVariables();
-	string getMessage();
+	const string& getMessage() const;
 	
 private:
 	// private variable keys which are set by IDMEFMessage
@@ -44,9 +45,11 @@ private:
 	
 	string analyzerId;
 	string message;
-	map<string, string> parameterValues;
+	const IDMEFTemplate* tmpl;
+	vector<string> values; /**< values of template variables, indexed by IDMEFTemplate::getVariableIndex() */
+	vector<bool> isSet;
 	
-	void readTemplate(const string tmplfilename);
+	string* getValue(const string& key);
 	string createMessageID();
 	string getCreateTime(time_t t);
 	string getNtpStamp(time_t t);
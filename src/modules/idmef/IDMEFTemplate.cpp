@@ -0,0 +1,194 @@
+/*
+ * VERMONT
+ * Copyright (C) 2014 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "IDMEFTemplate.h"
+
+#include "common/msg.h"
+
+#include <sys/stat.h>
+#include <cstring>
+#include <ctype.h>
+#include <errno.h>
+
+Mutex IDMEFTemplate::cacheMutex;
+map<string, IDMEFTemplate::CacheEntry> IDMEFTemplate::cache;
+vector<IDMEFTemplate*> IDMEFTemplate::retired;
+
+
+/**
+ * returns the parsed template stored in the given file
+ * the file is only read if it was not read before or if its modification time changed,
+ * which is checked at most once per second
+ */
+const IDMEFTemplate* IDMEFTemplate::get(const string& filename)
+{
+	time_t now = time(0);
+
+	cacheMutex.lock();
+	map<string, CacheEntry>::iterator it = cache.find(filename);
+	if (it != cache.end() && it->second.lastCheck == now) {
+		IDMEFTemplate* tmpl = it->second.tmpl;
+		cacheMutex.unlock();
+		return tmpl;
+	}
+
+	struct stat s;
+	if (stat(filename.c_str(), &s) != 0) {
+		if (it != cache.end()) {
+			// keep using the template which was read before
+			it->second.lastCheck = now;
+			IDMEFTemplate* tmpl = it->second.tmpl;
+			cacheMutex.unlock();
+			return tmpl;
+		}
+		cacheMutex.unlock();
+		THROWEXCEPTION("failed to open template file %s, error: %s", filename.c_str(), strerror(errno));
+	}
+
+	if (it != cache.end() && it->second.mtime == s.st_mtime) {
+		it->second.lastCheck = now;
+		IDMEFTemplate* tmpl = it->second.tmpl;
+		cacheMutex.unlock();
+		return tmpl;
+	}
+
+	IDMEFTemplate* tmpl;
+	try {
+		tmpl = new IDMEFTemplate(readFile(filename));
+	} catch (...) {
+		cacheMutex.unlock();
+		throw;
+	}
+	if (it != cache.end()) {
+		msg(LOG_NOTICE, "IDMEF template file %s was modified, reloading it", filename.c_str());
+		retired.push_back(it->second.tmpl);
+	}
+	CacheEntry& entry = cache[filename];
+	entry.tmpl = tmpl;
+	entry.mtime = s.st_mtime;
+	entry.lastCheck = now;
+	cacheMutex.unlock();
+
+	return tmpl;
+}
+
+string IDMEFTemplate::readFile(const string& filename)
+{
+	FILE* f = fopen(filename.c_str(), "r");
+	if (f == NULL) {
+		THROWEXCEPTION("failed to open template file %s, error: %s", filename.c_str(), strerror(errno));
+	}
+	string text;
+	char temp[1024];
+	size_t bytes;
+	while ((bytes = fread(temp, 1, sizeof(temp), f)) > 0) {
+		text.append(temp, bytes);
+	}
+	if (fclose(f) != 0) THROWEXCEPTION("failed to close template file %s, error %s", filename.c_str(), strerror(errno));
+	return text;
+}
+
+/**
+ * splits template text into literal text and variables
+ * a variable is marked as %KEY% where KEY consists of letters, digits and underscores,
+ * all other percent signs are treated as literal text
+ */
+IDMEFTemplate::IDMEFTemplate(const string& text)
+	: literalSize(0)
+{
+	size_t literalStart = 0;
+	size_t pos = 0;
+	while ((pos = text.find('%', pos)) != string::npos) {
+		size_t end = pos+1;
+		while (end < text.size() && (isalnum((unsigned char)text[end]) || text[end] == '_')) end++;
+		if (end == pos+1 || end == text.size() || text[end] != '%') {
+			// no variable, a percent sign at end may start the next one
+			pos = end;
+			continue;
+		}
+
+		addLiteral(text, literalStart, pos);
+		string name = text.substr(pos+1, end-pos-1);
+		map<string, int>::iterator it = variables.find(name);
+		int index;
+		if (it == variables.end()) {
+			index = variables.size();
+			variables[name] = index;
+		} else {
+			index = it->second;
+		}
+		Segment seg;
+		seg.text = text.substr(pos, end-pos+1);
+		seg.variable = index;
+		segments.push_back(seg);
+
+		pos = end+1;
+		literalStart = pos;
+	}
+	addLiteral(text, literalStart, text.size());
+}
+
+void IDMEFTemplate::addLiteral(const string& text, size_t start, size_t end)
+{
+	if (start >= end) return;
+	Segment seg;
+	seg.text = text.substr(start, end-start);
+	seg.variable = -1;
+	segments.push_back(seg);
+	literalSize += end-start;
+}
+
+/**
+ * @returns index of variable with given name (without percent signs), -1 if the template does not contain it
+ */
+int IDMEFTemplate::getVariableIndex(const string& name) const
+{
+	map<string, int>::const_iterator it = variables.find(name);
+	return it == variables.end() ? -1 : it->second;
+}
+
+/**
+ * @returns number of distinct variables in this template
+ */
+uint32_t IDMEFTemplate::getVariableCount() const
+{
+	return variables.size();
+}
+
+/**
+ * replaces all variables of the template with their values
+ * @param values values indexed by variable, must have getVariableCount() elements
+ * @param isSet marks variables with a value, all others are left unchanged in the result
+ * @param result receives the complete message
+ */
+void IDMEFTemplate::render(const vector<string>& values, const vector<bool>& isSet, string& result) const
+{
+	size_t size = literalSize;
+	for (size_t i = 0; i < values.size(); i++) size += values[i].size();
+	result.clear();
+	result.reserve(size);
+
+	for (vector<Segment>::const_iterator it = segments.begin(); it != segments.end(); it++) {
+		if (it->variable >= 0 && isSet[it->variable]) {
+			result += values[it->variable];
+		} else {
+			result += it->text;
+		}
+	}
+}
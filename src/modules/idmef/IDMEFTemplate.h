@@ -0,0 +1,75 @@
+/*
+ * VERMONT
+ * Copyright (C) 2014 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef IDMEFTEMPLATE_H_
+#define IDMEFTEMPLATE_H_
+
+#include "common/Mutex.h"
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+/**
+ * IDMEF XML template which is split into literal text and variables (%KEY%) once
+ *
+ * Templates are shared by all messages using the same file and are only read again if the
+ * modification time of the file changes. Replaced templates are kept until program exit, as
+ * messages may still render them in other threads.
+ */
+class IDMEFTemplate
+{
+public:
+	static const IDMEFTemplate* get(const string& filename);
+
+	IDMEFTemplate(const string& text);
+
+	int getVariableIndex(const string& name) const;
+	uint32_t getVariableCount() const;
+	void render(const vector<string>& values, const vector<bool>& isSet, string& result) const;
+
+private:
+	struct Segment {
+		string text; /**< literal text, or placeholder %KEY% if variable is not set */
+		int variable; /**< index of variable, -1 for literal text */
+	};
+
+	struct CacheEntry {
+		IDMEFTemplate* tmpl;
+		time_t mtime;
+		time_t lastCheck;
+	};
+
+	static Mutex cacheMutex;
+	static map<string, CacheEntry> cache;
+	static vector<IDMEFTemplate*> retired;
+
+	vector<Segment> segments;
+	map<string, int> variables;
+	size_t literalSize; /**< total size of literal text, used to reserve memory for result */
+
+	static string readFile(const string& filename);
+	void addLiteral(const string& text, size_t start, size_t end);
+};
+
+#endif /*IDMEFTEMPLATE_H_*/
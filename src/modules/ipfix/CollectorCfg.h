@@ -50,7 +50,8 @@ public:
 	CollectorCfg(XMLElement* elem, unsigned int moduleId)
 		: vrfName(""),
 		  protocol(UDP), port(0), mtu(0), buffer(0), moduleId(moduleId),
-		  zmqHighWaterMark(0), zmqPollTimeout(ZMQ_POLL_TIMEOUT_DEFAULT)
+		  zmqHighWaterMark(0), zmqPollTimeout(ZMQ_POLL_TIMEOUT_DEFAULT),
+		  receiverThreads(1), receiveBatchSize(DEFAULT_RECEIVE_BATCH_SIZE)
 	{
 		uint16_t defaultPort = 4739;
 		if (!elem)
@@ -108,6 +109,14 @@ public:
 				peerFqdns.insert(strdnsname);
 			} else if (e->matches("buffer")) {
 				buffer = (uint32_t)atoi(e->getContent().c_str());
+			} else if (e->matches("receiverThreads")) {
+				receiverThreads = (uint32_t)atoi(e->getContent().c_str());
+				if (receiverThreads == 0)
+					THROWEXCEPTION("Invalid configuration parameter for receiverThreads (%u)", receiverThreads);
+			} else if (e->matches("receiveBatchSize")) {
+				receiveBatchSize = (uint32_t)atoi(e->getContent().c_str());
+				if (receiveBatchSize == 0)
+					THROWEXCEPTION("Invalid configuration parameter for receiveBatchSize (%u)", receiveBatchSize);
 			} else if (e->matches("zmqEndpoint")) {
 				zmqEndpoints.push_back(e->getContent());
 			} else if (e->matches("zmqPubSubChannel")) {
@@ -151,7 +160,8 @@ public:
 		else if (protocol == TCP)
 			ipfixReceiver = new IpfixReceiverTcpIpV4(port, ipAddress, buffer);
 		else if (protocol == UDP)
-			ipfixReceiver = new IpfixReceiverUdpIpV4(port, ipAddress, buffer);
+			ipfixReceiver = new IpfixReceiverUdpIpV4(port, ipAddress, buffer, moduleId,
+					receiverThreads, receiveBatchSize);
 #ifdef ZMQ_SUPPORT_ENABLED
 		else if (protocol == ZMQ)
 			ipfixReceiver = new IpfixReceiverZmq(zmqEndpoints, zmqPubSubChannels,
@@ -180,6 +190,8 @@ public:
 			(mtu == other->mtu) &&
 			(peerFqdns == other->peerFqdns) &&
 			(buffer == other->buffer) &&
+			(receiverThreads == other->receiverThreads) &&
+			(receiveBatchSize == other->receiveBatchSize) &&
 			(authorizedHosts == other->authorizedHosts) &&
 			(zmqHighWaterMark == other->zmqHighWaterMark) &&
 			(zmqPollTimeout == other->zmqPollTimeout) &&
@@ -198,6 +210,7 @@ public:
 	uint16_t getPort() { return port; }
 	uint16_t getMtu() { return mtu; }
 	unsigned int getModuleId() {return moduleId; }
+	uint32_t getReceiverThreads() { return receiverThreads; }
 
 private:
 	std::string ipAddress;
@@ -213,6 +226,10 @@ private:
 	unsigned int moduleId;
 	int zmqHighWaterMark;
 	int zmqPollTimeout;
+	uint32_t receiverThreads; /**< number of sockets and threads receiving UDP messages */
+	uint32_t receiveBatchSize; /**< maximum number of UDP messages fetched with one system call */
+
+	static const uint32_t DEFAULT_RECEIVE_BATCH_SIZE = 32;
 };
 
 #endif /*COLLECTORCFG_H_*/
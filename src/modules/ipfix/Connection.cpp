@@ -22,6 +22,7 @@
 #include "common/crc.hpp"
 #include "common/Misc.h"
 #include "common/ipfixlolib/ipfix.h"
+#include "common/defs.h"
 
 #include <sstream>
 #include <algorithm>
@@ -29,195 +30,241 @@
 #include <iomanip>
 
 
+namespace {
+
+/**
+ * Information Elements read for the slots of ConnectionExtractor and the groups they belong to
+ */
+struct SlotField {
+	InformationElement::IeId id;
+	InformationElement::IeEnterpriseNumber enterprise;
+	ConnectionExtractor::Slot slot;
+	uint32_t group;
+};
+
+const SlotField slotFields[] = {
+	{ IPFIX_TYPEID_sourceIPv4Address, 0, ConnectionExtractor::SRC_IP, Connection::ADDRESSES },
+	{ IPFIX_TYPEID_destinationIPv4Address, 0, ConnectionExtractor::DST_IP, Connection::ADDRESSES },
+	{ IPFIX_TYPEID_sourceTransportPort, 0, ConnectionExtractor::SRC_PORT, Connection::PORTS },
+	{ IPFIX_TYPEID_destinationTransportPort, 0, ConnectionExtractor::DST_PORT, Connection::PORTS },
+	{ IPFIX_TYPEID_protocolIdentifier, 0, ConnectionExtractor::PROTOCOL, Connection::PROTOCOL },
+	{ IPFIX_TYPEID_flowStartNanoseconds, 0, ConnectionExtractor::SRC_START_NS, Connection::TIMES },
+	{ IPFIX_TYPEID_flowStartMilliseconds, 0, ConnectionExtractor::SRC_START_MS, Connection::TIMES },
+	{ IPFIX_TYPEID_flowStartSeconds, 0, ConnectionExtractor::SRC_START_S, Connection::TIMES },
+	{ IPFIX_TYPEID_flowEndNanoseconds, 0, ConnectionExtractor::SRC_END_NS, Connection::TIMES },
+	{ IPFIX_TYPEID_flowEndMilliseconds, 0, ConnectionExtractor::SRC_END_MS, Connection::TIMES },
+	{ IPFIX_TYPEID_flowEndSeconds, 0, ConnectionExtractor::SRC_END_S, Connection::TIMES },
+	{ IPFIX_TYPEID_flowStartNanoseconds, IPFIX_PEN_reverse, ConnectionExtractor::DST_START_NS, Connection::TIMES },
+	{ IPFIX_TYPEID_flowStartMilliseconds, IPFIX_PEN_reverse, ConnectionExtractor::DST_START_MS, Connection::TIMES },
+	{ IPFIX_TYPEID_flowStartSeconds, IPFIX_PEN_reverse, ConnectionExtractor::DST_START_S, Connection::TIMES },
+	{ IPFIX_TYPEID_flowEndNanoseconds, IPFIX_PEN_reverse, ConnectionExtractor::DST_END_NS, Connection::TIMES },
+	{ IPFIX_TYPEID_flowEndMilliseconds, IPFIX_PEN_reverse, ConnectionExtractor::DST_END_MS, Connection::TIMES },
+	{ IPFIX_TYPEID_flowEndSeconds, IPFIX_PEN_reverse, ConnectionExtractor::DST_END_S, Connection::TIMES },
+	{ IPFIX_TYPEID_octetDeltaCount, 0, ConnectionExtractor::SRC_OCTETS, Connection::COUNTERS },
+	{ IPFIX_TYPEID_octetDeltaCount, IPFIX_PEN_reverse, ConnectionExtractor::DST_OCTETS, Connection::COUNTERS },
+	{ IPFIX_TYPEID_packetDeltaCount, 0, ConnectionExtractor::SRC_PACKETS, Connection::COUNTERS },
+	{ IPFIX_TYPEID_packetDeltaCount, IPFIX_PEN_reverse, ConnectionExtractor::DST_PACKETS, Connection::COUNTERS },
+	{ IPFIX_ETYPEID_transportOctetDeltaCount, IPFIX_PEN_vermont, ConnectionExtractor::SRC_TRANS_OCTETS, Connection::COUNTERS },
+	{ IPFIX_ETYPEID_transportOctetDeltaCount, IPFIX_PEN_vermont|IPFIX_PEN_reverse, ConnectionExtractor::DST_TRANS_OCTETS, Connection::COUNTERS },
+	{ IPFIX_TYPEID_tcpControlBits, 0, ConnectionExtractor::SRC_TCP_FLAGS, Connection::TCP_FLAGS },
+	{ IPFIX_TYPEID_tcpControlBits, IPFIX_PEN_reverse, ConnectionExtractor::DST_TCP_FLAGS, Connection::TCP_FLAGS },
+	{ IPFIX_ETYPEID_frontPayload, IPFIX_PEN_vermont, ConnectionExtractor::SRC_PAYLOAD, Connection::PAYLOAD },
+	{ IPFIX_ETYPEID_frontPayloadLen, IPFIX_PEN_vermont, ConnectionExtractor::SRC_PAYLOAD_LEN, Connection::PAYLOAD },
+	{ IPFIX_ETYPEID_frontPayload, IPFIX_PEN_vermont|IPFIX_PEN_reverse, ConnectionExtractor::DST_PAYLOAD, Connection::PAYLOAD },
+	{ IPFIX_ETYPEID_frontPayloadLen, IPFIX_PEN_vermont|IPFIX_PEN_reverse, ConnectionExtractor::DST_PAYLOAD_LEN, Connection::PAYLOAD },
+	{ IPFIX_ETYPEID_frontPayloadPktCount, IPFIX_PEN_vermont, ConnectionExtractor::PAYLOAD_PKT_COUNT, Connection::DPA },
+	{ IPFIX_ETYPEID_dpaForcedExport, IPFIX_PEN_vermont, ConnectionExtractor::DPA_FORCED_EXPORT, Connection::DPA },
+	{ IPFIX_ETYPEID_dpaReverseStart, IPFIX_PEN_vermont, ConnectionExtractor::DPA_REVERSE_START, Connection::DPA },
+	{ IPFIX_ETYPEID_dpaFlowCount, IPFIX_PEN_vermont, ConnectionExtractor::DPA_FLOW_COUNT, Connection::DPA }
+};
+
+/**
+ * reads a time stamp, the field with the finest resolution is used
+ * @returns milliseconds since 1970, 0 if no field is available
+ */
+uint64_t readTime(IpfixRecord::Data* data, TemplateInfo::FieldInfo* ns, TemplateInfo::FieldInfo* ms, TemplateInfo::FieldInfo* s)
+{
+	uint64_t t = 0;
+	if (ns) {
+		convertNtp64(*(uint64_t*)(data + ns->offset), t);
+	} else if (ms) {
+		t = ntohll(*(uint64_t*)(data + ms->offset));
+	} else if (s) {
+		t = ntohl(*(uint32_t*)(data + s->offset));
+		t *= 1000;
+	}
+	return t;
+}
+
+/**
+ * tcpControlBits may have one or two bytes: RFC rfc7011 and rfc7012 changed the size
+ * from 1 byte to 2 bytes. Support both as the RFC mandates.
+ * @returns tcp control bits in network order
+ */
+uint16_t readTcpControlBits(IpfixRecord::Data* data, TemplateInfo::FieldInfo* fi)
+{
+	if (fi->type.length == 2) {
+		return *(uint16_t*)(data + fi->offset) & Connection::MASK;
+	} else if (fi->type.length == 1) {
+		return htons((uint16_t)*(uint8_t*)(data + fi->offset));
+	}
+	return 0;
+}
+
+/**
+ * copies front payload, its length is taken from the length field if available
+ */
+void readPayload(IpfixRecord::Data* data, TemplateInfo::FieldInfo* fi, TemplateInfo::FieldInfo* filen, char*& payload, uint32_t& len)
+{
+	if (!fi || !fi->type.length) return;
+	if (filen)
+		len = ntohl(*(uint32_t*)(data + filen->offset));
+	else
+		len = fi->type.length;
+	payload = new char[len];
+	memcpy(payload, data + fi->offset, len);
+}
+
+/**
+ * extractor used by modules which do not keep their own one
+ */
+ConnectionExtractor& getDefaultExtractor()
+{
+	static thread_local ConnectionExtractor extractor;
+	return extractor;
+}
+
+}
+
+
+/**
+ * @param fields groups of Connection::Fields which are read from records
+ * @param owner name of the module which is used in warnings about missing fields
+ */
+ConnectionExtractor::ConnectionExtractor(uint32_t fields, const string& owner)
+	: fields(fields),
+	  owner(owner)
+{
+}
+
+uint32_t ConnectionExtractor::getFields() const
+{
+	return fields;
+}
+
+/**
+ * looks up all requested fields in the given Template
+ */
+void ConnectionExtractor::buildPlan(TemplateInfo* ti, Plan& plan)
+{
+	for (int i = 0; i < SLOT_COUNT; i++) plan.index[i] = -1;
+
+	for (int i = 0; i < ti->fieldCount; i++) {
+		const InformationElement::IeInfo& type = ti->fieldInfo[i].type;
+		for (uint32_t j = 0; j < ARRAY_SIZE(slotFields); j++) {
+			const SlotField& sf = slotFields[j];
+			if ((sf.group & fields) && sf.id == type.id && sf.enterprise == type.enterprise && plan.index[sf.slot] < 0) {
+				plan.index[sf.slot] = i;
+			}
+		}
+	}
+
+	if ((fields & Connection::ADDRESSES) && plan.index[SRC_IP] < 0)
+		msg(LOG_NOTICE, "%s: failed to determine source ip for records of template %u, assuming 0.0.0.0", owner.c_str(), ti->templateId);
+	if ((fields & Connection::ADDRESSES) && plan.index[DST_IP] < 0)
+		msg(LOG_NOTICE, "%s: failed to determine destination ip for records of template %u, assuming 0.0.0.0", owner.c_str(), ti->templateId);
+	if ((fields & Connection::PORTS) && plan.index[SRC_PORT] < 0)
+		msg(LOG_NOTICE, "%s: failed to determine source port for records of template %u, assuming 0", owner.c_str(), ti->templateId);
+	if ((fields & Connection::PORTS) && plan.index[DST_PORT] < 0)
+		msg(LOG_NOTICE, "%s: failed to determine destination port for records of template %u, assuming 0", owner.c_str(), ti->templateId);
+	if ((fields & Connection::PROTOCOL) && plan.index[PROTOCOL] < 0)
+		msg(LOG_NOTICE, "%s: failed to determine protocol for records of template %u, using 0", owner.c_str(), ti->templateId);
+}
+
+/**
+ * @returns plan for the template of the given record, it is built if the template was not seen before
+ */
+const ConnectionExtractor::Plan& ConnectionExtractor::getPlan(IpfixDataRecord* record)
+{
+	boost::shared_ptr<TemplateInfo>& ti = record->templateInfo;
+	Plan& plan = plans[ti->getUniqueId()];
+	if (plan.templateInfo != ti.get() || plan.templateRef.expired()) {
+		// new template, or a template reusing the unique id of a freed one
+		plan.templateInfo = ti.get();
+		plan.templateRef = ti;
+		buildPlan(ti.get(), plan);
+	}
+	return plan;
+}
+
+
 /**
  * creates new connection element
  * and initializes values with given IPFIX record
  * NOTE: all values are *copied*, no reference will be kept to original IPFIX record
- * @param connTimeout time in seconds when connection element times out
  */
 Connection::Connection(IpfixDataRecord* record)
-	: srcOctets(0), dstOctets(0),
+	: Connection(record, getDefaultExtractor())
+{
+}
+
+/**
+ * creates new connection element, only the fields requested from extractor are read from
+ * the record, all other values are 0
+ * NOTE: all values are *copied*, no reference will be kept to original IPFIX record
+ */
+Connection::Connection(IpfixDataRecord* record, ConnectionExtractor& extractor)
+	: srcIP(0), dstIP(0), srcPort(0), dstPort(0),
+	  srcTimeStart(0), srcTimeEnd(0),
+	  dstTimeStart(0), dstTimeEnd(0),
+	  srcOctets(0), dstOctets(0),
 	  srcTransOctets(0), dstTransOctets(0),
 	  srcPackets(0), dstPackets(0),
 	  srcTcpControlBits(0), dstTcpControlBits(0),
+	  protocol(0),
 	  srcPayload(0), srcPayloadLen(0),
 	  dstPayload(0), dstPayloadLen(0),
+	  srcPayloadPktCount(0),
 	  dpaForcedExport(0), dpaFlowCount(0),
-	  dpaReverseStart(0)
+	  dpaReverseStart(0),
+	  timeExpire(0)
 {
-	// convert IpfixDataRecord to Connection
-	TemplateInfo::FieldInfo* fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_sourceIPv4Address, 0);
-	if (fi != 0) {
-		srcIP = *(uint32_t*)(record->data + fi->offset);
-	} else {
-		msg(LOG_NOTICE, "failed to determine source ip for record, assuming 0.0.0.0");
-		srcIP = 0;
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_destinationIPv4Address, 0);
-	if (fi != 0) {
-		dstIP = *(uint32_t*)(record->data + fi->offset);
-	} else {
-		msg(LOG_NOTICE, "failed to determine destination ip for record, assuming 0.0.0.0");
-		dstIP = 0;
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_sourceTransportPort, 0);
-	if (fi != 0) {
-		srcPort = *(uint16_t*)(record->data + fi->offset);
-	} else {
-		msg(LOG_NOTICE, "failed to determine source port for record, assuming 0");
-		srcPort = 0;
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_destinationTransportPort, 0);
-	if (fi != 0) {
-		dstPort = *(uint16_t*)(record->data + fi->offset);
-	} else {
-		msg(LOG_NOTICE, "failed to determine destination port for record, assuming 0");
-		srcPort = 0;
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_protocolIdentifier, 0);
-	if (fi != 0) {
-		protocol = *(uint8_t*)(record->data + fi->offset);
-	} else {
-		msg(LOG_NOTICE, "failed to determine protocol for record, using 0");
-		protocol = 0;
-	}
+	typedef ConnectionExtractor CE;
+	const CE::Plan& plan = extractor.getPlan(record);
+	TemplateInfo::FieldInfo* fields = record->getFieldInfoArray();
+	IpfixRecord::Data* data = record->data;
+	TemplateInfo::FieldInfo* fi;
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowStartNanoseconds, 0);
-	if (fi != 0) {
-		convertNtp64(*(uint64_t*)(record->data + fi->offset), srcTimeStart);
-	} else {
-		fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowStartMilliseconds, 0);
-		if (fi != 0) {
-			srcTimeStart = ntohll(*(uint64_t*)(record->data + fi->offset));
-		} else {
-			fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowStartSeconds, 0);
-			if (fi != 0) {
-				srcTimeStart = ntohl(*(uint32_t*)(record->data + fi->offset));
-				srcTimeStart *= 1000;
-			} else {
-				srcTimeStart = 0;
-			}
-		}
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowEndNanoseconds, 0);
-	if (fi != 0) {
-		convertNtp64(*(uint64_t*)(record->data + fi->offset), srcTimeEnd);
-	} else {
-		fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowEndMilliseconds, 0);
-		if (fi != 0) {
-			srcTimeEnd = ntohll(*(uint64_t*)(record->data + fi->offset));
-		} else {
-			fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowEndSeconds, 0);
-			if (fi != 0) {
-				srcTimeEnd = ntohl(*(uint32_t*)(record->data + fi->offset));
-				srcTimeEnd *= 1000;
-			} else {
-				srcTimeEnd = 0;
-			}
-		}
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowStartNanoseconds, IPFIX_PEN_reverse);
-	if (fi != 0) {
-		convertNtp64(*(uint64_t*)(record->data + fi->offset), dstTimeStart);
-	} else {
-		fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowStartMilliseconds, IPFIX_PEN_reverse);
-		if (fi != 0) {
-			dstTimeStart = ntohll(*(uint64_t*)(record->data + fi->offset));
-		} else {
-			fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowStartSeconds, IPFIX_PEN_reverse);
-			if (fi != 0) {
-				dstTimeStart = ntohl(*(uint32_t*)(record->data + fi->offset));
-				dstTimeStart *= 1000;
-			} else {
-				dstTimeStart = 0;
-			}
-		}
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowEndNanoseconds, IPFIX_PEN_reverse);
-	if (fi != 0) {
-		convertNtp64(*(uint64_t*)(record->data + fi->offset), dstTimeEnd);
-	} else {
-		fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowEndMilliseconds, IPFIX_PEN_reverse);
-		if (fi != 0) {
-			dstTimeEnd = ntohll(*(uint64_t*)(record->data + fi->offset));
-		} else {
-			fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_flowEndSeconds, IPFIX_PEN_reverse);
-			if (fi != 0) {
-				dstTimeEnd = ntohl(*(uint32_t*)(record->data + fi->offset));
-				dstTimeEnd *= 1000;
-			} else {
-				dstTimeEnd = 0;
-			}
-		}
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_octetDeltaCount, 0);
-	if (fi != 0) srcOctets = *(uint64_t*)(record->data + fi->offset);
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_octetDeltaCount, IPFIX_PEN_reverse);
-	if (fi != 0) dstOctets = *(uint64_t*)(record->data + fi->offset);
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_packetDeltaCount, 0);
-	if (fi != 0) srcPackets = *(uint64_t*)(record->data + fi->offset);
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_packetDeltaCount, IPFIX_PEN_reverse);
-	if (fi != 0) dstPackets = *(uint64_t*)(record->data + fi->offset);
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_tcpControlBits, 0);
-	if (fi != 0) {
-		/*
-		 * RFC rfc7011 and rfc7012 changed the tcpControlBits size
-		 * from 1 byte to 2 bytes. Support both as the RFC mandates.
-		 */
-		if (fi->type.length == 2) {
-			srcTcpControlBits = *(uint16_t*)(record->data + fi->offset) & Connection::MASK;
-		} else if (fi->type.length == 1) {
-			srcTcpControlBits = htons((uint16_t)*(uint8_t*)(record->data + fi->offset));
-		} else {
-			srcTcpControlBits = 0;
-		}
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_tcpControlBits, IPFIX_PEN_reverse);
-	if (fi != 0) {
-		/*
-		 * RFC rfc7011 and rfc7012 changed the tcpControlBits size
-		 * from 1 byte to 2 bytes. Support both as the RFC mandates.
-		 */
-		if (fi->type.length == 2) {
-			dstTcpControlBits = *(uint16_t*)(record->data + fi->offset) & Connection::MASK;
-		} else if (fi->type.length == 1) {
-			dstTcpControlBits = htons((uint16_t)*(uint8_t*)(record->data + fi->offset));
-		} else {
-			dstTcpControlBits = 0;
-		}
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_frontPayload, IPFIX_PEN_vermont);
-	if (fi != 0 && fi->type.length) {
-		TemplateInfo::FieldInfo* filen = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_frontPayloadLen, IPFIX_PEN_vermont);
-		if (filen != 0)
-			srcPayloadLen = ntohl(*(uint32_t*)(record->data + filen->offset));
-		else
-			srcPayloadLen = fi->type.length;
-		srcPayload = new char[srcPayloadLen];
-		memcpy(srcPayload, record->data + fi->offset, srcPayloadLen);
-	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_frontPayload, IPFIX_PEN_vermont|IPFIX_PEN_reverse);
-	if (fi != 0 && fi->type.length) {
-		TemplateInfo::FieldInfo* filen = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_frontPayloadLen, IPFIX_PEN_vermont|IPFIX_PEN_reverse);
-		if (filen != 0)
-			dstPayloadLen = ntohl(*(uint32_t*)(record->data + filen->offset));
-		else
-			dstPayloadLen = fi->type.length;
-		dstPayload = new char[dstPayloadLen];
-		memcpy(dstPayload, record->data + fi->offset, dstPayloadLen);
+	if ((fi = plan.get(CE::SRC_IP, fields))) srcIP = *(uint32_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::DST_IP, fields))) dstIP = *(uint32_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::SRC_PORT, fields))) srcPort = *(uint16_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::DST_PORT, fields))) dstPort = *(uint16_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::PROTOCOL, fields))) protocol = *(uint8_t*)(data + fi->offset);
+
+	if (extractor.getFields() & TIMES) {
+		srcTimeStart = readTime(data, plan.get(CE::SRC_START_NS, fields), plan.get(CE::SRC_START_MS, fields), plan.get(CE::SRC_START_S, fields));
+		srcTimeEnd = readTime(data, plan.get(CE::SRC_END_NS, fields), plan.get(CE::SRC_END_MS, fields), plan.get(CE::SRC_END_S, fields));
+		dstTimeStart = readTime(data, plan.get(CE::DST_START_NS, fields), plan.get(CE::DST_START_MS, fields), plan.get(CE::DST_START_S, fields));
+		dstTimeEnd = readTime(data, plan.get(CE::DST_END_NS, fields), plan.get(CE::DST_END_MS, fields), plan.get(CE::DST_END_S, fields));
 	}
-	fi = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_frontPayloadPktCount, IPFIX_PEN_vermont);
-	if (fi != 0) srcPayloadPktCount= *(uint32_t*)(record->data + fi->offset);
-	fi = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_dpaForcedExport, IPFIX_PEN_vermont);
-	if (fi != 0) dpaForcedExport = *(uint8_t*)(record->data + fi->offset);
-	fi = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_dpaReverseStart, IPFIX_PEN_vermont);
-	if (fi != 0) dpaReverseStart = *(uint8_t*)(record->data + fi->offset);
-	fi = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_dpaFlowCount, IPFIX_PEN_vermont);
-	if (fi != 0) dpaFlowCount = ntohl(*(uint32_t*)(record->data + fi->offset));
-	fi = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_transportOctetDeltaCount, IPFIX_PEN_vermont);
-	if (fi != 0) srcTransOctets = ntohll(*(uint64_t*)(record->data + fi->offset));
-	fi = record->templateInfo->getFieldInfo(IPFIX_ETYPEID_transportOctetDeltaCount, IPFIX_PEN_vermont|IPFIX_PEN_reverse);
-	if (fi != 0) dstTransOctets = ntohll(*(uint64_t*)(record->data + fi->offset));
+
+	if ((fi = plan.get(CE::SRC_OCTETS, fields))) srcOctets = *(uint64_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::DST_OCTETS, fields))) dstOctets = *(uint64_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::SRC_PACKETS, fields))) srcPackets = *(uint64_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::DST_PACKETS, fields))) dstPackets = *(uint64_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::SRC_TRANS_OCTETS, fields))) srcTransOctets = ntohll(*(uint64_t*)(data + fi->offset));
+	if ((fi = plan.get(CE::DST_TRANS_OCTETS, fields))) dstTransOctets = ntohll(*(uint64_t*)(data + fi->offset));
+
+	if ((fi = plan.get(CE::SRC_TCP_FLAGS, fields))) srcTcpControlBits = readTcpControlBits(data, fi);
+	if ((fi = plan.get(CE::DST_TCP_FLAGS, fields))) dstTcpControlBits = readTcpControlBits(data, fi);
+
+	readPayload(data, plan.get(CE::SRC_PAYLOAD, fields), plan.get(CE::SRC_PAYLOAD_LEN, fields), srcPayload, srcPayloadLen);
+	readPayload(data, plan.get(CE::DST_PAYLOAD, fields), plan.get(CE::DST_PAYLOAD_LEN, fields), dstPayload, dstPayloadLen);
+
+	if ((fi = plan.get(CE::PAYLOAD_PKT_COUNT, fields))) srcPayloadPktCount = *(uint32_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::DPA_FORCED_EXPORT, fields))) dpaForcedExport = *(uint8_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::DPA_REVERSE_START, fields))) dpaReverseStart = *(uint8_t*)(data + fi->offset);
+	if ((fi = plan.get(CE::DPA_FLOW_COUNT, fields))) dpaFlowCount = ntohl(*(uint32_t*)(data + fi->offset));
 }
 
 Connection::~Connection()
@@ -22,6 +22,8 @@
 
 #include <stdint.h>
 #include <string>
+#include <unordered_map>
+#include <boost/smart_ptr.hpp>
 
 #include "common/ManagedInstance.h"
 #include "IpfixRecord.hpp"
@@ -29,10 +31,27 @@
 
 using namespace std;
 
+class ConnectionExtractor;
 
 class Connection
 {
 	public:
+		/**
+		 * groups of fields which are read from Data Records, modules pass the groups they
+		 * need to ConnectionExtractor, fields of other groups are set to 0
+		 */
+		enum Fields {
+			ADDRESSES = 0x01, /**< srcIP, dstIP */
+			PORTS = 0x02, /**< srcPort, dstPort */
+			PROTOCOL = 0x04,
+			TIMES = 0x08, /**< start and end times of both directions */
+			COUNTERS = 0x10, /**< octets, packets and transport octets of both directions */
+			TCP_FLAGS = 0x20, /**< tcp control bits of both directions */
+			PAYLOAD = 0x40, /**< front payload of both directions */
+			DPA = 0x80, /**< front payload packet count and fields of dynamic payload aggregation */
+			ALL_FIELDS = 0xff
+		};
+
 		// static values in network order
 #if __BYTE_ORDER == __LITTLE_ENDIAN
 		static const uint16_t FIN = 0x0001;
@@ -96,6 +115,7 @@ class Connection
 		uint32_t timeExpire;
 
 		Connection(IpfixDataRecord* record);
+		Connection(IpfixDataRecord* record, ConnectionExtractor& extractor);
 		virtual ~Connection();
 		void addFlow(Connection* c);
 		string toString();
@@ -111,4 +131,61 @@ class Connection
 		string payloadToHex(const char* payload, uint32_t len);
 };
 
+/**
+ * determines which fields of a Template are read by Connection::Connection()
+ *
+ * The fields are looked up once per Template and the resulting plan is cached by
+ * TemplateInfo::getUniqueId(). The plan contains field indices, not offsets, so it also
+ * applies to variable-length records with their own field layout.
+ * Warnings about missing fields are issued once per Template when its plan is built.
+ * Each module owns its extractor, so no locking is needed.
+ */
+class ConnectionExtractor
+{
+	public:
+		enum Slot {
+			SRC_IP, DST_IP, SRC_PORT, DST_PORT, PROTOCOL,
+			SRC_START_NS, SRC_START_MS, SRC_START_S,
+			SRC_END_NS, SRC_END_MS, SRC_END_S,
+			DST_START_NS, DST_START_MS, DST_START_S,
+			DST_END_NS, DST_END_MS, DST_END_S,
+			SRC_OCTETS, DST_OCTETS, SRC_PACKETS, DST_PACKETS,
+			SRC_TRANS_OCTETS, DST_TRANS_OCTETS,
+			SRC_TCP_FLAGS, DST_TCP_FLAGS,
+			SRC_PAYLOAD, SRC_PAYLOAD_LEN, DST_PAYLOAD, DST_PAYLOAD_LEN,
+			PAYLOAD_PKT_COUNT, DPA_FORCED_EXPORT, DPA_REVERSE_START, DPA_FLOW_COUNT,
+			SLOT_COUNT
+		};
+
+		/**
+		 * field indices of one Template
+		 */
+		struct Plan {
+			const TemplateInfo* templateInfo; /**< template the plan was built for */
+			boost::weak_ptr<TemplateInfo> templateRef; /**< to detect that templateInfo was freed */
+			int32_t index[SLOT_COUNT]; /**< index of field in template, -1 if not contained or not requested */
+
+			Plan() : templateInfo(NULL) {}
+
+			/**
+			 * @returns FieldInfo of given slot in fields, NULL if the field is not available
+			 */
+			inline TemplateInfo::FieldInfo* get(Slot slot, TemplateInfo::FieldInfo* fields) const {
+				return index[slot] < 0 ? NULL : &fields[index[slot]];
+			}
+		};
+
+		ConnectionExtractor(uint32_t fields = Connection::ALL_FIELDS, const string& owner = "Connection");
+
+		const Plan& getPlan(IpfixDataRecord* record);
+		uint32_t getFields() const;
+
+	private:
+		uint32_t fields; /**< groups of Connection::Fields to be read */
+		string owner; /**< name used in warnings */
+		std::unordered_map<uint16_t, Plan> plans; /**< plans by TemplateInfo::getUniqueId() */
+
+		void buildPlan(TemplateInfo* ti, Plan& plan);
+};
+
 #endif
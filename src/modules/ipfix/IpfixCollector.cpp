@@ -36,13 +36,13 @@ IpfixCollector::IpfixCollector(IpfixReceiver* receiver)
 	: ipfixReceiver(receiver),
 	  statSentRecords(0)
 {
-	ipfixPacketProcessor = new IpfixParser(this);
 	receiver->setVModule(this);
 	
-	// wire ipfixReceiver with ipfixPacketProcessor
-	list<IpfixPacketProcessor*> pplist;
-	pplist.push_back(ipfixPacketProcessor);
-	ipfixReceiver->setPacketProcessors(pplist);
+	// wire ipfixReceiver with one ipfixPacketProcessor for each of its threads
+	for (uint32_t i = 0; i < receiver->getWorkerCount(); i++) {
+		ipfixPacketProcessors.push_back(new IpfixParser(this));
+	}
+	ipfixReceiver->setPacketProcessors(ipfixPacketProcessors);
 }
 
 /**
@@ -53,7 +53,9 @@ IpfixCollector::~IpfixCollector()
 	// to make sure that exitFlag is set and performShutdown() is called
 	this->shutdown(false);
 	delete ipfixReceiver;
-	delete ipfixPacketProcessor;
+	for (list<IpfixPacketProcessor*>::iterator it = ipfixPacketProcessors.begin(); it != ipfixPacketProcessors.end(); it++) {
+		delete *it;
+	}
 }
 
 /**
@@ -76,17 +78,23 @@ void IpfixCollector::performShutdown()
 
 void IpfixCollector::postReconfigration()
 { 
-	ipfixPacketProcessor->postReconfiguration();
+	for (list<IpfixPacketProcessor*>::iterator it = ipfixPacketProcessors.begin(); it != ipfixPacketProcessors.end(); it++) {
+		(*it)->postReconfiguration();
+	}
 }
 
 void IpfixCollector::onReconfiguration1()
 {
-	ipfixPacketProcessor->onReconfiguration1();
+	for (list<IpfixPacketProcessor*>::iterator it = ipfixPacketProcessors.begin(); it != ipfixPacketProcessors.end(); it++) {
+		(*it)->onReconfiguration1();
+	}
 }
 
 void IpfixCollector::onReconfiguration2()
 {
-	ipfixPacketProcessor->onReconfiguration2();
+	for (list<IpfixPacketProcessor*>::iterator it = ipfixPacketProcessors.begin(); it != ipfixPacketProcessors.end(); it++) {
+		(*it)->onReconfiguration2();
+	}
 }
 
 /**
@@ -98,7 +106,8 @@ bool IpfixCollector::send(IpfixRecord* ipfixRecord)
 	// do not send anything any more, if module is to be stopped
 	if (exitFlag) return false;
 	
-	statSentRecords++;
+	// receivers with several threads call this concurrently
+	__sync_add_and_fetch(&statSentRecords, 1);
 	return Source<IpfixRecord*>::send(ipfixRecord);	
 }
 
@@ -118,8 +127,10 @@ string IpfixCollector::getStatisticsXML(double interval)
  */
 void IpfixCollector::setTemplateLifetime(uint16_t time)
 {
-	if(ipfixPacketProcessor && dynamic_cast<IpfixParser*>(ipfixPacketProcessor))
-		dynamic_cast<IpfixParser*>(ipfixPacketProcessor)->setTemplateLifetime(time);
-	else
-		msg(LOG_ERR, "IpfixCollector: Cannot set template lifetime, ipfixPacketProcessor is NULL");
+	for (list<IpfixPacketProcessor*>::iterator it = ipfixPacketProcessors.begin(); it != ipfixPacketProcessors.end(); it++) {
+		if(dynamic_cast<IpfixParser*>(*it))
+			dynamic_cast<IpfixParser*>(*it)->setTemplateLifetime(time);
+		else
+			msg(LOG_ERR, "IpfixCollector: Cannot set template lifetime, ipfixPacketProcessor is not an IpfixParser");
+	}
 }
@@ -32,8 +32,8 @@
 /**
  * Represents a collector module
  * it always contains an IpfixReceiver (passed by constructor)
- * and one IpfixPacketProcessor, receiver and packet processor are
- * hard wired
+ * and one IpfixPacketProcessor per receiving thread, receiver and
+ * packet processors are hard wired
  */
 class IpfixCollector 
 	: public Module, public Source<IpfixRecord*>, public Destination<NullEmitable*>, public IpfixRecordSender 
@@ -58,7 +58,7 @@ class IpfixCollector
 
 	private:
 		IpfixReceiver* ipfixReceiver;
-		IpfixPacketProcessor* ipfixPacketProcessor;
+		std::list<IpfixPacketProcessor*> ipfixPacketProcessors; /**< one for each worker of ipfixReceiver */
 		uint64_t statSentRecords;
 
 };
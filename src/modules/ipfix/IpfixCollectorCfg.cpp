@@ -83,6 +83,9 @@ IpfixCollectorCfg::IpfixCollectorCfg(XMLElement* elem)
 			listener->getProtocol() != DTLS_OVER_SCTP)
 		THROWEXCEPTION("collectingProcess can handle only UDP, TCP, or SCTP!");
 #endif
+
+	if (listener->getReceiverThreads() > 1 && listener->getProtocol() != UDP)
+		THROWEXCEPTION("collectingProcess supports several receiverThreads only for UDP");
 	
 	msg(LOG_NOTICE, "IpfixCollectorCfg: Successfully parsed collectingProcess section");
 }
@@ -72,15 +72,15 @@ uint64_t IpfixCsExporter::retrieveTime(IpfixDataRecord* record, InformationEleme
 		InformationElement::IeId id3, InformationElement::IeEnterpriseNumber pen)
 {
 	uint64_t rettime;
-	TemplateInfo::FieldInfo* fi = record->templateInfo->getFieldInfo(id1, pen);
+	TemplateInfo::FieldInfo* fi = record->getFieldInfo(id1, pen);
 	if (fi != 0) {
 		convertNtp64(*(uint64_t*)(record->data + fi->offset), rettime);
 	} else {
-		fi = record->templateInfo->getFieldInfo(id2, pen);
+		fi = record->getFieldInfo(id2, pen);
 		if (fi != 0) {
 			rettime = ntohll(*(uint64_t*)(record->data + fi->offset));
 		} else {
-			fi = record->templateInfo->getFieldInfo(id3, pen);
+			fi = record->getFieldInfo(id3, pen);
 			if (fi != 0) {
 				rettime = ntohl(*(uint32_t*)(record->data + fi->offset));
 				rettime *= 1000;
@@ -115,11 +115,11 @@ void IpfixCsExporter::onDataRecord(IpfixDataRecord* record)
 	int idx;
 	idx = record->templateInfo->getFieldIndex(IPFIX_TYPEID_sourceIPv4Address, 0);
 	if (idx >= 0) {
-		fi = &record->templateInfo->fieldInfo[idx];
+		fi = &record->getFieldInfoArray()[idx];
 		csRecord->source_ipv4_address		= *(uint32_t*)(record->data + fi->offset);
 		// set export mode if anonymisationType IE is directly after this field
 		if (idx<record->templateInfo->fieldCount-1) {
-			fi = &record->templateInfo->fieldInfo[idx+1];
+			fi = &record->getFieldInfoArray()[idx+1];
 			if (fi->type==InformationElement::IeInfo(IPFIX_ETYPEID_anonymisationType, IPFIX_PEN_vermont)
 					&& *(uint8_t*)(record->data + fi->offset)==1) {
 				csRecord->src_export_mode = exportMode;
@@ -132,11 +132,11 @@ void IpfixCsExporter::onDataRecord(IpfixDataRecord* record)
 
 	idx = record->templateInfo->getFieldIndex(IPFIX_TYPEID_destinationIPv4Address, 0);
 	if (idx >= 0) {
-		fi = &record->templateInfo->fieldInfo[idx];
+		fi = &record->getFieldInfoArray()[idx];
 		csRecord->destination_ipv4_address	= *(uint32_t*)(record->data + fi->offset);
 		// set export mode if anonymisationType IE is directly after this field
 		if (idx<record->templateInfo->fieldCount-1) {
-			fi = &record->templateInfo->fieldInfo[idx+1];
+			fi = &record->getFieldInfoArray()[idx+1];
 			if (fi->type==InformationElement::IeInfo(IPFIX_ETYPEID_anonymisationType, IPFIX_PEN_vermont)
 					&& *(uint8_t*)(record->data + fi->offset)==1) {
 				csRecord->dst_export_mode = exportMode;
@@ -147,7 +147,7 @@ void IpfixCsExporter::onDataRecord(IpfixDataRecord* record)
 		csRecord->destination_ipv4_address	= 0;
 	}
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_protocolIdentifier, 0);
+	fi = record->getFieldInfo(IPFIX_TYPEID_protocolIdentifier, 0);
 	if (fi != 0) {
 		csRecord->protocol_identifier 		= *(uint8_t*)(record->data + fi->offset);
 	} else {
@@ -155,7 +155,7 @@ void IpfixCsExporter::onDataRecord(IpfixDataRecord* record)
 		csRecord->protocol_identifier		= 0;
 	}
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_sourceTransportPort, 0);
+	fi = record->getFieldInfo(IPFIX_TYPEID_sourceTransportPort, 0);
         if (fi != 0) {
 		csRecord->source_transport_port		= *(uint16_t*)(record->data + fi->offset);/* encode udp/tcp ports here */
 	} else {
@@ -163,7 +163,7 @@ void IpfixCsExporter::onDataRecord(IpfixDataRecord* record)
 		csRecord->source_transport_port		= 0;
 	}
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_destinationTransportPort, 0);
+	fi = record->getFieldInfo(IPFIX_TYPEID_destinationTransportPort, 0);
 	if (fi != 0) {
 		csRecord->destination_transport_port	= *(uint16_t*)(record->data + fi->offset);/* encode udp/tcp ports here */
 	} else {
@@ -172,7 +172,7 @@ void IpfixCsExporter::onDataRecord(IpfixDataRecord* record)
 	}
 
 	// IPFIX_TYPEID_icmpTypeCodeIPv4   (ICMP type * 256) + ICMP code (network-byte order!)
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_icmpTypeCodeIPv4, 0);
+	fi = record->getFieldInfo(IPFIX_TYPEID_icmpTypeCodeIPv4, 0);
 	if (fi != 0) {
 		csRecord->icmp_type_ipv4 		= *(uint8_t*)(record->data + fi->offset);
 		csRecord->icmp_code_ipv4		= *(uint8_t*)(record->data + fi->offset + 1);
@@ -181,7 +181,7 @@ void IpfixCsExporter::onDataRecord(IpfixDataRecord* record)
 		csRecord->icmp_code_ipv4                = 0;
 	}
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_tcpControlBits, 0);
+	fi = record->getFieldInfo(IPFIX_TYPEID_tcpControlBits, 0);
 	if (fi != 0) {
 		/*
 		 * RFC rfc7011 and rfc7012 changed the tcpControlBits size
@@ -215,29 +215,29 @@ void IpfixCsExporter::onDataRecord(IpfixDataRecord* record)
 		csRecord->flow_end_milliseconds = htonll(timeend);
 
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_octetDeltaCount, 0);
+	fi = record->getFieldInfo(IPFIX_TYPEID_octetDeltaCount, 0);
         if (fi != 0) {
 		csRecord->octet_total_count = *(uint64_t*)(record->data + fi->offset);
 	}
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_packetDeltaCount, 0);
+	fi = record->getFieldInfo(IPFIX_TYPEID_packetDeltaCount, 0);
 	if (fi != 0) {
 		csRecord->packet_total_count = *(uint64_t*)(record->data + fi->offset);
 	}
 
 	csRecord->biflow_direction = 0;
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_octetDeltaCount, IPFIX_PEN_reverse);
+	fi = record->getFieldInfo(IPFIX_TYPEID_octetDeltaCount, IPFIX_PEN_reverse);
 	if (fi != 0) {
 		csRecord->rev_octet_total_count = *(uint64_t*)(record->data + fi->offset);
 	}
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_packetDeltaCount, IPFIX_PEN_reverse);
+	fi = record->getFieldInfo(IPFIX_TYPEID_packetDeltaCount, IPFIX_PEN_reverse);
 	if (fi != 0) {
 		csRecord->rev_packet_total_count = *(uint64_t*)(record->data + fi->offset);
 	}
 
-	fi = record->templateInfo->getFieldInfo(IPFIX_TYPEID_tcpControlBits, IPFIX_PEN_reverse);
+	fi = record->getFieldInfo(IPFIX_TYPEID_tcpControlBits, IPFIX_PEN_reverse);
 	if (fi != 0) {
 		/*
 		 * RFC rfc7011 and rfc7012 changed the tcpControlBits size
@@ -29,6 +29,7 @@ IpfixExporterCfg::IpfixExporterCfg(XMLElement* elem)
 	templateRefreshTime(IS_DEFAULT_TEMPLATE_TIMEINTERVAL), /* templateRefreshRate(0), */
 	sctpDataLifetime(0), sctpReconnectInterval(0), export_protocol(IPFIX_PROTOCOL),
 	recordRateLimit(0), observationDomainId(0),
+	udpBatchSize(IS_DEFAULT_UDPBATCHSIZE), udpBatchDelay(IS_DEFAULT_UDPBATCHDELAY),
 	dtlsMaxConnectionLifetime(0)
 {
 
@@ -43,6 +44,11 @@ IpfixExporterCfg::IpfixExporterCfg(XMLElement* elem)
 	sctpReconnectInterval = getTimeInUnit("sctpReconnectInterval", SEC, IS_DEFAULT_SCTP_RECONNECTINTERVAL);
 	/* templateRefreshRate = getInt("templateRefreshRate", IS_DEFAULT_TEMPLATE_RECORDINTERVAL); */
 	templateRefreshTime = getTimeInUnit("templateRefreshInterval", SEC, IS_DEFAULT_TEMPLATE_TIMEINTERVAL);
+	udpBatchSize = getInt("udpBatchSize", IS_DEFAULT_UDPBATCHSIZE);
+	udpBatchDelay = getTimeInUnit("udpBatchDelay", mSEC, IS_DEFAULT_UDPBATCHDELAY);
+	if (udpBatchSize > IPFIX_MAX_UDP_BATCH) {
+		THROWEXCEPTION("Exporter: udpBatchSize must not exceed %u", IPFIX_MAX_UDP_BATCH);
+	}
 	// Config for DTLS
 	certificateChainFile = getOptional("cert");
 	privateKeyFile = getOptional("key");
@@ -70,6 +76,8 @@ IpfixExporterCfg::IpfixExporterCfg(XMLElement* elem)
 				/* e->matches("templateRefreshRate") || */
 				e->matches("templateRefreshInterval") ||
 				e->matches("observationDomainId") ||
+				e->matches("udpBatchSize") ||
+				e->matches("udpBatchDelay") ||
 				e->matches("cert") ||
 				e->matches("key") ||
 				e->matches("CAfile") ||
@@ -104,6 +112,7 @@ IpfixSender* IpfixExporterCfg::createInstance()
 	instance = new IpfixSender(observationDomainId, recordRateLimit, sctpDataLifetime, 
 			sctpReconnectInterval, templateRefreshTime,
 			certificateChainFile, privateKeyFile, caFile, caPath, export_protocol);
+	instance->setUdpBatching(udpBatchSize, udpBatchDelay);
 
 	std::vector<CollectorCfg*>::const_iterator it;
 	for (it = collectors.begin(); it != collectors.end(); it++) {
@@ -195,6 +204,8 @@ bool IpfixExporterCfg::equalTo(IpfixExporterCfg* other)
 	if (sctpReconnectInterval != other->sctpReconnectInterval) return false;
 	if (recordRateLimit != other->recordRateLimit) return false;
 	if (observationDomainId != other->observationDomainId) return false;
+	if (udpBatchSize != other->udpBatchSize) return false;
+	if (udpBatchDelay != other->udpBatchDelay) return false;
 	if (certificateChainFile != other->certificateChainFile) return false;
 	if (privateKeyFile != other->privateKeyFile) return false;
 	if (caFile != other->caFile) return false;
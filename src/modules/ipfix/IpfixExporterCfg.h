@@ -58,6 +58,10 @@ private:
 	export_protocol_version export_protocol;
 	uint32_t recordRateLimit;
 	uint32_t observationDomainId;
+
+	/** batched transmission to UDP collectors */
+	uint32_t udpBatchSize;
+	uint32_t udpBatchDelay;
 	
 	/** DTLS parameters */
 	std::string certificateChainFile;
@@ -133,11 +133,11 @@ uint32_t IpfixParser::processTemplateSet(boost::shared_ptr<IpfixRecord::SourceID
 			}
 		}
         
-		templateBuffer->bufferTemplate(bt); 
 		if((sourceId->protocol == IPFIX_protocolIdentifier_UDP) && (templateLifetime > 0))
 			bt->expires = time(0) + templateLifetime;
 		else
 			bt->expires = 0;
+		templateBuffer->bufferTemplate(bt); 
 
 		IpfixTemplateRecord* ipfixRecord = templateRecordIM.getNewInstance();
 		ipfixRecord->sourceID = sourceId;
@@ -283,11 +283,11 @@ uint32_t IpfixParser::processOptionsTemplateSet(boost::shared_ptr<IpfixRecord::S
 				ti->fieldInfo[fieldNo].offset = 0xFFFFFFFF;
 			}
 		}
-		templateBuffer->bufferTemplate(bt); 
 		if((sourceId->protocol == IPFIX_protocolIdentifier_UDP) && (templateLifetime > 0))
 			bt->expires = time(0) + templateLifetime;
 		else
 			bt->expires = 0;
+		templateBuffer->bufferTemplate(bt); 
 
 		IpfixTemplateRecord* ipfixRecord = templateRecordIM.getNewInstance();
 		ipfixRecord->sourceID = sourceId;
@@ -298,6 +298,47 @@ uint32_t IpfixParser::processOptionsTemplateSet(boost::shared_ptr<IpfixRecord::S
 	return numberOfRecords;
 }
 
+/**
+ * Determines offsets and lengths of the given fields in a variable-length record.
+ * @param fields FieldInfos of the Template, offset and length of each field are overwritten
+ * @param record start of the record
+ * @param endOfSet end of the Data Set containing the record
+ * @param recordLength offset of the first field, is set to the offset following the last field
+ * @return false if the fields exceed the Data Set
+ */
+bool IpfixParser::parseVariableLengthFields(std::vector<TemplateInfo::FieldInfo>& fields, uint8_t* record, uint8_t* endOfSet, int& recordLength)
+{
+	int fieldLength;
+
+	for (size_t i = 0; i < fields.size(); i++) {
+		if (!fields[i].isVariableLength) {
+			fieldLength = fields[i].type.length;
+		} else {
+			/* check if 1 byte for the length lies within set boundary */
+			if (record + recordLength + 1 > endOfSet) {
+				return false;
+			}
+			fieldLength = *(uint8_t*)(record + recordLength);
+			recordLength += 1;
+			if (fieldLength == 255) {
+				/* check if there are 2 bytes for the length */
+				if (record + recordLength + 2 > endOfSet) {
+					return false;
+				}
+				fieldLength = ntohs(*(uint16_t*)(record + recordLength));
+				recordLength += 2;
+			}
+		}
+		DPRINTF_INFO("Field: original length %u, offset %u", fields[i].type.length, fields[i].offset);
+		fields[i].offset = recordLength;
+		fields[i].type.length = fieldLength;
+		recordLength += fieldLength;
+	}
+
+	/* final check if entire record is within set boundary */
+	return record + recordLength <= endOfSet;
+}
+
 /**
  * Processes an IPFIX data set.
  * Called by processMessage
@@ -345,6 +386,7 @@ uint32_t IpfixParser::processDataSet(boost::shared_ptr<IpfixRecord::SourceID> so
 					IpfixDataRecord* ipfixRecord = dataRecordIM.getNewInstance();
 					ipfixRecord->sourceID = sourceId;
 					ipfixRecord->templateInfo = ti;
+					ipfixRecord->clearRecordLayout();
 					ipfixRecord->dataLength = bt->recordLength;
 					ipfixRecord->message = message;
 					ipfixRecord->data = record;
@@ -361,83 +403,29 @@ uint32_t IpfixParser::processDataSet(boost::shared_ptr<IpfixRecord::SourceID> so
 				msg(LOG_ERR, "IpfixParser: Got a Data Set that contained not a single full record");
 			}
 			else while (record < endOfSet) {
-				int recordLength=0;
-				int fieldLength;
-				int i;
-				bool incomplete = false;
-				ti = boost::shared_ptr<TemplateInfo>(new TemplateInfo(*bt->templateInfo.get()));
+				int recordLength = 0;
 
+				/* The Template is shared by all records, the offsets and lengths of this record are determined
+				 * on a copy of its FieldInfos which is reused for all following records */
 				/* Go through scope fields first */
-				for (i = 0; i < ti->scopeCount; i++) {
-					if (!ti->scopeInfo[i].isVariableLength) {
-						fieldLength = ti->scopeInfo[i].type.length;
-					} else {
-						/* check if 1 byte for the length lies within set boundary */
-						if (record + recordLength + 1 > endOfSet) {
-							incomplete = true;
-							break;
-						}
-						fieldLength = *(uint8_t*)(record + recordLength);
-						recordLength += 1;
-						if (fieldLength == 255) {
-							/* check if there are 2 bytes for the length */
-							if (record + recordLength + 2 > endOfSet) {
-								incomplete = true;
-								break;
-							}
-							fieldLength = ntohs(*(uint16_t*)(record + recordLength));
-							recordLength += 2;
-						}
-					}
-					DPRINTF_INFO("Scope field: original length %u, offset %u", ti->fieldInfo[i].type.length, ti->fieldInfo[i].offset);
-					ti->scopeInfo[i].offset = recordLength;
-					ti->scopeInfo[i].type.length = fieldLength;
-					recordLength += fieldLength;
-				}
-
-				/* final check if entire record is within set boundary */
-				if (incomplete || (record + recordLength > endOfSet)) {
+				varScopeInfo.assign(ti->scopeInfo, ti->scopeInfo + ti->scopeCount);
+				if (!parseVariableLengthFields(varScopeInfo, record, endOfSet, recordLength)) {
 					DPRINTF_INFO("Incomplete variable length record");
 					break;
-				} 
-
-				/* Now, go through non-scope fields */
-				for (i = 0; i < ti->fieldCount; i++) {
-					if (!ti->fieldInfo[i].isVariableLength) {
-						fieldLength = ti->fieldInfo[i].type.length;
-					} else {
-						/* check if 1 byte for the length lies within set boundary */
-						if (record + recordLength + 1 > endOfSet) {
-							incomplete = true;
-							break;
-						}
-						fieldLength = *(uint8_t*)(record + recordLength);
-						recordLength += 1;
-						if (fieldLength == 255) {
-							/* check if there are 2 bytes for the length */
-							if (record + recordLength + 2 > endOfSet) {
-								incomplete = true;
-								break;
-							}
-							fieldLength = ntohs(*(uint16_t*)(record + recordLength));
-							recordLength += 2;
-						}
-					}
-					DPRINTF_INFO("Non-scope field: original length %u, offset %u", ti->fieldInfo[i].type.length, ti->fieldInfo[i].offset);
-					ti->fieldInfo[i].offset = recordLength;
-					ti->fieldInfo[i].type.length = fieldLength;
-					recordLength += fieldLength;
 				}
 
-				/* final check if entire record is within set boundary */
-				if (incomplete || (record + recordLength > endOfSet)) {
+				/* Now, go through non-scope fields */
+				varFieldInfo.assign(ti->fieldInfo, ti->fieldInfo + ti->fieldCount);
+				if (!parseVariableLengthFields(varFieldInfo, record, endOfSet, recordLength)) {
 					DPRINTF_INFO("Incomplete variable length record");
 					break;
-				} 
+				}
 
 				IpfixDataRecord* ipfixRecord = dataRecordIM.getNewInstance();
 				ipfixRecord->sourceID = sourceId;
 				ipfixRecord->templateInfo = ti;
+				ipfixRecord->recordFieldInfo.assign(varFieldInfo.begin(), varFieldInfo.end());
+				ipfixRecord->recordScopeInfo.assign(varScopeInfo.begin(), varScopeInfo.end());
 				ipfixRecord->dataLength = recordLength;
 				ipfixRecord->message = message;
 				ipfixRecord->data = record;
@@ -660,6 +648,7 @@ int IpfixParser::processIpfixPacket(boost::shared_array<uint8_t> message, uint16
 int IpfixParser::processPacket(boost::shared_array<uint8_t> message, uint16_t length, boost::shared_ptr<IpfixRecord::SourceID> sourceId)
 {
 	pthread_mutex_lock(&mutex);
+	templateBuffer->expireTemplates(time(NULL));
 	if (length == 0) {
 		templateBuffer->destroyBufferedTemplate(sourceId, 0, true);
 		pthread_mutex_unlock(&mutex);
@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <boost/smart_ptr.hpp>
 #include <map>
+#include <vector>
 
 #ifdef EXPORT_TIME_SANITY_CHECK
 #include <time.h>
@@ -133,6 +134,10 @@ class IpfixParser : public IpfixPacketProcessor, public Sensor
 
 		pthread_mutex_t mutex; /**< Used to give only one IpfixReceiver access to the IpfixPacketProcessor */
 
+		std::vector<TemplateInfo::FieldInfo> varFieldInfo; /**< field layout of the variable-length record being parsed */
+		std::vector<TemplateInfo::FieldInfo> varScopeInfo; /**< scope field layout of the variable-length record being parsed */
+
+		static bool parseVariableLengthFields(std::vector<TemplateInfo::FieldInfo>& fields, uint8_t* record, uint8_t* endOfSet, int& recordLength);
 		uint32_t processDataSet(boost::shared_ptr<IpfixRecord::SourceID> sourceID, boost::shared_array<uint8_t> message, IpfixSetHeader* set, uint8_t* endOfMessage);
 		uint32_t processTemplateSet(boost::shared_ptr<IpfixRecord::SourceID> sourceID, TemplateInfo::SetId setId, boost::shared_array<uint8_t> message, IpfixSetHeader* set, uint8_t* endOfMessage);
 		uint32_t processOptionsTemplateSet(boost::shared_ptr<IpfixRecord::SourceID> sourceId, TemplateInfo::SetId setId, boost::shared_array<uint8_t> message, IpfixSetHeader* set, uint8_t* endOfMessage);
@@ -511,7 +511,6 @@ void IpfixPrinter::onTemplateDestruction(IpfixTemplateDestructionRecord* record)
  */
 void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 {
-	boost::shared_ptr<TemplateInfo> dataTemplateInfo = record->templateInfo;
 		char buf[100], buf2[120];
 
 		if (linesPrinted==0 || linesPrinted>50) {
@@ -529,7 +528,7 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 
 		uint32_t timetype = 0;
 		uint32_t starttime = 0;
-		TemplateInfo::FieldInfo* fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_flowStartSeconds, 0);
+		TemplateInfo::FieldInfo* fi = record->getFieldInfo(IPFIX_TYPEID_flowStartSeconds, 0);
 		if (fi != NULL) {
 			timetype = IPFIX_TYPEID_flowStartSeconds;
 			time_t t = ntohl(*reinterpret_cast<time_t*>(record->data+fi->offset));
@@ -537,7 +536,7 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 			tm = localtime(&t);
 			strftime(buf, 50, "%F %T", tm);
 		} else {
-			fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_flowStartMilliseconds, 0);
+			fi = record->getFieldInfo(IPFIX_TYPEID_flowStartMilliseconds, 0);
 			if (fi != NULL) {
 				timetype = IPFIX_TYPEID_flowStartMilliseconds;
 				uint64_t t2 = ntohll(*reinterpret_cast<uint64_t*>(record->data+fi->offset));
@@ -546,13 +545,13 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 				tm = localtime(&t);
 				strftime(buf, 50, "%F %T", tm);
 			} else {
-				fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_flowStartSysUpTime, 0);
+				fi = record->getFieldInfo(IPFIX_TYPEID_flowStartSysUpTime, 0);
 				if (fi != NULL) {
 					timetype = IPFIX_TYPEID_flowStartSysUpTime;
 					starttime = ntohl(*reinterpret_cast<uint32_t*>(record->data+fi->offset));
 					snprintf(buf, 50, "%u:%02u.%04u", starttime/60000, (starttime%60000)/1000, starttime%1000);
 				} else {
-					fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_flowStartSeconds, 0);
+					fi = record->getFieldInfo(IPFIX_TYPEID_flowStartSeconds, 0);
 					if (fi != NULL) {
 						timetype = IPFIX_TYPEID_flowStartNanoseconds;
 						uint64_t t2 = ntohll(*reinterpret_cast<uint64_t*>(record->data+fi->offset));
@@ -570,28 +569,28 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 			uint32_t dur = 0;
 			switch (timetype) {
 				case IPFIX_TYPEID_flowStartSeconds:
-					fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_flowEndSeconds, 0);
+					fi = record->getFieldInfo(IPFIX_TYPEID_flowEndSeconds, 0);
 					if (fi != NULL) {
 						dur = ntohl(*reinterpret_cast<uint32_t*>(record->data+fi->offset)) - starttime;
 						dur *= 1000;
 					}
 					break;
 				case IPFIX_TYPEID_flowStartMilliseconds:
-					fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_flowEndMilliseconds, 0);
+					fi = record->getFieldInfo(IPFIX_TYPEID_flowEndMilliseconds, 0);
 					if (fi != NULL) {
 						dur = ntohll(*reinterpret_cast<uint64_t*>(record->data+fi->offset)) - starttime;
 						dur *= 1000;
 					}
 					break;
 				case IPFIX_TYPEID_flowStartSysUpTime:
-					fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_flowEndSysUpTime, 0);
+					fi = record->getFieldInfo(IPFIX_TYPEID_flowEndSysUpTime, 0);
 					if (fi != NULL) {
 						dur = ntohl(*reinterpret_cast<uint32_t*>(record->data+fi->offset)) - starttime;
 						dur *= 1000;
 					}
 					break;
 				case IPFIX_TYPEID_flowStartNanoseconds:
-					fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_flowEndNanoseconds, 0);
+					fi = record->getFieldInfo(IPFIX_TYPEID_flowEndNanoseconds, 0);
 					if (fi != NULL) {
 						uint64_t t2 = ntohll(*reinterpret_cast<uint64_t*>(record->data+fi->offset));
 						timeval t = timentp64(u64_to_ntp64(t2));
@@ -605,7 +604,7 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 			fprintf(fh, "%20s %8s ", "---", "---");
 		}
 
-		fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_protocolIdentifier, 0);
+		fi = record->getFieldInfo(IPFIX_TYPEID_protocolIdentifier, 0);
 		if (fi != NULL && fi->type.length==1) {
 			snprintf(buf, ARRAY_SIZE(buf), "%hhu", *reinterpret_cast<uint8_t*>(record->data+fi->offset));
 		} else {
@@ -613,12 +612,12 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 		}
 		fprintf(fh, "%5s ", buf);
 
-		fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_sourceIPv4Address, 0);
+		fi = record->getFieldInfo(IPFIX_TYPEID_sourceIPv4Address, 0);
 		uint32_t srcip = 0;
 		if (fi != NULL && fi->type.length>=4) {
 			srcip = ntohl( *reinterpret_cast<uint32_t*>(record->data+fi->offset) );
 		}
-		fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_sourceTransportPort, 0);
+		fi = record->getFieldInfo(IPFIX_TYPEID_sourceTransportPort, 0);
 		uint16_t srcport = 0;
 		if (fi != NULL && fi->type.length==2) {
 			srcport = ntohs(*reinterpret_cast<uint16_t*>(record->data+fi->offset));
@@ -626,12 +625,12 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 		snprintf(buf, ARRAY_SIZE(buf), "%" PRIu8 ".%" PRIu8 ".%" PRIu8 ".%" PRIu8 ":%" PRIu16, (uint8_t)((srcip>>0)&0xFF), (uint8_t)((srcip>>8)&0xFF), (uint8_t)((srcip>>16)&0xFF), (uint8_t)((srcip>>24)&0xFF), srcport);
 		fprintf(fh, "%21s ", buf);
 
-		fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_destinationIPv4Address, 0);
+		fi = record->getFieldInfo(IPFIX_TYPEID_destinationIPv4Address, 0);
 		uint32_t dstip = 0;
 		if (fi != NULL && fi->type.length>=4) {
 			dstip = ntohl( *reinterpret_cast<uint32_t*>(record->data+fi->offset) );
 		}
-		fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_destinationTransportPort, 0);
+		fi = record->getFieldInfo(IPFIX_TYPEID_destinationTransportPort, 0);
 		uint16_t dstport = 0;
 		if (fi != NULL && fi->type.length==2) {
 			dstport = ntohs(*reinterpret_cast<uint16_t*>(record->data+fi->offset));
@@ -639,7 +638,7 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 		snprintf(buf, ARRAY_SIZE(buf), "%" PRIu8 ".%" PRIu8 ".%" PRIu8 ".%" PRIu8 ":%" PRIu16, (uint8_t)((dstip>>0)&0xFF), (uint8_t)((dstip>>8)&0xFF), (uint8_t)((dstip>>16)&0xFF), (uint8_t)((dstip>>24)&0xFF), dstport);
 		fprintf(fh, "%21s ", buf);
 
-		fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_packetDeltaCount, 0);
+		fi = record->getFieldInfo(IPFIX_TYPEID_packetDeltaCount, 0);
 		if (fi != NULL) {
 			printUint(buf, fi->type, record->data+fi->offset);
 		} else {
@@ -647,7 +646,7 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 		}
 		fprintf(fh, "%5s ", buf);
 
-		fi = dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_octetDeltaCount, 0);
+		fi = record->getFieldInfo(IPFIX_TYPEID_octetDeltaCount, 0);
 		if (fi != NULL) {
 			printUint(buf, fi->type, record->data+fi->offset);
 		} else {
@@ -663,6 +662,8 @@ void IpfixPrinter::printOneLineRecord(IpfixDataRecord* record)
 void IpfixPrinter::printTreeRecord(IpfixDataRecord* record)
 {
 	int i;
+	TemplateInfo::FieldInfo* fieldInfo = record->getFieldInfoArray();
+	TemplateInfo::FieldInfo* scopeInfo = record->getScopeInfoArray();
 
 	switch(record->templateInfo->setId) {
 		case TemplateInfo::NetflowTemplate:
@@ -697,22 +698,22 @@ void IpfixPrinter::printTreeRecord(IpfixDataRecord* record)
 		fprintf(fh, " `- variable scope data\n");
 		for(i = 0; i < record->templateInfo->scopeCount; i++) {
 			fprintf(fh, " '   `- ");
-			printFieldData(record->templateInfo->scopeInfo[i].type, (record->data + record->templateInfo->scopeInfo[i].offset));
+			printFieldData(scopeInfo[i].type, (record->data + scopeInfo[i].offset));
 			fprintf(fh, "\n");
 		}
 	}
 	fprintf(fh, " `- variable data\n");
 	for (i = 0; i < record->templateInfo->fieldCount; i++) {
 		fprintf(fh, " '   `- ");
-		if (record->templateInfo->fieldInfo[i].type == InformationElement::IeInfo(IPFIX_TYPEID_basicList, 0)) {
-			printFieldDataType(record->templateInfo->fieldInfo[i].type);
+		if (fieldInfo[i].type == InformationElement::IeInfo(IPFIX_TYPEID_basicList, 0)) {
+			printFieldDataType(fieldInfo[i].type);
 
-			fprintf(fh, "semantic=%hhu, %s [", record->templateInfo->fieldInfo[i].basicListData.semantic, record->templateInfo->fieldInfo[i].basicListData.fieldIe->toString().c_str());
+			fprintf(fh, "semantic=%hhu, %s [", fieldInfo[i].basicListData.semantic, fieldInfo[i].basicListData.fieldIe->toString().c_str());
 
-			vector<void*>** listPtrPtr = (vector<void*>**) (record->data + record->templateInfo->fieldInfo[i].offset);
+			vector<void*>** listPtrPtr = (vector<void*>**) (record->data + fieldInfo[i].offset);
 			for (vector<void*>::const_iterator iter = (*listPtrPtr)->begin(); iter != (*listPtrPtr)->end(); iter++) {
 
-				printFieldDataValue(*record->templateInfo->fieldInfo[i].basicListData.fieldIe, reinterpret_cast<IpfixRecord::Data*>(*iter));
+				printFieldDataValue(*fieldInfo[i].basicListData.fieldIe, reinterpret_cast<IpfixRecord::Data*>(*iter));
 
 				// No comma for last element in the list
 				if (iter+1 != (*listPtrPtr)->end()) {
@@ -721,7 +722,7 @@ void IpfixPrinter::printTreeRecord(IpfixDataRecord* record)
 			}
 			fprintf(fh, "]");
 		} else {
-			printFieldData(record->templateInfo->fieldInfo[i].type, (record->data + record->templateInfo->fieldInfo[i].offset));
+			printFieldData(fieldInfo[i].type, (record->data + fieldInfo[i].offset));
 		}
 		fprintf(fh, "\n");
 	}
@@ -107,6 +107,16 @@ int IpfixReceiver::setPacketProcessors(std::list<IpfixPacketProcessor*> packetPr
 	return 0;
 }
 
+/**
+ * Returns the number of threads receiving messages in parallel. Each of them needs its own
+ * PacketProcessor, so the list passed to setPacketProcessors() must contain this number
+ * of PacketProcessors. Receivers with a single thread pass each message to all PacketProcessors.
+ */
+uint32_t IpfixReceiver::getWorkerCount()
+{
+	return 1;
+}
+
 /**
  * Checks if PacketProcessors where assigned to the IpfixReceiver
  * @return 0 if no PacketProcessors where assigned, > 0 otherwise
@@ -53,6 +53,7 @@ class IpfixReceiver
 		void setVModule(Module* m);
 		
 		virtual void run() = 0;
+		virtual uint32_t getWorkerCount();
 
 	protected:
 		std::list<IpfixPacketProcessor*> packetProcessors; /**< Authorized incoming packets are forwarded to the packetProcessors. The list of packetProcessor must be created, managed and destroyed by an superior instance. The IpfixReceiver will only work with the given list */
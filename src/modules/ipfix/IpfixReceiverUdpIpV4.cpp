@@ -42,16 +42,64 @@ using namespace std;
  * Does UDP/IPv4 specific initialization.
  * @param port Port to listen on
  * @param ipAddr interface to use, if equals "", all interfaces will be used
+ * @param workers number of sockets and threads receiving on the port, sockets use SO_REUSEPORT if more than one
+ * @param batchSize maximum number of datagrams fetched with one call of recvmmsg()
  */
 IpfixReceiverUdpIpV4::IpfixReceiverUdpIpV4(int port, std::string ipAddr,
-		const uint32_t buffer, unsigned int moduleId)
-	: statReceivedPackets(0)
+		const uint32_t buffer, unsigned int moduleId, uint32_t workers, uint32_t batchSize)
+	: batchSize(batchSize),
+	  bufferPool(new BufferPool())
 {
 	receiverPort = port;
 
+	if (workers == 0 || batchSize == 0)
+		THROWEXCEPTION("IpfixReceiverUdpIpV4: number of workers and batch size must be at least 1");
+
+	for (uint32_t i = 0; i < workers; i++) {
+		Worker* worker = new Worker(this, i);
+		this->workers.push_back(worker);
+		worker->socket = createSocket(ipAddr, port, buffer, workers > 1);
+	}
+
+	SensorManager::getInstance().addSensor(this, "IpfixReceiverUdpIpV4", moduleId);
+
+	msg(LOG_NOTICE, "UDP Receiver listening on %s:%d, FD=%d, %u worker(s), batch size %u", (ipAddr == "")?std::string("ALL").c_str() : ipAddr.c_str(), 
+								port, 
+								this->workers[0]->socket, workers, batchSize);
+}
+
+
+/**
+ * Does UDP/IPv4 specific cleanup
+ */
+IpfixReceiverUdpIpV4::~IpfixReceiverUdpIpV4() {
+	for (size_t i = 0; i < workers.size(); i++) {
+		if (workers[i]->socket >= 0) close(workers[i]->socket);
+		delete workers[i];
+	}
+	SensorManager::getInstance().removeSensor(this);
+}
+
+
+IpfixReceiverUdpIpV4::Worker::Worker(IpfixReceiverUdpIpV4* receiver, uint32_t index)
+	: receiver(receiver),
+	  index(index),
+	  socket(-1),
+	  packetProcessor(NULL),
+	  thread(IpfixReceiverUdpIpV4::workerThread, "IpfixRecvUdp"),
+	  statReceivedPackets(0)
+{
+}
+
+
+/**
+ * creates and binds a socket
+ */
+int IpfixReceiverUdpIpV4::createSocket(const std::string& ipAddr, int port, uint32_t buffer, bool reusePort)
+{
 	struct sockaddr_in serverAddress;
 
-	listen_socket = socket(AF_INET, SOCK_DGRAM, 0);
+	int listen_socket = socket(AF_INET, SOCK_DGRAM, 0);
 	if(listen_socket < 0) {
 		/* ASK: error should be written to log file */
 		perror("Could not create socket");
@@ -59,6 +107,14 @@ IpfixReceiverUdpIpV4::IpfixReceiverUdpIpV4(int port, std::string ipAddr,
 		THROWEXCEPTION("Cannot create IpfixReceiverUdpIpV4, socket creation failed");
 	}
 
+	if (reusePort) {
+		int one = 1;
+		if (setsockopt(listen_socket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+			close(listen_socket);
+			THROWEXCEPTION("Cannot create IpfixReceiverUdpIpV4, setting SO_REUSEPORT failed: %s", strerror(errno));
+		}
+	}
+
 	setBufferSize(listen_socket, buffer);
 	
 	// if ipAddr set: listen on a specific interface 
@@ -74,34 +130,75 @@ IpfixReceiverUdpIpV4::IpfixReceiverUdpIpV4(int port, std::string ipAddr,
 	if(bind(listen_socket, (struct sockaddr*)&serverAddress, 
 		sizeof(struct sockaddr_in)) < 0) {
 		perror("Could not bind socket");
+		close(listen_socket);
 		THROWEXCEPTION("Cannot create IpfixReceiverUdpIpV4 %s:%d",ipAddr.c_str(), port );
 	}
 
-	SensorManager::getInstance().addSensor(this, "IpfixReceiverUdpIpV4", moduleId);
+	return listen_socket;
+}
 
-	msg(LOG_NOTICE, "UDP Receiver listening on %s:%d, FD=%d", (ipAddr == "")?std::string("ALL").c_str() : ipAddr.c_str(), 
-								port, 
-								listen_socket);
+
+uint32_t IpfixReceiverUdpIpV4::getWorkerCount()
+{
+	return workers.size();
 }
 
 
 /**
- * Does UDP/IPv4 specific cleanup
+ * UDP specific listener function. This function is called by @c listenerThread()
+ * Starts the threads of all further workers and receives on the first socket itself.
  */
-IpfixReceiverUdpIpV4::~IpfixReceiverUdpIpV4() {
-	close(listen_socket);
-	SensorManager::getInstance().removeSensor(this);
+void IpfixReceiverUdpIpV4::run() {
+	uint32_t i = 0;
+	for (std::list<IpfixPacketProcessor*>::iterator it = packetProcessors.begin(); it != packetProcessors.end() && i < workers.size(); ++it, ++i) {
+		workers[i]->packetProcessor = *it;
+	}
+	if (i < workers.size()) {
+		THROWEXCEPTION("IpfixReceiverUdpIpV4: got %u packet processors for %zu workers", i, workers.size());
+	}
+
+	for (i = 1; i < workers.size(); i++) {
+		workers[i]->thread.run(workers[i]);
+	}
+
+	receive(workers[0]);
+
+	for (i = 1; i < workers.size(); i++) {
+		workers[i]->thread.join();
+	}
+	msg(LOG_INFO, "IpfixReceiverUdpIpV4: Exiting");
+}
+
+
+void* IpfixReceiverUdpIpV4::workerThread(void* data)
+{
+	Worker* worker = (Worker*)data;
+
+	worker->receiver->vmodule->registerCurrentThread();
+
+	worker->receiver->receive(worker);
+
+	worker->receiver->vmodule->unregisterCurrentThread();
+
+	return NULL;
 }
 
 
 /**
- * UDP specific listener function. This function is called by @c listenerThread()
+ * receives messages on the socket of the given worker until the receiver is shut down
  */
-void IpfixReceiverUdpIpV4::run() {
-	struct sockaddr_in clientAddress;
-	socklen_t clientAddressLen;
-	clientAddressLen = sizeof(struct sockaddr_in);
-	
+void IpfixReceiverUdpIpV4::receive(Worker* worker) {
+	int listen_socket = worker->socket;
+	std::vector<struct sockaddr_in> clientAddresses(batchSize);
+	std::vector<struct iovec> iovecs(batchSize);
+	std::vector<struct mmsghdr> msgs(batchSize);
+	boost::scoped_array<uint8_t> slots(new uint8_t[batchSize*MAX_MSG_LEN]);
+
+	for (uint32_t i = 0; i < batchSize; i++) {
+		iovecs[i].iov_base = slots.get()+i*MAX_MSG_LEN;
+		iovecs[i].iov_len = MAX_MSG_LEN;
+	}
+
 	fd_set fd_array; //all active filedescriptors
 	fd_set readfds;  //parameter for for pselect
 
@@ -115,52 +212,136 @@ void IpfixReceiverUdpIpV4::run() {
 	timeOut.tv_sec = 0L;
 	timeOut.tv_nsec = 400000000L;
 	
+	bool wait = true;
 	while(!exitFlag) {
-		readfds = fd_array; // because select() changes readfds
-		ret = pselect(listen_socket + 1, &readfds, NULL, NULL, &timeOut, NULL);
-		if (ret == 0) {
-			/* Timeout */
-			continue;
-    		}
-		if ((ret == -1) && (errno == EINTR)) {
-			/* There was a signal... ignore */
-			continue;
-    		}
-    		if (ret < 0) {
-    			msg(LOG_ERR ,"select() returned with an error");
-			THROWEXCEPTION("IpfixReceiverUdpIpV4: terminating listener thread");
-			break;
+		if (wait) {
+			readfds = fd_array; // because select() changes readfds
+			ret = pselect(listen_socket + 1, &readfds, NULL, NULL, &timeOut, NULL);
+			if (ret == 0) {
+				/* Timeout */
+				continue;
+			}
+			if ((ret == -1) && (errno == EINTR)) {
+				/* There was a signal... ignore */
+				continue;
+			}
+			if (ret < 0) {
+				msg(LOG_ERR ,"select() returned with an error");
+				THROWEXCEPTION("IpfixReceiverUdpIpV4: terminating listener thread");
+				break;
+			}
 		}
 
-		boost::shared_array<uint8_t> data(new uint8_t[MAX_MSG_LEN]);
+		for (uint32_t i = 0; i < batchSize; i++) {
+			memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+			msgs[i].msg_hdr.msg_name = &clientAddresses[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			msgs[i].msg_hdr.msg_iov = &iovecs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
 
-		ret = recvfrom(listen_socket, data.get(), MAX_MSG_LEN,
-			     0, (struct sockaddr*)&clientAddress, &clientAddressLen);
+		ret = recvmmsg(listen_socket, msgs.data(), batchSize, MSG_DONTWAIT, NULL);
 		if (ret < 0) {
-			msg(LOG_CRIT, "recvfrom returned without data, terminating listener thread");
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+				wait = true;
+				continue;
+			}
+			msg(LOG_CRIT, "recvmmsg returned without data, terminating listener thread");
 			break;
 		}
-		
-		if (isHostAuthorized(&clientAddress.sin_addr, sizeof(clientAddress.sin_addr))) {
-			statReceivedPackets++;
-// 			uint32_t ip = clientAddress.sin_addr.s_addr;
-			boost::shared_ptr<IpfixRecord::SourceID> sourceID(new IpfixRecord::SourceID);
-			memcpy(sourceID->exporterAddress.ip, &clientAddress.sin_addr.s_addr, 4);
-			sourceID->exporterAddress.len = 4;
-			sourceID->exporterPort = ntohs(clientAddress.sin_port);
-			sourceID->protocol = IPFIX_protocolIdentifier_UDP;
-			sourceID->receiverPort = receiverPort;
-			sourceID->fileDescriptor = listen_socket;
-			mutex.lock();
-			for (std::list<IpfixPacketProcessor*>::iterator i = packetProcessors.begin(); i != packetProcessors.end(); ++i) { 
-				(*i)->processPacket(data, ret, sourceID);
+		// more datagrams may be pending if the batch was filled completely
+		wait = ((uint32_t)ret < batchSize);
+
+		for (int i = 0; i < ret; i++) {
+			struct sockaddr_in& clientAddress = clientAddresses[i];
+			uint32_t length = msgs[i].msg_len;
+			if (!isHostAuthorized(&clientAddress.sin_addr, sizeof(clientAddress.sin_addr))) {
+				msg(LOG_DEBUG, "IpfixReceiverUdpIpv4: packet from unauthorized host %s discarded", inet_ntoa(clientAddress.sin_addr));
+				continue;
 			}
-			mutex.unlock();
-		} else {
-			msg(LOG_DEBUG, "IpfixReceiverUdpIpv4: packet from unauthorized host %s discarded", inet_ntoa(clientAddress.sin_addr));
+
+			worker->statReceivedPackets++;
+			boost::shared_array<uint8_t> data = bufferPool->allocate(length);
+			memcpy(data.get(), iovecs[i].iov_base, length);
+			boost::shared_ptr<IpfixRecord::SourceID> sourceID = getSourceID(worker, clientAddress, data.get(), length);
+			worker->packetProcessor->processPacket(data, length, sourceID);
 		}
 	}
-	msg(LOG_INFO, "IpfixReceiverUdpIpV4: Exiting");
+}
+
+
+size_t IpfixReceiverUdpIpV4::SourceKeyHash::operator()(const SourceKey& k) const
+{
+	uint64_t h = ((uint64_t)k.address << 16) ^ k.port;
+	h = h * 0x9E3779B97F4A7C15ULL ^ k.observationDomainId;
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	return (size_t)h;
+}
+
+
+/**
+ * Returns the SourceID for a message.
+ * IpfixParser sets observationDomainId, exportTime and sysUpTime of the SourceID from the message header.
+ * Hence, a SourceID is only shared between consecutive messages of an exporter whose headers contain the
+ * same values, so that it is never modified while it is referenced by records of earlier messages.
+ */
+boost::shared_ptr<IpfixRecord::SourceID> IpfixReceiverUdpIpV4::getSourceID(Worker* worker, const struct sockaddr_in& clientAddress,
+		const uint8_t* data, uint32_t length)
+{
+	SourceKey key;
+	memset(&key, 0, sizeof(key));
+	key.address = clientAddress.sin_addr.s_addr;
+	key.port = clientAddress.sin_port;
+	uint16_t version = 0;
+	uint32_t exportTime = 0;
+	uint32_t sysUpTime = 0;
+	bool cacheable = false;
+	if (length >= 16) {
+		version = ntohs(*(uint16_t*)data);
+		if (version == 0x000a) {
+			exportTime = ntohl(*(uint32_t*)(data+4));
+			key.observationDomainId = ntohl(*(uint32_t*)(data+12));
+			cacheable = true;
+		} else if (version == 0x0009 && length >= 20) {
+			sysUpTime = ntohl(*(uint32_t*)(data+4));
+			exportTime = ntohl(*(uint32_t*)(data+8));
+			key.observationDomainId = ntohl(*(uint32_t*)(data+16));
+			cacheable = true;
+		}
+	}
+
+	CachedSourceID* cached = NULL;
+	if (cacheable) {
+		SourceIDCache::iterator it = worker->sourceIDs.find(key);
+		if (it != worker->sourceIDs.end()) {
+			cached = &it->second;
+			if (cached->version == version && cached->exportTime == exportTime && cached->sysUpTime == sysUpTime) {
+				return cached->sourceID;
+			}
+		}
+	}
+
+	boost::shared_ptr<IpfixRecord::SourceID> sourceID(new IpfixRecord::SourceID);
+	memcpy(sourceID->exporterAddress.ip, &clientAddress.sin_addr.s_addr, 4);
+	sourceID->exporterAddress.len = 4;
+	sourceID->exporterPort = ntohs(clientAddress.sin_port);
+	sourceID->protocol = IPFIX_protocolIdentifier_UDP;
+	sourceID->receiverPort = receiverPort;
+	sourceID->fileDescriptor = worker->socket;
+
+	if (cacheable) {
+		if (!cached) {
+			if (worker->sourceIDs.size() >= MAX_CACHED_SOURCEIDS) worker->sourceIDs.clear();
+			cached = &worker->sourceIDs[key];
+		}
+		cached->version = version;
+		cached->exportTime = exportTime;
+		cached->sysUpTime = sysUpTime;
+		cached->sourceID = sourceID;
+	}
+	return sourceID;
 }
 
 /**
@@ -170,7 +351,18 @@ std::string IpfixReceiverUdpIpV4::getStatisticsXML(double interval)
 {
 	ostringstream oss;
 	
-	oss << "<receivedPackets>" << statReceivedPackets << "</receivedPackets>" << endl;	
+	uint32_t received = 0;
+	for (size_t i = 0; i < workers.size(); i++) {
+		received += workers[i]->statReceivedPackets;
+	}
+	oss << "<receivedPackets>" << received << "</receivedPackets>" << endl;	
+	if (workers.size() > 1) {
+		for (size_t i = 0; i < workers.size(); i++) {
+			oss << "<worker id=\"" << i << "\"><receivedPackets>" << workers[i]->statReceivedPackets << "</receivedPackets></worker>" << endl;
+		}
+	}
+	oss << "<allocatedBuffers>" << bufferPool->getAllocatedBuffers() << "</allocatedBuffers>" << endl;
+	oss << "<recycledBuffers>" << bufferPool->getRecycledBuffers() << "</recycledBuffers>" << endl;
 
 	return oss.str();
 }
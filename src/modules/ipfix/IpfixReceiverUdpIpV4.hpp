@@ -27,22 +27,86 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <list>
+#include <vector>
+#include <unordered_map>
 
 #include "IpfixReceiver.hpp"
 #include "IpfixPacketProcessor.hpp"
+#include "common/BufferPool.h"
 
+/**
+ * Receives IPFIX and NetFlow v9 messages over UDP.
+ *
+ * Datagrams are fetched with recvmmsg() in batches of up to batchSize messages and copied
+ * into recycled buffers of their actual size. With more than one worker, each worker binds
+ * its own socket with SO_REUSEPORT and runs in its own thread, the kernel distributes the
+ * exporters among the sockets. Worker i passes its messages only to the i-th packet processor.
+ */
 class IpfixReceiverUdpIpV4 : public IpfixReceiver, Sensor {
 	public:
 		IpfixReceiverUdpIpV4(int port, std::string ipAddr = "",
-				const uint32_t buffer = 0, unsigned int moduleId = 0);
+				const uint32_t buffer = 0, unsigned int moduleId = 0,
+				uint32_t workers = 1, uint32_t batchSize = 1);
 		virtual ~IpfixReceiverUdpIpV4();
 
 		virtual void run();
+		virtual uint32_t getWorkerCount();
 		virtual std::string getStatisticsXML(double interval);
 		
 	private:
-		int listen_socket;
-		uint32_t statReceivedPackets;  /**< number of received packets */ 
+		/**
+		 * key of cached SourceIDs: exporter and observation domain
+		 */
+		struct SourceKey {
+			uint32_t address;
+			uint16_t port;
+			uint32_t observationDomainId;
+
+			bool operator==(const SourceKey& x) const {
+				return address == x.address && port == x.port && observationDomainId == x.observationDomainId;
+			}
+		};
+
+		struct SourceKeyHash {
+			size_t operator()(const SourceKey& k) const;
+		};
+
+		/**
+		 * SourceID of the last message of an exporter and observation domain,
+		 * along with the header fields which IpfixParser copies into it
+		 */
+		struct CachedSourceID {
+			uint16_t version;
+			uint32_t exportTime;
+			uint32_t sysUpTime;
+			boost::shared_ptr<IpfixRecord::SourceID> sourceID;
+		};
+
+		typedef std::unordered_map<SourceKey, CachedSourceID, SourceKeyHash> SourceIDCache;
+
+		struct Worker {
+			Worker(IpfixReceiverUdpIpV4* receiver, uint32_t index);
+
+			IpfixReceiverUdpIpV4* receiver;
+			uint32_t index;
+			int socket;
+			IpfixPacketProcessor* packetProcessor;
+			Thread thread;
+			SourceIDCache sourceIDs;
+			uint32_t statReceivedPackets;  /**< number of received packets */
+		};
+
+		static const uint32_t MAX_CACHED_SOURCEIDS = 4096;
+
+		std::vector<Worker*> workers;
+		uint32_t batchSize;
+		boost::shared_ptr<BufferPool> bufferPool;
+
+		int createSocket(const std::string& ipAddr, int port, uint32_t buffer, bool reusePort);
+		void receive(Worker* worker);
+		boost::shared_ptr<IpfixRecord::SourceID> getSourceID(Worker* worker, const struct sockaddr_in& clientAddress,
+				const uint8_t* data, uint32_t length);
+		static void* workerThread(void* worker);
 };
 
 #endif
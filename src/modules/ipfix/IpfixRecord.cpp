@@ -344,3 +344,44 @@ int TemplateInfo::getFieldIndex(InformationElement::IeId fieldTypeId, Informatio
 
 	return -1;
 }
+
+/**
+ * Gets the FieldInfo of this Data Record by IE type, with the offset and length valid for this record.
+ * @return NULL if not found
+ */
+TemplateInfo::FieldInfo* IpfixDataRecord::getFieldInfo(const InformationElement::IeInfo& type) {
+	return getFieldInfo(type.id, type.enterprise);
+}
+
+/**
+ * Gets the FieldInfo of this Data Record by IE Id and enterprise number.
+ * @param fieldTypeId Information element Id to look for
+ * @param fieldTypeEid Enterprise number to look for
+ * @return NULL if not found
+ */
+TemplateInfo::FieldInfo* IpfixDataRecord::getFieldInfo(InformationElement::IeId fieldTypeId, InformationElement::IeEnterpriseNumber fieldTypeEid) {
+	if (recordFieldInfo.empty())
+		return templateInfo->getFieldInfo(fieldTypeId, fieldTypeEid);
+
+	int i = templateInfo->getFieldIndex(fieldTypeId, fieldTypeEid);
+	if (i < 0)
+		return NULL;
+	return &recordFieldInfo[i];
+}
+
+/**
+ * Takes over the field layout of another Data Record, used when a record is copied.
+ */
+void IpfixDataRecord::copyRecordLayout(const IpfixDataRecord* other) {
+	recordFieldInfo.assign(other->recordFieldInfo.begin(), other->recordFieldInfo.end());
+	recordScopeInfo.assign(other->recordScopeInfo.begin(), other->recordScopeInfo.end());
+}
+
+/**
+ * Drops the field layout of a previous use of this instance, the fields of templateInfo apply afterwards.
+ * Keeps the allocated memory for later variable-length records.
+ */
+void IpfixDataRecord::clearRecordLayout() {
+	recordFieldInfo.clear();
+	recordScopeInfo.clear();
+}
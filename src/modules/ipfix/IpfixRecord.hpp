@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 #include <memory>
+#include <vector>
 #include <boost/smart_ptr.hpp>
 #include <stdexcept>
 #include "common/Misc.h"
@@ -205,29 +206,27 @@ class IpfixRecord
 			}
 		};
 
+		/**
+		 * kind of record, allows IpfixRecordDestination to dispatch records without RTTI
+		 */
+		enum RecordType {
+			TemplateRecord,
+			DataRecord,
+			TemplateDestructionRecord
+		};
+
 		boost::shared_ptr<IpfixRecord::SourceID> sourceID;
+		const RecordType recordType;
 
-		IpfixRecord() {}
+		IpfixRecord(RecordType type) : recordType(type) {}
 
-		virtual ~IpfixRecord() {
-			if (variableLenData != NULL) {
-				free(variableLenData);
-				variableLenData = NULL;
-			}
-		}
+		virtual ~IpfixRecord() {}
 
 		/**
 		 * all subclasses *MUST* inherit ManagedInstance, which implements these methods
 		 */
 		virtual void removeReference() = 0;
 		virtual void addReference(int count = 1) = 0;
-
-		// We can not use local variables on the stack for variable length IEs as the record memory is copied only later in the sending process
-		// We therefore need malloc'ed memory for encoding variable length IEs such as basicList
-		uint8_t threeByteIndicator = 255;
-		IpfixRecord::Data* variableLenData = NULL;
-		unsigned int variableLenDataTotalBytes = 100;
-		unsigned int variableLenDataCurrBytes = 0;
 };
 
 
@@ -324,7 +323,7 @@ class TemplateInfo {
 
 class IpfixTemplateRecord : public IpfixRecord, public ManagedInstance<IpfixTemplateRecord> {
 	public:
-		IpfixTemplateRecord(InstanceManager<IpfixTemplateRecord>* im) : ManagedInstance<IpfixTemplateRecord>(im) { }
+		IpfixTemplateRecord(InstanceManager<IpfixTemplateRecord>* im) : IpfixRecord(TemplateRecord), ManagedInstance<IpfixTemplateRecord>(im) { }
 
 		boost::shared_ptr<TemplateInfo> templateInfo;
 
@@ -335,23 +334,58 @@ class IpfixTemplateRecord : public IpfixRecord, public ManagedInstance<IpfixTemp
 
 class IpfixDataRecord : public IpfixRecord, public ManagedInstance<IpfixDataRecord> {
 	public:
-		IpfixDataRecord(InstanceManager<IpfixDataRecord>* im) : ManagedInstance<IpfixDataRecord>(im) {}
+		IpfixDataRecord(InstanceManager<IpfixDataRecord>* im) : IpfixRecord(DataRecord), ManagedInstance<IpfixDataRecord>(im) {}
 
 		boost::shared_ptr<TemplateInfo> templateInfo;
 		int dataLength;
 		boost::shared_array<IpfixRecord::Data> message; /**< data block that contains @c data */
 		IpfixRecord::Data* data; /**< pointer to start of field data in @c message. Undefined after @c message goes out of scope. */
 
+		/* Field layout of this record:
+		 * - empty if all fields have the offsets and lengths given in templateInfo
+		 * - for Templates with variable-length fields, IpfixParser stores a copy of the FieldInfos of
+		 *   templateInfo with the offsets and lengths found in this record, templateInfo itself is shared
+		 *   by all records of the Template
+		 * - the vectors keep their capacity when the instance is reused, so no memory is allocated per record
+		 * Modules accessing field data should always use getFieldInfo(), getFieldInfoArray() and getScopeInfoArray().
+		 */
+		std::vector<TemplateInfo::FieldInfo> recordFieldInfo;
+		std::vector<TemplateInfo::FieldInfo> recordScopeInfo;
+
+		inline bool hasRecordLayout() const {
+			return !recordFieldInfo.empty() || !recordScopeInfo.empty();
+		}
+
+		/**
+		 * @returns array of templateInfo->fieldCount FieldInfos describing the fields of this record
+		 */
+		inline TemplateInfo::FieldInfo* getFieldInfoArray() {
+			return recordFieldInfo.empty() ? templateInfo->fieldInfo : &recordFieldInfo[0];
+		}
+
+		/**
+		 * @returns array of templateInfo->scopeCount FieldInfos describing the scope fields of this record
+		 */
+		inline TemplateInfo::FieldInfo* getScopeInfoArray() {
+			return recordScopeInfo.empty() ? templateInfo->scopeInfo : &recordScopeInfo[0];
+		}
+
+		TemplateInfo::FieldInfo* getFieldInfo(const InformationElement::IeInfo& type);
+		TemplateInfo::FieldInfo* getFieldInfo(InformationElement::IeId fieldTypeId, InformationElement::IeEnterpriseNumber fieldTypeEid);
+		void copyRecordLayout(const IpfixDataRecord* other);
+		void clearRecordLayout();
+
 		// redirector to reference remover of ManagedInstance
 		virtual void removeReference() {
 
 			// Remove allocated vector data for basicList elements
 			// NOTE: This can not be done in BaseHashtable::destroyBucket() as this leads to corrupted memory when sending in IpfixSender
+			TemplateInfo::FieldInfo* fieldInfo = getFieldInfoArray();
 			for (int i = 0; i < templateInfo->fieldCount; i++) {
 
 				// Free basicList memory
-				if (templateInfo->fieldInfo[i].type == InformationElement::IeInfo(IPFIX_TYPEID_basicList, 0)) {
-					IpfixRecord::Data* dst = (data + templateInfo->fieldInfo[i].offset);
+				if (fieldInfo[i].type == InformationElement::IeInfo(IPFIX_TYPEID_basicList, 0)) {
+					IpfixRecord::Data* dst = (data + fieldInfo[i].offset);
 					vector<void*>** listPtrPtr = (vector<void*>**) dst;
 
 					if (*listPtrPtr != NULL) {
@@ -364,13 +398,6 @@ class IpfixDataRecord : public IpfixRecord, public ManagedInstance<IpfixDataReco
 				}
 			}
 
-			// Clean previously used variable length data
-			if (variableLenData != NULL) {
-				variableLenDataCurrBytes = 0;
-				free(variableLenData);
-				variableLenData = NULL;
-			}
-
 			ManagedInstance<IpfixDataRecord>::removeReference();
 		}
 		virtual void addReference(int count = 1) { ManagedInstance<IpfixDataRecord>::addReference(count); }
@@ -378,7 +405,7 @@ class IpfixDataRecord : public IpfixRecord, public ManagedInstance<IpfixDataReco
 
 class IpfixTemplateDestructionRecord : public IpfixRecord, public ManagedInstance<IpfixTemplateDestructionRecord> {
 	public:
-		IpfixTemplateDestructionRecord(InstanceManager<IpfixTemplateDestructionRecord>* im) : ManagedInstance<IpfixTemplateDestructionRecord>(im) {}
+		IpfixTemplateDestructionRecord(InstanceManager<IpfixTemplateDestructionRecord>* im) : IpfixRecord(TemplateDestructionRecord), ManagedInstance<IpfixTemplateDestructionRecord>(im) {}
 		boost::shared_ptr<TemplateInfo> templateInfo;
 
 		// redirector to reference remover of ManagedInstance
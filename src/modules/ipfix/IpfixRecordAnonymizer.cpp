@@ -40,6 +40,7 @@ void IpfixRecordAnonymizer::onDataRecord(IpfixDataRecord* record)
 		myRecord = dataRecordIM.getNewInstance();
 		myRecord->sourceID = record->sourceID;
 		myRecord->templateInfo = record->templateInfo;
+		myRecord->copyRecordLayout(record);
 		myRecord->dataLength = record->dataLength; // = recordLength
 		myRecord->message = boost::shared_array<IpfixRecord::Data>(new IpfixRecord::Data[record->dataLength]);
 		memcpy(myRecord->message.get(), record->data, record->dataLength);
@@ -54,7 +55,7 @@ void IpfixRecordAnonymizer::onDataRecord(IpfixDataRecord* record)
 	// anonymize Data Record fields
 	int32_t lastanonid = -2;
 	for (int i = 0; i != templateInfo->fieldCount; ++i) {
-		TemplateInfo::FieldInfo* field = templateInfo->fieldInfo + i;
+		TemplateInfo::FieldInfo* field = myRecord->getFieldInfoArray() + i;
 		if (lastanonid==i-1
 				&& field->type==InformationElement::IeInfo(IPFIX_ETYPEID_anonymisationType, IPFIX_PEN_vermont)) {
 			// only if the preceding information element was really anonymised, we set this IE to 1
@@ -68,7 +69,7 @@ void IpfixRecordAnonymizer::onDataRecord(IpfixDataRecord* record)
 	if((record->templateInfo->scopeCount != 0) && ((record->templateInfo->setId == TemplateInfo::IpfixOptionsTemplate)
 			|| (record->templateInfo->setId == TemplateInfo::NetflowOptionsTemplate))) {
 		for (int i = 0; i != templateInfo->scopeCount; ++i) {
-			TemplateInfo::FieldInfo* field = templateInfo->scopeInfo + i;
+			TemplateInfo::FieldInfo* field = myRecord->getScopeInfoArray() + i;
 			anonField(field->type, myRecord->data + field->offset, field->type.length);
 		}
 	}
@@ -31,24 +31,48 @@ IpfixRecordDestination::~IpfixRecordDestination()
 
 
 /**
- * tries to determine the received record type and calls the corresponding handler function
+ * determines the received record type and calls the corresponding handler function
  */
 void IpfixRecordDestination::receive(IpfixRecord* ipfixRecord)
 {
-	IpfixDataRecord* rec = dynamic_cast<IpfixDataRecord*>(ipfixRecord);
-	if (rec) {
-		onDataRecord(rec);
-	} else {
-		IpfixTemplateRecord* rec = dynamic_cast<IpfixTemplateRecord*>(ipfixRecord);
-		if (rec) {
-			onTemplate(rec);
+	switch (ipfixRecord->recordType) {
+		case IpfixRecord::DataRecord:
+			onDataRecord(static_cast<IpfixDataRecord*>(ipfixRecord));
+			break;
+		case IpfixRecord::TemplateRecord:
+			onTemplate(static_cast<IpfixTemplateRecord*>(ipfixRecord));
+			break;
+		case IpfixRecord::TemplateDestructionRecord:
+			onTemplateDestruction(static_cast<IpfixTemplateDestructionRecord*>(ipfixRecord));
+			break;
+	}
+}
+
+/**
+ * dispatches a batch of records in their original order
+ * consecutive Data Records are passed to onDataRecords() in chunks of up to DATA_RECORD_CHUNK_SIZE records
+ */
+void IpfixRecordDestination::receiveBatch(std::vector<IpfixRecord*>& batch)
+{
+	IpfixDataRecord* records[DATA_RECORD_CHUNK_SIZE];
+	size_t count = 0;
+
+	for (std::vector<IpfixRecord*>::iterator it = batch.begin(); it != batch.end(); ++it) {
+		if ((*it)->recordType == IpfixRecord::DataRecord) {
+			records[count++] = static_cast<IpfixDataRecord*>(*it);
+			if (count == DATA_RECORD_CHUNK_SIZE) {
+				onDataRecords(records, count);
+				count = 0;
+			}
 		} else {
-			IpfixTemplateDestructionRecord* rec = dynamic_cast<IpfixTemplateDestructionRecord*>(ipfixRecord);
-			if (rec) {
-				onTemplateDestruction(rec);
+			if (count > 0) {
+				onDataRecords(records, count);
+				count = 0;
 			}
+			receive(*it);
 		}
 	}
+	if (count > 0) onDataRecords(records, count);
 }
 
 /**
@@ -73,6 +97,20 @@ void IpfixRecordDestination::onDataRecord(IpfixDataRecord* record)
 	record->removeReference();
 }
 
+/**
+ * Callback function invoked for consecutive Data Records received in one batch.
+ * Modules which can process several records more efficiently (e.g. with one lock
+ * for all of them) should override this, the default calls onDataRecord() for each record.
+ * @param records Data Records, the references of all of them are handed over
+ * @param count number of records
+ */
+void IpfixRecordDestination::onDataRecords(IpfixDataRecord** records, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		onDataRecord(records[i]);
+	}
+}
+
 /**
  * Callback function invoked when a Template is being destroyed.
  * @param sourceID SourceID of the exporter that sent this Template
@@ -38,11 +38,18 @@ public:
 	virtual ~IpfixRecordDestination();
 	
 	virtual void receive(IpfixRecord* ipfixRecord);
+	virtual void receiveBatch(std::vector<IpfixRecord*>& batch);
 	
 protected:
+	/**
+	 * maximum number of Data Records passed to onDataRecords() at once
+	 */
+	static const size_t DATA_RECORD_CHUNK_SIZE = 64;
+
 	// virtual handler functions for child classes 
 	virtual void onTemplate(IpfixTemplateRecord* record);
 	virtual void onDataRecord(IpfixDataRecord* record);
+	virtual void onDataRecords(IpfixDataRecord** records, size_t count);
 	virtual void onTemplateDestruction(IpfixTemplateDestructionRecord* record);
 };
 
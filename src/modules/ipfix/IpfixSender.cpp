@@ -66,6 +66,7 @@ IpfixSender::IpfixSender(uint32_t observationDomainId, uint32_t maxRecordRate,
 	  noRecordsInCurrentSet(0),
 	  recordCacheTimeout(IS_DEFAULT_RECORDCACHETIMEOUT),
 	  timeoutRegistered(false),
+	  udpBatchTimeoutRegistered(false),
 	  currentTemplateId(0),
 	  maxRecordRate(maxRecordRate),
 	  export_protocol(export_protocol)
@@ -126,6 +127,7 @@ IpfixSender::IpfixSender(uint32_t observationDomainId, uint32_t maxRecordRate)
 	  noCachedRecords(0),
 	  recordCacheTimeout(IS_DEFAULT_RECORDCACHETIMEOUT),
 	  timeoutRegistered(false),
+	  udpBatchTimeoutRegistered(false),
 	  currentTemplateId(0),
 	  maxRecordRate(maxRecordRate),
 	  export_protocol(IPFIX_PROTOCOL)
@@ -232,6 +234,24 @@ void IpfixSender::addCollector(const char *ip, uint16_t port,
 	}
 }
 
+/**
+ * Sends several IPFIX messages to each UDP collector with a single system call
+ * @param maxMessages number of messages sent at once, 0 disables batching
+ * @param maxDelay maximum time in milliseconds a message may be delayed
+ */
+void IpfixSender::setUdpBatching(uint32_t maxMessages, uint32_t maxDelay)
+{
+	ipfixMessageLock.lock();
+	int ret = ipfix_set_udp_batching(ipfixExporter, maxMessages, maxDelay);
+	ipfixMessageLock.unlock();
+	if (ret != 0) {
+		THROWEXCEPTION("IpfixSender: ipfix_set_udp_batching failed");
+	}
+	if (maxMessages > 1) {
+		msg(LOG_NOTICE, "IpfixSender: sending up to %u messages per system call to UDP collectors, delaying them at most %u ms", maxMessages, maxDelay);
+	}
+}
+
 /**
  * Get a small, unused Template Id
  * @returns unused Template Id or 0 if not available
@@ -279,7 +299,7 @@ void IpfixSender::onTemplate(IpfixTemplateRecord* record)
 
 
 	// check if this is a known template
-	if(uniqueIdToTemplateId.find(dataTemplateInfo->getUniqueId()) != uniqueIdToTemplateId.end()) {
+	if(uniqueIdToTemplate.find(dataTemplateInfo->getUniqueId()) != uniqueIdToTemplate.end()) {
 		msg(LOG_ERR, "IpfixSender: Received known Template (id=%u) again, which should not happen.", dataTemplateInfo->templateId);
 		record->removeReference();
 		ipfixMessageLock.unlock();
@@ -306,10 +326,11 @@ void IpfixSender::onTemplate(IpfixTemplateRecord* record)
 
 	// Update maps
 	templateIdToUniqueId[my_template_id] = dataTemplateInfo->getUniqueId(); 
-	uniqueIdToTemplateId[dataTemplateInfo->getUniqueId()] = my_template_id;
+	ExportTemplate& exportTemplate = uniqueIdToTemplate[dataTemplateInfo->getUniqueId()];
+	exportTemplate.templateId = my_template_id;
+	initBulkCopy(dataTemplateInfo.get(), exportTemplate);
 
 	//for(map<TemplateInfo::TemplateId, uint16_t>::iterator iter = templateIdToUniqueId.begin(); iter != templateIdToUniqueId.end(); iter++) msg(LOG_CRIT, "template id %u -> unique id %u", iter->first, iter->second);
-	//for(map<uint16_t, TemplateInfo::TemplateId>::iterator iter = uniqueIdToTemplateId.begin(); iter != uniqueIdToTemplateId.end(); iter++) msg(LOG_CRIT, "unique id %u -> template id %u", iter->first, iter->second);
 
 	int i;
 
@@ -355,7 +376,7 @@ void IpfixSender::onTemplate(IpfixTemplateRecord* record)
 		THROWEXCEPTION("IpfixSender: ipfix_end_template failed");
 	}
 
-	msg(LOG_INFO, "IpfixSender: created template with ID %u", my_template_id);
+	msg(LOG_INFO, "IpfixSender: created template with ID %u%s", my_template_id, exportTemplate.bulkCopy ? " (bulk copy of records)" : "");
 
 	// release message lock
 	ipfixMessageLock.unlock();
@@ -370,6 +391,41 @@ void IpfixSender::onTemplate(IpfixTemplateRecord* record)
 	record->removeReference();
 }
 
+/**
+ * Determines if Data Records of the given Template can be copied to the outgoing
+ * message in one piece, i.e. all fields are stored contiguously in the order of
+ * the Template and are sent without conversion.
+ * Data Records with their own field layout (see IpfixDataRecord::hasRecordLayout())
+ * are always encoded field by field.
+ */
+void IpfixSender::initBulkCopy(const TemplateInfo* templateInfo, ExportTemplate& exportTemplate)
+{
+	exportTemplate.bulkCopy = templateInfo->fieldCount > 0;
+	exportTemplate.bulkOffset = 0;
+	exportTemplate.bulkLength = 0;
+	exportTemplate.packetDeltaCountIndex = -1;
+
+	for (int i = 0; i < templateInfo->fieldCount; i++) {
+		const TemplateInfo::FieldInfo* fi = &templateInfo->fieldInfo[i];
+		if (fi->type.id == IPFIX_TYPEID_packetDeltaCount && fi->type.length <= 8) {
+			exportTemplate.packetDeltaCountIndex = i;
+		}
+
+		if (i == 0) exportTemplate.bulkOffset = fi->offset;
+		if (fi->type.length == 65535 ||
+				fi->type.id == IPFIX_TYPEID_basicList ||
+				(fi->type.id == IPFIX_TYPEID_sourceIPv4Address && fi->type.length == 5) ||
+				(fi->type.id == IPFIX_TYPEID_destinationIPv4Address && fi->type.length == 5) ||
+				(export_protocol == NFV9_PROTOCOL && fi->type.id == IPFIX_TYPEID_tcpControlBits && fi->type.length != 1) ||
+				fi->offset != exportTemplate.bulkOffset + exportTemplate.bulkLength ||
+				exportTemplate.bulkLength + fi->type.length > 65535) {
+			exportTemplate.bulkCopy = false;
+		} else {
+			exportTemplate.bulkLength += fi->type.length;
+		}
+	}
+}
+
 /**
  * Invalidates a template; Does NOT free dataTemplateInfo
  * @param record Pointer to a structure defining the Template used
@@ -403,18 +459,18 @@ void IpfixSender::onTemplateDestruction(IpfixTemplateDestructionRecord* record)
 		return;
 	}
 
-	map<uint16_t, TemplateInfo::TemplateId>::iterator iter = uniqueIdToTemplateId.find(dataTemplateInfo->getUniqueId());
-	if(iter == uniqueIdToTemplateId.end()) {
+	map<uint16_t, ExportTemplate>::iterator iter = uniqueIdToTemplate.find(dataTemplateInfo->getUniqueId());
+	if(iter == uniqueIdToTemplate.end()) {
 		msg(LOG_ERR, "IpfixSender: Template (id=%u) to be destroyed does not exist.", dataTemplateInfo->templateId);
 		record->removeReference();
 		ipfixMessageLock.unlock();
 		return;
 	}
 
-	TemplateInfo::TemplateId my_template_id = iter->second;
+	TemplateInfo::TemplateId my_template_id = iter->second.templateId;
 
 	// remove from maps
-	uniqueIdToTemplateId.erase(iter);
+	uniqueIdToTemplate.erase(iter);
 	templateIdToUniqueId.erase(my_template_id);
 
 	/* Remove template from ipfixlolib */
@@ -510,27 +566,49 @@ void IpfixSender::send() {
 		THROWEXCEPTION("sndIpfix: ipfix_send failed");
 	}
 
-	removeRecordReferences();
+	noCachedRecords = 0;
+	registerUdpBatchTimeout();
 }
 
+
 /**
- * removes references to flows inside buffer recordsToRelease
+ * Put new Data Record in outbound exporter queue
+ * @param rec Data Record
  */
-void IpfixSender::removeRecordReferences()
+void IpfixSender::onDataRecord(IpfixDataRecord* record)
 {
-	while (!recordsToRelease.empty()) {
-		recordsToRelease.front()->removeReference();
-		recordsToRelease.pop();
+	if (!ipfixExporter) {
+		THROWEXCEPTION("ipfixExporter not set");
 	}
-	noCachedRecords = 0;
+
+	// get the message lock
+	ipfixMessageLock.lock();
+	addDataRecord(record);
+	// release the message lock
+	ipfixMessageLock.unlock();
 }
 
+/**
+ * Put several Data Records in outbound exporter queue, acquiring the message lock only once
+ */
+void IpfixSender::onDataRecords(IpfixDataRecord** records, size_t count)
+{
+	if (!ipfixExporter) {
+		THROWEXCEPTION("ipfixExporter not set");
+	}
+
+	ipfixMessageLock.lock();
+	for (size_t i = 0; i < count; i++) {
+		addDataRecord(records[i]);
+	}
+	ipfixMessageLock.unlock();
+}
 
 /**
- * Put new Data Record in outbound exporter queue
- * @param rec Data Record
+ * Copies Data Record to the current IPFIX message and releases it
+ * ipfixMessageLock must be held by the caller
  */
-void IpfixSender::onDataRecord(IpfixDataRecord* record)
+void IpfixSender::addDataRecord(IpfixDataRecord* record)
 {
 	boost::shared_ptr<TemplateInfo> dataTemplateInfo = record->templateInfo;
 	// TODO: Implement Options Data Record handling
@@ -541,160 +619,108 @@ void IpfixSender::onDataRecord(IpfixDataRecord* record)
 		return;
 	}
 
-	if (!ipfixExporter) {
-		THROWEXCEPTION("ipfixExporter not set");
-	}
-
-	// get the message lock
-	ipfixMessageLock.lock();
-
 	// check if we know the Template
-	map<uint16_t, TemplateInfo::TemplateId>::iterator iter = uniqueIdToTemplateId.find(dataTemplateInfo->getUniqueId());
-	if(iter == uniqueIdToTemplateId.end()) {
+	map<uint16_t, ExportTemplate>::iterator iter = uniqueIdToTemplate.find(dataTemplateInfo->getUniqueId());
+	if(iter == uniqueIdToTemplate.end()) {
 		msg(LOG_ERR, "IpfixSender: Discard Data Record because Template (id=%u) does not exist (this may happen during reconfiguration).", dataTemplateInfo->templateId);
 		record->removeReference();
-		ipfixMessageLock.unlock();
 		return;
 	}
 
 	IpfixRecord::Data* data = record->data;
-	TemplateInfo::TemplateId my_template_id = iter->second;
+	const ExportTemplate& exportTemplate = iter->second;
 
 	// return if exitFlag has ben set in the meanwhile
 	if (exitFlag) {
 		record->removeReference();
-		ipfixMessageLock.unlock();
 		return;
 	}
 
-	setTemplateId(my_template_id, record->dataLength);
+	setTemplateId(exportTemplate.templateId, record->dataLength);
 
-	// Set variable length data based on template estimation to avoid realloc
-	initVarLenData(record, data);
-
-	int i;
-	for (i = 0; i < dataTemplateInfo->fieldCount; i++) {
-		TemplateInfo::FieldInfo* fi = &(dataTemplateInfo->fieldInfo[i]);
-		addDataRecordValue(fi, data, record);
+	if (exportTemplate.bulkCopy && !record->hasRecordLayout()) {
+		putDataField(data + exportTemplate.bulkOffset, exportTemplate.bulkLength);
+		if (exportTemplate.packetDeltaCountIndex >= 0) {
+			TemplateInfo::FieldInfo* fi = &dataTemplateInfo->fieldInfo[exportTemplate.packetDeltaCountIndex];
+			uint64_t p = 0;
+			memcpy(&p, data+fi->offset, fi->type.length);
+			statPacketsInFlows += ntohll(p);
+		}
+	} else {
+		// offsets and lengths of variable-length fields are given by the record
+		TemplateInfo::FieldInfo* fieldInfo = record->getFieldInfoArray();
+		for (int i = 0; i < dataTemplateInfo->fieldCount; i++) {
+			addDataRecordValue(&fieldInfo[i], data);
+		}
 	}
 	remainingSpace -= record->dataLength;
 	statSentDataRecords++;
 	recordsSentStep++;
 
-	recordsToRelease.push(record);
+	// all fields have been copied to the message
+	record->removeReference();
 
 	noCachedRecords++;
 	noRecordsInCurrentSet++;
 	registerTimeout();
-
-	// release the message lock
-	ipfixMessageLock.unlock();
 }
 
-void IpfixSender::addDataRecordValue(TemplateInfo::FieldInfo* fi, IpfixRecord::Data* data)
-{
-	addDataRecordValue(fi, data, NULL);
-}
-
-void IpfixSender::sendDataFromVarLenDataBuff(IpfixDataRecord* record, void* data, size_t len)
-{
-	if (record->variableLenDataCurrBytes + len > record->variableLenDataTotalBytes) {
-		THROWEXCEPTION("Not enough bytes allocated: %u allocated, %u needed", record->variableLenDataTotalBytes, record->variableLenDataCurrBytes + (unsigned int) len);
-	}
-
-	memcpy(&(record->variableLenData[record->variableLenDataCurrBytes]), data, len);
-	ipfix_put_data_field(ipfixExporter, &record->variableLenData[record->variableLenDataCurrBytes], len);
-	record->variableLenDataCurrBytes += len;
-}
-
-void IpfixSender::initVarLenData(IpfixDataRecord* record, IpfixRecord::Data* data)
+/**
+ * Copies data field to the current IPFIX message
+ */
+void IpfixSender::putDataField(const void* data, unsigned length)
 {
-	size_t varLenDataTotalSize = 0;
-
-	for (int i = 0; i < record->templateInfo->fieldCount; i++) {
-		TemplateInfo::FieldInfo* fi = &(record->templateInfo->fieldInfo[i]);
-		if (fi->type.id == IPFIX_TYPEID_basicList) {
-			vector<void*>** listPtrPtr = (vector<void*>**) (data + fi->offset);
-			// Variable length IE length field (2B) + Semantic (1B) + Field ID (2B) + Element Length (2B) + (optional: Enterprise Number (3B)) + basicList Content (variable)
-			// NOTE: Even though some of these fields are not copied to the variableLenData, we include them in the varLenDataTotalSize estimation
-			varLenDataTotalSize += 2 + 1 + 2 + 2;
-			varLenDataTotalSize += (fi->basicListData.fieldIe->enterprise == 0) ? 0 : 3;
-			varLenDataTotalSize += ((*listPtrPtr)->size()) * fi->basicListData.fieldIe->length;
-		}
-	}
-
-	// Allocate memory if variable length is present
-	if (varLenDataTotalSize > 0) {
-		if (record->variableLenData != NULL) {
-			free(record->variableLenData);
-			record->variableLenData = NULL;
-			record->variableLenDataCurrBytes = 0;
-		}
-		record->variableLenDataTotalBytes = varLenDataTotalSize;
-		record->variableLenData = (IpfixRecord::Data*) malloc(record->variableLenDataTotalBytes);
+	if (ipfix_put_data_field_copy(ipfixExporter, data, length) != 0) {
+		THROWEXCEPTION("IpfixSender: ipfix_put_data_field_copy failed");
 	}
 }
 
-void IpfixSender::addDataRecordValue(TemplateInfo::FieldInfo* fi, IpfixRecord::Data* data, IpfixDataRecord* record)
+void IpfixSender::addDataRecordValue(TemplateInfo::FieldInfo* fi, IpfixRecord::Data* data)
 {
 
 	/* Split IPv4 fields with length 5, i.e. fields with network mask attached */
-	if ((fi->type.id == IPFIX_TYPEID_sourceIPv4Address) && (fi->type.length == 5)) {
-		uint8_t* mask = &conversionRingbuffer[ringbufferPos++];
-		*mask = 32 - *(uint8_t*)(data + fi->offset + 4);
-		ipfix_put_data_field(ipfixExporter, data + fi->offset, 4);
-		ipfix_put_data_field(ipfixExporter, mask, 1);
-	}
-	else if ((fi->type.id == IPFIX_TYPEID_destinationIPv4Address) && (fi->type.length == 5)) {
-		uint8_t* mask = &conversionRingbuffer[ringbufferPos++];
-		*mask = 32 - *(uint8_t*)(data + fi->offset + 4); // TODO FIXME Valgrind complains due to uninitialized memory!!!
-		ipfix_put_data_field(ipfixExporter, data + fi->offset, 4);
-		ipfix_put_data_field(ipfixExporter, mask, 1);
+	if (((fi->type.id == IPFIX_TYPEID_sourceIPv4Address) || (fi->type.id == IPFIX_TYPEID_destinationIPv4Address)) && (fi->type.length == 5)) {
+		uint8_t mask = 32 - *(uint8_t*)(data + fi->offset + 4);
+		putDataField(data + fi->offset, 4);
+		putDataField(&mask, 1);
 	}
 	else if ((export_protocol == NFV9_PROTOCOL) &&
 			(fi->type.id == IPFIX_TYPEID_tcpControlBits) &&
 			(fi->type.length != 1)) {
 		// data is in network order, we want just the second byte as per RFC
-		ipfix_put_data_field(ipfixExporter, data + fi->offset + 1, 1);
+		putDataField(data + fi->offset + 1, 1);
 	}
 	else if (fi->type.id == IPFIX_TYPEID_basicList) {
 		vector<void*>** listPtrPtr = (vector<void*>**) (data + fi->offset);
 
 		// Always use three-byte length encoding as RECOMMENDED in RFC 6313
-		ipfix_put_data_field(ipfixExporter, &record->threeByteIndicator, 1);
-
-		// Need to allocate memory to store length etc. as they are not immediately sent over the wire
-		// Is deallocated in IpfixRecord destructor
-		if (record->variableLenData == NULL) {
-			msg(LOG_ERR, "Variable length data present but variableLenData not allocated.");
-		}
+		uint8_t threeByteIndicator = 255;
+		putDataField(&threeByteIndicator, 1);
 
 		// Semantic (1B) + Field ID (2B) + Element Length (2B) + (optional: Enterprise Number (3B)) + basicList Content (variable)
 		uint16_t varLen = 1 + 2 + 2;
 		varLen += (fi->basicListData.fieldIe->enterprise == 0) ? 0 : 3;
 		varLen += ((*listPtrPtr)->size()) * fi->basicListData.fieldIe->length;
 		varLen = htons(varLen);
-
-		sendDataFromVarLenDataBuff(record, &varLen, sizeof(varLen));
-
+		putDataField(&varLen, sizeof(varLen));
 
 		// Var length field
 		// Semantic
-		ipfix_put_data_field(ipfixExporter, (void *) &fi->basicListData.semantic, 1);
+		putDataField(&fi->basicListData.semantic, 1);
 
 		// Field ID
 		// TODO: Distinguish between enterprise=0
 		uint16_t fieldId = htons(fi->basicListData.fieldIe->id);
-		sendDataFromVarLenDataBuff(record, &fieldId, sizeof(fieldId));
+		putDataField(&fieldId, sizeof(fieldId));
 
 		// Field length
 		uint16_t fieldLen = htons(fi->basicListData.fieldIe->length);
-		sendDataFromVarLenDataBuff(record, &fieldLen, sizeof(fieldLen));
+		putDataField(&fieldLen, sizeof(fieldLen));
 
 		// Add basicList content
 		for (vector<void*>::const_iterator iter = (*listPtrPtr)->begin(); iter != (*listPtrPtr)->end(); iter++) {
 			IpfixRecord::Data* elem = reinterpret_cast<IpfixRecord::Data*>(*iter);
-			sendDataFromVarLenDataBuff(record, elem, ntohs(fieldLen));
+			putDataField(elem, ntohs(fieldLen));
 		}
 	}
 	else {
@@ -703,7 +729,7 @@ void IpfixSender::addDataRecordValue(TemplateInfo::FieldInfo* fi, IpfixRecord::D
 			memcpy(&p, data+fi->offset, fi->type.length);
 			statPacketsInFlows += ntohll(p);
 		}
-		ipfix_put_data_field(ipfixExporter, data + fi->offset, fi->type.length);
+		putDataField(data + fi->offset, fi->type.length);
 	}
 }
 
@@ -734,7 +760,7 @@ void IpfixSender::onReconfiguration2()
 		}
 	}
 	// clear maps
-	uniqueIdToTemplateId.clear();
+	uniqueIdToTemplate.clear();
 	templateIdToUniqueId.clear();
 
 	// release message lock
@@ -791,8 +817,21 @@ void IpfixSender::onSendRecordsTimeout(void) {
 
 void IpfixSender::onTimeout(void* dataPtr)
 {
+	if (dataPtr == &timeoutUdpBatch) {
+		// sends IPFIX messages whose maximum batching delay is over
+		ipfixMessageLock.lock();
+		udpBatchTimeoutRegistered = false;
+		ipfix_beat(ipfixExporter);
+		registerUdpBatchTimeout();
+		ipfixMessageLock.unlock();
+		return;
+	}
+
 	onSendRecordsTimeout();
+	// also sends IPFIX messages whose maximum batching delay is over
+	ipfixMessageLock.lock();
 	ipfix_beat(ipfixExporter);
+	ipfixMessageLock.unlock();
 	registerBeatTimeout();
 }
 
@@ -807,6 +846,28 @@ void IpfixSender::registerTimeout()
 	timeoutRegistered = true;
 }
 
+/**
+ * registers timeout for function onTimeout in Timer at which the oldest IPFIX
+ * message queued for UDP collectors must be sent, so that it is not delayed
+ * until the next beat. ipfixMessageLock must be held.
+ */
+void IpfixSender::registerUdpBatchTimeout()
+{
+	ipfix_udp_batch* batch = ipfixExporter->udp_batch;
+	// queued messages are flushed in performShutdown()
+	if (udpBatchTimeoutRegistered || !timer || exitFlag || !batch || batch->count == 0) return;
+
+	timespec to;
+	to.tv_sec = batch->first_queued.tv_sec + batch->max_delay/1000;
+	to.tv_nsec = (batch->first_queued.tv_usec + (batch->max_delay%1000)*1000) * 1000L;
+	if (to.tv_nsec >= 1000000000L) {
+		to.tv_sec++;
+		to.tv_nsec -= 1000000000L;
+	}
+	timer->addTimeout(this, to, &timeoutUdpBatch);
+	udpBatchTimeoutRegistered = true;
+}
+
 void IpfixSender::registerBeatTimeout()
 {
 	timespec to;
@@ -828,8 +889,12 @@ void IpfixSender::performShutdown()
 {
 	// send remaining records first
 	sendRecords(IfNotEmpty);
+	ipfixMessageLock.lock();
+	ipfix_flush(ipfixExporter);
+	ipfixMessageLock.unlock();
 	if (timer != NULL) {
 		timer->removeTimeout(&timeoutIpfixlolibBeat);
+		timer->removeTimeout(&timeoutUdpBatch);
 	}
 }
 
@@ -845,13 +910,27 @@ void IpfixSender::clearStatistics()
 	statSentDataRecords = 0;
 	statSentPackets = 0;
 	statPacketsInFlows = 0;
+	ipfixMessageLock.lock();
+	if (ipfixExporter->udp_batch) {
+		ipfixExporter->udp_batch->messages_sent = 0;
+		ipfixExporter->udp_batch->syscalls = 0;
+	}
+	ipfixMessageLock.unlock();
 }
 
 string IpfixSender::getStatisticsXML(double interval)
 {
-	char buf[200];
-	snprintf(buf, ARRAY_SIZE(buf), "<totalSentDataRecords>%u</totalSentDataRecords><totalSentUDPDataRecordPackets>%u</totalSentUDPDataRecordPackets><totalPacketsInFlows>%u</totalPacketsInFlows>",
+	char buf[400];
+	int len = snprintf(buf, ARRAY_SIZE(buf), "<totalSentDataRecords>%u</totalSentDataRecords><totalSentUDPDataRecordPackets>%u</totalSentUDPDataRecordPackets><totalPacketsInFlows>%u</totalPacketsInFlows>",
 			statSentDataRecords, statSentPackets, statPacketsInFlows);
+	ipfixMessageLock.lock();
+	if (ipfixExporter->udp_batch) {
+		uint64_t messages = ipfixExporter->udp_batch->messages_sent;
+		uint64_t syscalls = ipfixExporter->udp_batch->syscalls;
+		snprintf(buf+len, ARRAY_SIZE(buf)-len, "<batchedUDPMessages>%llu</batchedUDPMessages><batchedUDPSyscalls>%llu</batchedUDPSyscalls><messagesPerSyscall>%.2f</messagesPerSyscall>",
+				(long long unsigned)messages, (long long unsigned)syscalls, syscalls ? (double)messages/syscalls : 0.0);
+	}
+	ipfixMessageLock.unlock();
 	return buf;
 }
 
@@ -58,12 +58,14 @@ public:
 			ipfix_transport_protocol proto, void *aux_config,
 			const char *vrf_name);
 	void flushPacket();
+	void setUdpBatching(uint32_t maxMessages, uint32_t maxDelay);
 
 	virtual void notifyQueueRunning();
 
 	virtual void onTemplate(IpfixTemplateRecord* record);
 	virtual void onTemplateDestruction(IpfixTemplateDestructionRecord* record);
 	virtual void onDataRecord(IpfixDataRecord* record);
+	virtual void onDataRecords(IpfixDataRecord** records, size_t count);
 
 	virtual void onReconfiguration1();
 	virtual void onReconfiguration2();
@@ -83,6 +85,19 @@ private:
 		IfNotEmpty,
 		Always
 	};
+
+	/**
+	 * Template as used in outgoing messages
+	 */
+	struct ExportTemplate {
+		TemplateInfo::TemplateId templateId; /**< Template ID used in outgoing messages */
+		bool bulkCopy; /**< fields are stored in Data Records exactly as they are sent */
+		uint16_t bulkOffset; /**< offset of the first field in the Data Record if bulkCopy is set */
+		uint16_t bulkLength; /**< length of all fields if bulkCopy is set */
+		int packetDeltaCountIndex; /**< index of field packetDeltaCount or -1 */
+	};
+
+	void initBulkCopy(const TemplateInfo* templateInfo, ExportTemplate& exportTemplate);
 	void performShutdown(); 
 	static void* threadWrapper(void* instance);
 	void processLoop();
@@ -92,14 +107,13 @@ private:
 	void endDataSet();
 	void send();
 	void sendRecords(SendPolicy policy);
-	void removeRecordReferences();
 	void registerTimeout();
+	void registerUdpBatchTimeout();
 	void onSendRecordsTimeout(void);
 	void registerBeatTimeout();
+	void addDataRecord(IpfixDataRecord* record);
 	void addDataRecordValue(TemplateInfo::FieldInfo*, IpfixRecord::Data*);
-	void addDataRecordValue(TemplateInfo::FieldInfo*, IpfixRecord::Data*, IpfixDataRecord*);
-	void sendDataFromVarLenDataBuff(IpfixDataRecord*, void*, size_t);
-	void initVarLenData(IpfixDataRecord*, IpfixRecord::Data*);
+	void putDataField(const void* data, unsigned length);
 
 	TemplateInfo::TemplateId getUnusedTemplateId();
 
@@ -121,17 +135,14 @@ private:
 	Mutex ipfixMessageLock;
 
 	// send after timeout parameters
-	queue<IpfixRecord*> recordsToRelease;
-	uint16_t noCachedRecords; /**< number of records already passed to ipfixlob, should be equal to recordsToRelease.size() */
+	uint16_t noCachedRecords; /**< number of records already passed to ipfixlolib */
 	uint16_t noRecordsInCurrentSet; /**< Number of records in current data set. */
 	uint16_t recordCacheTimeout; /**< how long may records be cached until sent, milliseconds */
 	bool timeoutRegistered; /**< true if next timeout was already registered in timer */
+	bool udpBatchTimeoutRegistered; /**< true if timeout for queued UDP messages was already registered in timer */
 	uint16_t currentTemplateId; /**< Template ID of the unfinished data set */
 	uint16_t remainingSpace; /**< Remaining space in current IPFIX message measured in bytes. */
 
-	uint16_t ringbufferPos; /**< Pointer to next free slot in @c conversionRingbuffer. */
-	uint8_t conversionRingbuffer[65536]; /**< Ringbuffer used to store converted imasks between @c ipfix_put_data_field() and @c ipfix_send() */
-
 	// rate limiting paramemters 
 	struct timeval curTimeStep; /**< current time used for determining packet rate */
 	uint32_t recordsSentStep; /**< number of records sent in timestep (usually 100ms)*/
@@ -139,10 +150,11 @@ private:
 
 	int timeoutSendRecords; /**< Dummy variable. Used as a pointer destination to distinguish between two dirrent types of timeout */
 	int timeoutIpfixlolibBeat; /**< Dummy variable. Used as a pointer destination to distinguish between two dirrent types of timeout */
+	int timeoutUdpBatch; /**< Dummy variable. Used as a pointer destination to distinguish between two dirrent types of timeout */
 
 	// mapping of uniqueId to templateId and vice versa
 	std::map<TemplateInfo::TemplateId, uint16_t> templateIdToUniqueId; /**< stores uniqueId for a give Template ID */
-	std::map<uint16_t, TemplateInfo::TemplateId> uniqueIdToTemplateId; /**< stores Template ID for a give unique ID */
+	std::map<uint16_t, ExportTemplate> uniqueIdToTemplate; /**< stores Template for a give unique ID */
 	export_protocol_version export_protocol; // Version of Flow record, V9 or IPFIX
 
 };
@@ -37,9 +37,8 @@ bool TemplateBuffer::BufferedTemplate::isExpired() {
  * Returns a TemplateInfo or NULL
  */
 TemplateBuffer::BufferedTemplate* TemplateBuffer::getBufferedTemplate(boost::shared_ptr<IpfixRecord::SourceID> sourceId, TemplateInfo::TemplateId templateId) {
-	TemplateBuffer::BufferedTemplate* bt = head;
-
 #ifdef DEBUG
+	TemplateBuffer::BufferedTemplate* bt = head;
 	DPRINTF_INFO("ALL TEMPLATES ---------------------------");
 	while (bt != 0) {
 		DPRINTF_INFO("bt->sourceID odid %" PRIu32 " exporter port %u collector port %u exporter ip %u.%u.%u.%u len %u prot %u ptr: %p size: %zu expires in %ld sec", bt->sourceID.get()->observationDomainId, bt->sourceID.get()->exporterPort, bt->sourceID.get()->receiverPort, bt->sourceID.get()->exporterAddress.ip[0], bt->sourceID.get()->exporterAddress.ip[1], bt->sourceID.get()->exporterAddress.ip[2], bt->sourceID.get()->exporterAddress.ip[3], bt->sourceID.get()->exporterAddress.len, bt->sourceID.get()->protocol, (void*)bt->sourceID.get(), sizeof(IpfixRecord::SourceID), bt->expires - time(NULL));
@@ -48,21 +47,16 @@ TemplateBuffer::BufferedTemplate* TemplateBuffer::getBufferedTemplate(boost::sha
 	}
 	DPRINTF_INFO("END ALL TEMPLATES --------------------------");
 	
-	bt = head;
 	DPRINTF_INFO("Searching for : sourceID %" PRIu32 " %u %u %u.%u.%u.%u  %u %u", sourceId.get()->observationDomainId, sourceId.get()->exporterPort, sourceId.get()->receiverPort, sourceId.get()->exporterAddress.ip[0], sourceId.get()->exporterAddress.ip[1], sourceId.get()->exporterAddress.ip[2], sourceId.get()->exporterAddress.ip[3], sourceId.get()->exporterAddress.len, sourceId.get()->protocol);
 #endif
 	
-	while (bt != 0) {
-		if ((*(bt->sourceID.get()) == *(sourceId.get())) && (bt->templateInfo->templateId == templateId)){
-			if (bt->isExpired()) {
-				DPRINTF_INFO("Template found but expired.");
-				cleanUpExpiredTemplates();
-				return 0;
-			}
-			DPRINTF_INFO("Template found.");
-			return bt;
-		}
-		bt = bt->next;
+	TemplateKey key;
+	key.sourceID = sourceId.get();
+	key.templateId = templateId;
+	TemplateIndex::const_iterator it = index.find(key);
+	if (it != index.end()) {
+		DPRINTF_INFO("Template found.");
+		return it->second;
 	}
 	DPRINTF_INFO("getBufferedTemplate not found!!!");
 	return 0;
@@ -70,38 +64,68 @@ TemplateBuffer::BufferedTemplate* TemplateBuffer::getBufferedTemplate(boost::sha
 
 /**
  * Saves a TemplateInfo, IpfixRecord::OptionsTemplateInfo, IpfixRecord::DataTemplateInfo overwriting existing Templates
+ * bt->expires must already be set, it must not be changed while the template is buffered
  */
 void TemplateBuffer::bufferTemplate(TemplateBuffer::BufferedTemplate* bt) {
-	cleanUpExpiredTemplates();
 	destroyBufferedTemplate(bt->sourceID, bt->templateInfo->templateId);
+	bt->prev = 0;
 	bt->next = head;
-	bt->expires = 0;
+	if (head) head->prev = bt;
 	head = bt;
+
+	TemplateKey key;
+	key.sourceID = bt->sourceID.get();
+	key.templateId = bt->templateInfo->templateId;
+	index[key] = bt;
+	if (bt->expires) expiryQueue.insert(std::make_pair(bt->expires, bt));
 }
 
 /**
- * Saves a TemplateInfo, IpfixRecord::OptionsTemplateInfo, IpfixRecord::DataTemplateInfo overwriting existing Templates
+ * Destroys all templates which expired before the given time.
+ * Only looks at the templates due, so it is cheap to call this for every received message.
  */
-void TemplateBuffer::cleanUpExpiredTemplates() {
-	TemplateBuffer::BufferedTemplate* predecessor = 0;
-	TemplateBuffer::BufferedTemplate* bt = head;
-	while (bt != 0) {
-		if (bt->isExpired()) {
-			DPRINTF_INFO("Cleaning up expired template with id %d",bt->templateInfo->templateId);
-			bt->onPreDestroy(ipfixParser);
-			if (predecessor)
-				predecessor->next = bt->next;
-			else
-				head = bt->next;
-			TemplateBuffer::BufferedTemplate* toBeFreed = bt;
-			bt = bt->next;
-			delete toBeFreed;
-			/* leave predecessor unchanged. */
-		} else {
-			predecessor = bt;
-			bt = bt->next;
+void TemplateBuffer::expireTemplates(time_t now) {
+	while (!expiryQueue.empty() && expiryQueue.begin()->first < now) {
+		TemplateBuffer::BufferedTemplate* bt = expiryQueue.begin()->second;
+		DPRINTF_INFO("Cleaning up expired template with id %d",bt->templateInfo->templateId);
+		bt->onPreDestroy(ipfixParser);
+		removeBufferedTemplate(bt);
+	}
+}
+
+/**
+ * Unlinks template from all structures and frees it, does not send a TemplateDestructionRecord
+ */
+void TemplateBuffer::removeBufferedTemplate(TemplateBuffer::BufferedTemplate* bt) {
+	if (bt->prev)
+		bt->prev->next = bt->next;
+	else
+		head = bt->next;
+	if (bt->next) bt->next->prev = bt->prev;
+
+	TemplateKey key;
+	key.sourceID = bt->sourceID.get();
+	key.templateId = bt->templateInfo->templateId;
+	index.erase(key);
+	if (bt->expires) expiryQueue.erase(std::make_pair(bt->expires, bt));
+	delete bt;
+}
+
+size_t TemplateBuffer::TemplateKeyHash::operator()(const TemplateKey& k) const {
+	const IpfixRecord::SourceID* s = k.sourceID;
+	uint64_t h = ((uint64_t)s->observationDomainId << 16) ^ k.templateId;
+	h = h * 0x9E3779B97F4A7C15ULL ^ (uint32_t)s->fileDescriptor;
+	if (s->protocol != 132) {
+		// see IpfixRecord::SourceID::operator==, SCTP sources are identified by their file descriptor
+		h = h * 0x9E3779B97F4A7C15ULL ^ s->exporterPort;
+		for (uint8_t i = 0; i < s->exporterAddress.len; i++) {
+			h = h * 0x100000001B3ULL ^ s->exporterAddress.ip[i];
 		}
 	}
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	return (size_t)h;
 }
 
 /**
@@ -109,29 +133,32 @@ void TemplateBuffer::cleanUpExpiredTemplates() {
  */
 void TemplateBuffer::destroyBufferedTemplate(boost::shared_ptr<IpfixRecord::SourceID> sourceId, TemplateInfo::TemplateId templateId, bool all) 
 {
-	TemplateBuffer::BufferedTemplate* predecessor = 0;
-	TemplateBuffer::BufferedTemplate* bt = head;
 	bool found = false;
-	while (bt != 0) {
-		/* templateId == setID means that all templates of this set type shall be removed for given sourceID */
-		/* all == true means that all templates of given sourceID shall be removed */
-		if (((*(bt->sourceID.get()) == *(sourceId.get())) && ((bt->templateInfo->templateId == templateId) || (bt->templateInfo->setId == templateId)))
-				|| (all && sourceId->equalIgnoringODID(*(bt->sourceID.get())))) {
+	if (!all && templateId >= 256) {
+		/* ids of data templates are unique per sourceID, so the index can be used */
+		TemplateBuffer::BufferedTemplate* bt = getBufferedTemplate(sourceId, templateId);
+		if (bt) {
 			found = true;
 			DPRINTF_INFO("Destroying template with id %u", bt->templateInfo->templateId);
-			if (predecessor != 0) {
-				predecessor->next = bt->next;
-			} else {
-				head = bt->next;
-			}
 			/* Invoke all registered callback functions */
 			bt->onPreDestroy(ipfixParser);
-			TemplateBuffer::BufferedTemplate* toBeFreed = bt;
-			bt = bt->next;
-			delete toBeFreed;
-		} else {
-			predecessor = bt;
-			bt = bt->next;
+			removeBufferedTemplate(bt);
+		}
+	} else {
+		TemplateBuffer::BufferedTemplate* bt = head;
+		while (bt != 0) {
+			/* templateId == setID means that all templates of this set type shall be removed for given sourceID */
+			/* all == true means that all templates of given sourceID shall be removed */
+			TemplateBuffer::BufferedTemplate* next = bt->next;
+			if (((*(bt->sourceID.get()) == *(sourceId.get())) && ((bt->templateInfo->templateId == templateId) || (bt->templateInfo->setId == templateId)))
+					|| (all && sourceId->equalIgnoringODID(*(bt->sourceID.get())))) {
+				found = true;
+				DPRINTF_INFO("Destroying template with id %u", bt->templateInfo->templateId);
+				/* Invoke all registered callback functions */
+				bt->onPreDestroy(ipfixParser);
+				removeBufferedTemplate(bt);
+			}
+			bt = next;
 		}
 	}
 	if (!found && !all) {
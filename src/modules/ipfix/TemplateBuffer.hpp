@@ -24,6 +24,8 @@
 #include "IpfixParser.hpp"
 #include <time.h>
 #include <boost/smart_ptr.hpp>
+#include <set>
+#include <unordered_map>
 
 #define DEFAULT_TEMPLATE_EXPIRE_SECS  70
 
@@ -32,6 +34,11 @@
  * 
  * this class also sends TemplateDestructionRecords, if a template is 
  * removed from the buffer
+ *
+ * Templates are chained in a doubly linked list (for iteration), indexed by
+ * (SourceID, templateId) in a hash table (for lookups per data set) and,
+ * if they expire, ordered by expiry time in a separate queue. Expired
+ * templates are removed by expireTemplates(), never on the lookup path.
  */
 class TemplateBuffer {
 	public:
@@ -48,6 +55,7 @@ class TemplateBuffer {
 			TemplateBuffer::BufferedTemplate*	next; /**< Pointer to next buffered Template */
 			bool isExpired();
 			private:
+			TemplateBuffer::BufferedTemplate*	prev; /**< Pointer to previous buffered Template */
 			void onPreDestroy(IpfixParser* ipfixParser);
 		};
 
@@ -59,13 +67,40 @@ class TemplateBuffer {
 			// templateId=2,3,4 means that all Templates, Option Templates, or Data Templates of given sourceID are destroyed
 			// all=true overrides templateId parameter, so all Templates of given sourceID will be deleted		
 		void bufferTemplate(TemplateBuffer::BufferedTemplate* bt);
+		void expireTemplates(time_t now);
 		TemplateBuffer::BufferedTemplate* getFirstBufferedTemplate();
 
 	protected:
 		TemplateBuffer::BufferedTemplate* head; /**< Start of BufferedTemplate chain */
 		IpfixParser* ipfixParser; /**< Pointer to the ipfixParser which instantiated this TemplateBuffer */
 	private:
-		void cleanUpExpiredTemplates();
+		/**
+		 * key of the template index, sourceID points to the SourceID of the indexed template
+		 * (or to the one being searched for)
+		 */
+		struct TemplateKey {
+			const IpfixRecord::SourceID* sourceID;
+			TemplateInfo::TemplateId templateId;
+
+			bool operator==(const TemplateKey& x) const {
+				return (templateId == x.templateId) && (*sourceID == *x.sourceID);
+			}
+		};
+
+		/**
+		 * hashes exactly those fields which are compared by IpfixRecord::SourceID::operator==
+		 */
+		struct TemplateKeyHash {
+			size_t operator()(const TemplateKey& k) const;
+		};
+
+		typedef std::unordered_map<TemplateKey, BufferedTemplate*, TemplateKeyHash> TemplateIndex;
+		typedef std::set<std::pair<time_t, BufferedTemplate*> > ExpiryQueue;
+
+		TemplateIndex index; /**< all buffered templates by (SourceID, templateId) */
+		ExpiryQueue expiryQueue; /**< buffered templates with expires != 0, ordered by expiry time */
+
+		void removeBufferedTemplate(TemplateBuffer::BufferedTemplate* bt);
 };
 
 #endif
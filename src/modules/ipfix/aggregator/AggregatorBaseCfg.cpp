@@ -26,7 +26,7 @@
 #include "BaseHashtable.h"
 
 AggregatorBaseCfg::AggregatorBaseCfg(XMLElement* elem)
-	: CfgBase(elem), pollInterval(0)
+	: CfgBase(elem), pollInterval(0), hashFunction(FlowHash::DEFAULT_ENGINE), symmetricHash(true), shards(1)
 {
 	if (!elem)
 		return;
@@ -57,6 +57,15 @@ AggregatorBaseCfg::AggregatorBaseCfg(XMLElement* elem)
 			pollInterval = getTimeInUnit("pollInterval", mSEC, AGG_DEFAULT_POLLING_TIME);
 		} else if (e->matches("hashtableBits")) {
 			htableBits = getInt("hashtableBits", HT_DEFAULT_BITSIZE);
+		} else if (e->matches("hashFunction")) {
+			hashFunction = FlowHash::parseEngine(get("hashFunction"));
+		} else if (e->matches("symmetricHash")) {
+			symmetricHash = getBool("symmetricHash", symmetricHash);
+		} else if (e->matches("shards")) {
+			int n = getInt("shards", 1);
+			if (n < 1)
+				THROWEXCEPTION("Aggregator: number of shards must be at least 1");
+			shards = n;
 		} else if (e->matches("next")) { // ignore next
 		} else {
 			msg(LOG_CRIT, "Unkown Aggregator config entry %s\n", e->getName().c_str());
@@ -265,6 +274,9 @@ bool AggregatorBaseCfg::equalTo(AggregatorBaseCfg *other) {
 	if (inactiveTimeout != other->inactiveTimeout) return false;
 	if (pollInterval != other->pollInterval) return false;
 	if (htableBits != other->htableBits) return false;
+	if (hashFunction != other->hashFunction) return false;
+	if (symmetricHash != other->symmetricHash) return false;
+	if (shards != other->shards) return false;
 	if (*rules != *other->rules) return false;
 
 	return true;
@@ -23,6 +23,7 @@
 
 #include "core/Cfg.h"
 #include "modules/ipfix/aggregator/Rule.hpp"
+#include "common/FlowHash.h"
 
 // forward declarations
 class Rule;
@@ -46,6 +47,9 @@ protected:
 	unsigned inactiveTimeout;
 	unsigned pollInterval;
 	uint8_t htableBits;
+	FlowHash::Engine hashFunction; /**< hash function for flow keys (only used by packet aggregator) */
+	bool symmetricHash; /**< use same hash for both directions of a biflow (only used by packet aggregator) */
+	uint32_t shards; /**< number of aggregation threads with private hashtables (only used by packet aggregator) */
 
 	Rules* rules;
 };
@@ -171,24 +171,32 @@ void BaseAggregator::exporterThread()
 		}
 
 		gettimeofday(&curtime, 0);
-		for (size_t i = 0; i < rules->count; i++) {
-			rules->rule[i]->hashtable->expireFlows();
-		}
+		expireFlows();
 		struct timeval endtime;
 		gettimeofday(&endtime, 0);
 		timeval_subtract(&difftime, &endtime, &curtime);
 	}
 
 	if (getShutdownProperly()) {
-		for (size_t i = 0; i < rules->count; i++) {
-			rules->rule[i]->hashtable->expireFlows(true);
-		}
+		expireFlows(true);
 	}
 
 	unregisterCurrentThread();
 }
 
 
+/**
+ * exports expired flows of all hashtables, called by exporterThread
+ * @param all if true, all flows are exported
+ */
+void BaseAggregator::expireFlows(bool all)
+{
+	for (size_t i = 0; i < rules->count; i++) {
+		rules->rule[i]->hashtable->expireFlows(all);
+	}
+}
+
+
 /**
  * small static wrapper function to start thread
  */
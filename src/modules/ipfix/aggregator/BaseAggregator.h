@@ -56,6 +56,7 @@ protected:
 	virtual BaseHashtable* createHashtable(Rule* rule, uint16_t inactiveTimeout, uint16_t activeTimeout, uint8_t hashbits) = 0;
 	void poll();
 	void exporterThread();
+	virtual void expireFlows(bool all = false);
 	
 	// events from Module
 	virtual void performStart();
@@ -22,6 +22,7 @@
 #include "BaseHashtable.h"
 #include "common/Time.h"
 
+#include <sched.h>
 #include <sstream>
 #include <stdint.h>
 #include <iostream>
@@ -32,8 +33,9 @@ using namespace std;
  * Creates and initializes a new hashtable buffer for flows matching @c rule
  */
 BaseHashtable::BaseHashtable(Source<IpfixRecord*>* recordsource, Rule* rule,
-		uint16_t inactiveTimeout, uint16_t activeTimeout, uint8_t hashbits)
-	: biflowAggregation(rule->biflowAggregation),
+		uint16_t inactiveTimeout, uint16_t activeTimeout, uint8_t hashbits, bool chainedBuckets)
+	: buckets(NULL),
+	  biflowAggregation(rule->biflowAggregation),
 	  revKeyMapper(NULL),
 	  switchArray(NULL),
 	  htableBits(hashbits),
@@ -50,6 +52,7 @@ BaseHashtable::BaseHashtable(Source<IpfixRecord*>* recordsource, Rule* rule,
 	  fieldModifier(0),
 	  recordSource(recordsource),
 	  sourceID(new IpfixRecord::SourceID),
+	  expiryWheel(unixtime().tv_sec),
 	  dataDataRecordIM("IpfixDataDataRecord", 0),
 	  dataTemplateRecordIM("IpfixDataTemplateRecord", 0),
 	  templateDestructionRecordIM("IpfixTemplateDestructionRecord", 0),
@@ -61,11 +64,14 @@ BaseHashtable::BaseHashtable(Source<IpfixRecord*>* recordsource, Rule* rule,
 	msg(LOG_NOTICE, "  - activeTimeout=%d", activeTimeout);
 	msg(LOG_NOTICE, "  - htableBits=%d", hashbits);
 
-	buckets = new HashtableBucket*[htableSize];
-	for (uint32_t i = 0; i < htableSize; i++)
-		buckets[i] = NULL;
+	if (chainedBuckets) {
+		buckets = new HashtableBucket*[htableSize];
+		for (uint32_t i = 0; i < htableSize; i++)
+			buckets[i] = NULL;
+	}
 
 	createDataTemplate(rule);
+	exportTemplate = dataTemplate;
 
 	if (biflowAggregation) {
 		genBiflowStructs();
@@ -188,7 +194,7 @@ void BaseHashtable::createDataTemplate(Rule* rule)
  */
 BaseHashtable::~BaseHashtable()
 {
-	for (uint32_t i = 0; i < htableSize; i++)
+	for (uint32_t i = 0; buckets && i < htableSize; i++)
 		if (buckets[i] != NULL) {
 			HashtableBucket* bucket = buckets[i];
 			while (bucket != 0) {
@@ -231,7 +237,7 @@ void BaseHashtable::exportBucket(HashtableBucket* bucket)
 	/* Pass Data Record to exporter interface */
 	IpfixDataRecord* ipfixRecord = dataDataRecordIM.getNewInstance();
 	ipfixRecord->sourceID = sourceID;
-	ipfixRecord->templateInfo = dataTemplate;
+	ipfixRecord->templateInfo = exportTemplate;
 	ipfixRecord->dataLength = fieldLength;
 	ipfixRecord->message = bucket->data;
 	ipfixRecord->data = bucket->data.get();
@@ -277,51 +283,96 @@ void BaseHashtable::removeBucket(HashtableBucket* bucket)
 }
 
 /**
- * Exports all expired flows and removes them from the buffer
+ * (re)schedules export of the given bucket in the expiry wheel
+ * must be called whenever expiry times or forceExpiry of the bucket have changed
  */
-void BaseHashtable::expireFlows(bool all)
+void BaseHashtable::scheduleExpiry(HashtableBucket* bucket)
 {
-	// the following lock should almost never fail (only during reconfiguration)
+	time_t deadline;
+	if (bucket->forceExpiry) {
+		deadline = 0;
+	} else {
+		deadline = bucket->inactiveExpireTime<bucket->activeExpireTime ? bucket->inactiveExpireTime : bucket->activeExpireTime;
+	}
+	expiryWheel.schedule(bucket->listNode, deadline);
+}
+
+/**
+ * acquires aggInProgress
+ * the lock is held for short periods only, so we yield the processor a few times before
+ * falling back to sleep (long waits only happen during reconfiguration)
+ */
+void BaseHashtable::lockAggregation()
+{
+	uint32_t tries = 0;
 	while (atomic_lock(&aggInProgress)) {
-		timespec req;
-		req.tv_sec = 0;
-		req.tv_nsec = 50000000;
-		nanosleep(&req, &req);
+		if (++tries < 100) {
+			sched_yield();
+		} else {
+			timespec req;
+			req.tv_sec = 0;
+			req.tv_nsec = 50000000;
+			nanosleep(&req, &req);
+		}
 	}
+}
+
+/**
+ * Exports all expired flows and removes them from the buffer
+ * Buckets are exported in slices of EXPIRY_SLICE_SIZE, aggInProgress is released between
+ * the slices so that aggregation does not stall behind a large number of expiring flows.
+ * @param all if set to true, all flows are exported regardless of their expiry times
+ */
+void BaseHashtable::expireFlows(bool all)
+{
+	lockAggregation();
 
-	HashtableBucket* bucket = 0;
-	BucketListElement* node = 0;
 	timeval unix_now = unixtime();
+	if (all) {
+		expiryWheel.expireAll();
+	} else {
+		expiryWheel.advance(unix_now.tv_sec);
+	}
 
-	if (!exportList.isEmpty) {
-		while (exportList.head) { //check the first entry in the BucketList
-			node = exportList.head;
-			bucket = node->bucket;
-			// TODO: change this one list to two lists: one for active, one for passive timeout
-			// problem here: flows with active timeout may be exported passive timeout seconds too late
-			// now must be updated by the child classes
-			if ((bucket->inactiveExpireTime <= unix_now.tv_sec) || (bucket->activeExpireTime <= unix_now.tv_sec) || all) {
-				if (unix_now.tv_sec >= bucket->activeExpireTime) {
-					DPRINTF_INFO("expireFlows: forced expiry");
-				} else if (unix_now.tv_sec >= bucket->inactiveExpireTime) {
-					DPRINTF_INFO("expireFlows: normal expiry");
-				}
-				if (bucket->inTable) removeBucket(bucket);
-				statExportedBuckets++;
-				exportBucket(bucket);
-				exportList.remove(node);
-				destroyBucket(bucket);
-				node->removeReference();
-				statTotalEntries--;
-			}//end if
-			else
-				break;
-		}//end while
+	uint32_t exported = 0;
+	BucketListElement* node;
+	while ((node = expiryWheel.popDue()) != NULL) {
+		HashtableBucket* bucket = node->bucket;
+		if (unix_now.tv_sec >= bucket->activeExpireTime) {
+			DPRINTF_INFO("expireFlows: forced expiry");
+		} else if (unix_now.tv_sec >= bucket->inactiveExpireTime) {
+			DPRINTF_INFO("expireFlows: normal expiry");
+		}
+		if (bucket->inTable) removeBucket(bucket);
+		statExportedBuckets++;
+		exportBucket(bucket);
+		destroyBucket(bucket);
+		node->removeReference();
+		statTotalEntries--;
+
+		if (++exported % EXPIRY_SLICE_SIZE == 0) {
+			// let aggregation continue, buckets which are updated meanwhile are rescheduled
+			atomic_release(&aggInProgress);
+			lockAggregation();
+		}
 	}
 
 	atomic_release(&aggInProgress);
 }
 
+/**
+ * lets this hashtable export its records with template and source id of primary
+ * used by sharded aggregators whose hashtables for one rule must appear as a single one
+ * (all hashtables must have been created for the same rule)
+ */
+void BaseHashtable::shareTemplate(const BaseHashtable* primary)
+{
+	if (primary->fieldLength != fieldLength || primary->dataTemplate->fieldCount != dataTemplate->fieldCount)
+		THROWEXCEPTION("BaseHashtable: cannot share template of hashtable with different record layout");
+	exportTemplate = primary->exportTemplate;
+	sourceID = primary->sourceID;
+}
+
 /**
  * Checks whether the given @c type is one of the types that has to be aggregated
  * @return 1 if flow is to be aggregated
@@ -410,7 +461,7 @@ void BaseHashtable::sendDataTemplate()
 {
 	IpfixTemplateRecord* ipfixRecord = dataTemplateRecordIM.getNewInstance();
 	ipfixRecord->sourceID = sourceID;
-	ipfixRecord->templateInfo = dataTemplate;
+	ipfixRecord->templateInfo = exportTemplate;
 	recordSource->send(ipfixRecord);
 }
 
@@ -421,7 +472,7 @@ void BaseHashtable::sendTemplateDestructionRecord()
 {
 	IpfixTemplateDestructionRecord* ipfixRecord = templateDestructionRecordIM.getNewInstance();
 	ipfixRecord->sourceID = sourceID;
-	ipfixRecord->templateInfo = dataTemplate;
+	ipfixRecord->templateInfo = exportTemplate;
 	recordSource->send(ipfixRecord);
 }
 
@@ -479,12 +530,23 @@ std::string BaseHashtable::getStatisticsXML(double interval)
 {
 	ostringstream oss;
 	oss << "<entries>" << statTotalEntries << "</entries>";
-	oss << "<emptyBuckets>" << statEmptyBuckets << "</emptyBuckets>";
-	oss << "<multientryBuckets>" << statMultiEntries << "</multientryBuckets>";
+	oss << getTableStatisticsXML();
 	uint32_t diff = statExportedBuckets - statLastExpBuckets;
 	statLastExpBuckets += diff;
 	oss << "<exportedEntries>" << (uint32_t) ((double) diff / interval) << "</exportedEntries>";
 	oss << "<totalExportedEntries>" << statExportedBuckets << "</totalExportedEntries>";
+	oss << "<expiryCascadedEntries>" << expiryWheel.statCascaded << "</expiryCascadedEntries>";
+	return oss.str();
+}
+
+/**
+ * returns statistics about the structure of the hashtable
+ */
+std::string BaseHashtable::getTableStatisticsXML()
+{
+	ostringstream oss;
+	oss << "<emptyBuckets>" << statEmptyBuckets << "</emptyBuckets>";
+	oss << "<multientryBuckets>" << statMultiEntries << "</multientryBuckets>";
 	return oss.str();
 }
 
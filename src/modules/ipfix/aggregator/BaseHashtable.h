@@ -45,6 +45,7 @@
 
 #include "modules/ipfix/IpfixRecord.hpp"
 #include "HashtableBuckets.h"
+#include "ExpiryWheel.h"
 #include "Rule.hpp"
 #include "core/Module.h"
 #include "common/Sensor.h"
@@ -59,7 +60,7 @@ class BaseHashtable : public Sensor
 public:
 
 	BaseHashtable(Source<IpfixRecord*>* recordsource, Rule* rule, uint16_t inactiveTimeout,
-			uint16_t activeTimeout, uint8_t hashbits);
+			uint16_t activeTimeout, uint8_t hashbits, bool chainedBuckets = true);
 
 	virtual ~BaseHashtable();
 
@@ -94,6 +95,8 @@ public:
 
 	static int isToBeAggregated(InformationElement::IeInfo& type);
 
+	void shareTemplate(const BaseHashtable* primary);
+
 protected:
 	/**
 	 * contains needed data elements when FPA or DPA is performed for PacketHashtable
@@ -115,7 +118,8 @@ protected:
 	};
 
 	boost::shared_ptr<TemplateInfo> dataTemplate; /**< structure describing both variable and fixed fields and containing fixed data */
-	HashtableBucket** buckets; /**< array of pointers to hash buckets at start of spill chain. Members are NULL where no entry present */
+	boost::shared_ptr<TemplateInfo> exportTemplate; /**< template used for exported records, equals dataTemplate unless shared with another hashtable */
+	HashtableBucket** buckets; /**< array of pointers to hash buckets at start of spill chain. Members are NULL where no entry present, array is NULL if subclass uses its own table */
 
 	bool biflowAggregation; /**< set to true if biflow aggregation is to be done*/
 	uint32_t* revKeyMapper; /**< contains indizes to dataTemplate for a reverse flow*/
@@ -146,13 +150,15 @@ protected:
 	Source<IpfixRecord*>* recordSource; /**< pointer to vermont module which is able to send IpfixRecords */
 	boost::shared_ptr<IpfixRecord::SourceID> sourceID; /**< used for hack: we *must* supply an observationDomainID, so take a static one */
 
-	HashtableBucketList exportList;
+	ExpiryWheel expiryWheel; /**< schedules all buckets for export, contains each bucket until it is exported */
 
 	InstanceManager<IpfixDataRecord> dataDataRecordIM;
 	InstanceManager<IpfixTemplateRecord> dataTemplateRecordIM;
 	InstanceManager<IpfixTemplateDestructionRecord> templateDestructionRecordIM;
 	InstanceManager<BucketListElement> hbucketIM;
 
+	static const uint32_t EXPIRY_SLICE_SIZE = 256; /**< maximum number of buckets exported by expireFlows() without releasing aggInProgress */
+
 	alock_t aggInProgress; /** indicates if currently an element is aggregated in the hashtable, used for atomic lock for preReconfiguration */
 
 	HashtableBucket* createBucket(boost::shared_array<IpfixRecord::Data> data, uint32_t obsdomainid,
@@ -166,7 +172,10 @@ protected:
 	void mapReverseElement(const InformationElement::IeInfo& ieinfo);
 	void genBiflowStructs();
 	void reverseFlowBucket(HashtableBucket* bucket);
-	void removeBucket(HashtableBucket* bucket);
+	virtual void removeBucket(HashtableBucket* bucket);
+	void scheduleExpiry(HashtableBucket* bucket);
+	void lockAggregation();
+	virtual std::string getTableStatisticsXML();
 
 };
 
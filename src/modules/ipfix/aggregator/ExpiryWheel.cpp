@@ -0,0 +1,213 @@
+/*
+ * Vermont Aggregator Subsystem
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "ExpiryWheel.h"
+
+#include "common/msg.h"
+
+
+/**
+ * @param now time from which on the wheel starts to process its slots
+ */
+ExpiryWheel::ExpiryWheel(time_t now)
+	: statCascaded(0),
+	  currentTime(now),
+	  entries(0),
+	  dueEntries(0)
+{
+}
+
+/**
+ * inserts node into the wheel, or moves it if it is already scheduled
+ * @param deadline time when the node becomes due, nodes with deadlines in the past are due immediately
+ */
+void ExpiryWheel::schedule(BucketListElement* node, time_t deadline)
+{
+	if (node->list) {
+		if (node->expireTime == deadline) return;
+		cancel(node);
+	}
+	node->expireTime = deadline;
+	place(node);
+	entries++;
+}
+
+/**
+ * removes node from the wheel
+ */
+void ExpiryWheel::cancel(BucketListElement* node)
+{
+	if (!node->list) return;
+	if (node->list == &due) dueEntries--;
+	node->list->remove(node);
+	node->list = NULL;
+	entries--;
+}
+
+/**
+ * inserts node into the slot belonging to its expireTime
+ */
+void ExpiryWheel::place(BucketListElement* node)
+{
+	if (node->expireTime <= currentTime) {
+		due.push(node);
+		node->list = &due;
+		dueEntries++;
+		return;
+	}
+
+	uint64_t delta = node->expireTime-currentTime;
+	uint64_t slotTime = node->expireTime;
+	if (delta >= MAX_RANGE) {
+		// will be placed again when the slot is cascaded
+		delta = MAX_RANGE-1;
+		slotTime = currentTime+delta;
+	}
+
+	HashtableBucketList* list;
+	if (delta < LEVEL0_SIZE) {
+		list = &level0[slotTime & (LEVEL0_SIZE-1)];
+	} else {
+		uint32_t level = 0;
+		uint32_t shift = LEVEL0_BITS;
+		while (delta >= ((uint64_t)1<<(shift+LEVEL_BITS))) {
+			level++;
+			shift += LEVEL_BITS;
+		}
+		list = &levels[level][(slotTime>>shift) & (LEVEL_SIZE-1)];
+	}
+	list->push(node);
+	node->list = list;
+}
+
+/**
+ * redistributes the elements of the current slot of given level (1..LEVELS) to the levels below
+ * cascades higher levels first if the current slot of this level is the first one
+ */
+void ExpiryWheel::cascade(uint32_t level)
+{
+	uint32_t shift = LEVEL0_BITS+(level-1)*LEVEL_BITS;
+	uint32_t idx = (currentTime>>shift) & (LEVEL_SIZE-1);
+	if (idx == 0 && level < LEVELS) cascade(level+1);
+
+	HashtableBucketList& list = levels[level-1][idx];
+	while (!list.isEmpty) {
+		BucketListElement* node = list.head;
+		list.remove(node);
+		place(node);
+		statCascaded++;
+	}
+}
+
+void ExpiryWheel::moveToDue(HashtableBucketList& list)
+{
+	while (!list.isEmpty) {
+		BucketListElement* node = list.head;
+		list.remove(node);
+		due.push(node);
+		node->list = &due;
+		dueEntries++;
+	}
+}
+
+/**
+ * processes all slots up to the given time, elements which became due may be fetched using popDue()
+ */
+void ExpiryWheel::advance(time_t now)
+{
+	if (now <= currentTime) return;
+
+	if ((uint64_t)(now-currentTime) >= MAX_RANGE) {
+		// clock jumped: collect all elements and schedule them again
+		HashtableBucketList pending;
+		for (uint32_t i = 0; i < LEVEL0_SIZE; i++) {
+			while (!level0[i].isEmpty) {
+				BucketListElement* node = level0[i].head;
+				level0[i].remove(node);
+				pending.push(node);
+			}
+		}
+		for (uint32_t l = 0; l < LEVELS; l++) {
+			for (uint32_t i = 0; i < LEVEL_SIZE; i++) {
+				while (!levels[l][i].isEmpty) {
+					BucketListElement* node = levels[l][i].head;
+					levels[l][i].remove(node);
+					pending.push(node);
+				}
+			}
+		}
+		currentTime = now;
+		while (!pending.isEmpty) {
+			BucketListElement* node = pending.head;
+			pending.remove(node);
+			place(node);
+		}
+		return;
+	}
+
+	while (currentTime < now) {
+		currentTime++;
+		uint32_t idx = currentTime & (LEVEL0_SIZE-1);
+		if (idx == 0) cascade(1);
+		moveToDue(level0[idx]);
+	}
+}
+
+/**
+ * makes all scheduled elements due, regardless of their deadline
+ */
+void ExpiryWheel::expireAll()
+{
+	for (uint32_t i = 0; i < LEVEL0_SIZE; i++) {
+		moveToDue(level0[i]);
+	}
+	for (uint32_t l = 0; l < LEVELS; l++) {
+		for (uint32_t i = 0; i < LEVEL_SIZE; i++) {
+			moveToDue(levels[l][i]);
+		}
+	}
+}
+
+/**
+ * removes the first due element from the wheel
+ * @returns NULL if no element is due
+ */
+BucketListElement* ExpiryWheel::popDue()
+{
+	if (due.isEmpty) return NULL;
+	BucketListElement* node = due.head;
+	cancel(node);
+	return node;
+}
+
+uint32_t ExpiryWheel::getEntries() const
+{
+	return entries;
+}
+
+uint32_t ExpiryWheel::getDueEntries() const
+{
+	return dueEntries;
+}
+
+time_t ExpiryWheel::getCurrentTime() const
+{
+	return currentTime;
+}
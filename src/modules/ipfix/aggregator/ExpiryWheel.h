@@ -0,0 +1,84 @@
+/*
+ * Vermont Aggregator Subsystem
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef EXPIRYWHEEL_H_
+#define EXPIRYWHEEL_H_
+
+#include "modules/ipfix/IpfixRecord.hpp"
+#include "HashtableBuckets.h"
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Hierarchical timing wheel which schedules hashtable buckets for export.
+ *
+ * Elements are kept in slots of one second granularity. The first level covers
+ * the next 2^8 seconds, each of the three following levels covers 2^6 times the
+ * range of the level below. Deadlines beyond the range of the last level are placed
+ * in its farthest slot and rescheduled when that slot is cascaded.
+ * Scheduling and cancelling an element is O(1), advancing the wheel costs one step per
+ * elapsed second plus the number of elements which are moved to a lower level or
+ * become due. Due elements are appended to a list from which they can be taken in
+ * arbitrary small portions using popDue().
+ *
+ * The wheel uses the fields next, prev, list and expireTime of BucketListElement.
+ *
+ * ATTENTION: this class is not thread-safe
+ */
+class ExpiryWheel
+{
+public:
+	ExpiryWheel(time_t now);
+
+	void schedule(BucketListElement* node, time_t deadline);
+	void cancel(BucketListElement* node);
+	void advance(time_t now);
+	void expireAll();
+	BucketListElement* popDue();
+
+	uint32_t getEntries() const;
+	uint32_t getDueEntries() const;
+	time_t getCurrentTime() const;
+
+	uint64_t statCascaded; /**< number of elements moved to a lower level, used for statistics */
+
+private:
+	static const uint32_t LEVEL0_BITS = 8;
+	static const uint32_t LEVEL_BITS = 6;
+	static const uint32_t LEVELS = 3; /**< number of levels above level 0 */
+	static const uint32_t LEVEL0_SIZE = 1<<LEVEL0_BITS;
+	static const uint32_t LEVEL_SIZE = 1<<LEVEL_BITS;
+	static const uint64_t MAX_RANGE = (uint64_t)1<<(LEVEL0_BITS+LEVELS*LEVEL_BITS);
+
+	time_t currentTime; /**< all slots up to this second have been processed */
+	uint32_t entries;
+	uint32_t dueEntries;
+
+	HashtableBucketList level0[LEVEL0_SIZE];
+	HashtableBucketList levels[LEVELS][LEVEL_SIZE];
+	HashtableBucketList due;
+
+	void place(BucketListElement* node);
+	void cascade(uint32_t level);
+	void moveToDue(HashtableBucketList& list);
+};
+
+#endif /*EXPIRYWHEEL_H_*/
@@ -32,7 +32,8 @@
 
 FlowHashtable::FlowHashtable(Source<IpfixRecord*>* recordsource, Rule* rule,
 		uint16_t inactiveTimeout, uint16_t activeTimeout, uint8_t hashbits)
-	: BaseHashtable(recordsource, rule, inactiveTimeout, activeTimeout, hashbits)
+	: BaseHashtable(recordsource, rule, inactiveTimeout, activeTimeout, hashbits),
+	  recordBuffer(new IpfixRecord::Data[fieldLength+privDataLength])
 {
 }
 
@@ -450,15 +451,16 @@ HashtableBucket* FlowHashtable::lookupBucket(uint32_t hash, IpfixRecord::Data* d
 
 /**
  * Inserts a data block into the hashtable
+ * @param data record in the layout of the hashtable, it is copied if a new bucket is created
  */
-void FlowHashtable::bufferDataBlock(boost::shared_array<IpfixRecord::Data> data)
+void FlowHashtable::bufferDataBlock(IpfixRecord::Data* data)
 {
 	statRecordsReceived++;
 
-	uint32_t nhash = getHash(data.get(), false);
+	uint32_t nhash = getHash(data, false);
 	DPRINTF_DEBUG( "nhash=%u", nhash);
 	HashtableBucket* prevbucket;
-	HashtableBucket* bucket = lookupBucket(nhash, data.get(), false, &prevbucket);
+	HashtableBucket* bucket = lookupBucket(nhash, data, false, &prevbucket);
 
 	bool flowfound = false;
 	bool expiryforced = false;
@@ -476,31 +478,32 @@ void FlowHashtable::bufferDataBlock(boost::shared_array<IpfixRecord::Data> data)
 			expiryforced = true;
 			bucket->forceExpiry = true;
 			removeBucket(bucket);
+			scheduleExpiry(bucket);
 		} else {
 			flowfound = true;
-			aggregateFlow(bucket->data.get(), data.get(), false);
+			aggregateFlow(bucket->data.get(), data, false);
 			bucket->inactiveExpireTime = unix_now.tv_sec + inactiveTimeout;
+			scheduleExpiry(bucket);
 			if (bucket->activeExpireTime>bucket->inactiveExpireTime) {
-				exportList.remove(bucket->listNode);
-				exportList.push(bucket->listNode);
 				removeBucket(bucket);
 			}
 		}
 	}
 	if (biflowAggregation && !flowfound && !expiryforced) {
 		// try reverse flow
-		uint32_t rhash = getHash(data.get(), true);
+		uint32_t rhash = getHash(data, true);
 		DPRINTF_DEBUG( "rhash=%u", rhash);
-		bucket = lookupBucket(rhash, data.get(), true, &prevbucket);
+		bucket = lookupBucket(rhash, data, true, &prevbucket);
 		if (bucket != NULL) {
 			if (unix_now.tv_sec > bucket->inactiveExpireTime || unix_now.tv_sec > bucket->activeExpireTime) {
 				bucket->forceExpiry = true;
 				expiryforced = true;
 				removeBucket(bucket);
+				scheduleExpiry(bucket);
 			} else {
 				flowfound = true;
 				DPRINTF_DEBUG( "aggregating reverse flow");
-				int must_reverse = aggregateFlow(bucket->data.get(), data.get(), true);
+				int must_reverse = aggregateFlow(bucket->data.get(), data, true);
 				if (must_reverse == 1) {
 					DPRINTF_DEBUG( "reversing whole flow");
 					// reverse flow
@@ -523,9 +526,8 @@ void FlowHashtable::bufferDataBlock(boost::shared_array<IpfixRecord::Data> data)
 					bucket->prev = 0;
 					if (bucket->next != NULL) bucket->next->prev = bucket;
 					bucket->inactiveExpireTime = unix_now.tv_sec + inactiveTimeout;
+					scheduleExpiry(bucket);
 					if (bucket->activeExpireTime>bucket->inactiveExpireTime) {
-						exportList.remove(bucket->listNode);
-						exportList.push(bucket->listNode);
 						removeBucket(bucket);
 					}
 				}
@@ -535,134 +537,184 @@ void FlowHashtable::bufferDataBlock(boost::shared_array<IpfixRecord::Data> data)
 	if (!flowfound || expiryforced) {
 		DPRINTF_DEBUG( "creating new bucket");
 		statTotalEntries++;
+		boost::shared_array<IpfixRecord::Data> htdata(new IpfixRecord::Data[fieldLength+privDataLength]);
+		memcpy(htdata.get(), data, fieldLength+privDataLength);
 		HashtableBucket* n = buckets[nhash];
-		buckets[nhash] = createBucket(data, 0, n, 0, nhash, unix_now.tv_sec); // FIXME: insert observationDomainID!
+		buckets[nhash] = createBucket(htdata, 0, n, 0, nhash, unix_now.tv_sec); // FIXME: insert observationDomainID!
 		buckets[nhash]->inTable = true;
 		if (n != NULL) n->prev = buckets[nhash];
 		BucketListElement* node = hbucketIM.getNewInstance();
 		node->reset();
 		buckets[nhash]->listNode = node;
 		node->bucket = buckets[nhash];
-		exportList.push(node);
+		scheduleExpiry(buckets[nhash]);
 	}
 	atomic_release(&aggInProgress);
 }
 
+void FlowHashtable::addFieldMappingOp(FieldMappingPlan& plan, FieldMappingOp::Type type, uint32_t dstOffset, uint32_t srcOffset,
+		uint32_t length, uint32_t value, uint8_t imask)
+{
+	FieldMappingOp op;
+	op.type = type;
+	op.dstOffset = dstOffset;
+	op.srcOffset = srcOffset;
+	op.length = length;
+	op.value = value;
+	op.imask = imask;
+	plan.ops.push_back(op);
+}
+
 /**
- * Copies \c srcData to \c dstData applying \c modifier.
- * Takes care to pad \c srcData with zero-bytes in case it is shorter than \c dstData.
+ * Returns the field of type \c type out of the \c ti->fieldCount FieldInfos in \c fieldInfo, or NULL.
  */
-void FlowHashtable::copyData(TemplateInfo::FieldInfo* dstFI, IpfixRecord::Data* dst, TemplateInfo::FieldInfo* srcFI, IpfixRecord::Data* src, Rule::Field::Modifier modifier)
+static TemplateInfo::FieldInfo* findFieldInfo(TemplateInfo* ti, TemplateInfo::FieldInfo* fieldInfo,
+		InformationElement::IeId id, InformationElement::IeEnterpriseNumber enterprise)
 {
-	InformationElement::IeInfo* dstType = &dstFI->type;
-	InformationElement::IeInfo* srcType = &srcFI->type;
-	IpfixRecord::Data* dstData = dst+dstFI->offset;
-	IpfixRecord::Data* srcData = src+srcFI->offset;
-	if((dstType->id != srcType->id) || (dstType->enterprise != srcType->enterprise)) {
-		DPRINTF_INFO("copyData: Tried to copy field to destination of different type\n");
-		return;
-	}
+	int i = ti->getFieldIndex(id, enterprise);
+	return i < 0 ? NULL : &fieldInfo[i];
+}
 
-	/* Copy data, care for length differences */
-	uint32_t copylen = 0;
-	if(dstType->length == srcType->length) {
-		copylen = srcType->length;
-		memcpy(dstData, srcData, copylen);
-
-	} else if(dstType->length > srcType->length) {
-		copylen = srcType->length;
-		/* TODO: We simply pad with zeroes - will this always be correct? */
-		if (dstType->enterprise==0) {
-			switch (dstType->id) {
-				/* Fields of type IPv4Address-type and payload are padded on the right */
-				case IPFIX_TYPEID_sourceIPv4Address:
-				case IPFIX_TYPEID_destinationIPv4Address:
-					bzero(dstData+copylen, dstType->length-copylen);
-					memcpy(dstData, srcData, copylen);
-					break;
+/**
+ * Determines all steps needed to convert a data record described by \c ti to the layout of this hashtable.
+ * For every field of the hashtable, the matching field of \c ti is copied (padded with zero-bytes in case it
+ * is shorter) and the field modifier is applied. Fields not contained in \c ti are set to zero.
+ * @param fieldInfo offsets and lengths of the fields of \c ti, which may be those of a single variable-length record
+ */
+void FlowHashtable::buildFieldMappingPlan(TemplateInfo* ti, TemplateInfo::FieldInfo* fieldInfo, FieldMappingPlan& plan)
+{
+	plan.ops.clear();
 
-				default:
-					bzero(dstData, dstType->length-srcType->length);
-					memcpy(dstData + dstType->length - srcType->length, srcData, copylen);
-					break;
-			}
-		} else if ((dstType->enterprise&IPFIX_PEN_vermont) && dstType->id==IPFIX_ETYPEID_frontPayload) {
-			bzero(dstData+copylen, dstType->length-copylen);
-			memcpy(dstData, srcData, copylen);
-		} else {
-			bzero(dstData, dstType->length-srcType->length);
-			memcpy(dstData + dstType->length - srcType->length, srcData, copylen);
-		}
+	for (int i = 0; i < dataTemplate->fieldCount; i++) {
+		TemplateInfo::FieldInfo* hfi = &dataTemplate->fieldInfo[i];
+		InformationElement::IeInfo* dstType = &hfi->type;
 
-	} else {
-		if ((dstType->enterprise&IPFIX_PEN_vermont) && dstType->id == IPFIX_ETYPEID_frontPayload) {
+		TemplateInfo::FieldInfo* tfi = findFieldInfo(ti, fieldInfo, hfi->type.id, hfi->type.enterprise);
+		if (!tfi) {
+			DPRINTF_INFO("Flow to be buffered will not contain %s field\n", hfi->type.toString().c_str());
+			addFieldMappingOp(plan, FieldMappingOp::ZERO, hfi->offset, 0, dstType->length);
+			continue;
+		}
+		InformationElement::IeInfo* srcType = &tfi->type;
+
+		bool frontPayload = (dstType->enterprise&IPFIX_PEN_vermont) && dstType->id == IPFIX_ETYPEID_frontPayload;
+		bool copied = true;
+		uint32_t copylen = 0;
+		if (dstType->length == srcType->length) {
+			copylen = srcType->length;
+			addFieldMappingOp(plan, FieldMappingOp::COPY, hfi->offset, tfi->offset, copylen);
+		} else if (dstType->length > srcType->length) {
+			copylen = srcType->length;
+			/* TODO: We simply pad with zeroes - will this always be correct? */
+			/* Fields of type IPv4Address-type and payload are padded on the right */
+			if ((dstType->enterprise == 0 && (dstType->id == IPFIX_TYPEID_sourceIPv4Address || dstType->id == IPFIX_TYPEID_destinationIPv4Address))
+					|| frontPayload) {
+				addFieldMappingOp(plan, FieldMappingOp::ZERO, hfi->offset+copylen, 0, dstType->length-copylen);
+				addFieldMappingOp(plan, FieldMappingOp::COPY, hfi->offset, tfi->offset, copylen);
+			} else {
+				addFieldMappingOp(plan, FieldMappingOp::ZERO, hfi->offset, 0, dstType->length-copylen);
+				addFieldMappingOp(plan, FieldMappingOp::COPY, hfi->offset+dstType->length-copylen, tfi->offset, copylen);
+			}
+		} else if (frontPayload) {
 			copylen = dstType->length;
-			memcpy(dstData, srcData, copylen);
+			addFieldMappingOp(plan, FieldMappingOp::COPY, hfi->offset, tfi->offset, copylen);
 		} else {
 			DPRINTF_INFO("Target buffer too small. Buffer expected %s of length %d, got one with length %dn", srcType->toString().c_str(), srcType->length, dstType->length);
-			return;
+			addFieldMappingOp(plan, FieldMappingOp::ZERO, hfi->offset, 0, dstType->length);
+			copied = false;
 		}
-	}
-
-	// save used length of payload field
-	if ((dstType->enterprise&IPFIX_PEN_vermont) && dstType->id == IPFIX_ETYPEID_frontPayload) {
-		*reinterpret_cast<uint32_t*>(&dst[dstFI->privDataOffset+4]) = copylen;
-	}
-
-	/* Apply modifier */
-	if(modifier == Rule::Field::DISCARD) {
-		DPRINTF_INFO("Tried to copy data w/ having field modifier set to discard\n");
-		return;
-	} else if((modifier == Rule::Field::KEEP) || (modifier == Rule::Field::AGGREGATE)) {
 
-	} else if((modifier >= Rule::Field::MASK_START) && (modifier <= Rule::Field::MASK_END)) {
+		if (copied) {
+			// save used length of payload field
+			if (frontPayload) {
+				addFieldMappingOp(plan, FieldMappingOp::SET_UINT32, hfi->privDataOffset+4, 0, 4, copylen);
+			}
 
-		if((dstType->id != IPFIX_TYPEID_sourceIPv4Address) && (dstType->id != IPFIX_TYPEID_destinationIPv4Address)) {
-			DPRINTF_INFO("Tried to apply mask to %s field\n", dstType->toString().c_str());
-			return;
+			/* Apply modifier */
+			Rule::Field::Modifier modifier = fieldModifier[i];
+			if ((modifier >= Rule::Field::MASK_START) && (modifier <= Rule::Field::MASK_END)) {
+				if ((dstType->id != IPFIX_TYPEID_sourceIPv4Address) && (dstType->id != IPFIX_TYPEID_destinationIPv4Address)) {
+					DPRINTF_INFO("Tried to apply mask to %s field\n", dstType->toString().c_str());
+				} else if (dstType->length != 5) {
+					DPRINTF_INFO("Destination data to short - no room to store mask\n");
+				} else {
+					uint8_t imask = 32 - (modifier - (int)Rule::Field::MASK_START);
+					uint32_t mask = imask >= 32 ? 0 : ~((1U << imask) - 1);
+					addFieldMappingOp(plan, FieldMappingOp::MASK, hfi->offset, 0, 5, htonl(mask), imask);
+				}
+			} else if ((modifier != Rule::Field::KEEP) && (modifier != Rule::Field::AGGREGATE)) {
+				DPRINTF_INFO("Unhandled field modifier: %d\n", modifier);
+			}
 		}
 
-		if (dstType->length != 5) {
-			DPRINTF_INFO("Destination data to short - no room to store mask\n");
-			return;
+		/* copy associated mask, should there be one */
+		TemplateInfo::FieldInfo* mfi = NULL;
+		if (hfi->type.id == IPFIX_TYPEID_sourceIPv4Address) {
+			mfi = findFieldInfo(ti, fieldInfo, IPFIX_TYPEID_sourceIPv4PrefixLength, 0);
+		} else if (hfi->type.id == IPFIX_TYPEID_destinationIPv4Address) {
+			mfi = findFieldInfo(ti, fieldInfo, IPFIX_TYPEID_destinationIPv4PrefixLength, 0);
 		}
-
-		uint8_t imask = 32 - (modifier - (int)Rule::Field::MASK_START);
-		dstData[4] = imask; /* store the inverse network mask */
-
-		if (imask > 0) {
-			if (imask == 8) {
-				dstData[3] = 0x00;
-			} else if (imask == 16) {
-				dstData[2] = 0x00;
-				dstData[3] = 0x00;
-			} else if (imask == 24) {
-				dstData[1] = 0x00;
-				dstData[2] = 0x00;
-				dstData[3] = 0x00;
-			} else if (imask == 32) {
-				dstData[0] = 0x00;
-				dstData[1] = 0x00;
-				dstData[2] = 0x00;
-				dstData[3] = 0x00;
+		if (mfi) {
+			if (hfi->type.length != 5) {
+				DPRINTF_INFO("Tried to set mask of length %d IP address\n", hfi->type.length);
+			} else if (mfi->type.length != 1) {
+				DPRINTF_INFO("Cannot process associated mask with invalid length %d\n", mfi->type.length);
 			} else {
-				int pattern = 0;
-				int i;
-				for(i = 0; i < imask; i++) {
-					pattern |= (1 << i);
-				}
-
-				*(uint32_t*)dstData = htonl(ntohl(*(uint32_t*)(dstData)) & ~pattern);
+				addFieldMappingOp(plan, FieldMappingOp::COPY, hfi->offset+4, mfi->offset, 1);
 			}
 		}
+	}
+}
 
-	} else {
-		DPRINTF_INFO("Unhandled field modifier: %d\n", modifier);
-		return;
+/**
+ * Compiles the conversion of data records described by \c ti, so that they can be aggregated without any
+ * further lookups. Called for every incoming template.
+ */
+void FlowHashtable::compileTemplate(boost::shared_ptr<TemplateInfo> ti)
+{
+	for (uint16_t i = 0; i < ti->fieldCount; i++) {
+		// offsets differ from record to record, they are passed with each of them
+		if (ti->fieldInfo[i].isVariableLength) return;
 	}
+
+	FieldMappingPlan& plan = plans[ti->getUniqueId()];
+	plan.templateInfo = ti.get();
+	plan.templateRef = ti;
+	buildFieldMappingPlan(ti.get(), ti->fieldInfo, plan);
 }
 
+/**
+ * Drops the compiled plan of \c ti, called when the template is destroyed.
+ */
+void FlowHashtable::removeTemplate(boost::shared_ptr<TemplateInfo> ti)
+{
+	std::unordered_map<uint16_t, FieldMappingPlan>::iterator it = plans.find(ti->getUniqueId());
+	if (it != plans.end() && it->second.templateInfo == ti.get()) plans.erase(it);
+}
 
+/**
+ * Returns the plan for converting \c record.
+ * Records with their own field layout (variable-length records) or whose TemplateInfo could not be compiled
+ * get a temporary plan which is built for this record only.
+ */
+const FlowHashtable::FieldMappingPlan& FlowHashtable::getFieldMappingPlan(IpfixDataRecord* record)
+{
+	const boost::shared_ptr<TemplateInfo>& ti = record->templateInfo;
+	if (!record->hasRecordLayout()) {
+		std::unordered_map<uint16_t, FieldMappingPlan>::iterator it = plans.find(ti->getUniqueId());
+		if (it != plans.end() && it->second.templateInfo == ti.get() && !it->second.templateRef.expired()) {
+			return it->second;
+		}
+		compileTemplate(ti);
+		it = plans.find(ti->getUniqueId());
+		if (it != plans.end() && it->second.templateInfo == ti.get()) {
+			// template which was not announced to us, it will be used by following records, too
+			return it->second;
+		}
+	}
+	buildFieldMappingPlan(ti.get(), record->getFieldInfoArray(), tempPlan);
+	return tempPlan;
+}
 
 /**
  * Buffer passed flow (containing fixed-value fields) in Hashtable @c ht
@@ -671,78 +723,42 @@ void FlowHashtable::aggregateDataRecord(IpfixDataRecord* record)
 {
 	DPRINTF_INFO("called");
 
-	boost::shared_ptr<TemplateInfo> ti = record->templateInfo;
 	IpfixRecord::Data* data = record->data;
 
 	// the following lock should almost never fail (only during reconfiguration)
-	while (atomic_lock(&aggInProgress)) {
-		timespec req;
-		req.tv_sec = 0;
-		req.tv_nsec = 50000000;
-		nanosleep(&req, &req);
-	}
+	lockAggregation();
 
-	int i;
+	const FieldMappingPlan& plan = getFieldMappingPlan(record);
 
-	/* Create data block to be inserted into buffer... */
-	boost::shared_array<IpfixRecord::Data> htdata(new IpfixRecord::Data[fieldLength+privDataLength]);
+	/* Convert record into the layout of the hashtable... */
+	IpfixRecord::Data* htdata = recordBuffer.get();
 
 	// set private data fields to zero
-	memset(htdata.get()+fieldLength, 0, privDataLength);
-
-	for (i = 0; i < dataTemplate->fieldCount; i++) {
-		TemplateInfo::FieldInfo* hfi = &dataTemplate->fieldInfo[i];
-
-		/* Copy from matching variable field, should it exist */
-		TemplateInfo::FieldInfo* tfi = ti->getFieldInfo(hfi->type);
-		if (tfi) {
-			// this path is normal for normal flow data records!
-			copyData(hfi, htdata.get(), tfi, data, fieldModifier[i]);
-
-			/* copy associated mask, should there be one */
-			switch (hfi->type.id) {
-
-				case IPFIX_TYPEID_sourceIPv4Address:
-					tfi = ti->getFieldInfo(IPFIX_TYPEID_sourceIPv4PrefixLength, 0);
-					if(tfi) {
-						if(hfi->type.length != 5) {
-							DPRINTF_INFO("Tried to set mask of length %d IP address\n", hfi->type.length);
-						} else {
-							if(tfi->type.length == 1) {
-								*(uint8_t*)(htdata.get() + hfi->offset + 4) = *(uint8_t*)(data + tfi->offset);
-							} else {
-								DPRINTF_INFO("Cannot process associated mask with invalid length %d\n", tfi->type.length);
-							}
-						}
-					}
+	memset(htdata+fieldLength, 0, privDataLength);
+
+	const FieldMappingOp* op = plan.ops.data();
+	const FieldMappingOp* end = op+plan.ops.size();
+	for (; op != end; op++) {
+		switch (op->type) {
+			case FieldMappingOp::COPY:
+				memcpy(htdata+op->dstOffset, data+op->srcOffset, op->length);
+				break;
+			case FieldMappingOp::ZERO:
+				memset(htdata+op->dstOffset, 0, op->length);
+				break;
+			case FieldMappingOp::MASK:
+				{
+					uint32_t addr;
+					memcpy(&addr, htdata+op->dstOffset, 4);
+					addr &= op->value;
+					memcpy(htdata+op->dstOffset, &addr, 4);
+					htdata[op->dstOffset+4] = op->imask;
 					break;
-
-				case IPFIX_TYPEID_destinationIPv4Address:
-					tfi = ti->getFieldInfo(IPFIX_TYPEID_destinationIPv4PrefixLength, 0);
-					if(tfi) {
-						if(hfi->type.length != 5) {
-							DPRINTF_INFO("Tried to set mask of length %d IP address", hfi->type.length);
-						} else {
-							if(tfi->type.length == 1) {
-								*(uint8_t*)(htdata.get() + hfi->offset + 4) = *(uint8_t*)(data + tfi->offset);
-							} else {
-								DPRINTF_INFO("Cannot process associated mask with invalid length %d", tfi->type.length);
-							}
-						}
-					}
-					break;
-
-				default:
-					break;
-			}
-		} else {
-			// field not filled
-			DPRINTF_INFO("Flow to be buffered did not contain %s field\n", hfi->type.toString().c_str());
-			// if field was not copied, fill it with 0
-			memset(htdata.get() + hfi->offset, 0, hfi->type.length);
+				}
+			case FieldMappingOp::SET_UINT32:
+				memcpy(htdata+op->dstOffset, &op->value, 4);
+				break;
 		}
-
-		continue;
 	}
 
 	/* ...then buffer it */
@@ -26,6 +26,8 @@
 
 #include <boost/smart_ptr.hpp>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 class FlowHashtable : public BaseHashtable
 {
@@ -35,20 +37,55 @@ public:
 	virtual ~FlowHashtable();
 
 	void aggregateDataRecord(IpfixDataRecord* record);
+	void compileTemplate(boost::shared_ptr<TemplateInfo> ti);
+	void removeTemplate(boost::shared_ptr<TemplateInfo> ti);
 
 
 private:
+	/**
+	 * single step of the conversion of an incoming data record to the layout of this hashtable
+	 */
+	struct FieldMappingOp {
+		enum Type {
+			COPY,		/**< copy length bytes from srcOffset to dstOffset */
+			ZERO,		/**< set length bytes at dstOffset to zero */
+			MASK,		/**< apply network mask value to IPv4 address at dstOffset and store imask behind it */
+			SET_UINT32	/**< store value at dstOffset */
+		};
+		Type type;
+		uint32_t dstOffset;
+		uint32_t srcOffset;
+		uint32_t length;
+		uint32_t value;
+		uint8_t imask;
+	};
+
+	/**
+	 * all steps needed to convert records of one incoming template, see compileTemplate()
+	 */
+	struct FieldMappingPlan {
+		const TemplateInfo* templateInfo; /**< template the plan was compiled for */
+		boost::weak_ptr<TemplateInfo> templateRef; /**< to detect that templateInfo was freed */
+		std::vector<FieldMappingOp> ops;
+	};
+
+	std::unordered_map<uint16_t, FieldMappingPlan> plans; /**< compiled plans by TemplateInfo::getUniqueId() */
+	FieldMappingPlan tempPlan; /**< plan for records which cannot use a compiled plan, e.g. variable-length records */
+	boost::scoped_array<IpfixRecord::Data> recordBuffer; /**< incoming record converted to hashtable layout */
+
+	void buildFieldMappingPlan(TemplateInfo* ti, TemplateInfo::FieldInfo* fieldInfo, FieldMappingPlan& plan);
+	void addFieldMappingOp(FieldMappingPlan& plan, FieldMappingOp::Type type, uint32_t dstOffset, uint32_t srcOffset,
+			uint32_t length, uint32_t value = 0, uint8_t imask = 0);
+	const FieldMappingPlan& getFieldMappingPlan(IpfixDataRecord* record);
 	int aggregateField(TemplateInfo::FieldInfo* basefi, TemplateInfo::FieldInfo* deltafi, IpfixRecord::Data* base,
 		  IpfixRecord::Data* delta);
 	int aggregateFlow(IpfixRecord::Data* baseFlow, IpfixRecord::Data* flow, bool reverse);
 	uint32_t getHash(IpfixRecord::Data* data, bool reverse);
 	int equalFlow(IpfixRecord::Data* flow1, IpfixRecord::Data* flow2, bool reverse);
 	HashtableBucket* lookupBucket(uint32_t hash, IpfixRecord::Data* data, bool reverse, HashtableBucket** prevbucket);
-	void bufferDataBlock(boost::shared_array<IpfixRecord::Data> data);
+	void bufferDataBlock(IpfixRecord::Data* data);
 	int equalRaw(InformationElement::IeInfo* data1Type, IpfixRecord::Data* data1,
 			InformationElement::IeInfo* data2Type, IpfixRecord::Data* data2);
-	void copyData(TemplateInfo::FieldInfo* dstFI, IpfixRecord::Data* dst,
-			TemplateInfo::FieldInfo* srcFI, IpfixRecord::Data* src, Rule::Field::Modifier modifier);
 	int compare4ByteField(IpfixRecord::Data* baseFlow, TemplateInfo::FieldInfo* baseFi,
 			IpfixRecord::Data* flow, TemplateInfo::FieldInfo* deltaFi);
 	int compare8ByteField(IpfixRecord::Data* baseFlow, TemplateInfo::FieldInfo* baseFi,
@@ -0,0 +1,261 @@
+/*
+ * Vermont Aggregator Subsystem
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "FlowTable.h"
+
+#include "common/msg.h"
+
+#include <string.h>
+
+
+HashtableBucket* const FlowTable::DELETED = reinterpret_cast<HashtableBucket*>(1);
+
+/**
+ * @param keyLength length of flow keys in bytes
+ * @param initialBits the table starts with 2^initialBits slots, it never shrinks below this size
+ */
+FlowTable::FlowTable(uint32_t keyLength, uint8_t initialBits)
+	: statLookups(0),
+	  statProbes(0),
+	  statResizes(0),
+	  keyLength(keyLength),
+	  minBits(initialBits < MIN_BITS ? MIN_BITS : initialBits),
+	  migratePos(0)
+{
+	// keep slots 8 byte aligned
+	slotSize = (sizeof(Slot)+keyLength+7) & ~7;
+	allocTable(current, minBits);
+	old.slots = NULL;
+	old.mask = 0;
+	old.bits = 0;
+	old.entries = 0;
+}
+
+FlowTable::~FlowTable()
+{
+	delete[] current.slots;
+	delete[] old.slots;
+}
+
+void FlowTable::allocTable(Table& t, uint8_t bits)
+{
+	if (bits > 31)
+		THROWEXCEPTION("FlowTable: table size exceeds 2^31 slots");
+	size_t size = (size_t)1<<bits;
+	t.slots = new uint8_t[size*slotSize];
+	memset(t.slots, 0, size*slotSize);
+	t.mask = size-1;
+	t.bits = bits;
+	t.entries = 0;
+}
+
+/**
+ * searches given table for a slot containing the key
+ * @returns NULL if key was not found
+ */
+FlowTable::Slot* FlowTable::lookup(Table& t, uint32_t hash, const uint8_t* key)
+{
+	uint32_t idx = hash & t.mask;
+	while (true) {
+		Slot* slot = getSlot(t, idx);
+		statProbes++;
+		if (slot->bucket == NULL) return NULL;
+		if (slot->bucket != DELETED && slot->hash == hash && memcmp(getKey(slot), key, keyLength) == 0)
+			return slot;
+		idx = (idx+1) & t.mask;
+	}
+}
+
+/**
+ * copies given slot into the first free slot of its probe sequence in t
+ */
+void FlowTable::place(Table& t, const Slot* src)
+{
+	uint32_t idx = src->hash & t.mask;
+	while (getSlot(t, idx)->bucket != NULL) {
+		idx = (idx+1) & t.mask;
+	}
+	memcpy(getSlot(t, idx), src, slotSize);
+	t.entries++;
+}
+
+/**
+ * removes slot idx from t and moves following entries of the probe sequence backwards,
+ * so that lookups do not need deletion markers
+ */
+void FlowTable::eraseSlot(Table& t, uint32_t idx)
+{
+	uint32_t hole = idx;
+	uint32_t j = idx;
+	while (true) {
+		j = (j+1) & t.mask;
+		Slot* slot = getSlot(t, j);
+		if (slot->bucket == NULL) break;
+		uint32_t home = slot->hash & t.mask;
+		// entry stays if its home slot lies cyclically in (hole, j]
+		bool stays = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+		if (!stays) {
+			memcpy(getSlot(t, hole), slot, slotSize);
+			hole = j;
+		}
+	}
+	getSlot(t, hole)->bucket = NULL;
+	t.entries--;
+}
+
+/**
+ * allocates a new table with 2^bits slots, the current table becomes the old one
+ * and its entries are migrated by the following operations
+ */
+void FlowTable::startResize(uint8_t bits)
+{
+	if (old.slots) migrate(old.mask+1);
+
+	DPRINTF_INFO("FlowTable: resizing from %u to %u slots (%u entries)", current.mask+1, 1<<bits, current.entries);
+	old = current;
+	allocTable(current, bits);
+	migratePos = 0;
+	statResizes++;
+}
+
+/**
+ * moves up to count slots from old table into current table
+ */
+void FlowTable::migrate(uint32_t count)
+{
+	uint32_t oldSize = old.mask+1;
+	while (count-- > 0 && migratePos < oldSize && old.entries > 0) {
+		Slot* slot = getSlot(old, migratePos++);
+		if (slot->bucket != NULL && slot->bucket != DELETED) {
+			place(current, slot);
+			slot->bucket = DELETED;
+			old.entries--;
+		}
+	}
+	if (migratePos == oldSize || old.entries == 0) {
+		delete[] old.slots;
+		old.slots = NULL;
+		old.mask = 0;
+		old.entries = 0;
+	}
+}
+
+/**
+ * @returns bucket which was inserted with given key, NULL if there is none
+ */
+HashtableBucket* FlowTable::find(uint32_t hash, const uint8_t* key)
+{
+	statLookups++;
+	if (old.slots) migrate(MIGRATION_STEP);
+
+	Slot* slot = lookup(current, hash, key);
+	if (!slot && old.slots) slot = lookup(old, hash, key);
+	return slot ? slot->bucket : NULL;
+}
+
+/**
+ * inserts bucket with given key, the key must not be contained in the table yet
+ */
+void FlowTable::insert(uint32_t hash, const uint8_t* key, HashtableBucket* bucket)
+{
+	if (old.slots) migrate(MIGRATION_STEP);
+
+	if ((uint64_t)(current.entries+1)*4 > (uint64_t)(current.mask+1)*3) {
+		startResize(current.bits+1);
+	}
+
+	uint32_t idx = hash & current.mask;
+	while (getSlot(current, idx)->bucket != NULL) {
+		idx = (idx+1) & current.mask;
+	}
+	Slot* slot = getSlot(current, idx);
+	slot->bucket = bucket;
+	slot->hash = hash;
+	memcpy(getKey(slot), key, keyLength);
+	current.entries++;
+}
+
+/**
+ * removes given bucket which was inserted with the given hash value
+ */
+void FlowTable::remove(uint32_t hash, HashtableBucket* bucket)
+{
+	if (old.slots) migrate(MIGRATION_STEP);
+
+	uint32_t idx = hash & current.mask;
+	Slot* slot;
+	while ((slot = getSlot(current, idx))->bucket != NULL) {
+		if (slot->bucket == bucket) {
+			eraseSlot(current, idx);
+
+			if (!old.slots && current.bits > minBits && current.entries < (current.mask+1)/8) {
+				startResize(current.bits-1);
+			}
+			return;
+		}
+		idx = (idx+1) & current.mask;
+	}
+
+	if (old.slots) {
+		idx = hash & old.mask;
+		while ((slot = getSlot(old, idx))->bucket != NULL) {
+			if (slot->bucket == bucket) {
+				slot->bucket = DELETED;
+				old.entries--;
+				return;
+			}
+			idx = (idx+1) & old.mask;
+		}
+	}
+
+	THROWEXCEPTION("FlowTable: bucket %p to be removed is not contained in table", (void*)bucket);
+}
+
+/**
+ * appends all buckets contained in the table to result
+ */
+void FlowTable::getBuckets(std::vector<HashtableBucket*>& result) const
+{
+	for (uint32_t i = 0; i <= current.mask; i++) {
+		Slot* slot = getSlot(current, i);
+		if (slot->bucket != NULL) result.push_back(slot->bucket);
+	}
+	if (old.slots) {
+		for (uint32_t i = 0; i <= old.mask; i++) {
+			Slot* slot = getSlot(old, i);
+			if (slot->bucket != NULL && slot->bucket != DELETED) result.push_back(slot->bucket);
+		}
+	}
+}
+
+uint32_t FlowTable::getEntries() const
+{
+	return current.entries+old.entries;
+}
+
+uint32_t FlowTable::getCapacity() const
+{
+	return current.mask+1;
+}
+
+bool FlowTable::isResizing() const
+{
+	return old.slots != NULL;
+}
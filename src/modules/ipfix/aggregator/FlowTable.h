@@ -0,0 +1,109 @@
+/*
+ * Vermont Aggregator Subsystem
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef FLOWTABLE_H_
+#define FLOWTABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+class HashtableBucket;
+
+/**
+ * Open addressing hashtable which maps flow keys to hashtable buckets.
+ *
+ * Each slot contains the 32 bit hash of the flow key, the pointer to the bucket and
+ * a copy of the flow key, so lookups touch only one memory location in most cases and
+ * no pointers need to be followed for comparison. Collisions are resolved by linear
+ * probing, entries are deleted with backward shifting, so no tombstones accumulate.
+ *
+ * The table grows when its load factor exceeds 3/4 and shrinks when it falls below 1/8.
+ * Resizing is done incrementally: a new table is allocated and each following operation
+ * moves MIGRATION_STEP slots from the old table into the new one. Until all slots are
+ * moved, lookups search both tables. Migrated slots in the old table are marked as
+ * deleted, so probe sequences of remaining entries stay intact.
+ *
+ * ATTENTION: this class is not thread-safe
+ */
+class FlowTable
+{
+public:
+	FlowTable(uint32_t keyLength, uint8_t initialBits);
+	~FlowTable();
+
+	HashtableBucket* find(uint32_t hash, const uint8_t* key);
+	void insert(uint32_t hash, const uint8_t* key, HashtableBucket* bucket);
+	void remove(uint32_t hash, HashtableBucket* bucket);
+	void getBuckets(std::vector<HashtableBucket*>& result) const;
+
+	uint32_t getEntries() const;
+	uint32_t getCapacity() const;
+	bool isResizing() const;
+
+	uint64_t statLookups; /**< number of lookups, used for statistics */
+	uint64_t statProbes; /**< number of inspected slots during lookups, used for statistics */
+	uint32_t statResizes; /**< number of started resize operations, used for statistics */
+
+private:
+	struct Slot {
+		HashtableBucket* bucket; /**< NULL if slot is empty, DELETED if slot was migrated or deleted from old table */
+		uint32_t hash;
+		// followed by keyLength bytes of flow key
+	};
+
+	struct Table {
+		uint8_t* slots;
+		uint32_t mask;
+		uint8_t bits;
+		uint32_t entries;
+	};
+
+	static HashtableBucket* const DELETED;
+	static const uint32_t MIGRATION_STEP = 64; /**< number of old slots moved per operation during resize */
+	static const uint8_t MIN_BITS = 10;
+
+	uint32_t keyLength;
+	uint32_t slotSize;
+	uint8_t minBits;
+
+	Table current;
+	Table old; /**< table which is being migrated into current, old.slots is NULL if no resize is in progress */
+	uint32_t migratePos; /**< next slot in old table to be migrated */
+
+	inline Slot* getSlot(const Table& t, uint32_t idx) const
+	{
+		return reinterpret_cast<Slot*>(t.slots+(size_t)idx*slotSize);
+	}
+
+	inline uint8_t* getKey(Slot* slot) const
+	{
+		return reinterpret_cast<uint8_t*>(slot)+sizeof(Slot);
+	}
+
+	void allocTable(Table& t, uint8_t bits);
+	Slot* lookup(Table& t, uint32_t hash, const uint8_t* key);
+	void place(Table& t, const Slot* src);
+	void eraseSlot(Table& t, uint32_t idx);
+	void startResize(uint8_t bits);
+	void migrate(uint32_t count);
+};
+
+#endif /*FLOWTABLE_H_*/
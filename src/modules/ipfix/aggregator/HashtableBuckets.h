@@ -24,6 +24,7 @@
 
 
 class BucketListElement;
+class HashtableBucketList;
 
 /**
  * Single Bucket containing one buffered flow's variable data.
@@ -51,13 +52,17 @@ public:
 	BucketListElement* next; //next Element in list
 	BucketListElement* prev; //previous Element in list
 	HashtableBucket* bucket;
+	HashtableBucketList* list; //list of ExpiryWheel which contains this element, NULL if not scheduled
+	time_t expireTime; //time when element is due in ExpiryWheel
 
 
 	BucketListElement(InstanceManager<BucketListElement>* im)
 		: ManagedInstance<BucketListElement>(im),
 		next(0),
 		prev(0),
-		bucket(0)
+		bucket(0),
+		list(0),
+		expireTime(0)
 	{
 	}
 
@@ -66,6 +71,8 @@ public:
 		next = 0;
 		prev = 0;
 		bucket = 0;
+		list = 0;
+		expireTime = 0;
 	}
 };
 
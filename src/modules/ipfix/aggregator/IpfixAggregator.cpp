@@ -45,6 +45,42 @@ IpfixAggregator::~IpfixAggregator()
 }
 
 
+/**
+ * Compiles the field mappings of all hashtables for the new Template,
+ * so that its Data Records can be aggregated without looking up fields.
+ */
+void IpfixAggregator::onTemplate(IpfixTemplateRecord* record)
+{
+	if (((record->templateInfo->setId == TemplateInfo::NetflowTemplate)
+		|| (record->templateInfo->setId == TemplateInfo::IpfixTemplate)) && rules) {
+		mutex.lock();
+		for (size_t i = 0; i < rules->count; i++) {
+			static_cast<FlowHashtable*>(rules->rule[i]->hashtable)->compileTemplate(record->templateInfo);
+		}
+		mutex.unlock();
+	}
+
+	record->removeReference();
+}
+
+
+/**
+ * Drops the field mappings compiled for the destroyed Template.
+ */
+void IpfixAggregator::onTemplateDestruction(IpfixTemplateDestructionRecord* record)
+{
+	if (rules) {
+		mutex.lock();
+		for (size_t i = 0; i < rules->count; i++) {
+			static_cast<FlowHashtable*>(rules->rule[i]->hashtable)->removeTemplate(record->templateInfo);
+		}
+		mutex.unlock();
+	}
+
+	record->removeReference();
+}
+
+
 /**
  * Injects new DataRecords into the Aggregator.
  * @param sourceID ignored
@@ -81,6 +117,38 @@ void IpfixAggregator::onDataRecord(IpfixDataRecord* record)
 	record->removeReference();
 }
 
+/**
+ * aggregates several Data Records while holding the aggregator's mutex only once
+ */
+void IpfixAggregator::onDataRecords(IpfixDataRecord** records, size_t count)
+{
+#if defined(DEBUG)
+	if(!rules) {
+		THROWEXCEPTION("Aggregator not started");
+	}
+#endif
+
+	mutex.lock();
+	for (size_t j = 0; j < count; j++) {
+		IpfixDataRecord* record = records[j];
+		// only treat non-Options Data Records (although we cannot be sure that there is a Flow inside)
+		if ((record->templateInfo->setId == TemplateInfo::NetflowTemplate)
+			|| (record->templateInfo->setId == TemplateInfo::IpfixTemplate)) {
+			for (size_t i = 0; i < rules->count; i++) {
+				if (rules->rule[i]->dataRecordMatches(record)) {
+					DPRINTF_INFO("rule %zu matches\n", i);
+					static_cast<FlowHashtable*>(rules->rule[i]->hashtable)->aggregateDataRecord(record);
+				}
+			}
+		}
+	}
+	mutex.unlock();
+
+	for (size_t j = 0; j < count; j++) {
+		records[j]->removeReference();
+	}
+}
+
 
 /**
  * creates hashtable for this aggregator
@@ -40,7 +40,10 @@ public:
 	IpfixAggregator(uint32_t pollinterval);
 	virtual ~IpfixAggregator();
 
+	virtual void onTemplate(IpfixTemplateRecord* record);
 	virtual void onDataRecord(IpfixDataRecord* record);
+	virtual void onDataRecords(IpfixDataRecord** records, size_t count);
+	virtual void onTemplateDestruction(IpfixTemplateDestructionRecord* record);
 
 protected:
 	BaseHashtable* createHashtable(Rule* rule, uint16_t inactiveTimeout, 
@@ -22,22 +22,66 @@
 
 #include "PacketHashtable.h"
 
+#include <algorithm>
+#include <netinet/in.h>
+#include <string.h>
 #include <sstream>
 
 /**
  * constructs a new instance
  * @param pollinterval sets the interval of polling the hashtable for expired flows in ms
+ * @param hashFunction hash function used for flow keys in the hashtables
+ * @param symmetricHash if true, both directions of a biflow get the same hash value
+ * @param shards number of worker threads with private hashtables, 1 disables sharding
  */
-PacketAggregator::PacketAggregator(uint32_t pollinterval)
+PacketAggregator::PacketAggregator(uint32_t pollinterval, FlowHash::Engine hashFunction, bool symmetricHash, uint32_t shards)
 	: BaseAggregator(pollinterval),
+	  hashFunction(hashFunction),
+	  symmetricHash(symmetricHash),
+	  matcher(0),
+	  shardHash(hashFunction),
+	  shardIpPrefix(0),
+	  shardPorts(false),
+	  shardProtocol(false),
+	  shardsStopped(true),
 	  statPacketsReceived(0),
 	  statIgnoredPackets(0)
 {
+	if (shards > 1) {
+		for (uint32_t i = 0; i < shards; i++) {
+			this->shards.push_back(new Shard(this, i));
+		}
+	}
 }
 
 
 PacketAggregator::~PacketAggregator()
 {
+	// worker threads must be stopped before the hashtables are destroyed
+	shutdown(false);
+
+	for (size_t i = 0; i < shards.size(); i++) {
+		// hashtables of shard 0 belong to the rules and are deleted by BaseAggregator
+		if (i > 0) {
+			for (size_t j = 0; j < shards[i]->hashtables.size(); j++) {
+				delete shards[i]->hashtables[j];
+			}
+		}
+		delete shards[i];
+	}
+	delete matcher;
+}
+
+
+PacketAggregator::Shard::Shard(PacketAggregator* aggregator, uint32_t index)
+	: aggregator(aggregator),
+	  index(index),
+	  queue(SHARD_QUEUE_SIZE, ConcurrentQueue<Packet*>::MPSC),
+	  thread(PacketAggregator::shardThread, "PacketAggShard"),
+	  statPackets(0),
+	  statIgnoredPackets(0)
+{
+	queue.setOwner("PacketAggregator shard");
 }
 
 
@@ -53,26 +97,303 @@ void PacketAggregator::receive(Packet* e)
 #endif
 
 	statPacketsReceived++;
+	if (!shards.empty()) {
+		shards[getShard(e)]->queue.push(e);
+		return;
+	}
+	aggregate(e);
+	e->removeReference();
+}
+
+
+/**
+ * aggregates all packets of the batch, references are released afterwards
+ */
+void PacketAggregator::receiveBatch(std::vector<Packet*>& batch)
+{
+#if defined(DEBUG)
+	if(!rules) {
+		THROWEXCEPTION("Aggregator not started");
+	}
+#endif
+
+	statPacketsReceived += batch.size();
+	if (!shards.empty()) {
+		// partitions are kept per thread, as several threads may call this function
+		static thread_local std::vector<std::vector<Packet*> > partitions;
+		if (partitions.size() < shards.size()) partitions.resize(shards.size());
+		for (std::vector<Packet*>::iterator it = batch.begin(); it != batch.end(); ++it) {
+			partitions[getShard(*it)].push_back(*it);
+		}
+		for (size_t i = 0; i < shards.size(); i++) {
+			if (partitions[i].empty()) continue;
+			shards[i]->queue.pushBatch(partitions[i]);
+			partitions[i].clear();
+		}
+		return;
+	}
+
+	for (std::vector<Packet*>::iterator it = batch.begin(); it != batch.end(); ++it) {
+		aggregate(*it);
+	}
+	for (std::vector<Packet*>::iterator it = batch.begin(); it != batch.end(); ++it) {
+		(*it)->removeReference();
+	}
+}
+
+
+/**
+ * aggregates the packet into the hashtables of all matching rules
+ */
+void PacketAggregator::aggregate(Packet* e)
+{
+	uint16_t matching[MAX_RULES];
+	uint32_t n = matcher->getMatchingRules(e, matching);
+	statIgnoredPackets += rules->count-n;
+	for (uint32_t i = 0; i < n; i++) {
+		DPRINTF_INFO("rule %u matches\n", matching[i]);
+		static_cast<PacketHashtable*>(rules->rule[matching[i]]->hashtable)->aggregatePacket(e);
+	}
+}
+
+
+/**
+ * determines which fields of the 5-tuple are used to distribute packets to shards
+ * only fields which are flow keys in all rules may be used, so that all packets of a flow
+ * are processed by the same shard. Source and destination fields are only used in pairs
+ * and are combined symmetrically, so that both directions of a biflow meet.
+ */
+void PacketAggregator::determineShardKey()
+{
+	shardIpPrefix = 32;
+	shardPorts = true;
+	shardProtocol = true;
 
 	for (size_t i = 0; i < rules->count; i++) {
-		if (rules->rule[i]->ExptemplateDataMatches(e)) {
-			DPRINTF_INFO("rule %zu matches\n", i);
-			static_cast<PacketHashtable*>(rules->rule[i]->hashtable)->aggregatePacket(e);
-		} else {
-			statIgnoredPackets++;
+		Rule* rule = rules->rule[i];
+		int srcPrefix = 0, dstPrefix = 0;
+		bool srcPort = false, dstPort = false, proto = false;
+		for (int j = 0; j < rule->fieldCount; j++) {
+			Rule::Field* f = rule->field[j];
+			if (f->type.enterprise != 0) continue;
+			int prefix = 0;
+			if (f->modifier == Rule::Field::KEEP) {
+				prefix = 32;
+			} else if (f->modifier >= Rule::Field::MASK_START && f->modifier <= Rule::Field::MASK_END) {
+				prefix = f->modifier-Rule::Field::MASK_START;
+			}
+			switch (f->type.id) {
+				case IPFIX_TYPEID_sourceIPv4Address:
+					srcPrefix = prefix;
+					break;
+				case IPFIX_TYPEID_destinationIPv4Address:
+					dstPrefix = prefix;
+					break;
+				case IPFIX_TYPEID_sourceTransportPort:
+					srcPort = (f->modifier == Rule::Field::KEEP);
+					break;
+				case IPFIX_TYPEID_destinationTransportPort:
+					dstPort = (f->modifier == Rule::Field::KEEP);
+					break;
+				case IPFIX_TYPEID_protocolIdentifier:
+					proto = (f->modifier == Rule::Field::KEEP);
+					break;
+			}
 		}
+		int prefix = srcPrefix < dstPrefix ? srcPrefix : dstPrefix;
+		if (prefix > 32) prefix = 32;
+		if (prefix < shardIpPrefix) shardIpPrefix = prefix;
+		shardPorts = shardPorts && srcPort && dstPort;
+		shardProtocol = shardProtocol && proto;
 	}
-	e->removeReference();
+
+	if (shardIpPrefix == 0 && !shardPorts && !shardProtocol) {
+		msg(LOG_WARNING, "PacketAggregator: rules have no common 5-tuple flow keys, all packets are aggregated by shard 0");
+	}
+	msg(LOG_NOTICE, "PacketAggregator: distributing packets to %zu shards (IP prefix %u, ports %s, protocol %s)",
+			shards.size(), shardIpPrefix, shardPorts ? "yes" : "no", shardProtocol ? "yes" : "no");
+}
+
+
+/**
+ * @returns index of shard which aggregates the given packet
+ */
+uint32_t PacketAggregator::getShard(const Packet* p) const
+{
+	uint8_t key[13];
+	uint32_t len = 0;
+
+	if (p->classification & PCLASS_NET_IP4) {
+		if (shardIpPrefix > 0) {
+			uint32_t mask = htonl(0xFFFFFFFF << (32-shardIpPrefix));
+			uint32_t a, b;
+			memcpy(&a, p->data.netHeader+12, 4);
+			memcpy(&b, p->data.netHeader+16, 4);
+			a &= mask;
+			b &= mask;
+			if (a > b) std::swap(a, b);
+			memcpy(key+len, &a, 4);
+			memcpy(key+len+4, &b, 4);
+			len += 8;
+		}
+		if (shardPorts && (p->classification & (PCLASS_TRN_TCP|PCLASS_TRN_UDP))) {
+			uint16_t a, b;
+			memcpy(&a, p->transportHeader, 2);
+			memcpy(&b, p->transportHeader+2, 2);
+			if (a > b) std::swap(a, b);
+			memcpy(key+len, &a, 2);
+			memcpy(key+len+2, &b, 2);
+			len += 4;
+		}
+		if (shardProtocol) {
+			key[len++] = p->data.netHeader[9];
+		}
+	}
+	if (len == 0) return 0;
+
+	// use the upper bits, as the hashtables use the lower bits of similar hash values
+	return (uint32_t)(((uint64_t)shardHash.hash(key, len)*shards.size()) >> 32);
+}
+
+
+/**
+ * aggregates packets of the shard's queue until the queue is shut down
+ */
+void PacketAggregator::processShard(Shard* shard)
+{
+	registerCurrentThread();
+
+	std::vector<Packet*> batch;
+	batch.reserve(SHARD_BATCH_SIZE);
+	while (shard->queue.popBatch(batch, SHARD_BATCH_SIZE)) {
+		shard->statPackets += batch.size();
+		uint16_t matching[MAX_RULES];
+		for (std::vector<Packet*>::iterator it = batch.begin(); it != batch.end(); ++it) {
+			uint32_t n = matcher->getMatchingRules(*it, matching);
+			shard->statIgnoredPackets += rules->count-n;
+			for (uint32_t i = 0; i < n; i++) {
+				shard->hashtables[matching[i]]->aggregatePacket(*it);
+			}
+		}
+		for (std::vector<Packet*>::iterator it = batch.begin(); it != batch.end(); ++it) {
+			(*it)->removeReference();
+		}
+		batch.clear();
+	}
+
+	unregisterCurrentThread();
+}
+
+
+void* PacketAggregator::shardThread(void* shard)
+{
+	Shard* s = reinterpret_cast<Shard*>(shard);
+	s->aggregator->processShard(s);
+	return 0;
 }
 
 
 /**
  * creates hashtable for this aggregator
+ * if sharding is enabled, additional hashtables for all other shards are created
  */
 BaseHashtable* PacketAggregator::createHashtable(Rule* rule, uint16_t inactiveTimeout,
 		uint16_t activeTimeout, uint8_t hashbits)
 {
-	return new PacketHashtable(this, rule, inactiveTimeout, activeTimeout, hashbits);
+	PacketHashtable* primary = new PacketHashtable(this, rule, inactiveTimeout, activeTimeout, hashbits, hashFunction, symmetricHash);
+	for (size_t i = 0; i < shards.size(); i++) {
+		if (i == 0) {
+			shards[i]->hashtables.push_back(primary);
+		} else {
+			PacketHashtable* ht = new PacketHashtable(this, rule, inactiveTimeout, activeTimeout, hashbits, hashFunction, symmetricHash);
+			ht->shareTemplate(primary);
+			shards[i]->hashtables.push_back(ht);
+		}
+	}
+	return primary;
+}
+
+
+/**
+ * expires flows of all shards, so that records are sent by a single thread
+ * on shutdown, all flows are only expired after the shards have aggregated their queued packets
+ */
+void PacketAggregator::expireFlows(bool all)
+{
+	if (shards.empty()) {
+		BaseAggregator::expireFlows(all);
+		return;
+	}
+	if (all && !shardsStopped) return;
+
+	for (size_t i = 0; i < rules->count; i++) {
+		for (size_t j = 0; j < shards.size(); j++) {
+			shards[j]->hashtables[i]->expireFlows(all);
+		}
+	}
+}
+
+
+void PacketAggregator::performStart()
+{
+	if (!matcher) matcher = new RuleMatcher(rules);
+	if (!shards.empty()) determineShardKey();
+
+	shardsStopped = false;
+	BaseAggregator::performStart();
+
+	for (size_t i = 0; i < shards.size(); i++) {
+		shards[i]->queue.restart();
+		shards[i]->thread.run(shards[i]);
+	}
+}
+
+
+/**
+ * stops worker threads after they have processed all queued packets
+ * the exporter thread skips its final expiry of all flows if shards are used, so it is done here
+ */
+void PacketAggregator::performShutdown()
+{
+	for (size_t i = 0; i < shards.size(); i++) {
+		shards[i]->queue.notifyShutdown();
+		shards[i]->thread.join();
+	}
+
+	BaseAggregator::performShutdown();
+
+	if (!shards.empty()) {
+		shardsStopped = true;
+		if (getShutdownProperly()) expireFlows(true);
+	}
+}
+
+
+void PacketAggregator::preReconfiguration()
+{
+	BaseAggregator::preReconfiguration();
+
+	for (size_t i = 1; i < shards.size(); i++) {
+		for (size_t j = 0; j < shards[i]->hashtables.size(); j++) {
+			shards[i]->hashtables[j]->preReconfiguration();
+		}
+	}
+}
+
+
+void PacketAggregator::clearStatistics()
+{
+	BaseAggregator::clearStatistics();
+
+	for (size_t i = 0; i < shards.size(); i++) {
+		if (i > 0) {
+			for (size_t j = 0; j < shards[i]->hashtables.size(); j++) {
+				shards[i]->hashtables[j]->clearStatistics();
+			}
+		}
+		shards[i]->statPackets = 0;
+		shards[i]->statIgnoredPackets = 0;
+	}
 }
 
 
@@ -80,8 +401,30 @@ string PacketAggregator::getStatisticsXML(double interval)
 {
 	ostringstream oss;
 	oss << "<totalReceivedPackets>" << statPacketsReceived << "</totalReceivedPackets>";
-	oss << "<ignoredPackets>" << statIgnoredPackets << "</ignoredPackets>";
-	oss << BaseAggregator::getStatisticsXML(interval);
+	if (shards.empty()) {
+		oss << "<ignoredPackets>" << statIgnoredPackets << "</ignoredPackets>";
+		oss << BaseAggregator::getStatisticsXML(interval);
+		return oss.str();
+	}
+
+	uint32_t ignored = 0;
+	for (size_t i = 0; i < shards.size(); i++) {
+		ignored += shards[i]->statIgnoredPackets;
+	}
+	oss << "<ignoredPackets>" << ignored << "</ignoredPackets>";
+	for (size_t i = 0; i < shards.size(); i++) {
+		oss << "<shard id=\"" << i << "\">";
+		oss << "<packets>" << shards[i]->statPackets << "</packets>";
+		oss << "<queueLength>" << shards[i]->queue.getCount() << "</queueLength>";
+		oss << "</shard>";
+	}
+	for (size_t i = 0; i < rules->count; i++) {
+		for (size_t j = 0; j < shards.size(); j++) {
+			oss << "<hashtable rule=\"" << i << "\" shard=\"" << j << "\">";
+			oss << shards[j]->hashtables[i]->getStatisticsXML(interval);
+			oss << "</hashtable>";
+		}
+	}
 
 	return oss.str();
 }
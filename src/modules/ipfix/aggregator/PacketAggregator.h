@@ -23,36 +23,92 @@
 
 #include "Rules.hpp"
 #include "BaseAggregator.h"
+#include "RuleMatcher.h"
+#include "common/FlowHash.h"
 #include "core/Module.h"
 #include "core/Source.h"
 #include "core/Destination.h"
+#include "common/ConcurrentQueue.h"
+#include "common/Thread.h"
 
 
 #include <pthread.h>
+#include <vector>
 
+class PacketHashtable;
 
 /**
  * does the same as IpfixAggregator, only faster and only for raw packets
  * (IpfixAggregator is mainly used for aggregation of IPFIX flows)
  * inherits functionality of ExpressAggregator
+ *
+ * If more than one shard is configured, packets are distributed to worker threads
+ * by a symmetric hash over those parts of the 5-tuple which are flow keys of all rules,
+ * so both directions of a flow are always aggregated by the same worker. Each worker owns
+ * a private hashtable per rule. The hashtables of one rule share template and source id,
+ * and all of them are expired by the single exporter thread, so following modules receive
+ * one IPFIX stream as if there was only one hashtable per rule.
  */
 class PacketAggregator
 		: public BaseAggregator, public Destination<Packet*>
 {
 public:
-	PacketAggregator(uint32_t pollinterval);
+	PacketAggregator(uint32_t pollinterval, FlowHash::Engine hashFunction = FlowHash::DEFAULT_ENGINE,
+			bool symmetricHash = true, uint32_t shards = 1);
 	virtual ~PacketAggregator();
 
 	virtual void receive(Packet* e);
+	virtual void receiveBatch(std::vector<Packet*>& batch);
 
+	virtual void preReconfiguration();
+	virtual void clearStatistics();
 	virtual string getStatisticsXML(double interval);
 
 
 protected:
 	virtual BaseHashtable* createHashtable(Rule* rule, uint16_t inactiveTimeout,
 			uint16_t activeTimeout, uint8_t hashbits);
+	virtual void expireFlows(bool all = false);
+
+	virtual void performStart();
+	virtual void performShutdown();
 
 private:
+	/**
+	 * worker thread with its private hashtables, only used if more than one shard is configured
+	 */
+	struct Shard {
+		PacketAggregator* aggregator;
+		uint32_t index;
+		std::vector<PacketHashtable*> hashtables; /**< one hashtable per rule, shard 0 uses the hashtables of the rules */
+		ConcurrentQueue<Packet*> queue;
+		Thread thread;
+		uint64_t statPackets;
+		uint32_t statIgnoredPackets;
+
+		Shard(PacketAggregator* aggregator, uint32_t index);
+	};
+
+	static const uint32_t SHARD_QUEUE_SIZE = 4096;
+	static const uint32_t SHARD_BATCH_SIZE = 64;
+
+	void aggregate(Packet* e);
+	void determineShardKey();
+	uint32_t getShard(const Packet* p) const;
+	void processShard(Shard* shard);
+	static void* shardThread(void* shard);
+
+	FlowHash::Engine hashFunction;
+	bool symmetricHash;
+	RuleMatcher* matcher; /**< compiled patterns of all rules, created on start */
+
+	std::vector<Shard*> shards; /**< empty if aggregation is done by the thread calling receive() */
+	FlowHash shardHash;
+	uint8_t shardIpPrefix; /**< prefix length of IPv4 addresses included in the shard key, 0 if not included */
+	bool shardPorts; /**< transport ports are included in the shard key */
+	bool shardProtocol; /**< protocol identifier is included in the shard key */
+	bool shardsStopped; /**< false while worker threads may aggregate packets */
+
 	uint32_t statPacketsReceived;
 	uint32_t statIgnoredPackets;
 };
@@ -41,7 +41,7 @@ PacketAggregatorCfg* PacketAggregatorCfg::create(XMLElement* elem)
 
 PacketAggregator* PacketAggregatorCfg::createInstance()
 {
-	instance = new PacketAggregator(pollInterval);
+	instance = new PacketAggregator(pollInterval, hashFunction, symmetricHash, shards);
 	instance->buildAggregator(rules, inactiveTimeout, activeTimeout, htableBits);
 
 	return instance;
@@ -22,8 +22,7 @@
 #include "PacketHashtable.h"
 #include <iostream>
 #include <fstream>
-
-#include "common/crc.hpp"
+#include <sstream>
 
 #include "common/ipfixlolib/ipfix.h"
 #include "common/Misc.h"
@@ -36,16 +35,45 @@ using namespace InformationElement;
 const uint32_t PacketHashtable::ExpHelperTable::UNUSED = 0xFFFFFFFF;
 
 PacketHashtable::PacketHashtable(Source<IpfixRecord*>* recordsource, Rule* rule,
-		uint16_t inactiveTimeout, uint16_t activeTimeout, uint8_t hashbits)
-	: BaseHashtable(recordsource, rule, inactiveTimeout, activeTimeout, hashbits),
-	snapshotWritten(false)
+		uint16_t inactiveTimeout, uint16_t activeTimeout, uint8_t hashbits,
+		FlowHash::Engine hashFunction, bool symmetricHash)
+	: BaseHashtable(recordsource, rule, inactiveTimeout, activeTimeout, hashbits, false),
+	flowTable(NULL),
+	flowKeyLength(0),
+	flowHash(hashFunction),
+	symmetricHash(symmetricHash && rule->biflowAggregation)
 {
 	buildExpHelperTable();
+
+	for (int i=0; i<expHelperTable.noKeyFields; i++) {
+		flowKeyLength += expHelperTable.keyFields[i].srcLength;
+		if (biflowAggregation && expHelperTable.revKeyFieldMapper[i]->srcLength != expHelperTable.keyFields[i].srcLength) {
+			THROWEXCEPTION("key field %s and its reverse field %s differ in length, biflow aggregation is not possible",
+					expHelperTable.keyFields[i].typeId.toString().c_str(),
+					expHelperTable.revKeyFieldMapper[i]->typeId.toString().c_str());
+		}
+	}
+	msg(LOG_NOTICE, "PacketHashtable: using hash function %s%s", flowHash.getDescription().c_str(),
+			this->symmetricHash ? " (symmetric)" : "");
+	flowKey = new IpfixRecord::Data[flowKeyLength];
+	revFlowKey = new IpfixRecord::Data[flowKeyLength];
+	// hashbits only specifies the initial size, the table grows and shrinks with the number of flows
+	flowTable = new FlowTable(flowKeyLength, hashbits);
 }
 
 
 PacketHashtable::~PacketHashtable()
 {
+	vector<HashtableBucket*> remaining;
+	flowTable->getBuckets(remaining);
+	for (vector<HashtableBucket*>::iterator iter = remaining.begin(); iter != remaining.end(); iter++) {
+		// we don't want to export the buckets, as the exporter thread may already be shut down!
+		destroyBucket(*iter);
+	}
+	delete flowTable;
+	delete[] flowKey;
+	delete[] revFlowKey;
+
 	delete[] expHelperTable.keyFields;
 	delete[] expHelperTable.aggFields;
 	delete[] expHelperTable.revAggFields;
@@ -1062,33 +1090,53 @@ void PacketHashtable::buildExpHelperTable()
 
 
 /**
- * calculates hash for given raw packet data in express aggregator
+ * concatenates all key fields of the raw packet to the flow key which is stored in the flow table
+ * (part of express aggregator)
  */
-uint32_t PacketHashtable::calculateHash(const IpfixRecord::Data* data)
+void PacketHashtable::buildFlowKey(const Packet* p, IpfixRecord::Data* key)
 {
-	uint32_t hash = 0xAAAAAAAA;
 	for (int i=0; i<expHelperTable.noKeyFields; i++) {
 		ExpFieldData* efd = &expHelperTable.keyFields[i];
-		DPRINTF_DEBUG( "hash for i=%u, typeid=%s, length=%u srcpointer=%p", i, efd->typeId.toString().c_str(),
-				efd->srcLength, reinterpret_cast<const char*>(data)+efd->srcIndex);
-		hash = crc32(hash, efd->srcLength, reinterpret_cast<const char*>(data)+efd->srcIndex);
+		DPRINTF_DEBUG( "key for i=%u, typeid=%s, length=%u srcpointer=%p", i, efd->typeId.toString().c_str(),
+				efd->srcLength, p->data.netHeader+efd->srcIndex);
+		memcpy(key, p->data.netHeader+efd->srcIndex, efd->srcLength);
+		key += efd->srcLength;
 	}
-	return hash & (htableSize-1);
 }
 
 /**
- * calculates hash for given raw packet data in express aggregator for reverse flows
+ * builds the flow key of the reverse flow, i.e. the key a flow in opposite direction
+ * was inserted with (for biflow aggregation)
  */
-uint32_t PacketHashtable::calculateHashRev(const IpfixRecord::Data* data)
+void PacketHashtable::buildFlowKeyRev(const Packet* p, IpfixRecord::Data* key)
 {
-	uint32_t hash = 0xAAAAAAAA;
 	for (int i=0; i<expHelperTable.noKeyFields; i++) {
 		ExpFieldData* efd = expHelperTable.revKeyFieldMapper[i];
-		DPRINTF_DEBUG( "hashrev for i=%u, typeid=%s, length=%u, srcpointer=%p", i,
-				efd->typeId.toString().c_str(), efd->srcLength, reinterpret_cast<const char*>(data)+efd->srcIndex);
-		hash = crc32(hash, efd->srcLength, reinterpret_cast<const char*>(data)+efd->srcIndex);
+		DPRINTF_DEBUG( "keyrev for i=%u, typeid=%s, length=%u, srcpointer=%p", i,
+				efd->typeId.toString().c_str(), efd->srcLength, p->data.netHeader+efd->srcIndex);
+		memcpy(key, p->data.netHeader+efd->srcIndex, efd->srcLength);
+		key += efd->srcLength;
 	}
-	return hash & (htableSize-1);
+}
+
+/**
+ * calculates hash for given flow key in express aggregator
+ */
+uint32_t PacketHashtable::calculateHash(const IpfixRecord::Data* key)
+{
+	return flowHash.hash(key, flowKeyLength);
+}
+
+/**
+ * calculates a hash value which is equal for the flow key and the reverse flow key of a packet,
+ * so that the reverse flow can be looked up without hashing again
+ * (the smaller one of both keys is hashed)
+ */
+uint32_t PacketHashtable::calculateHashSymmetric(const IpfixRecord::Data* key, const IpfixRecord::Data* revKey)
+{
+	if (memcmp(key, revKey, flowKeyLength) <= 0)
+		return flowHash.hash(key, flowKeyLength);
+	return flowHash.hash(revKey, flowKeyLength);
 }
 
 /**
@@ -1414,51 +1462,10 @@ void PacketHashtable::aggregateFlow(HashtableBucket* bucket, const Packet* p, bo
 	if (!bucket->forceExpiry) {
 		timeval unix_now = unixtime();
 		bucket->inactiveExpireTime = unix_now.tv_sec + inactiveTimeout;
-
-		if (bucket->activeExpireTime>bucket->inactiveExpireTime) {
-			exportList.remove(bucket->listNode);
-			exportList.push(bucket->listNode);
-		}
-	}
-}
-
-/**
- * compares if given hashtable bucket data is equal with raw packet data
- * @returns true if equal, false if not equal
- */
-bool PacketHashtable::equalFlow(IpfixRecord::Data* bucket, const Packet* p)
-{
-	for (int i=0; i<expHelperTable.noKeyFields; i++) {
-		ExpFieldData* efd = &expHelperTable.keyFields[i];
-
-		DPRINTF_DEBUG( "equal for i=%u, typeid=%s, length=%u, srcpointer=%p", i, efd->typeId.toString().c_str(), efd->srcLength, p->data.netHeader+efd->srcIndex);
-		// just compare srcLength bytes, as we still have our original packet data
-		if (memcmp(bucket+efd->dstIndex, p->data.netHeader+efd->srcIndex, efd->srcLength)!=0)
-			return false;
+		scheduleExpiry(bucket);
 	}
-	return true;
 }
 
-/**
- * compares if given hashtable bucket data is equal with raw packet data, reverse version
- * (for biflow aggregation)
- * @returns true if equal, false if not equal
- */
-bool PacketHashtable::equalFlowRev(IpfixRecord::Data* bucket, const Packet* p)
-{
-	for (int i=0; i<expHelperTable.noKeyFields; i++) {
-		ExpFieldData* efdsrc = &expHelperTable.keyFields[i];
-		ExpFieldData* efddst = expHelperTable.revKeyFieldMapper[i];
-
-		DPRINTF_DEBUG( "equalrev for i=%u, typeid=%s, length=%u, srcpointer=%p", i, efdsrc->typeId.toString().c_str(), efdsrc->srcLength, p->data.netHeader+efdsrc->srcIndex);
-		// just compare srcLength bytes, as we still have our original packet data
-		if (memcmp(bucket+efddst->dstIndex, p->data.netHeader+efdsrc->srcIndex, efdsrc->srcLength)!=0)
-			return false;
-	}
-	return true;
-}
-
-
 /**
  * masks ip addresses inside raw packet and creates a mask field
  * (part of express aggregator)
@@ -1560,7 +1567,7 @@ void PacketHashtable::updateBucketData(HashtableBucket* bucket)
 	node->reset();
 	node->bucket = bucket;
 	bucket->listNode = node;
-	exportList.push(node);
+	scheduleExpiry(bucket);
 }
 
 /**
@@ -1585,142 +1592,117 @@ bool PacketHashtable::mustExpireBucket(const HashtableBucket* bucket, const Pack
 void PacketHashtable::aggregatePacket(Packet* p)
 {
 	// the following lock should almost never block (only during reconfiguration)
-	while (atomic_lock(&aggInProgress)) {
-		timespec req;
-		req.tv_sec = 0;
-		req.tv_nsec = 50000000;
-		nanosleep(&req, &req);
-	}
+	lockAggregation();
 
 	DPRINTF_INFO("PacketHashtable::aggregatePacket()");
 	updatePointers(p);
 	createMaskedFields(p);
 
-	uint32_t hash = calculateHash(p->data.netHeader);
+	buildFlowKey(p, flowKey);
+	uint32_t hash;
+	if (symmetricHash) {
+		buildFlowKeyRev(p, revFlowKey);
+		hash = calculateHashSymmetric(flowKey, revFlowKey);
+	} else {
+		hash = calculateHash(flowKey);
+	}
 	DPRINTF_DEBUG( "packet hash=%u", hash);
 
 	// search bucket inside hashtable
-	HashtableBucket* bucket = buckets[hash];
+	HashtableBucket* bucket = flowTable->find(hash, flowKey);
 	uint32_t* oldflowcount = NULL;
 	bool flowfound = false;
 	bool expiryforced = false;
 	if (bucket != 0) {
-		// This slot is already used, search spill chain for equal flow
-		while (1) {
-			if (equalFlow(bucket->data.get(), p)) {
-				if (mustExpireBucket(bucket, p)) {
-					// this packet expires the bucket
-					// we therefore need to create a new flow
-					bucket->forceExpiry = true;
-					expiryforced = true;
-					removeBucket(bucket);
-				} else {
-					DPRINTF_INFO("aggregate flow in normal direction");
-					aggregateFlow(bucket, p, 0);
-					if (!bucket->forceExpiry) {
-						flowfound = true;
-					} else {
-						DPRINTF_DEBUG( "forced expiry of bucket");
-						removeBucket(bucket);
-						expiryforced = true;
-						if (expHelperTable.dpaFlowCountOffset != ExpHelperTable::UNUSED)
-							oldflowcount = reinterpret_cast<uint32_t*>(bucket->data.get()+expHelperTable.dpaFlowCountOffset);
-						bucket = NULL;
-					}
-				}
-				break;
-			}
-
-			if (bucket->next==NULL) {
-				break;
+		if (mustExpireBucket(bucket, p)) {
+			// this packet expires the bucket
+			// we therefore need to create a new flow
+			bucket->forceExpiry = true;
+			expiryforced = true;
+			removeBucket(bucket);
+			scheduleExpiry(bucket);
+		} else {
+			DPRINTF_INFO("aggregate flow in normal direction");
+			aggregateFlow(bucket, p, 0);
+			if (!bucket->forceExpiry) {
+				flowfound = true;
+			} else {
+				DPRINTF_DEBUG( "forced expiry of bucket");
+				removeBucket(bucket);
+				scheduleExpiry(bucket);
+				expiryforced = true;
+				if (expHelperTable.dpaFlowCountOffset != ExpHelperTable::UNUSED)
+					oldflowcount = reinterpret_cast<uint32_t*>(bucket->data.get()+expHelperTable.dpaFlowCountOffset);
 			}
-			bucket = (HashtableBucket*)bucket->next;
 		}
 	}
 	if (biflowAggregation && !flowfound && !expiryforced) {
 		// search for reverse direction
-		uint32_t rhash = calculateHashRev(p->data.netHeader);
+		uint32_t rhash = hash;
+		if (!symmetricHash) {
+			buildFlowKeyRev(p, revFlowKey);
+			rhash = calculateHash(revFlowKey);
+		}
 		DPRINTF_DEBUG( "rev packet hash=%u", rhash);
-		HashtableBucket* bucket = buckets[rhash];
-
-		while (bucket!=0) {
-			if (equalFlowRev(bucket->data.get(), p)) {
-				if (mustExpireBucket(bucket, p)) {
-					// this packet expires the bucket
-					// we therefore need to create a new flow
-					bucket->forceExpiry = true;
-					expiryforced = true;
-					removeBucket(bucket);
+		HashtableBucket* bucket = flowTable->find(rhash, revFlowKey);
+
+		if (bucket != 0) {
+			if (mustExpireBucket(bucket, p)) {
+				// this packet expires the bucket
+				// we therefore need to create a new flow
+				bucket->forceExpiry = true;
+				expiryforced = true;
+				removeBucket(bucket);
+				scheduleExpiry(bucket);
+			} else {
+				DPRINTF_INFO("aggregate flow in reverse direction");
+				aggregateFlow(bucket, p, 1);
+				if (!bucket->forceExpiry) {
+					flowfound = true;
 				} else {
-					DPRINTF_INFO("aggregate flow in reverse direction");
-					aggregateFlow(bucket, p, 1);
-					if (!bucket->forceExpiry) {
-						flowfound = true;
-					} else {
-						DPRINTF_DEBUG( "forced expiry of bucket");
-						removeBucket(bucket);
-						expiryforced = true;
-						if (expHelperTable.dpaFlowCountOffset != ExpHelperTable::UNUSED)
-							oldflowcount = reinterpret_cast<uint32_t*>(bucket->data.get()+expHelperTable.dpaFlowCountOffset);
-						bucket = NULL;
-					}
+					DPRINTF_DEBUG( "forced expiry of bucket");
+					removeBucket(bucket);
+					scheduleExpiry(bucket);
+					expiryforced = true;
+					if (expHelperTable.dpaFlowCountOffset != ExpHelperTable::UNUSED)
+						oldflowcount = reinterpret_cast<uint32_t*>(bucket->data.get()+expHelperTable.dpaFlowCountOffset);
 				}
-				break;
 			}
-			bucket = (HashtableBucket*)bucket->next;
 		}
 	}
 
 	if (!flowfound || expiryforced) {
 		// create new flow
 		DPRINTF_INFO("creating new bucket");
-		HashtableBucket* firstbucket = buckets[hash];
-		buckets[hash] = createBucket(buildBucketData(p), p->observationDomainID, firstbucket, 0, hash, p->timestamp.tv_sec);
-		if (firstbucket) {
-			firstbucket->prev = buckets[hash];
-			statMultiEntries++;
-		} else {
-			statEmptyBuckets--;
-		}
-		buckets[hash]->inTable = true;
+		HashtableBucket* newbucket = createBucket(buildBucketData(p), p->observationDomainID, 0, 0, hash, p->timestamp.tv_sec);
+		flowTable->insert(hash, flowKey, newbucket);
+		newbucket->inTable = true;
 
 		if (oldflowcount) {
 			DPRINTF_DEBUG( "oldflowcount: %u", ntohl(*oldflowcount));
-			*reinterpret_cast<uint32_t*>(buckets[hash]->data.get()+expHelperTable.dpaFlowCountOffset) = htonl(ntohl(*oldflowcount)+1);
+			*reinterpret_cast<uint32_t*>(newbucket->data.get()+expHelperTable.dpaFlowCountOffset) = htonl(ntohl(*oldflowcount)+1);
 		}
-		updateBucketData(buckets[hash]);
+		updateBucketData(newbucket);
 	}
-	//if (!snapshotWritten && (time(0)- 300 > starttime)) writeHashtable();
-	// FIXME: enable snapshots again by configuration
 	atomic_release(&aggInProgress);
 }
 
-void PacketHashtable::snapshotHashtable()
+/**
+ * removes given bucket from the flow table
+ */
+void PacketHashtable::removeBucket(HashtableBucket* bucket)
 {
-	// FIXME: this snapshotting code is not good ...
-	int count = 0;
-	ofstream fout("/home/sistmika/vermont/dos-attack/hashtable.txt");
-	if (fout){
-
-		fout << "bucket\tnumber\n";
-		for(uint32_t i = 0; i < htableSize; i++){
-			HashtableBucket* bucket = buckets[i];
-			if (bucket == 0) count = 0;
-			else{
-				count++;
-				while(bucket->next != 0){
-					count++;
-					bucket = (HashtableBucket*)bucket->next;
-					}
-			}
-			fout << i+1 << "\t" << count  << "\n";
-			count =0;
-		}
-		fout.close();
-		snapshotWritten = true;
-	}
-	else {
-	DPRINTF_INFO("unable to open file to write Hashtable\n");
-	}
+	flowTable->remove(bucket->hash, bucket);
+	bucket->inTable = false;
 }
 
+std::string PacketHashtable::getTableStatisticsXML()
+{
+	ostringstream oss;
+	oss << "<tableSize>" << flowTable->getCapacity() << "</tableSize>";
+	oss << "<tableResizes>" << flowTable->statResizes << "</tableResizes>";
+	oss << "<resizeInProgress>" << (flowTable->isResizing() ? 1 : 0) << "</resizeInProgress>";
+	double probes = flowTable->statLookups ? (double)flowTable->statProbes/flowTable->statLookups : 0;
+	oss << "<avgProbesPerLookup>" << probes << "</avgProbesPerLookup>";
+	return oss.str();
+}
@@ -25,6 +25,8 @@
 #include "Rule.hpp"
 #include "modules/packet/Packet.h"
 #include "BaseHashtable.h"
+#include "FlowTable.h"
+#include "common/FlowHash.h"
 #include <iostream>
 #include <fstream>
 
@@ -125,9 +127,13 @@ private:
 
 	ExpHelperTable expHelperTable;
 
-	bool snapshotWritten; /**< set to true, if snapshot of hashtable was already written */
+	FlowTable* flowTable; /**< maps flow keys (concatenated raw packet key fields) to buckets */
+	uint32_t flowKeyLength; /**< length of a flow key in bytes */
+	IpfixRecord::Data* flowKey; /**< temporary storage for flow key of current packet */
+	IpfixRecord::Data* revFlowKey; /**< temporary storage for reverse flow key of current packet */
+	FlowHash flowHash; /**< hash function for flow keys */
+	bool symmetricHash; /**< if true, forward and reverse flow key of a biflow get the same hash value */
 
-	void snapshotHashtable();
 	void buildExpHelperTable();
 
 	static void copyDataEqualLengthNoMod(CopyFuncParameters* cfp);
@@ -147,14 +153,14 @@ private:
 									  const ExpFieldData* efd, bool firstpacket, bool onlyinit);
 	void (*getCopyDataFunction(const ExpFieldData* efd))(CopyFuncParameters*);
 	void fillExpFieldData(ExpFieldData* efd, TemplateInfo::FieldInfo* hfi, Rule::Field::Modifier fieldModifier, uint16_t index);
-	uint32_t calculateHash(const IpfixRecord::Data* data);
-	uint32_t calculateHashRev(const IpfixRecord::Data* data);
+	void buildFlowKey(const Packet* p, IpfixRecord::Data* key);
+	void buildFlowKeyRev(const Packet* p, IpfixRecord::Data* key);
+	uint32_t calculateHash(const IpfixRecord::Data* key);
+	uint32_t calculateHashSymmetric(const IpfixRecord::Data* key, const IpfixRecord::Data* revKey);
 	boost::shared_array<IpfixRecord::Data> buildBucketData(Packet* p);
 	void aggregateField(const ExpFieldData* efd, HashtableBucket* hbucket,
 					    const IpfixRecord::Data* deltaData, IpfixRecord::Data* data);
 	void aggregateFlow(HashtableBucket* bucket, const Packet* p, bool reverse);
-	bool equalFlow(IpfixRecord::Data* bucket, const Packet* p);
-	bool equalFlowRev(IpfixRecord::Data* bucket, const Packet* p);
 	void createMaskedField(IpfixRecord::Data* address, uint8_t imask);
 	void createMaskedFields( Packet* p);
 	void updatePointers(const Packet* p);
@@ -165,9 +171,14 @@ private:
 	bool mustExpireBucket(const HashtableBucket* bucket, const Packet* p);
 	void destroyExpFieldData(ExpFieldData* efd, int numFields); // TODO: Do we need this?
 
+protected:
+	virtual void removeBucket(HashtableBucket* bucket);
+	virtual std::string getTableStatisticsXML();
+
 public:
 	PacketHashtable(Source<IpfixRecord*>* recordsource, Rule* rule,
-			uint16_t inactiveTimeout, uint16_t activeTimeout, uint8_t hashbits);
+			uint16_t inactiveTimeout, uint16_t activeTimeout, uint8_t hashbits,
+			FlowHash::Engine hashFunction = FlowHash::DEFAULT_ENGINE, bool symmetricHash = true);
 	virtual ~PacketHashtable();
 
 	void aggregatePacket(Packet* p);
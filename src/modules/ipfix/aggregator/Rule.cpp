@@ -90,6 +90,14 @@ void Rule::initialize()
 	}
 }
 
+/**
+ * @returns types of protocols which may be aggregated by this rule, valid after initialize()
+ */
+Packet::IPProtocolType Rule::getValidProtocols() const
+{
+	return validProtocols;
+}
+
 const char* modifier2string(Rule::Field::Modifier i) {
 	static char s[16];
 	if (i == Rule::Field::DISCARD) return "discard";
@@ -229,7 +237,8 @@ int matchesIPv4Pattern(const InformationElement::IeInfo* dataType, const IpfixRe
 	uint32_t daddr = getIPv4Address(dataType, data);
 	uint32_t paddr = getIPv4Address(patternType, pattern);
 
-	return ((daddr >> pmaski) == (paddr >> pmaski));
+	/* A /0 pattern matches all addresses, shifting by 32 bits is undefined */
+	return (pmaski >= 32) || ((daddr >> pmaski) == (paddr >> pmaski));
 }
 
 /**
@@ -326,7 +335,7 @@ bool Rule::ExptemplateDataMatches(const Packet* p)
 					uint32_t daddr = getIPv4Address(&fi.type, field_data);
 					uint32_t paddr = getIPv4Address(&ruleField->type, ruleField->pattern);
 
-					if ((daddr >> pmaski) != (paddr >> pmaski))
+					if ((pmaski < 32) && ((daddr >> pmaski) != (paddr >> pmaski)))
 						return false;
 					break;
 				}
@@ -346,7 +355,7 @@ bool Rule::ExptemplateDataMatches(const Packet* p)
 					uint32_t daddr = getIPv4Address( &fi.type, field_data);
 					uint32_t paddr = getIPv4Address(&ruleField->type, ruleField->pattern);
 
-					if ((daddr >> pmaski) != (paddr >> pmaski))
+					if ((pmaski < 32) && ((daddr >> pmaski) != (paddr >> pmaski)))
 						return false;
 					break;
 				}
@@ -391,7 +400,6 @@ int Rule::dataRecordMatches(IpfixDataRecord* record) {
 	int i;
 	TemplateInfo::FieldInfo* recordField;
 	IpfixRecord::Data* recordData = record->data;
-	boost::shared_ptr<TemplateInfo> dataTemplateInfo = record->templateInfo;
 
 	/* for all patterns of this rule, check if they are matched */
 	for(i = 0; i < fieldCount; i++) {
@@ -403,15 +411,15 @@ int Rule::dataRecordMatches(IpfixDataRecord* record) {
 
 		if(ruleField->pattern) {
 
-			recordField = dataTemplateInfo->getFieldInfo(ruleField->type);
+			recordField = record->getFieldInfo(ruleField->type);
 			if (recordField) {
 				/* corresponding data field found, check if it matches. If it doesn't the whole rule cannot be matched */
 				if (!matchesPattern(&recordField->type, (recordData + recordField->offset), &ruleField->type, ruleField->pattern)) return 0;
 				if ((ruleField->type.enterprise == 0) && (ruleField->type.length == 5)) {
 					if (ruleField->type.id == IPFIX_TYPEID_sourceIPv4Address) {
-						if(!checkMask(dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_sourceIPv4PrefixLength, 0), recordData, ruleField)) return 0;
+						if(!checkMask(record->getFieldInfo(IPFIX_TYPEID_sourceIPv4PrefixLength, 0), recordData, ruleField)) return 0;
 					} else if (ruleField->type.id == IPFIX_TYPEID_destinationIPv4Address) {
-						if(!checkMask(dataTemplateInfo->getFieldInfo(IPFIX_TYPEID_destinationIPv4PrefixLength, 0), recordData, ruleField)) return 0;
+						if(!checkMask(record->getFieldInfo(IPFIX_TYPEID_destinationIPv4PrefixLength, 0), recordData, ruleField)) return 0;
 					}
 				}
 				continue;
@@ -423,13 +431,13 @@ int Rule::dataRecordMatches(IpfixDataRecord* record) {
 		}
 		/* if a non-discarding rule field specifies no pattern, check at least if the data field exists */
 		else if (ruleField->modifier != Rule::Field::DISCARD) {
-			recordField = dataTemplateInfo->getFieldInfo(ruleField->type);
+			recordField = record->getFieldInfo(ruleField->type);
 			if (recordField) continue;
 
 			/* in the case of biflow, we also check the reverse direction */
 			if (biflowAggregation && ruleField->type.existsReverseDirection()) {
 				InformationElement::IeInfo revie = ruleField->type.getReverseDirection();
-				recordField = dataTemplateInfo->getFieldInfo(revie);
+				recordField = record->getFieldInfo(revie);
 				if (recordField) continue;
 			}
 
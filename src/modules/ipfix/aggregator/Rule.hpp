@@ -81,6 +81,7 @@ class Rule : private PrintHelpers {
 		void initialize();
 		void print();
 		bool ExptemplateDataMatches(const Packet* p);
+		Packet::IPProtocolType getValidProtocols() const;
 		int dataRecordMatches(IpfixDataRecord* record);
 		friend bool operator==(const Rule &rhs, const Rule &lhs);
 		friend bool operator!=(const Rule &rhs, const Rule &lhs);
@@ -97,4 +98,7 @@ class Rule : private PrintHelpers {
 		uint16_t patternFieldsLen;
 };
 
+uint8_t getIPv4IMask(const InformationElement::IeInfo* type, const IpfixRecord::Data* data);
+uint32_t getIPv4Address(const InformationElement::IeInfo* type, const IpfixRecord::Data* data);
+
 #endif
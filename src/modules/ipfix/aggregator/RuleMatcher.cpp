@@ -0,0 +1,314 @@
+/*
+ * Vermont Aggregator Subsystem
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "RuleMatcher.h"
+
+#include "common/msg.h"
+
+#include <algorithm>
+#include <netinet/in.h>
+#include <string.h>
+
+
+void RuleMatcher::RuleSet::clear()
+{
+	memset(w, 0, sizeof(w));
+}
+
+void RuleMatcher::RuleSet::set(uint32_t rule)
+{
+	w[rule/64] |= (uint64_t)1 << (rule%64);
+}
+
+void RuleMatcher::RuleSet::add(const RuleSet& other)
+{
+	for (uint32_t i = 0; i < WORDS; i++) w[i] |= other.w[i];
+}
+
+void RuleMatcher::RuleSet::intersect(const RuleSet& other)
+{
+	for (uint32_t i = 0; i < WORDS; i++) w[i] &= other.w[i];
+}
+
+
+RuleMatcher::PrefixTrie::PrefixTrie()
+{
+	TrieNode root;
+	root.child[0] = root.child[1] = -1;
+	root.rules.clear();
+	nodes.push_back(root);
+}
+
+/**
+ * adds rule to all addresses whose first length bits equal those of prefix
+ */
+void RuleMatcher::PrefixTrie::insert(uint32_t prefix, uint8_t length, uint32_t rule)
+{
+	uint32_t node = 0;
+	for (uint8_t i = 0; i < length; i++) {
+		uint32_t bit = (prefix >> (31-i)) & 1;
+		if (nodes[node].child[bit] < 0) {
+			TrieNode n;
+			n.child[0] = n.child[1] = -1;
+			n.rules.clear();
+			nodes.push_back(n);
+			nodes[node].child[bit] = nodes.size()-1;
+		}
+		node = nodes[node].child[bit];
+	}
+	nodes[node].rules.set(rule);
+}
+
+/**
+ * adds rule to all addresses
+ */
+void RuleMatcher::PrefixTrie::addWildcard(uint32_t rule)
+{
+	nodes[0].rules.set(rule);
+}
+
+/**
+ * @param addr address in host byte order
+ * @param result is set to all rules with a prefix matching addr
+ */
+void RuleMatcher::PrefixTrie::lookup(uint32_t addr, RuleSet& result) const
+{
+	const TrieNode* node = &nodes[0];
+	result = node->rules;
+	for (uint32_t i = 0; i < 32; i++) {
+		int32_t c = node->child[(addr >> (31-i)) & 1];
+		if (c < 0) break;
+		node = &nodes[c];
+		result.add(node->rules);
+	}
+}
+
+
+RuleMatcher::RangeTable::RangeTable()
+{
+	wildcard.clear();
+}
+
+void RuleMatcher::RangeTable::addRange(uint16_t start, uint16_t end, uint32_t rule)
+{
+	Range r;
+	r.start = start;
+	r.end = end;
+	r.rule = rule;
+	ranges.push_back(r);
+}
+
+void RuleMatcher::RangeTable::addWildcard(uint32_t rule)
+{
+	wildcard.set(rule);
+}
+
+/**
+ * splits port space into elementary intervals which are not divided by any range
+ * and determines matching rules for each of them
+ */
+void RuleMatcher::RangeTable::compile()
+{
+	boundaries.clear();
+	boundaries.push_back(0);
+	for (size_t i = 0; i < ranges.size(); i++) {
+		boundaries.push_back(ranges[i].start);
+		boundaries.push_back((uint32_t)ranges[i].end+1);
+	}
+	std::sort(boundaries.begin(), boundaries.end());
+	boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+	if (boundaries.back() > 0xFFFF) boundaries.pop_back();
+
+	sets.assign(boundaries.size(), wildcard);
+	for (size_t i = 0; i < ranges.size(); i++) {
+		if (ranges[i].start > ranges[i].end) continue;
+		size_t j = std::lower_bound(boundaries.begin(), boundaries.end(), (uint32_t)ranges[i].start)-boundaries.begin();
+		for (; j < boundaries.size() && boundaries[j] <= ranges[i].end; j++) {
+			sets[j].set(ranges[i].rule);
+		}
+	}
+}
+
+const RuleMatcher::RuleSet& RuleMatcher::RangeTable::lookup(uint16_t port) const
+{
+	size_t i = std::upper_bound(boundaries.begin(), boundaries.end(), (uint32_t)port)-boundaries.begin();
+	return sets[i-1];
+}
+
+
+/**
+ * compiles patterns of given rules
+ * the rules must have been initialized and must not be changed while this object is used
+ */
+RuleMatcher::RuleMatcher(Rules* rules)
+	: rules(rules),
+	  uncompiledRules(0)
+{
+	for (uint32_t i = 0; i < 256; i++) {
+		protocolTypes[i].clear();
+		protocolIds[i].clear();
+	}
+	fullCheck.clear();
+
+	for (uint32_t i = 0; i < rules->count; i++) {
+		compileRule(i);
+	}
+	srcPorts.compile();
+	dstPorts.compile();
+
+	if (uncompiledRules > 0) {
+		msg(LOG_NOTICE, "RuleMatcher: %u of %zu rules contain patterns which are matched field by field", uncompiledRules, rules->count);
+	}
+}
+
+void RuleMatcher::compileRule(uint32_t index)
+{
+	Rule* rule = rules->rule[index];
+	bool srcAddr = false, dstAddr = false, srcPort = false, dstPort = false, protoId = false;
+	bool uncompiled = false;
+
+	for (uint32_t v = 0; v < 256; v++) {
+		if (v & rule->getValidProtocols()) protocolTypes[v].set(index);
+	}
+
+	for (int i = 0; i < rule->fieldCount; i++) {
+		Rule::Field* f = rule->field[i];
+		if (!f->pattern) continue;
+		if (f->type.enterprise != 0) {
+			uncompiled = true;
+			continue;
+		}
+
+		switch (f->type.id) {
+			case IPFIX_TYPEID_sourceIPv4Address:
+			case IPFIX_TYPEID_destinationIPv4Address:
+				{
+					bool& seen = (f->type.id == IPFIX_TYPEID_sourceIPv4Address) ? srcAddr : dstAddr;
+					if (seen) {
+						uncompiled = true;
+						break;
+					}
+					seen = true;
+					uint8_t imask = getIPv4IMask(&f->type, f->pattern);
+					uint8_t length = imask < 32 ? 32-imask : 0;
+					uint32_t prefix = getIPv4Address(&f->type, f->pattern);
+					PrefixTrie& trie = (f->type.id == IPFIX_TYPEID_sourceIPv4Address) ? srcAddresses : dstAddresses;
+					trie.insert(prefix, length, index);
+					break;
+				}
+			case IPFIX_TYPEID_sourceTransportPort:
+			case IPFIX_TYPEID_destinationTransportPort:
+				{
+					bool& seen = (f->type.id == IPFIX_TYPEID_sourceTransportPort) ? srcPort : dstPort;
+					if (seen || (f->type.length != 2 && f->type.length % 4 != 0)) {
+						uncompiled = true;
+						break;
+					}
+					seen = true;
+					RangeTable& table = (f->type.id == IPFIX_TYPEID_sourceTransportPort) ? srcPorts : dstPorts;
+					if (f->type.length == 2) {
+						uint16_t port = (f->pattern[0] << 8) + f->pattern[1];
+						table.addRange(port, port, index);
+					} else {
+						for (uint32_t j = 0; j < f->type.length; j += 4) {
+							table.addRange((f->pattern[j] << 8) + f->pattern[j+1], (f->pattern[j+2] << 8) + f->pattern[j+3], index);
+						}
+					}
+					break;
+				}
+			case IPFIX_TYPEID_protocolIdentifier:
+				if (protoId || f->type.length != 1) {
+					uncompiled = true;
+					break;
+				}
+				protoId = true;
+				protocolIds[f->pattern[0]].set(index);
+				break;
+			default:
+				uncompiled = true;
+				break;
+		}
+	}
+
+	// rules without a pattern for a field match all of its values
+	if (!srcAddr) srcAddresses.addWildcard(index);
+	if (!dstAddr) dstAddresses.addWildcard(index);
+	if (!srcPort) srcPorts.addWildcard(index);
+	if (!dstPort) dstPorts.addWildcard(index);
+	if (!protoId) {
+		for (uint32_t v = 0; v < 256; v++) protocolIds[v].set(index);
+	}
+
+	if (uncompiled) {
+		fullCheck.set(index);
+		uncompiledRules++;
+	}
+}
+
+/**
+ * determines all rules matching the given packet
+ * @param result receives indices of matching rules in ascending order, must have space for all rules
+ * @returns number of matching rules
+ */
+uint32_t RuleMatcher::getMatchingRules(const Packet* p, uint16_t* result) const
+{
+	RuleSet candidates = protocolTypes[p->ipProtocolType & 0xFF];
+	candidates.intersect(protocolIds[p->data.netHeader[9]]);
+
+	RuleSet addrRules;
+	uint32_t addr;
+	memcpy(&addr, p->data.netHeader+12, 4);
+	srcAddresses.lookup(ntohl(addr), addrRules);
+	candidates.intersect(addrRules);
+	memcpy(&addr, p->data.netHeader+16, 4);
+	dstAddresses.lookup(ntohl(addr), addrRules);
+	candidates.intersect(addrRules);
+
+	// ports of other protocols are matched as zero, just as in Rule::ExptemplateDataMatches()
+	uint16_t sport = 0, dport = 0;
+	if (p->ipProtocolType == Packet::TCP || p->ipProtocolType == Packet::UDP) {
+		sport = (p->transportHeader[0] << 8) + p->transportHeader[1];
+		dport = (p->transportHeader[2] << 8) + p->transportHeader[3];
+	}
+	candidates.intersect(srcPorts.lookup(sport));
+	candidates.intersect(dstPorts.lookup(dport));
+
+	uint32_t n = 0;
+	for (uint32_t i = 0; i < WORDS; i++) {
+		uint64_t bits = candidates.w[i];
+		while (bits) {
+			uint32_t index = i*64+__builtin_ctzll(bits);
+			bits &= bits-1;
+			if ((fullCheck.w[i] >> (index%64)) & 1) {
+				if (!rules->rule[index]->ExptemplateDataMatches(p)) continue;
+			}
+			result[n++] = index;
+		}
+	}
+	return n;
+}
+
+/**
+ * @returns number of rules which need to be checked using Rule::ExptemplateDataMatches()
+ */
+uint32_t RuleMatcher::getUncompiledRuleCount() const
+{
+	return uncompiledRules;
+}
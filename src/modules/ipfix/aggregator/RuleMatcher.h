@@ -0,0 +1,120 @@
+/*
+ * Vermont Aggregator Subsystem
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef RULEMATCHER_H_
+#define RULEMATCHER_H_
+
+#include "Rules.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Precompiled form of the patterns of a rule set, determines all rules matching a packet in one pass.
+ *
+ * Every supported pattern dimension yields a set of rules (as bitmap) for each packet:
+ *  - protocol types valid for the rules and protocolIdentifier patterns: tables indexed by value
+ *  - source and destination IPv4 address patterns: binary prefix tries, the sets of all nodes
+ *    on the path of the address are combined
+ *  - source and destination port patterns: sorted elementary intervals of all port ranges
+ * Rules without a pattern in a dimension are contained in all of its sets. The intersection of
+ * all sets contains the matching rules.
+ * Rules with patterns which cannot be compiled (e.g. MAC addresses, TCP flags or several patterns
+ * for the same field) are additionally checked with Rule::ExptemplateDataMatches(), the compiled
+ * dimensions are then used as prefilter only.
+ */
+class RuleMatcher
+{
+public:
+	RuleMatcher(Rules* rules);
+
+	uint32_t getMatchingRules(const Packet* p, uint16_t* result) const;
+	uint32_t getUncompiledRuleCount() const;
+
+private:
+	static const uint32_t WORDS = (MAX_RULES+63)/64;
+
+	struct RuleSet {
+		uint64_t w[WORDS];
+
+		void clear();
+		void set(uint32_t rule);
+		void add(const RuleSet& other);
+		void intersect(const RuleSet& other);
+	};
+
+	struct TrieNode {
+		int32_t child[2];
+		RuleSet rules;
+	};
+
+	/**
+	 * matches one IPv4 address field against prefix patterns
+	 */
+	class PrefixTrie
+	{
+	public:
+		PrefixTrie();
+		void insert(uint32_t prefix, uint8_t length, uint32_t rule);
+		void addWildcard(uint32_t rule);
+		void lookup(uint32_t addr, RuleSet& result) const;
+
+	private:
+		std::vector<TrieNode> nodes;
+	};
+
+	/**
+	 * matches one port field against port ranges
+	 */
+	class RangeTable
+	{
+	public:
+		RangeTable();
+		void addRange(uint16_t start, uint16_t end, uint32_t rule);
+		void addWildcard(uint32_t rule);
+		void compile();
+		const RuleSet& lookup(uint16_t port) const;
+
+	private:
+		struct Range {
+			uint16_t start;
+			uint16_t end;
+			uint32_t rule;
+		};
+		std::vector<Range> ranges;
+		RuleSet wildcard;
+		std::vector<uint32_t> boundaries; /**< start of each elementary interval, first one is 0 */
+		std::vector<RuleSet> sets; /**< rules matching elementary interval with same index */
+	};
+
+	Rules* rules;
+	RuleSet protocolTypes[256]; /**< rules valid for Packet::ipProtocolType */
+	RuleSet protocolIds[256]; /**< rules matching protocolIdentifier */
+	PrefixTrie srcAddresses;
+	PrefixTrie dstAddresses;
+	RangeTable srcPorts;
+	RangeTable dstPorts;
+	RuleSet fullCheck; /**< rules with patterns which are not (completely) compiled */
+	uint32_t uncompiledRules;
+
+	void compileRule(uint32_t index);
+};
+
+#endif /*RULEMATCHER_H_*/
@@ -36,7 +36,8 @@ IpfixDbWriterCfg* IpfixDbWriterCfg::create(XMLElement* e)
 
 IpfixDbWriterCfg::IpfixDbWriterCfg(XMLElement* elem)
     : CfgHelper<IpfixDbWriterSQL, IpfixDbWriterCfg>(elem, "ipfixDbWriter"),
-      port(0), bufferRecords(30), observationDomainId(0), tablePrefix("f"), useLegacyNames(false)
+      port(0), bufferRecords(30), observationDomainId(0), tablePrefix("f"), useLegacyNames(false),
+      copyMode(false), copyFlushInterval(1000), copyMaxBacklog(0)
 {
     if (!elem) return;
 
@@ -68,6 +69,12 @@ IpfixDbWriterCfg::IpfixDbWriterCfg(XMLElement* elem)
 			observationDomainId = getInt("observationDomainId");
 		} else if (e->matches("tablePrefix")) {
 			tablePrefix = e->getFirstText();
+		} else if (e->matches("copyMode")) {
+			copyMode = getBool("copyMode");
+		} else if (e->matches("copyFlushInterval")) {
+			copyFlushInterval = getTimeInUnit("copyFlushInterval", mSEC, 1000);
+		} else if (e->matches("copyMaxBacklog")) {
+			copyMaxBacklog = getInt("copyMaxBacklog");
 		} else if (e->matches("next")) { // ignore next
 		} else {
 			msg(LOG_CRIT, "Unknown IpfixDbWriter config statement %s\n", e->getName().c_str());
@@ -79,6 +86,8 @@ IpfixDbWriterCfg::IpfixDbWriterCfg(XMLElement* elem)
 	if (port==0) THROWEXCEPTION("IpfixDbWriterCfg: port not set in configuration!");
 	if (dbname=="") THROWEXCEPTION("IpfixDbWriterCfg: dbname not set in configuration!");
 	if (user=="") THROWEXCEPTION("IpfixDbWriterCfg: username not set in configuration!");
+	if (copyMode && databaseType != "postgres") THROWEXCEPTION("IpfixDbWriterCfg: copyMode is only supported for dbType postgres");
+	if (copyMode && copyFlushInterval == 0) THROWEXCEPTION("IpfixDbWriterCfg: copyFlushInterval must be greater than zero");
 }
 
 void IpfixDbWriterCfg::readColumns(XMLElement* elem) {
@@ -116,7 +125,9 @@ IpfixDbWriterSQL* IpfixDbWriterCfg::createInstance()
 	} else if  (databaseType == "postgres") {
 
 #if defined(PG_SUPPORT_ENABLED)
-		instance = new IpfixDbWriterPg(databaseType.c_str(), hostname.c_str(), dbname.c_str(), user.c_str(), password.c_str(), port, observationDomainId, bufferRecords, colNames, useLegacyNames, tablePrefix.c_str());
+		IpfixDbWriterPg* writer = new IpfixDbWriterPg(databaseType.c_str(), hostname.c_str(), dbname.c_str(), user.c_str(), password.c_str(), port, observationDomainId, bufferRecords, colNames, useLegacyNames, tablePrefix.c_str());
+		if (copyMode) writer->enableCopyMode(copyFlushInterval, copyMaxBacklog);
+		instance = writer;
 #else
 		goto except;
 #endif
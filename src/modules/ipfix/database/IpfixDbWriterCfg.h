@@ -57,6 +57,9 @@ protected:
 	string tablePrefix; /**< prefix for database table names */
 	vector<string> colNames; /**< column names */
 	bool useLegacyNames;
+	bool copyMode; /**< write rows using COPY in a separate thread (postgres only) */
+	uint32_t copyFlushInterval; /**< maximum time in milliseconds a row is buffered in copy mode */
+	uint32_t copyMaxBacklog; /**< maximum number of buffered rows in copy mode, 0 for 10 times bufferRecords */
 
 	void readColumns(XMLElement* elem);
 	IpfixDbWriterCfg(XMLElement*);
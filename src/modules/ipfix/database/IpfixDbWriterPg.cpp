@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <sstream>
 #include <algorithm>
+#include <sys/time.h>
 #include <boost/format.hpp>
 
 using namespace std;
@@ -49,18 +50,9 @@ void IpfixDbWriterPg::connectToDB()
     // close (in the case that it was already connected)
     if (conn) PQfinish(conn);
 
+    conn = openConnection();
+    if (!conn) return;
 
-    /**Connect to Database*/
-    ostringstream conninfo;
-    conninfo << "host='" << hostName << "' port='" << portNum << "' ";
-    conninfo << "dbname='" << dbName << "' user='" << userName<< "' ";
-    conninfo << "password='" << password << "'";// sslmode=require";
-    DPRINTF_INFO("using connection string '%s'", conninfo.str().c_str());
-    conn = PQconnectdb(conninfo.str().c_str());
-    if (PQstatus(conn) != CONNECTION_OK) {
-    	msg(LOG_CRIT, "IpfixDbWriterPg: Connection to database failed, error: %s", PQerrorMessage(conn));
-    	return;
-    }
     /**create table exporter*/
     if (createExporterTable()!=0) return;
 
@@ -68,6 +60,25 @@ void IpfixDbWriterPg::connectToDB()
 }
 
 
+/**
+ * opens a new connection to the database
+ * @returns NULL if the connection failed
+ */
+PGconn* IpfixDbWriterPg::openConnection()
+{
+    ostringstream conninfo;
+    conninfo << "host='" << hostName << "' port='" << portNum << "' ";
+    conninfo << "dbname='" << dbName << "' user='" << userName<< "' ";
+    conninfo << "password='" << password << "'";// sslmode=require";
+    DPRINTF_INFO("using connection string '%s'", conninfo.str().c_str());
+    PGconn* c = PQconnectdb(conninfo.str().c_str());
+    if (PQstatus(c) != CONNECTION_OK) {
+    	msg(LOG_CRIT, "IpfixDbWriterPg: Connection to database failed, error: %s", PQerrorMessage(c));
+    	PQfinish(c);
+    	return NULL;
+    }
+    return c;
+}
 
 int IpfixDbWriterPg::createExporterTable()
 {
@@ -325,21 +336,359 @@ void IpfixDbWriterPg::parseIpfixMacAddress(IpfixRecord::Data* data, string* pars
     *parsedData = boost::str(boost::format("'%02x:%02x:%02x:%02x:%02x:%02x'") % (int) data[0] % (int) data[1] % (int) data[2] % (int) data[3] % (int) data[4] % (int) data[5]);
 }
 
+/**
+ * Switches to COPY mode: rows are encoded in the binary format of PostgreSQL's COPY command
+ * and written by a separate thread, so that a slow database does not stall the module thread.
+ * Two batches are used alternately: while copyThread writes one of them, new rows are appended
+ * to the other one. copyThread takes the filled batch as soon as it contains maxStatements rows or
+ * when flushInterval has elapsed. If the database cannot keep up, the batch grows beyond
+ * maxStatements up to maxBacklog rows, further rows are dropped and counted in the statistics.
+ * @param flushInterval maximum time in milliseconds rows are buffered
+ * @param maxBacklog maximum number of buffered rows, 0 for 10 times maxStatements
+ */
+void IpfixDbWriterPg::enableCopyMode(uint32_t flushInterval, uint32_t maxBacklog)
+{
+	copyMode = true;
+	copyFlushInterval = flushInterval;
+	copyMaxBacklog = maxBacklog ? maxBacklog : 10*insertBuffer.maxRows;
+	if (copyMaxBacklog < insertBuffer.maxRows) copyMaxBacklog = insertBuffer.maxRows;
+
+	copyColumns.clear();
+	for (vector<Column>::iterator col = tableColumns.begin(); col != tableColumns.end(); col++) {
+		CopyColumn c;
+		c.ipfixType = col->ipfixId == EXPORTERID ? IPFIX_TYPE_unsigned16 : ipfix_id_lookup(col->ipfixId, col->enterprise)->type;
+		c.type = PgCopyBuffer::getType(c.ipfixType);
+		copyColumns.push_back(c);
+	}
+
+	msg(LOG_NOTICE, "IpfixDbWriterPg: writing rows using COPY, flush interval %u ms, backlog %u rows",
+			copyFlushInterval, copyMaxBacklog);
+}
+
+void IpfixDbWriterPg::onDataRecord(IpfixDataRecord* record)
+{
+	if (!copyMode) {
+		IpfixDbWriterSQL::onDataRecord(record);
+		return;
+	}
+
+	// only treat non-Options Data Records (although we cannot be sure that there is a Flow inside)
+	if((record->templateInfo->setId != TemplateInfo::NetflowTemplate)
+		&& (record->templateInfo->setId != TemplateInfo::IpfixTemplate)) {
+		record->removeReference();
+		return;
+	}
+
+	if (dbError) connectToDB();
+	if (dbError) {
+		pthread_mutex_lock(&copyMutex);
+		statCopyDropped++;
+		pthread_mutex_unlock(&copyMutex);
+	} else {
+		IpfixRecord::SourceID* sourceID = record->sourceID.get();
+		/* overwrite sourceid if defined */
+		if (srcId.observationDomainId != 0 || sourceID == NULL) {
+			sourceID = &srcId;
+		}
+		encodeCopyRow(sourceID, record->templateInfo.get(), record->getFieldInfoArray(), record->data);
+	}
+
+	record->removeReference();
+}
+
+/**
+ * reads an unsigned integer with reduced size encoding
+ */
+static uint64_t readUnsigned(const IpfixRecord::Data* data, uint16_t length)
+{
+	uint64_t acc = 0;
+	for (uint16_t i = 0; i < length && i < 8; i++) {
+		acc = (acc << 8) | data[i];
+	}
+	return acc;
+}
+
+/**
+ * encodes the record as binary COPY row and appends it to fillBatch
+ * same mapping of fields to columns as in IpfixDbWriterSQL::fillInsertRow(), but missing
+ * values of non-numeric columns are stored as NULL
+ */
+void IpfixDbWriterPg::encodeCopyRow(IpfixRecord::SourceID* sourceID, TemplateInfo* dataTemplateInfo,
+		TemplateInfo::FieldInfo* fieldInfo, IpfixRecord::Data* data)
+{
+	uint64_t flowstart = 0;
+
+	copyRow.clear();
+	copyRow.beginRow(numberOfColumns);
+
+	for (uint32_t i = 0; i < numberOfColumns; i++) {
+		Column* col = &tableColumns[i];
+		const CopyColumn& cc = copyColumns[i];
+		if (col->ipfixId == EXPORTERID) {
+			copyRow.addInteger(cc.type, getExporterID(sourceID));
+			continue;
+		}
+
+		uint64_t value = 0;
+		int k;
+		for (k = 0; k < dataTemplateInfo->fieldCount; k++) {
+			if (fieldInfo[k].type.enterprise == col->enterprise && fieldInfo[k].type.id == col->ipfixId) {
+				copyRow.addIpfixValue(cc.type, cc.ipfixType, data+fieldInfo[k].offset, fieldInfo[k].type.length);
+				value = readUnsigned(data+fieldInfo[k].offset, fieldInfo[k].type.length);
+				break;
+			}
+		}
+		if (k == dataTemplateInfo->fieldCount) {
+			// check for time-related alternative fields, then use default value
+			string parsedData;
+			checkTimeAlternatives(col, dataTemplateInfo, fieldInfo, data, &parsedData);
+			if (!parsedData.empty()) {
+				value = strtod(parsedData.c_str(), NULL);
+				copyRow.addInteger(cc.type, value);
+			} else if (PgCopyBuffer::isNumeric(cc.type)) {
+				value = col->defaultValue;
+				copyRow.addInteger(cc.type, col->defaultValue);
+			} else {
+				copyRow.addNull();
+			}
+		}
+
+		// we need to extract the flow start time for determining the correct DB table
+		if (col->enterprise == 0) {
+			if (col->ipfixId == IPFIX_TYPEID_flowStartSeconds) {
+				flowstart = value*1000;
+			} else if (col->ipfixId == IPFIX_TYPEID_flowStartMilliseconds && flowstart == 0) {
+				flowstart = value;
+			}
+		} else if (col->enterprise == IPFIX_PEN_reverse && flowstart == 0) {
+			if (col->ipfixId == IPFIX_TYPEID_flowStartMilliseconds || col->ipfixId == IPFIX_TYPEID_flowEndMilliseconds) {
+				flowstart = value;
+			}
+		}
+	}
+
+	if (!checkCurrentTable(flowstart) && !setCurrentTable(flowstart)) {
+		msg(LOG_ERR, "failed to change table, dropping record");
+		pthread_mutex_lock(&copyMutex);
+		statCopyDropped++;
+		pthread_mutex_unlock(&copyMutex);
+		return;
+	}
+
+	pthread_mutex_lock(&copyMutex);
+	if (fillBatch->rowCount >= copyMaxBacklog) {
+		statCopyDropped++;
+		pthread_mutex_unlock(&copyMutex);
+		return;
+	}
+	if (fillBatch->segments.empty() || fillBatch->segments.back().table != curTable.name) {
+		CopySegment segment;
+		segment.table = curTable.name;
+		segment.offset = fillBatch->rows.size();
+		segment.length = 0;
+		segment.rowCount = 0;
+		fillBatch->segments.push_back(segment);
+	}
+	CopySegment& segment = fillBatch->segments.back();
+	fillBatch->rows.append(copyRow);
+	segment.length += copyRow.size();
+	segment.rowCount++;
+	fillBatch->rowCount++;
+	if (fillBatch->rowCount > statCopyBacklogPeak) statCopyBacklogPeak = fillBatch->rowCount;
+	if (fillBatch->rowCount == insertBuffer.maxRows) {
+		pthread_cond_signal(&copyCond);
+	} else if (fillBatch->rowCount == insertBuffer.maxRows+1) {
+		// copyThread did not take the full batch yet
+		statCopyStalls++;
+	}
+	pthread_mutex_unlock(&copyMutex);
+}
+
+/**
+ * writes the rows of one segment using a single COPY command on copyConn
+ * @returns false if the rows could not be written
+ */
+bool IpfixDbWriterPg::writeCopySegment(const CopyBatch& batch, const CopySegment& segment)
+{
+	static const size_t CHUNK_SIZE = 1024*1024;
+
+	if (copyConn && PQstatus(copyConn) != CONNECTION_OK) {
+		PQfinish(copyConn);
+		copyConn = NULL;
+	}
+	if (!copyConn) {
+		copyConn = openConnection();
+		if (!copyConn) return false;
+	}
+
+	string sql = "COPY " + segment.table + " (" + tableColumnsString + ") FROM STDIN WITH (FORMAT binary)";
+	PGresult* res = PQexec(copyConn, sql.c_str());
+	if (PQresultStatus(res) != PGRES_COPY_IN) {
+		msg(LOG_ERR, "IpfixDbWriterPg: COPY into %s failed. Error: %s", segment.table.c_str(), PQerrorMessage(copyConn));
+		PQclear(res);
+		return false;
+	}
+	PQclear(res);
+
+	bool sent = PQputCopyData(copyConn, (const char*)PgCopyBuffer::HEADER, sizeof(PgCopyBuffer::HEADER)) == 1;
+	const char* rows = (const char*)batch.rows.data()+segment.offset;
+	for (size_t pos = 0; sent && pos < segment.length; pos += CHUNK_SIZE) {
+		size_t len = segment.length-pos < CHUNK_SIZE ? segment.length-pos : CHUNK_SIZE;
+		sent = PQputCopyData(copyConn, rows+pos, len) == 1;
+	}
+	if (sent) sent = PQputCopyData(copyConn, (const char*)PgCopyBuffer::TRAILER, sizeof(PgCopyBuffer::TRAILER)) == 1;
+	if (PQputCopyEnd(copyConn, sent ? NULL : "failed to send rows") != 1) sent = false;
+
+	bool ok = sent;
+	while ((res = PQgetResult(copyConn)) != NULL) {
+		if (PQresultStatus(res) != PGRES_COMMAND_OK) ok = false;
+		PQclear(res);
+	}
+	if (!ok) {
+		msg(LOG_ERR, "IpfixDbWriterPg: COPY of %u rows into %s failed. Error: %s", segment.rowCount,
+				segment.table.c_str(), PQerrorMessage(copyConn));
+	}
+	return ok;
+}
+
+/**
+ * thread which writes batches filled by encodeCopyRow() to the database
+ */
+void IpfixDbWriterPg::copyWriter()
+{
+	registerCurrentThread();
+
+	pthread_mutex_lock(&copyMutex);
+	while (true) {
+		if (!copyExit && fillBatch->rowCount < insertBuffer.maxRows) {
+			struct timespec timeout;
+			addToCurTime(&timeout, copyFlushInterval);
+			pthread_cond_timedwait(&copyCond, &copyMutex, &timeout);
+		}
+		if (fillBatch->rowCount == 0) {
+			if (copyExit) break;
+			continue;
+		}
+
+		std::swap(fillBatch, writeBatch);
+		pthread_mutex_unlock(&copyMutex);
+
+		struct timeval start, end, diff;
+		gettimeofday(&start, 0);
+		uint32_t written = 0;
+		uint32_t failed = 0;
+		for (vector<CopySegment>::const_iterator seg = writeBatch->segments.begin(); seg != writeBatch->segments.end(); seg++) {
+			if (writeCopySegment(*writeBatch, *seg)) {
+				written += seg->rowCount;
+			} else {
+				failed++;
+				msg(LOG_ERR, "IpfixDbWriterPg: dropping %u rows", seg->rowCount);
+			}
+		}
+		gettimeofday(&end, 0);
+		timeval_subtract(&diff, &end, &start);
+		DPRINTF_INFO("wrote %u rows using COPY", written);
+
+		pthread_mutex_lock(&copyMutex);
+		statCopyRows += written;
+		statCopyDropped += writeBatch->rowCount-written;
+		statCopyBatches += writeBatch->segments.size();
+		statCopyFailed += failed;
+		statCopyTime += diff.tv_sec*1000000ULL+diff.tv_usec;
+		writeBatch->rows.clear();
+		writeBatch->segments.clear();
+		writeBatch->rowCount = 0;
+	}
+	pthread_mutex_unlock(&copyMutex);
+
+	unregisterCurrentThread();
+}
+
+void* IpfixDbWriterPg::copyThreadWrapper(void* instance)
+{
+	static_cast<IpfixDbWriterPg*>(instance)->copyWriter();
+	return 0;
+}
+
+void IpfixDbWriterPg::performStart()
+{
+	if (copyMode) {
+		// the module may be started again after performShutdown()
+		pthread_mutex_lock(&copyMutex);
+		copyExit = false;
+		pthread_mutex_unlock(&copyMutex);
+		copyThread.run(this);
+	}
+}
+
+/**
+ * writes all buffered rows and stops copyThread
+ */
+void IpfixDbWriterPg::performShutdown()
+{
+	pthread_mutex_lock(&copyMutex);
+	copyExit = true;
+	pthread_cond_signal(&copyCond);
+	pthread_mutex_unlock(&copyMutex);
+	copyThread.join();
+}
+
+void IpfixDbWriterPg::clearStatistics()
+{
+	pthread_mutex_lock(&copyMutex);
+	statCopyRows = 0;
+	statCopyDropped = 0;
+	statCopyBatches = 0;
+	statCopyFailed = 0;
+	statCopyStalls = 0;
+	statCopyBacklogPeak = fillBatch->rowCount;
+	statCopyTime = 0;
+	pthread_mutex_unlock(&copyMutex);
+}
+
+string IpfixDbWriterPg::getStatisticsXML(double interval)
+{
+	if (!copyMode) return "";
+
+	char buf[400];
+	pthread_mutex_lock(&copyMutex);
+	snprintf(buf, ARRAY_SIZE(buf), "<copyRows>%llu</copyRows><copyDroppedRows>%llu</copyDroppedRows><copyCommands>%llu</copyCommands><copyFailedCommands>%llu</copyFailedCommands><copyStalls>%u</copyStalls><copyBacklog>%u</copyBacklog><copyBacklogPeak>%u</copyBacklogPeak><copyTimePerRow>%.2f</copyTimePerRow>",
+			(long long unsigned)statCopyRows, (long long unsigned)statCopyDropped, (long long unsigned)statCopyBatches,
+			(long long unsigned)statCopyFailed, statCopyStalls, fillBatch->rowCount, statCopyBacklogPeak,
+			statCopyRows ? (double)statCopyTime/statCopyRows : 0.0);
+	pthread_mutex_unlock(&copyMutex);
+	return buf;
+}
+
 /***** Exported Functions ****************************************************/
 
 IpfixDbWriterPg::IpfixDbWriterPg(const char* dbType, const char* host, const char* db,
 		const char* user, const char* pw,
 		unsigned int port, uint16_t observationDomainId,
 		int maxStatements, vector<string> columns, bool legacyNames, const char* prefix)
-	: IpfixDbWriterSQL(dbType, host, db, user, pw, port, observationDomainId, maxStatements, columns, legacyNames, prefix), conn(0)
+	: IpfixDbWriterSQL(dbType, host, db, user, pw, port, observationDomainId, maxStatements, columns, legacyNames, prefix), conn(0),
+	  copyMode(false), copyFlushInterval(0), copyMaxBacklog(0),
+	  fillBatch(&copyBatches[0]), writeBatch(&copyBatches[1]), copyExit(false),
+	  statCopyRows(0), statCopyDropped(0), statCopyBatches(0), statCopyFailed(0),
+	  statCopyStalls(0), statCopyBacklogPeak(0), statCopyTime(0),
+	  copyConn(0), copyThread(IpfixDbWriterPg::copyThreadWrapper, "DbWriterCopy")
 {
+	pthread_mutex_init(&copyMutex, NULL);
+	pthread_cond_init(&copyCond, NULL);
+	copyBatches[0].rowCount = 0;
+	copyBatches[1].rowCount = 0;
+
 	connectToDB();
 }
 
 IpfixDbWriterPg::~IpfixDbWriterPg()
 {
+	performShutdown();
 	writeToDb();
+	if (copyConn) PQfinish(copyConn);
 	if (conn) PQfinish(conn);
+	pthread_cond_destroy(&copyCond);
+	pthread_mutex_destroy(&copyMutex);
 }
 
 
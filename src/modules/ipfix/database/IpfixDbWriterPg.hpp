@@ -30,10 +30,13 @@
 
 #include "IpfixDbCommon.hpp"
 #include "IpfixDbWriterSQL.hpp"
+#include "PgCopyBuffer.hpp"
 #include "../IpfixRecordDestination.h"
 #include "common/ipfixlolib/ipfix.h"
 #include "common/ipfixlolib/ipfixlolib.h"
+#include "common/Thread.h"
 #include <libpq-fe.h>
+#include <pthread.h>
 #include <netinet/in.h>
 #include <time.h>
 
@@ -53,6 +56,14 @@ class IpfixDbWriterPg
 				int maxStatements, vector<string> columns, bool legacyNames, const char* prefix);
 		~IpfixDbWriterPg();
 
+		void enableCopyMode(uint32_t flushInterval, uint32_t maxBacklog);
+
+		virtual void onDataRecord(IpfixDataRecord* record);
+		virtual void performStart();
+		virtual void performShutdown();
+		virtual void clearStatistics();
+		virtual string getStatisticsXML(double interval);
+
 		virtual void connectToDB();
 		virtual bool writeToDb();
 		virtual int createExporterTable();
@@ -65,7 +76,64 @@ class IpfixDbWriterPg
 	protected:
 		PGconn* conn;
 		bool checkRelationExists(const char* relname);
+		PGconn* openConnection();
+
+	private:
+		/**
+		 * consecutive rows in a CopyBatch which belong to the same table
+		 */
+		struct CopySegment {
+			string table;
+			size_t offset; /**< start of the rows in CopyBatch::rows */
+			size_t length;
+			uint32_t rowCount;
+		};
+
+		/**
+		 * rows to be written by one run of the COPY thread
+		 */
+		struct CopyBatch {
+			PgCopyBuffer rows;
+			vector<CopySegment> segments;
+			uint32_t rowCount;
+		};
+
+		bool copyMode; /**< rows are written using COPY by copyThread instead of INSERT statements */
+		uint32_t copyFlushInterval; /**< maximum time in milliseconds a row is buffered in copy mode */
+		uint32_t copyMaxBacklog; /**< maximum number of buffered rows in copy mode, further rows are dropped */
+		struct CopyColumn {
+			PgCopyBuffer::Type type;
+			uint16_t ipfixType;
+		};
+
+		vector<CopyColumn> copyColumns; /**< encoding of each column */
+		PgCopyBuffer copyRow; /**< encoded row which is currently built */
+
+		// all following members up to statCopy* are protected by copyMutex
+		pthread_mutex_t copyMutex;
+		pthread_cond_t copyCond;
+		CopyBatch copyBatches[2];
+		CopyBatch* fillBatch; /**< batch receiving new rows */
+		CopyBatch* writeBatch; /**< batch being written by copyThread */
+		bool copyExit;
+
+		uint64_t statCopyRows; /**< rows written to database */
+		uint64_t statCopyDropped; /**< rows dropped because the backlog was full or COPY failed */
+		uint64_t statCopyBatches; /**< number of COPY commands */
+		uint64_t statCopyFailed; /**< number of failed COPY commands */
+		uint32_t statCopyStalls; /**< number of times maxRows was exceeded while copyThread was busy */
+		uint32_t statCopyBacklogPeak; /**< maximum number of buffered rows */
+		uint64_t statCopyTime; /**< time spent in COPY commands in microseconds */
+
+		PGconn* copyConn; /**< connection used by copyThread */
+		Thread copyThread;
+
+		void encodeCopyRow(IpfixRecord::SourceID* sourceID, TemplateInfo* dataTemplateInfo,
+				TemplateInfo::FieldInfo* fieldInfo, IpfixRecord::Data* data);
+		void copyWriter();
+		bool writeCopySegment(const CopyBatch& batch, const CopySegment& segment);
 
+		static void* copyThreadWrapper(void* instance);
 };
 
 
@@ -251,7 +251,7 @@ std::string IpfixDbWriterSQL::getDBDataType(const uint16_t ipfixType)
  * save given elements of record to database
  */
 void IpfixDbWriterSQL::processDataDataRecord(IpfixRecord::SourceID* sourceID,
-		TemplateInfo* dataTemplateInfo, uint16_t length,
+		TemplateInfo* dataTemplateInfo, TemplateInfo::FieldInfo* fieldInfo, uint16_t length,
 		IpfixRecord::Data* data)
 {
 	DPRINTF_INFO("Processing data record");
@@ -278,7 +278,7 @@ void IpfixDbWriterSQL::processDataDataRecord(IpfixRecord::SourceID* sourceID,
 	}
 
 	// insert record into buffer
-	fillInsertRow(sourceID, dataTemplateInfo, length, data);
+	fillInsertRow(sourceID, dataTemplateInfo, fieldInfo, length, data);
 
 	// statemBuffer is filled ->  insert in table
 	if(insertBuffer.curRows==insertBuffer.maxRows) {
@@ -301,7 +301,7 @@ void IpfixDbWriterSQL::onDataRecord(IpfixDataRecord* record)
 	}
 
 	processDataDataRecord(record->sourceID.get(), record->templateInfo.get(),
-			record->dataLength, record->data);
+			record->getFieldInfoArray(), record->dataLength, record->data);
 
 	record->removeReference();
 }
@@ -364,7 +364,7 @@ std::string IpfixDbWriterSQL::insertRowPrefix()
  *  results are stored in insertBuffer.sql
  */
 void IpfixDbWriterSQL::fillInsertRow(IpfixRecord::SourceID* sourceID,
-		TemplateInfo* dataTemplateInfo, uint16_t length, IpfixRecord::Data* data)
+		TemplateInfo* dataTemplateInfo, TemplateInfo::FieldInfo* fieldInfo, uint16_t length, IpfixRecord::Data* data)
 {
 	uint64_t flowstart = 0;
 	uint32_t k;
@@ -386,15 +386,15 @@ void IpfixDbWriterSQL::fillInsertRow(IpfixRecord::SourceID* sourceID,
 			// try to gather data required for the field
 			// look inside the ipfix record
 			for(k=0; k < dataTemplateInfo->fieldCount; k++) {
-				if(dataTemplateInfo->fieldInfo[k].type.enterprise == col->enterprise && dataTemplateInfo->fieldInfo[k].type.id == col->ipfixId) {
-					parseIpfixData(dataTemplateInfo->fieldInfo[k].type,(data+dataTemplateInfo->fieldInfo[k].offset), &parsedData);
-					DPRINTF_INFO("IpfixDbWriter::parseIpfixData: really saw ipfix id %d (%s) in packet with parsedData %s, type %d, length %d and offset %X", col->ipfixId, ipfix_id_lookup(col->ipfixId, col->enterprise)->name, parsedData.c_str(), dataTemplateInfo->fieldInfo[k].type.id, dataTemplateInfo->fieldInfo[k].type.length, dataTemplateInfo->fieldInfo[k].offset);
+				if(fieldInfo[k].type.enterprise == col->enterprise && fieldInfo[k].type.id == col->ipfixId) {
+					parseIpfixData(fieldInfo[k].type,(data+fieldInfo[k].offset), &parsedData);
+					DPRINTF_INFO("IpfixDbWriter::parseIpfixData: really saw ipfix id %d (%s) in packet with parsedData %s, type %d, length %d and offset %X", col->ipfixId, ipfix_id_lookup(col->ipfixId, col->enterprise)->name, parsedData.c_str(), fieldInfo[k].type.id, fieldInfo[k].type.length, fieldInfo[k].offset);
 					break;
 				}
 			}
 			// check for time-related alternative fields in the database
 			if (parsedData.empty()) {
-				checkTimeAlternatives(&(*col), dataTemplateInfo, data, &parsedData);
+				checkTimeAlternatives(&(*col), dataTemplateInfo, fieldInfo, data, &parsedData);
 			}
 
 			// get default value if nothing found until now
@@ -473,7 +473,7 @@ void IpfixDbWriterSQL::fillInsertRow(IpfixRecord::SourceID* sourceID,
 /**
  * Check alternatives if no exact was found for time-related IPFIX IEs.
  */
-void IpfixDbWriterSQL::checkTimeAlternatives(Column* col, TemplateInfo* dataTemplateInfo, IpfixRecord::Data* data, string* parsedData) {
+void IpfixDbWriterSQL::checkTimeAlternatives(Column* col, TemplateInfo* dataTemplateInfo, TemplateInfo::FieldInfo* fieldInfo, IpfixRecord::Data* data, string* parsedData) {
 
 	int k;
 
@@ -483,56 +483,56 @@ void IpfixDbWriterSQL::checkTimeAlternatives(Column* col, TemplateInfo* dataTemp
 			case IPFIX_TYPEID_flowStartSeconds:
 				for(k=0; k < dataTemplateInfo->fieldCount; k++) {
 					// look for alternative (flowStartMilliseconds/1000)
-					if(dataTemplateInfo->fieldInfo[k].type.id == IPFIX_TYPEID_flowStartMilliseconds) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, .001, parsedData);
+					if(fieldInfo[k].type.id == IPFIX_TYPEID_flowStartMilliseconds) {
+						parseUintAndScale(fieldInfo[k], data, .001, parsedData);
 						break;
 					}
 					// if no flow start time is available, maybe this is is from a netflow from Cisco
 					// then - as a last alternative - use flowStartSysUpTime as flow start time
-					if(dataTemplateInfo->fieldInfo[k].type.id == IPFIX_TYPEID_flowStartSysUpTime) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, 1., parsedData);
+					if(fieldInfo[k].type.id == IPFIX_TYPEID_flowStartSysUpTime) {
+						parseUintAndScale(fieldInfo[k], data, 1., parsedData);
 					}
 				}
 				break;
 			case IPFIX_TYPEID_flowStartMilliseconds:
 				for(k=0; k < dataTemplateInfo->fieldCount; k++) {
 					// look for alternative (flowStartSeconds*1000)
-					if(dataTemplateInfo->fieldInfo[k].type.id == IPFIX_TYPEID_flowStartSeconds) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, 1000., parsedData);
+					if(fieldInfo[k].type.id == IPFIX_TYPEID_flowStartSeconds) {
+						parseUintAndScale(fieldInfo[k], data, 1000., parsedData);
 						break;
 					}
 					// if no flow start time is available, maybe this is is from a netflow from Cisco
 					// then - as a last alternative - use flowStartSysUpTime as flow start time
-					if(dataTemplateInfo->fieldInfo[k].type.id == IPFIX_TYPEID_flowStartSysUpTime) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, 1000., parsedData);
+					if(fieldInfo[k].type.id == IPFIX_TYPEID_flowStartSysUpTime) {
+						parseUintAndScale(fieldInfo[k], data, 1000., parsedData);
 					}
 				}
 				break;
 			case IPFIX_TYPEID_flowEndSeconds:
 				for(k=0; k < dataTemplateInfo->fieldCount; k++) {
 					// look for alternative (flowEndMilliseconds/1000)
-					if(dataTemplateInfo->fieldInfo[k].type.id == IPFIX_TYPEID_flowEndMilliseconds) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, .001, parsedData);
+					if(fieldInfo[k].type.id == IPFIX_TYPEID_flowEndMilliseconds) {
+						parseUintAndScale(fieldInfo[k], data, .001, parsedData);
 						break;
 					}
 					// if no flow end time is available, maybe this is is from a netflow from Cisco
 					// then use flowEndSysUpTime as flow start time
-					if(dataTemplateInfo->fieldInfo[k].type.id == IPFIX_TYPEID_flowEndSysUpTime) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, 1., parsedData);
+					if(fieldInfo[k].type.id == IPFIX_TYPEID_flowEndSysUpTime) {
+						parseUintAndScale(fieldInfo[k], data, 1., parsedData);
 					}
 				}
 				break;
 			case IPFIX_TYPEID_flowEndMilliseconds:
 				for(k=0; k < dataTemplateInfo->fieldCount; k++) {
 					// look for alternative (flowEndSeconds*1000)
-					if(dataTemplateInfo->fieldInfo[k].type.id == IPFIX_TYPEID_flowEndSeconds) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, 1000., parsedData);
+					if(fieldInfo[k].type.id == IPFIX_TYPEID_flowEndSeconds) {
+						parseUintAndScale(fieldInfo[k], data, 1000., parsedData);
 						break;
 					}
 					// if no flow end time is available, maybe this is is from a netflow from Cisco
 					// then use flowEndSysUpTime as flow start time
-					if(dataTemplateInfo->fieldInfo[k].type.id == IPFIX_TYPEID_flowEndSysUpTime) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, 1000., parsedData);
+					if(fieldInfo[k].type.id == IPFIX_TYPEID_flowEndSysUpTime) {
+						parseUintAndScale(fieldInfo[k], data, 1000., parsedData);
 					}
 				}
 				break;
@@ -542,8 +542,8 @@ void IpfixDbWriterSQL::checkTimeAlternatives(Column* col, TemplateInfo* dataTemp
 			case IPFIX_TYPEID_flowStartSeconds:
 				// look for alternative (revFlowStartMilliseconds/1000)
 				for(k=0; k < dataTemplateInfo->fieldCount; k++) {
-					if(dataTemplateInfo->fieldInfo[k].type == InformationElement::IeInfo(IPFIX_TYPEID_flowStartMilliseconds, IPFIX_PEN_reverse)) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, .001, parsedData);
+					if(fieldInfo[k].type == InformationElement::IeInfo(IPFIX_TYPEID_flowStartMilliseconds, IPFIX_PEN_reverse)) {
+						parseUintAndScale(fieldInfo[k], data, .001, parsedData);
 						break;
 					}
 				}
@@ -551,8 +551,8 @@ void IpfixDbWriterSQL::checkTimeAlternatives(Column* col, TemplateInfo* dataTemp
 			case IPFIX_TYPEID_flowStartMilliseconds:
 				// look for alternative (revFlowStartSeconds*1000)
 				for(k=0; k < dataTemplateInfo->fieldCount; k++) {
-					if(dataTemplateInfo->fieldInfo[k].type == InformationElement::IeInfo(IPFIX_TYPEID_flowStartSeconds, IPFIX_PEN_reverse)) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, 1000., parsedData);
+					if(fieldInfo[k].type == InformationElement::IeInfo(IPFIX_TYPEID_flowStartSeconds, IPFIX_PEN_reverse)) {
+						parseUintAndScale(fieldInfo[k], data, 1000., parsedData);
 						break;
 					}
 				}
@@ -560,8 +560,8 @@ void IpfixDbWriterSQL::checkTimeAlternatives(Column* col, TemplateInfo* dataTemp
 			case IPFIX_TYPEID_flowEndSeconds:
 				// look for alternative (revFlowEndMilliseconds/1000)
 				for(k=0; k < dataTemplateInfo->fieldCount; k++) {
-					if(dataTemplateInfo->fieldInfo[k].type == InformationElement::IeInfo(IPFIX_TYPEID_flowEndMilliseconds, IPFIX_PEN_reverse)) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, .001, parsedData);
+					if(fieldInfo[k].type == InformationElement::IeInfo(IPFIX_TYPEID_flowEndMilliseconds, IPFIX_PEN_reverse)) {
+						parseUintAndScale(fieldInfo[k], data, .001, parsedData);
 						break;
 					}
 				}
@@ -569,8 +569,8 @@ void IpfixDbWriterSQL::checkTimeAlternatives(Column* col, TemplateInfo* dataTemp
 			case IPFIX_TYPEID_flowEndMilliseconds:
 				// look for alternative (revFlowEndSeconds*1000)
 				for(k=0; k < dataTemplateInfo->fieldCount; k++) {
-					if(dataTemplateInfo->fieldInfo[k].type == InformationElement::IeInfo(IPFIX_TYPEID_flowEndSeconds, IPFIX_PEN_reverse)) {
-						parseUintAndScale(dataTemplateInfo->fieldInfo[k], data, 1000., parsedData);
+					if(fieldInfo[k].type == InformationElement::IeInfo(IPFIX_TYPEID_flowEndSeconds, IPFIX_PEN_reverse)) {
+						parseUintAndScale(fieldInfo[k], data, 1000., parsedData);
 						break;
 					}
 				}
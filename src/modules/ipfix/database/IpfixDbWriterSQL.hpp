@@ -129,7 +129,7 @@ class IpfixDbWriterSQL
 		void addColumnEntry(const char* insert, bool quoted, bool lastcolumn);
 		void addColumnEntry(const uint64_t insert, bool quoted, bool lastcolumn);
 		void fillInsertRow(IpfixRecord::SourceID* sourceID,
-				TemplateInfo* dataTemplateInfo, uint16_t length, IpfixRecord::Data* data);
+				TemplateInfo* dataTemplateInfo, TemplateInfo::FieldInfo* fieldInfo, uint16_t length, IpfixRecord::Data* data);
 		bool checkCurrentTable(uint64_t flowStart);
 		bool setCurrentTable(uint64_t flowStart);
 		string getTimeAsString(uint64_t milliseconds, const char* formatstring, bool addfraction, uint32_t microseconds = 0);
@@ -147,18 +147,18 @@ class IpfixDbWriterSQL
 		virtual void parseIpfixIpv6Address(IpfixRecord::Data* data, string* parsedData) = 0;
 		virtual void parseIpfixMacAddress(IpfixRecord::Data* data, string* parsedData) = 0;
 		std::string getDBDataType(const uint16_t ipfixType);
+		void checkTimeAlternatives(Column* col, TemplateInfo* dataTemplateInfo, TemplateInfo::FieldInfo* fieldInfo, IpfixRecord::Data* data, string* parsedData);
 		Column* legacyNamesMap;
 
 	private:
 		void processDataDataRecord(IpfixRecord::SourceID* sourceID,
-				TemplateInfo* dataTemplateInfo, uint16_t length,
+				TemplateInfo* dataTemplateInfo, TemplateInfo::FieldInfo* fieldInfo, uint16_t length,
 				IpfixRecord::Data* data);
 
 		/***** Internal Functions ****************************************************/
 
 		char* getTableNamDependTime(char* tablename,uint64_t flowstartsec);
 
-		void checkTimeAlternatives(Column* col, TemplateInfo* dataTemplateInfo, IpfixRecord::Data* data, string* parsedData);
 		void parseUintAndScale(TemplateInfo::FieldInfo fieldInfo, IpfixRecord::Data* data, double factor, string* parsedData);
 		void parseIpfixData(InformationElement::IeInfo type, IpfixRecord::Data* data, string* ret);
 		void parseIpfixUint(IpfixRecord::Data* data, uint16_t length, string* parsedData);
@@ -0,0 +1,319 @@
+/*
+ * IPFIX Database Writer for PostgreSQL, binary COPY encoding
+ * Copyright (C) 2014 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "PgCopyBuffer.hpp"
+#include "common/msg.h"
+#include "common/ipfixlolib/ipfix.h"
+
+#include <string.h>
+
+/** signature, flags and header extension length of a binary COPY stream */
+const uint8_t PgCopyBuffer::HEADER[19] = {
+	'P', 'G', 'C', 'O', 'P', 'Y', '\n', 0xFF, '\r', '\n', 0,
+	0, 0, 0, 0,
+	0, 0, 0, 0
+};
+
+/** field count -1 marks the end of a binary COPY stream */
+const uint8_t PgCopyBuffer::TRAILER[2] = { 0xFF, 0xFF };
+
+/** address families as used by PostgreSQL's inet type, independent of the local AF_* values */
+static const uint8_t PGSQL_AF_INET = 2;
+static const uint8_t PGSQL_AF_INET6 = 3;
+
+
+/**
+ * @returns encoding of the column type IpfixDbWriterSQL::getDBDataType() uses for PostgreSQL
+ */
+PgCopyBuffer::Type PgCopyBuffer::getType(uint16_t ipfixType)
+{
+	switch (ipfixType) {
+		case IPFIX_TYPE_octetArray:
+		case IPFIX_TYPE_basicList:
+		case IPFIX_TYPE_subTemplateList:
+		case IPFIX_TYPE_subTemplateMultiList:
+			return Bytea;
+
+		case IPFIX_TYPE_unsigned8:
+		case IPFIX_TYPE_signed8:
+		case IPFIX_TYPE_signed16:
+			return Int2;
+
+		case IPFIX_TYPE_unsigned16:
+		case IPFIX_TYPE_signed32:
+		case IPFIX_TYPE_dateTimeSeconds:
+			return Int4;
+
+		case IPFIX_TYPE_unsigned32:
+		case IPFIX_TYPE_unsigned64:
+		case IPFIX_TYPE_signed64:
+		case IPFIX_TYPE_dateTimeMilliseconds:
+		case IPFIX_TYPE_dateTimeMicroseconds:
+		case IPFIX_TYPE_dateTimeNanoseconds:
+			return Int8;
+
+		case IPFIX_TYPE_float32:
+			return Float4;
+
+		case IPFIX_TYPE_float64:
+			return Float8;
+
+		case IPFIX_TYPE_boolean:
+			return Bool;
+
+		case IPFIX_TYPE_macAddress:
+			return MacAddr;
+
+		case IPFIX_TYPE_string:
+			return Text;
+
+		case IPFIX_TYPE_ipv4Address:
+		case IPFIX_TYPE_ipv6Address:
+			return Inet;
+
+		default:
+			THROWEXCEPTION("PgCopyBuffer: unsupported IPFIX type %hu", ipfixType);
+	}
+	// make compiler happy. we should never get here
+	return Bytea;
+}
+
+/**
+ * @returns true if columns of the given type can hold a numeric default value
+ */
+bool PgCopyBuffer::isNumeric(Type type)
+{
+	return type == Int2 || type == Int4 || type == Int8 || type == Float4 || type == Float8;
+}
+
+void PgCopyBuffer::clear()
+{
+	buf.clear();
+}
+
+size_t PgCopyBuffer::size() const
+{
+	return buf.size();
+}
+
+const uint8_t* PgCopyBuffer::data() const
+{
+	return buf.empty() ? NULL : &buf[0];
+}
+
+void PgCopyBuffer::put16(uint16_t v)
+{
+	buf.push_back(v >> 8);
+	buf.push_back(v & 0xFF);
+}
+
+void PgCopyBuffer::put32(uint32_t v)
+{
+	put16(v >> 16);
+	put16(v & 0xFFFF);
+}
+
+void PgCopyBuffer::put64(uint64_t v)
+{
+	put32(v >> 32);
+	put32(v & 0xFFFFFFFF);
+}
+
+void PgCopyBuffer::putLength(int32_t length)
+{
+	put32((uint32_t)length);
+}
+
+/**
+ * starts a new row, exactly the given number of fields must be added afterwards
+ */
+void PgCopyBuffer::beginRow(uint16_t fields)
+{
+	put16(fields);
+}
+
+void PgCopyBuffer::addNull()
+{
+	putLength(-1);
+}
+
+/**
+ * adds an integer value to a column of the given type, floating point types are converted
+ */
+void PgCopyBuffer::addInteger(Type type, int64_t value)
+{
+	switch (type) {
+		case Int2:
+			putLength(2);
+			put16((uint16_t)value);
+			break;
+		case Int4:
+			putLength(4);
+			put32((uint32_t)value);
+			break;
+		case Int8:
+			putLength(8);
+			put64((uint64_t)value);
+			break;
+		case Float4:
+			{
+				float f = (float)value;
+				uint32_t v;
+				memcpy(&v, &f, 4);
+				putLength(4);
+				put32(v);
+				break;
+			}
+		case Float8:
+			{
+				double d = (double)value;
+				uint64_t v;
+				memcpy(&v, &d, 8);
+				putLength(8);
+				put64(v);
+				break;
+			}
+		default:
+			addNull();
+	}
+}
+
+/**
+ * converts an IPFIX field to the binary representation of the given column type
+ * reduced size encoding is supported for integers and floats, values which do not fit
+ * the column type (e.g. addresses with an unexpected length) are stored as NULL
+ * @param ipfixType data type of the Information Element
+ * @param data field value in network byte order
+ * @param length length of the field in the record
+ */
+void PgCopyBuffer::addIpfixValue(Type type, uint16_t ipfixType, const uint8_t* data, uint16_t length)
+{
+	switch (type) {
+		case Int2:
+		case Int4:
+		case Int8:
+			{
+				if (length == 0 || length > 8) {
+					addNull();
+					break;
+				}
+				bool isSigned = ipfixType == IPFIX_TYPE_signed8 || ipfixType == IPFIX_TYPE_signed16
+					|| ipfixType == IPFIX_TYPE_signed32 || ipfixType == IPFIX_TYPE_signed64;
+				uint64_t acc = (isSigned && (data[0] & 0x80)) ? ~(uint64_t)0 : 0;
+				for (uint16_t i = 0; i < length; i++) {
+					acc = (acc << 8) | data[i];
+				}
+				addInteger(type, (int64_t)acc);
+				break;
+			}
+
+		case Float4:
+		case Float8:
+			{
+				double value;
+				if (length == 4) {
+					uint32_t v = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+					float f;
+					memcpy(&f, &v, 4);
+					value = f;
+				} else if (length == 8) {
+					uint64_t v = 0;
+					for (int i = 0; i < 8; i++) v = (v << 8) | data[i];
+					memcpy(&value, &v, 8);
+				} else {
+					addNull();
+					break;
+				}
+				if (type == Float4) {
+					float f = (float)value;
+					uint32_t v;
+					memcpy(&v, &f, 4);
+					putLength(4);
+					put32(v);
+				} else {
+					uint64_t v;
+					memcpy(&v, &value, 8);
+					putLength(8);
+					put64(v);
+				}
+				break;
+			}
+
+		case Bool:
+			// IPFIX encodes true as 1 and false as 2
+			if (length != 1) {
+				addNull();
+				break;
+			}
+			putLength(1);
+			buf.push_back(data[0] == 1 ? 1 : 0);
+			break;
+
+		case MacAddr:
+			if (length != 6) {
+				addNull();
+				break;
+			}
+			addBytes(data, 6);
+			break;
+
+		case Inet:
+			if (length != 4 && length != 16) {
+				addNull();
+				break;
+			}
+			putLength(4+length);
+			buf.push_back(length == 4 ? PGSQL_AF_INET : PGSQL_AF_INET6);
+			buf.push_back(length == 4 ? 32 : 128); // netmask bits
+			buf.push_back(0); // is_cidr
+			buf.push_back(length);
+			buf.insert(buf.end(), data, data+length);
+			break;
+
+		case Text:
+			{
+				// strings in fixed length fields may be padded with zeros which text values must not contain
+				const uint8_t* end = (const uint8_t*)memchr(data, 0, length);
+				addBytes(data, end ? end-data : length);
+				break;
+			}
+
+		case Bytea:
+			addBytes(data, length);
+			break;
+	}
+}
+
+/**
+ * appends all rows contained in other
+ */
+void PgCopyBuffer::append(const PgCopyBuffer& other)
+{
+	buf.insert(buf.end(), other.buf.begin(), other.buf.end());
+}
+
+/**
+ * adds a field with the given raw value
+ */
+void PgCopyBuffer::addBytes(const uint8_t* data, size_t length)
+{
+	putLength(length);
+	buf.insert(buf.end(), data, data+length);
+}
@@ -0,0 +1,74 @@
+/*
+ * IPFIX Database Writer for PostgreSQL, binary COPY encoding
+ * Copyright (C) 2014 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef PGCOPYBUFFER_H
+#define PGCOPYBUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Buffer for rows in the binary format of PostgreSQL's COPY command.
+ *
+ * Each row consists of the number of fields followed by length and value of each field,
+ * all in network byte order. Values of IPFIX fields are converted directly from the
+ * record data to the binary representation of the column type which
+ * IpfixDbWriterSQL::getDBDataType() uses for PostgreSQL, so no intermediate strings are
+ * built. The buffer does not depend on libpq, header and trailer of a COPY stream are
+ * available as separate buffers.
+ */
+class PgCopyBuffer
+{
+public:
+	/**
+	 * binary encodings of the PostgreSQL column types used for IPFIX types
+	 */
+	enum Type {
+		Int2, Int4, Int8, Float4, Float8, Bool, MacAddr, Inet, Text, Bytea
+	};
+
+	static Type getType(uint16_t ipfixType);
+	static bool isNumeric(Type type);
+
+	static const uint8_t HEADER[19];
+	static const uint8_t TRAILER[2];
+
+	void clear();
+	size_t size() const;
+	const uint8_t* data() const;
+
+	void beginRow(uint16_t fields);
+	void addNull();
+	void addInteger(Type type, int64_t value);
+	void addIpfixValue(Type type, uint16_t ipfixType, const uint8_t* data, uint16_t length);
+	void append(const PgCopyBuffer& other);
+	void addBytes(const uint8_t* data, size_t length);
+
+private:
+	std::vector<uint8_t> buf;
+
+	void putLength(int32_t length);
+	void put16(uint16_t v);
+	void put32(uint32_t v);
+	void put64(uint64_t v);
+};
+
+#endif
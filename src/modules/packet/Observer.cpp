@@ -86,7 +86,12 @@ Observer::Observer(const std::string& interface, bool offline, uint64_t maxpacke
 	lastProcessedPackets(0),
 	captureInterface(NULL), fileName(NULL), replaceTimestampsFromFile(false),
 	stretchTimeInt(1), stretchTime(1.0), autoExit(true), slowMessageShown(false),
-	statTotalLostPackets(0), statTotalRecvPackets(0)
+	statTotalLostPackets(0), statTotalRecvPackets(0),
+#if defined(HAVE_TPACKET_V3)
+	ring(NULL),
+#endif
+	useRing(false), ringBlockSize(0), ringBlockCount(0), ringFanoutGroup(-1),
+	batchSize(OBSERVER_DEFAULT_BATCH_SIZE)
 {
 	if(offline) {
 		readFromFile = true;
@@ -116,12 +121,16 @@ Observer::~Observer()
 
 	/* collect and output statistics */
 	pcap_stat pstats;
-	if (captureDevice && pcap_stats(captureDevice, &pstats)==0) {
+	if (getPcapStats(&pstats)==0) {
 		msg(LOG_WARNING, "PCAP statistics (INFO: if statistics were activated, this information does not contain correct data!):");
 		msg(LOG_WARNING, "Number of packets received on interface: %u", pstats.ps_recv);
 		msg(LOG_WARNING, "Number of packets dropped by PCAP: %u", pstats.ps_drop);
 	}
 
+#if defined(HAVE_TPACKET_V3)
+	delete ring;
+#endif
+
 	msg(LOG_INFO, "freeing pcap/devices");
 	if(captureDevice) {
 		pcap_close(captureDevice);
@@ -151,7 +160,6 @@ void *Observer::observerThread(void *arg)
 	Packet *p = NULL;
 	const unsigned char *pcapData;
 	struct pcap_pkthdr packetHeader;
-	bool have_send = false;
 	obs->registerCurrentThread();
 	bool file_eof = false;
 
@@ -173,6 +181,11 @@ void *Observer::observerThread(void *arg)
 	msg(LOG_NOTICE, "now running capturing thread for device %s", obs->captureInterface);
 
 
+#if defined(HAVE_TPACKET_V3)
+	if (obs->ring) {
+		obs->captureFromRing();
+	} else
+#endif
 	if(!obs->readFromFile) {
 		while(!obs->exitFlag && (obs->maxPackets==0 || obs->processedPackets<obs->maxPackets)) {
 			// wait until data can be read from pcap file descriptor
@@ -194,46 +207,38 @@ void *Observer::observerThread(void *arg)
 			}
 
 			/*
-			 get next packet (no zero-copy possible *sigh*)
+			 get all packets which are available without blocking (no zero-copy possible *sigh*)
 			 NOTICE: potential bottleneck, if pcap_next() is calling gettimeofday() at a high rate;
 			 there is partially caching function described in an Sun or IBM (Developerworks) article
 			 that can act as a via LD_PRELOAD used overlay function.
 			 unfortunately I don't have an URL ready -Freek
 			 */
-			DPRINTF_DEBUG( "trying to get packet from pcap");
-			pcapData = pcap_next(obs->captureDevice, &packetHeader);
-			if(!pcapData)
-			/* no packet data was available */
-			continue;
-			DPRINTF_DEBUG( "got new packet!");
-
-			// show current packet as c-structure on stdout
-			//for (unsigned int i=0; i<packetHeader.caplen; i++) {
-			//printf("0x%02hhX, ", ((unsigned char*)pcapData)[i]);
-			//}
-			//printf("\n");
+			while (obs->batch.size() < obs->batchSize && (obs->maxPackets==0 || obs->processedPackets<obs->maxPackets)) {
+				DPRINTF_DEBUG( "trying to get packet from pcap");
+				pcapData = pcap_next(obs->captureDevice, &packetHeader);
+				if(!pcapData)
+					/* no more packet data available */
+					break;
+				DPRINTF_DEBUG( "got new packet!");
 
-			// initialize packet structure (init copies packet data)
-			p = packetManager.getNewInstance();
-			p->init((char*)pcapData, packetHeader.caplen, packetHeader.ts, obs->observationDomainID, packetHeader.len, obs->dataLinkType);
+				// initialize packet structure (init copies packet data)
+				p = packetManager.getNewInstance();
+				p->init((char*)pcapData, packetHeader.caplen, packetHeader.ts, obs->observationDomainID, packetHeader.len, obs->dataLinkType);
 
-			DPRINTF_INFO("received packet at %u.%04u, len=%d",
-					(unsigned)p->timestamp.tv_sec,
-					(unsigned)p->timestamp.tv_usec / 1000,
-					packetHeader.caplen
-			);
+				DPRINTF_INFO("received packet at %u.%04u, len=%d",
+						(unsigned)p->timestamp.tv_sec,
+						(unsigned)p->timestamp.tv_usec / 1000,
+						packetHeader.caplen
+				);
 
-			// update statistics
-			obs->receivedBytes += packetHeader.caplen;
-			obs->processedPackets++;
+				// update statistics
+				obs->receivedBytes += packetHeader.caplen;
+				obs->processedPackets++;
 
-			while (!obs->exitFlag) {
-				DPRINTF_DEBUG( "trying to push packet to queue");
-				if ((have_send = obs->send(p))) {
-					DPRINTF_DEBUG( "packet pushed");
-					break;
-				}
+				obs->batch.push_back(p);
 			}
+
+			obs->flushBatch();
 		}
 	} else {
 		// file handle
@@ -291,6 +296,8 @@ void *Observer::observerThread(void *arg)
 						timersub(&delta_to_be, &delta_now, &wait_val);
 						wait_spec.tv_sec = wait_val.tv_sec;
 						wait_spec.tv_nsec = wait_val.tv_usec * 1000;
+						// do not hold back already read packets while we are sleeping
+						obs->flushBatch();
 						if(nanosleep(&wait_spec, NULL) != 0)
 							msg(LOG_NOTICE, "Observer: nanosleep returned nonzero value, errno=%u (%s)", errno, strerror(errno));
 					}
@@ -324,14 +331,11 @@ void *Observer::observerThread(void *arg)
 			obs->receivedBytes += packetHeader.caplen;
 			obs->processedPackets++;
 
-			while (!obs->exitFlag) {
-				DPRINTF_DEBUG( "trying to push packet to queue");
-				if ((have_send = obs->send(p))) {
-					DPRINTF_DEBUG( "packet pushed");
-					break;
-				}
-			}
+			obs->batch.push_back(p);
+			if (obs->batch.size() >= obs->batchSize)
+				obs->flushBatch();
 		}
+		obs->flushBatch();
 	}
 
 	if (obs->autoExit && (file_eof || (obs->maxPackets && obs->processedPackets>=obs->maxPackets)) ) {
@@ -346,6 +350,104 @@ void *Observer::observerThread(void *arg)
 }
 
 
+/*
+ sends all buffered packets to the next module
+ */
+void Observer::flushBatch()
+{
+	while (!exitFlag && !batch.empty()) {
+		DPRINTF_DEBUG( "trying to push %zu packets to queue", batch.size());
+		if (sendBatch(batch)) {
+			DPRINTF_DEBUG( "packets pushed");
+			break;
+		}
+	}
+
+	// we are shutting down, nobody will receive these packets any more
+	for (size_t i = 0; i < batch.size(); i++)
+		batch[i]->removeReference();
+	batch.clear();
+}
+
+#if defined(HAVE_TPACKET_V3)
+/*
+ capture loop for the TPACKET_V3 ring: walks all frames of each block the kernel
+ has filled and gives the block back to the kernel directly afterwards
+ */
+void Observer::captureFromRing()
+{
+	TPacketRing::Frame frame;
+
+	while(!exitFlag && (maxPackets==0 || processedPackets<maxPackets)) {
+		struct tpacket_block_desc* block = ring->nextBlock(1000);
+		if (!block) continue;
+
+		DPRINTF_DEBUG("got ring block with %u packets", ring->getFrameCount(block));
+		bool more = ring->firstFrame(block, &frame);
+		while (more) {
+			uint32_t caplen = (frame.caplen < capturelen) ? frame.caplen : capturelen;
+
+			// initialize packet structure (init copies packet data out of the ring)
+			Packet* p = packetManager.getNewInstance();
+			p->init((char*)frame.data, caplen, frame.ts, observationDomainID, frame.len, dataLinkType);
+
+			receivedBytes += caplen;
+			processedPackets++;
+
+			batch.push_back(p);
+			if (batch.size() >= batchSize)
+				flushBatch();
+
+			more = ring->nextFrame(&frame) && !exitFlag && (maxPackets==0 || processedPackets<maxPackets);
+		}
+		ring->releaseBlock(block);
+		flushBatch();
+	}
+}
+
+/*
+ sets up the TPACKET_V3 ring and attaches the pcap filter (if any) to it
+ */
+bool Observer::prepareRing()
+{
+	ring = new TPacketRing(captureInterface, ringBlockSize, ringBlockCount, capturelen, pcap_promisc, ringFanoutGroup);
+	if (!ring->open()) {
+		msg(LOG_CRIT, "Error initializing TPACKET_V3 ring on interface %s", captureInterface);
+		goto out;
+	}
+	dataLinkType = ring->getDataLinkType();
+
+	if (filter_exp) {
+		// pcap is only used to compile the filter expression into BPF code
+		pcap_t* dead = pcap_open_dead(dataLinkType, capturelen);
+		if (!dead) {
+			msg(LOG_CRIT, "unable to create pcap handle for filter compilation");
+			goto out;
+		}
+		msg(LOG_INFO, "compiling pcap filter code from: %s", filter_exp);
+		if (pcap_compile(dead, &pcap_filter, filter_exp, 1, 0) == -1) {
+			msg(LOG_CRIT, "unable to validate+compile pcap filter: %s", pcap_geterr(dead));
+			pcap_close(dead);
+			goto out;
+		}
+		pcap_close(dead);
+		bool attached = ring->setFilter(&pcap_filter);
+		pcap_freecode(&pcap_filter);
+		if (!attached) goto out;
+	} else {
+		msg(LOG_INFO, "using no pcap filter");
+	}
+
+	ready = true;
+	return true;
+
+out:
+	delete ring;
+	ring = NULL;
+	return false;
+}
+#endif
+
 /*
  call after an Observer has been created
  error checking on pcap here, because it can't be done in the constructor
@@ -363,6 +465,12 @@ bool Observer::prepare(const std::string& filter)
 		usedBytes += filter.size()+1;
 	}
 
+#if defined(HAVE_TPACKET_V3)
+	if (!readFromFile && useRing) {
+		return prepareRing();
+	}
+#endif
+
 	if (!readFromFile) {
 		// query all available capture devices
 		msg(LOG_NOTICE, "Finding devices");
@@ -555,6 +663,31 @@ int Observer::getPacketTimeout()
 	return pcap_timeout;
 }
 
+/*
+   capture live traffic with an AF_PACKET TPACKET_V3 ring instead of libpcap
+   offline files are always read with libpcap
+   */
+void Observer::setRingCapture(uint32_t blockSize, uint32_t blockCount, int fanoutGroup)
+{
+#if defined(HAVE_TPACKET_V3)
+	if (ready) {
+		THROWEXCEPTION("changing capture mode on-the-fly is not supported");
+	}
+	useRing = !readFromFile;
+	ringBlockSize = blockSize;
+	ringBlockCount = blockCount;
+	ringFanoutGroup = fanoutGroup;
+#else
+	THROWEXCEPTION("Observer: TPACKET_V3 capturing is not supported, recompile with SUPPORT_TPACKET_V3 on a Linux system");
+#endif
+}
+
+void Observer::setBatchSize(uint32_t size)
+{
+	batchSize = (size > 0) ? size : 1;
+	batch.reserve(batchSize);
+}
+
 /*
    get some capturing statistics
    struct pcap_stat is defined in pcap.h and has at least 3 u_int variables:
@@ -564,6 +697,13 @@ int Observer::getPacketTimeout()
    */
 int Observer::getPcapStats(struct pcap_stat *out)
 {
+#if defined(HAVE_TPACKET_V3)
+	if (ring) {
+		out->ps_ifdrop = 0;
+		return ring->getStats(&out->ps_recv, &out->ps_drop) ? 0 : -1;
+	}
+#endif
+	if (!captureDevice) return -1;
 	return(pcap_stats(captureDevice, out));
 }
 
@@ -574,7 +714,7 @@ std::string Observer::getStatisticsXML(double interval)
 {
 	ostringstream oss;
 	pcap_stat pstats;
-	if (captureDevice && pcap_stats(captureDevice, &pstats)==0) {
+	if (getPcapStats(&pstats)==0) {
 		unsigned int recv = pstats.ps_recv;
 		unsigned int dropped = pstats.ps_drop;
 
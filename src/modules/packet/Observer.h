@@ -21,8 +21,20 @@
  */
 #define PCAP_TIMEOUT 100
 
+/*
+ default geometry of the TPACKET_V3 capture ring (64 MB)
+ */
+#define TPACKET_RING_DEFAULT_BLOCK_SIZE (1 << 20)
+#define TPACKET_RING_DEFAULT_BLOCK_COUNT 64
+
+/*
+ default number of packets the Observer hands to the next module at once
+ */
+#define OBSERVER_DEFAULT_BATCH_SIZE 64
+
 
 #include "Packet.h"
+#include "TPacketRing.h"
 
 #include "common/msg.h"
 #include "common/Thread.h"
@@ -51,6 +63,8 @@ public:
 	void setOfflineAutoExit(bool autoexit);
 	int getCaptureLen();
 	bool setPacketTimeout(int ms);
+	void setRingCapture(uint32_t blockSize, uint32_t blockCount, int fanoutGroup);
+	void setBatchSize(uint32_t size);
 	int getPacketTimeout();
 	void replaceOfflineTimestamps();
 	void setOfflineSpeed(float m);
@@ -130,6 +144,22 @@ protected:
 	uint32_t statTotalLostPackets;
 	uint32_t statTotalRecvPackets;
 
+#if defined(HAVE_TPACKET_V3)
+	// AF_PACKET TPACKET_V3 capture ring, used instead of pcap for live capturing if set
+	TPacketRing* ring;
+	bool prepareRing();
+	void captureFromRing();
+#endif
+	bool useRing;
+	uint32_t ringBlockSize;
+	uint32_t ringBlockCount;
+	int ringFanoutGroup; // -1 == no fanout
+
+	// captured packets which were not yet sent to the next module
+	std::vector<Packet*> batch;
+	uint32_t batchSize;
+	void flushBatch();
+
 	static void *observerThread(void *);
 
 	int dataLinkType; // contains the datalink type of the capturing device
@@ -45,7 +45,12 @@ ObserverCfg::ObserverCfg(XMLElement* elem)
 	replaceOfflineTimestamps(false),
 	offlineAutoExit(true),
 	offlineSpeed(1.0),
-	maxPackets(0)
+	maxPackets(0),
+	useRing(false),
+	ringBlockSize(TPACKET_RING_DEFAULT_BLOCK_SIZE),
+	ringBlockCount(TPACKET_RING_DEFAULT_BLOCK_COUNT),
+	fanoutGroup(-1),
+	batchSize(OBSERVER_DEFAULT_BATCH_SIZE)
 {
 	if (!elem) return;  // needed because of table inside ConfigManager
 
@@ -72,6 +77,23 @@ ObserverCfg::ObserverCfg(XMLElement* elem)
 			capture_len = getInt("captureLength");
 		} else if (e->matches("maxPackets")) {
 			maxPackets = getInt("maxPackets");
+		} else if (e->matches("captureMode")) {
+			std::string mode = e->getFirstText();
+			if (mode == "pcap") {
+				useRing = false;
+			} else if (mode == "tpacket_v3") {
+				useRing = true;
+			} else {
+				THROWEXCEPTION("Unknown observer capture mode '%s', use 'pcap' or 'tpacket_v3'", mode.c_str());
+			}
+		} else if (e->matches("ringBlockSize")) {
+			ringBlockSize = getInt("ringBlockSize");
+		} else if (e->matches("ringBlockCount")) {
+			ringBlockCount = getInt("ringBlockCount");
+		} else if (e->matches("fanoutGroup")) {
+			fanoutGroup = getInt("fanoutGroup");
+		} else if (e->matches("batchSize")) {
+			batchSize = getInt("batchSize");
 		} else if (e->matches("next")) { // ignore next
 		} else {
 			msg(LOG_CRIT, "Unknown observer config statement %s\n", e->getName().c_str());
@@ -91,6 +113,8 @@ Observer* ObserverCfg::createInstance()
 	instance->setOfflineSpeed(offlineSpeed);
 	instance->setOfflineAutoExit(offlineAutoExit);
 	if (replaceOfflineTimestamps) instance->replaceOfflineTimestamps();
+	if (useRing) instance->setRingCapture(ringBlockSize, ringBlockCount, fanoutGroup);
+	instance->setBatchSize(batchSize);
 
 	if (capture_len) {
 		if(!instance->setCaptureLen(capture_len)) {
@@ -115,6 +139,9 @@ bool ObserverCfg::deriveFrom(ObserverCfg* old)
 		return false;
 	if (pcap_filter != old->pcap_filter)
 		return false;
+	if (useRing != old->useRing || ringBlockSize != old->ringBlockSize ||
+			ringBlockCount != old->ringBlockCount || fanoutGroup != old->fanoutGroup)
+		return false;
 
 	return true;
 }
@@ -61,6 +61,11 @@ private:
 	bool offlineAutoExit;
 	float offlineSpeed;
 	uint64_t maxPackets;
+	bool useRing;		// capture with TPACKET_V3 ring instead of pcap
+	uint32_t ringBlockSize;
+	uint32_t ringBlockCount;
+	int fanoutGroup;
+	uint32_t batchSize;	// number of packets sent to the next module at once
 };
 
 #endif /*OBSERVERCFG_H_*/
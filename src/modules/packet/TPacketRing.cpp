@@ -0,0 +1,301 @@
+/*
+ * Vermont Packet Capturing
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#if defined(HAVE_TPACKET_V3)
+
+#include "TPacketRing.h"
+
+#include "common/msg.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+
+TPacketRing::TPacketRing(const std::string& interface, uint32_t blockSize, uint32_t blockCount,
+		uint32_t snaplen, bool promisc, int fanoutGroup)
+	: interface(interface), blockSize(blockSize), blockCount(blockCount), snaplen(snaplen),
+	  promisc(promisc), fanoutGroup(fanoutGroup), fd(-1), ring(NULL), ringSize(0),
+	  currentBlock(0), dataLinkType(DLT_EN10MB), currentFrame(NULL), framesLeft(0),
+	  statReceived(0), statDropped(0)
+{
+	if (blockSize == 0 || (blockSize % getpagesize()) != 0)
+		THROWEXCEPTION("TPacketRing: block size %u must be a non-zero multiple of the page size (%d)", blockSize, getpagesize());
+	if (blockCount == 0)
+		THROWEXCEPTION("TPacketRing: block count must not be zero");
+	if (snaplen + TPACKET3_HDRLEN > blockSize)
+		THROWEXCEPTION("TPacketRing: block size %u is too small for capture length %u", blockSize, snaplen);
+}
+
+TPacketRing::~TPacketRing()
+{
+	close();
+}
+
+/**
+ * opens the packet socket, maps the ring buffer and binds it to the interface
+ * @returns false on failure, errors are logged
+ */
+bool TPacketRing::open()
+{
+	fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (fd < 0) {
+		msg(LOG_CRIT, "TPacketRing: socket(AF_PACKET) failed: %s", strerror(errno));
+		return false;
+	}
+
+	int ifindex = if_nametoindex(interface.c_str());
+	if (ifindex == 0) {
+		msg(LOG_CRIT, "TPacketRing: unknown interface %s", interface.c_str());
+		goto out;
+	}
+
+	// we only support interfaces with ethernet framing, everything else needs libpcap
+	struct ifreq ifr;
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, interface.c_str(), IFNAMSIZ-1);
+	if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+		msg(LOG_CRIT, "TPacketRing: SIOCGIFHWADDR on %s failed: %s", interface.c_str(), strerror(errno));
+		goto out;
+	}
+	if (ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER && ifr.ifr_hwaddr.sa_family != ARPHRD_LOOPBACK) {
+		msg(LOG_CRIT, "TPacketRing: interface %s has unsupported hardware type %u, use pcap capture mode",
+				interface.c_str(), ifr.ifr_hwaddr.sa_family);
+		goto out;
+	}
+	dataLinkType = DLT_EN10MB;
+
+	{
+		int version = TPACKET_V3;
+		if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+			msg(LOG_CRIT, "TPacketRing: kernel does not support TPACKET_V3: %s", strerror(errno));
+			goto out;
+		}
+	}
+
+	// truncate packets to the capture length before they are copied into the ring
+	// (replaced by setFilter() if a pcap filter is configured)
+	{
+		struct sock_filter snapcode = BPF_STMT(BPF_RET | BPF_K, snaplen);
+		struct sock_fprog snapprog;
+		snapprog.len = 1;
+		snapprog.filter = &snapcode;
+		if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &snapprog, sizeof(snapprog)) < 0) {
+			msg(LOG_ERR, "TPacketRing: failed to attach snaplen filter, whole frames are copied into the ring: %s", strerror(errno));
+		}
+	}
+
+	{
+		struct tpacket_req3 req;
+		memset(&req, 0, sizeof(req));
+		req.tp_block_size = blockSize;
+		req.tp_block_nr = blockCount;
+		req.tp_frame_size = TPACKET_ALIGN(TPACKET3_HDRLEN + snaplen);
+		req.tp_frame_nr = (blockSize / req.tp_frame_size) * blockCount;
+		req.tp_retire_blk_tov = DEFAULT_BLOCK_TIMEOUT;
+		req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+		if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+			msg(LOG_CRIT, "TPacketRing: failed to set up receive ring (%u blocks of %u bytes): %s", blockCount, blockSize, strerror(errno));
+			goto out;
+		}
+	}
+
+	ringSize = (size_t)blockSize * blockCount;
+	ring = (unsigned char*)mmap(NULL, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd, 0);
+	if (ring == MAP_FAILED) {
+		// MAP_LOCKED may fail due to RLIMIT_MEMLOCK, try again without it
+		ring = (unsigned char*)mmap(NULL, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	if (ring == MAP_FAILED) {
+		msg(LOG_CRIT, "TPacketRing: mmap of %zu bytes failed: %s", ringSize, strerror(errno));
+		ring = NULL;
+		goto out;
+	}
+
+	{
+		struct sockaddr_ll addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sll_family = AF_PACKET;
+		addr.sll_protocol = htons(ETH_P_ALL);
+		addr.sll_ifindex = ifindex;
+		if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+			msg(LOG_CRIT, "TPacketRing: bind to %s failed: %s", interface.c_str(), strerror(errno));
+			goto out;
+		}
+	}
+
+	if (promisc) {
+		struct packet_mreq mreq;
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.mr_ifindex = ifindex;
+		mreq.mr_type = PACKET_MR_PROMISC;
+		if (setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+			msg(LOG_ERR, "TPacketRing: failed to enable promiscuous mode on %s: %s", interface.c_str(), strerror(errno));
+		}
+	}
+
+	if (fanoutGroup >= 0) {
+		// PACKET_FANOUT_HASH keeps both directions of a flow on the same socket
+		int fanout = (fanoutGroup & 0xffff) | (PACKET_FANOUT_HASH << 16);
+		if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0) {
+			msg(LOG_CRIT, "TPacketRing: failed to join fanout group %d: %s", fanoutGroup, strerror(errno));
+			goto out;
+		}
+	}
+
+	msg(LOG_NOTICE, "TPacketRing: capturing on %s with %u blocks of %u bytes (fanout group %d)",
+			interface.c_str(), blockCount, blockSize, fanoutGroup);
+	return true;
+
+out:
+	close();
+	return false;
+}
+
+void TPacketRing::close()
+{
+	if (ring) {
+		munmap(ring, ringSize);
+		ring = NULL;
+	}
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+}
+
+/**
+ * attaches a BPF program compiled by pcap_compile() to the socket
+ * the program should have been compiled for our data link type and snaplen,
+ * so that its accept statements also truncate packets to the capture length
+ */
+bool TPacketRing::setFilter(struct bpf_program* program)
+{
+	struct sock_fprog prog;
+	prog.len = program->bf_len;
+	prog.filter = (struct sock_filter*)program->bf_insns;
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+		msg(LOG_CRIT, "TPacketRing: failed to attach filter: %s", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+int TPacketRing::getDataLinkType() const
+{
+	return dataLinkType;
+}
+
+/**
+ * returns the next block filled by the kernel, waits max. timeout_ms milliseconds for it
+ * @returns NULL if no block is available (timeout or interrupted system call)
+ */
+struct tpacket_block_desc* TPacketRing::nextBlock(int timeout_ms)
+{
+	struct tpacket_block_desc* block = (struct tpacket_block_desc*)(ring + (size_t)currentBlock * blockSize);
+
+	if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN | POLLERR;
+		pfd.revents = 0;
+		int result = poll(&pfd, 1, timeout_ms);
+		if (result < 0 && errno != EINTR) {
+			THROWEXCEPTION("TPacketRing: poll() on packet socket failed: %s", strerror(errno));
+		}
+		if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+			return NULL;
+	}
+
+	currentBlock = (currentBlock + 1) % blockCount;
+	return block;
+}
+
+/**
+ * hands the block back to the kernel, frames inside the block must not be accessed any more
+ */
+void TPacketRing::releaseBlock(struct tpacket_block_desc* block)
+{
+	__atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+}
+
+uint32_t TPacketRing::getFrameCount(const struct tpacket_block_desc* block) const
+{
+	return block->hdr.bh1.num_pkts;
+}
+
+bool TPacketRing::firstFrame(struct tpacket_block_desc* block, Frame* frame)
+{
+	framesLeft = block->hdr.bh1.num_pkts;
+	if (framesLeft == 0) return false;
+
+	currentFrame = (struct tpacket3_hdr*)((unsigned char*)block + block->hdr.bh1.offset_to_first_pkt);
+	fillFrame(frame);
+	return true;
+}
+
+bool TPacketRing::nextFrame(Frame* frame)
+{
+	if (--framesLeft == 0) return false;
+
+	currentFrame = (struct tpacket3_hdr*)((unsigned char*)currentFrame + currentFrame->tp_next_offset);
+	fillFrame(frame);
+	return true;
+}
+
+inline void TPacketRing::fillFrame(Frame* frame)
+{
+	frame->data = (const unsigned char*)currentFrame + currentFrame->tp_mac;
+	frame->caplen = currentFrame->tp_snaplen;
+	frame->len = currentFrame->tp_len;
+	frame->ts.tv_sec = currentFrame->tp_sec;
+	frame->ts.tv_usec = currentFrame->tp_nsec / 1000;
+}
+
+/**
+ * returns the number of received and dropped packets since the ring was opened
+ */
+bool TPacketRing::getStats(uint32_t* received, uint32_t* dropped)
+{
+	if (fd < 0) return false;
+
+	struct tpacket_stats_v3 stats;
+	socklen_t len = sizeof(stats);
+	if (getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) < 0)
+		return false;
+
+	// tp_packets includes the dropped packets
+	statReceived += stats.tp_packets;
+	statDropped += stats.tp_drops;
+	*received = statReceived;
+	*dropped = statDropped;
+	return true;
+}
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Vermont Packet Capturing
+ * Copyright (C) 2009 Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef TPACKETRING_H
+#define TPACKETRING_H
+
+#if defined(HAVE_TPACKET_V3)
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <string>
+
+#include <linux/if_packet.h>
+#include <pcap.h>
+
+/**
+ * Linux AF_PACKET capture socket with a memory mapped TPACKET_V3 receive ring.
+ *
+ * The kernel fills whole blocks of frames into the ring. A block is handed to
+ * the caller with nextBlock(), the frames inside it are walked with
+ * firstFrame()/nextFrame(), and the block is given back to the kernel with
+ * releaseBlock(). No system call is needed per packet, only poll() when the
+ * ring runs empty.
+ */
+class TPacketRing
+{
+public:
+	/**
+	 * frame inside a ring block, points directly into the mmap'ed ring
+	 */
+	struct Frame {
+		const unsigned char* data;
+		uint32_t caplen;
+		uint32_t len;
+		struct timeval ts;
+	};
+
+	// ms after which the kernel hands out a block that is not completely filled
+	static const uint32_t DEFAULT_BLOCK_TIMEOUT = 10;
+
+	TPacketRing(const std::string& interface, uint32_t blockSize, uint32_t blockCount,
+			uint32_t snaplen, bool promisc, int fanoutGroup);
+	~TPacketRing();
+
+	bool open();
+	void close();
+	bool setFilter(struct bpf_program* program);
+	int getDataLinkType() const;
+
+	struct tpacket_block_desc* nextBlock(int timeout_ms);
+	void releaseBlock(struct tpacket_block_desc* block);
+	uint32_t getFrameCount(const struct tpacket_block_desc* block) const;
+	bool firstFrame(struct tpacket_block_desc* block, Frame* frame);
+	bool nextFrame(Frame* frame);
+
+	bool getStats(uint32_t* received, uint32_t* dropped);
+
+private:
+	std::string interface;
+	uint32_t blockSize;
+	uint32_t blockCount;
+	uint32_t snaplen;
+	bool promisc;
+	int fanoutGroup;
+
+	int fd;
+	unsigned char* ring;
+	size_t ringSize;
+	uint32_t currentBlock;
+	int dataLinkType;
+
+	// frame cursor within the block returned by firstFrame()
+	struct tpacket3_hdr* currentFrame;
+	uint32_t framesLeft;
+
+	// statistics are reset by the kernel on every read, so we sum them up here
+	uint32_t statReceived;
+	uint32_t statDropped;
+
+	void fillFrame(Frame* frame);
+};
+
+#endif
+
+#endif
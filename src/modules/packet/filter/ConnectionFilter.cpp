@@ -22,20 +22,25 @@
 
 #include "ConnectionFilter.h"
 
-ConnectionFilter::ConnectionFilter(unsigned Timeout, unsigned bytes, unsigned hashFunctions, unsigned filterSize)
-	:  hashParams(hashFunctions), synFilter(&hashParams, filterSize, false), exportFilter(&hashParams, filterSize, false),
-	  connectionFilter(&hashParams, filterSize, false), timeout(Timeout), exportBytes(bytes), exportControlPackets(true)
+ConnectionFilter::ConnectionFilter(unsigned Timeout, unsigned bytes, unsigned hashFunctions, unsigned filterSize,
+		BloomFilterLayout layout)
+	:  hashParams(hashFunctions), synFilter(&hashParams, filterSize, false, layout),
+	  exportFilter(&hashParams, filterSize, false, layout), connectionFilter(&hashParams, filterSize, false, layout),
+	  timeout(Timeout), exportBytes(bytes), exportControlPackets(true)
 {
 	msg(LOG_NOTICE, "Created connectionFilter with parameters:");
 	msg(LOG_NOTICE, "\t - %i seconds timeout", timeout);
 	msg(LOG_NOTICE, "\t - %i bytes filter size", filterSize);
 	msg(LOG_NOTICE, "\t - %i hash functions", hashFunctions);
 	msg(LOG_NOTICE, "\t - %i bytes to export", bytes);
+	msg(LOG_NOTICE, "\t - %s filter layout", layout == BLOOM_LAYOUT_BLOCKED ? "blocked" : "standard");
 }
 
-ConnectionFilter::ConnectionFilter(unsigned Timeout, unsigned bytes, unsigned hashFunctions, unsigned filterSize, unsigned seed)
-	: hashParams(hashFunctions, seed), synFilter(&hashParams, filterSize, false), exportFilter(&hashParams, filterSize, false),
-	connectionFilter(&hashParams, filterSize, false), timeout(Timeout), exportBytes(bytes), exportControlPackets(true)
+ConnectionFilter::ConnectionFilter(unsigned Timeout, unsigned bytes, unsigned hashFunctions, unsigned filterSize, unsigned seed,
+		BloomFilterLayout layout)
+	: hashParams(hashFunctions, seed), synFilter(&hashParams, filterSize, false, layout),
+	exportFilter(&hashParams, filterSize, false, layout), connectionFilter(&hashParams, filterSize, false, layout),
+	timeout(Timeout), exportBytes(bytes), exportControlPackets(true)
 {
 	msg(LOG_NOTICE, "Created connectionFilter with parameters:");
 	msg(LOG_NOTICE, "\t - %i seed", seed);
@@ -43,6 +48,7 @@ ConnectionFilter::ConnectionFilter(unsigned Timeout, unsigned bytes, unsigned ha
 	msg(LOG_NOTICE, "\t - %i bytes filter size", filterSize);
 	msg(LOG_NOTICE, "\t - %i hash functions", hashFunctions);
 	msg(LOG_NOTICE, "\t - %i bytes to export", bytes);
+	msg(LOG_NOTICE, "\t - %s filter layout", layout == BLOOM_LAYOUT_BLOCKED ? "blocked" : "standard");
 }
 
 bool ConnectionFilter::processPacket(Packet* p)
@@ -64,23 +70,26 @@ bool ConnectionFilter::processPacket(Packet* p)
 		return false;
 	}
 
+	// all filters use the same hash parameters, so the key is hashed only once
+	BloomHash h = synFilter.hash(key.data, key.len);
+
 	if (*((uint8_t*)p->layer2Start + flagsOffset) & SYN) {
 		DPRINTF_INFO("ConnectionFilter: Got SYN packet");
-		synFilter.set(key.data, key.len, (agetime_t)p->timestamp.tv_sec);
-		DPRINTF_INFO("ConnectionFilter: synFilter saved time %u", synFilter.get(key.data, key.len));
+		synFilter.set(h, (agetime_t)p->timestamp.tv_sec);
+		DPRINTF_INFO("ConnectionFilter: synFilter saved time %u", synFilter.get(h));
 		return exportControlPackets;
 	} else if (*((uint8_t*)p->layer2Start + flagsOffset) & RST || *((uint8_t*)p->layer2Start + flagsOffset) & FIN) {
 		
 		DPRINTF_INFO("ConnectionFilter: Got %s packet", *((uint8_t*)p->layer2Start + flagsOffset) & RST?"RST":"FIN");
 	
-		exportFilter.set(key.data, key.len, -exportFilter.get(key.data, key.len));
-		connectionFilter.set(key.data, key.len, p->timestamp.tv_sec);
-		DPRINTF_INFO("ConnectionFilter: connectionFilter saved time %u", connectionFilter.get(key.data, key.len));
+		exportFilter.set(h, -exportFilter.get(h));
+		connectionFilter.set(h, p->timestamp.tv_sec);
+		DPRINTF_INFO("ConnectionFilter: connectionFilter saved time %u", connectionFilter.get(h));
 
 		return exportControlPackets;
 	} else {
 		DPRINTF_INFO("ConnectionFilter: Got a normal packet");
-		if ((tmp = exportFilter.get(key.data, key.len)) > 0) {
+		if ((tmp = exportFilter.get(h)) > 0) {
 			DPRINTF_INFO("ConnectionFilter: Connection known, exporting packet");
 			static unsigned diffVal;
 			bool ret = false;
@@ -92,25 +101,25 @@ bool ConnectionFilter::processPacket(Packet* p)
 				diffVal = -tmp;
 				ret = false;
 			}
-			exportFilter.set(key.data, key.len, diffVal);
-			if (exportFilter.get(key.data, key.len) <= 0) {
-				connectionFilter.set(key.data, key.len, p->timestamp.tv_sec);
+			exportFilter.set(h, diffVal);
+			if (exportFilter.get(h) <= 0) {
+				connectionFilter.set(h, p->timestamp.tv_sec);
 			}
-			DPRINTF_INFO("ConnectionFilter: We have to export %i bytes after exporting this packet", exportFilter.get(key.data, key.len));
+			DPRINTF_INFO("ConnectionFilter: We have to export %i bytes after exporting this packet", exportFilter.get(h));
 			return ret;
 		} else {
-			if ((unsigned)(p->timestamp.tv_sec - synFilter.get(key.data, key.len)) < timeout &&
-			    synFilter.get(key.data, key.len) - connectionFilter.get(key.data, key.len) > 0) {
+			if ((unsigned)(p->timestamp.tv_sec - synFilter.get(h)) < timeout &&
+			    synFilter.get(h) - connectionFilter.get(h) > 0) {
 				bool ret = false;
 			    	DPRINTF_INFO("ConnectionFilter: Found new connection, exporting packet");
 				if (payloadLen < exportBytes) {
-					exportFilter.set(key.data, key.len, exportBytes - payloadLen);
+					exportFilter.set(h, exportBytes - payloadLen);
 					ret = true;
 				} else {
-					connectionFilter.set(key.data, key.len, p->timestamp.tv_sec);
+					connectionFilter.set(h, p->timestamp.tv_sec);
 					ret = false;
 				}
-				DPRINTF_INFO("ConnectionFilter: We have to export %i bytes after exporting this packet", exportFilter.get(key.data, key.len));
+				DPRINTF_INFO("ConnectionFilter: We have to export %i bytes after exporting this packet", exportFilter.get(h));
 				return ret;
 			}
 			DPRINTF_INFO("ConnectionFilter: Paket will not be exported");
@@ -30,8 +30,10 @@
 
 class ConnectionFilter : public PacketProcessor {
 public:
-	ConnectionFilter(unsigned timeout, unsigned bytes, unsigned hashFunctions, unsigned FilterSize);
-	ConnectionFilter(unsigned timeout, unsigned bytes, unsigned hashFunctions, unsigned FilterSize, unsigned seed);
+	ConnectionFilter(unsigned timeout, unsigned bytes, unsigned hashFunctions, unsigned FilterSize,
+			BloomFilterLayout layout = BLOOM_LAYOUT_STANDARD);
+	ConnectionFilter(unsigned timeout, unsigned bytes, unsigned hashFunctions, unsigned FilterSize, unsigned seed,
+			BloomFilterLayout layout = BLOOM_LAYOUT_STANDARD);
 
 	virtual bool processPacket(Packet* p);
 	void setExportControlPackets(bool e) { exportControlPackets = e; }
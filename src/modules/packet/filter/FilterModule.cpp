@@ -71,6 +71,44 @@ void FilterModule::receive(Packet* p)
 	p->removeReference();
 }
 
+/*
+ runs all packets of the batch through the packetProcessors and forwards
+ the remaining packets to the receiver with a single call
+ */
+void FilterModule::receiveBatch(std::vector<Packet*>& batch)
+{
+	vector<PacketProcessor *>::iterator it;
+	size_t kept = 0;
+
+	for (size_t i = 0; i < batch.size(); i++) {
+		Packet* p = batch[i];
+		bool keepPacket = true;
+
+		for (it = processors.begin();
+		     it != processors.end() && keepPacket; ++it)
+		{
+			keepPacket = (*it)->processPacket(p);
+		}
+
+		if (keepPacket) {
+			batch[kept++] = p;
+		} else {
+			DPRINTF_INFO("FilterModule: releasing packet");
+			p->removeReference();
+		}
+	}
+	batch.resize(kept);
+
+	DPRINTF_INFO("FilterModule: pushing %zu packets", kept);
+	while (!exitFlag && !sendBatch(batch));
+
+	// sendBatch() clears batch on success, remaining packets were interrupted by shutdown
+	for (size_t i = 0; i < batch.size(); i++) {
+		batch[i]->removeReference();
+	}
+	batch.clear();
+}
+
 //FIXME: this function is unneccessary, only here to help restructuring
 bool FilterModule::hasReceiver()
 {
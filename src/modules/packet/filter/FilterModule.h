@@ -39,6 +39,7 @@ public:
 	virtual ~FilterModule();
 
 	virtual void receive(Packet *);
+	virtual void receiveBatch(std::vector<Packet*>& batch);
 
 	void addProcessor(PacketProcessor *p);
 	std::vector<PacketProcessor*> getProcessors();
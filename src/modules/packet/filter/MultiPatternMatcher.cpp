@@ -0,0 +1,246 @@
+/*
+ * Vermont Packet Filter
+ * Copyright (C) 2009  Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "MultiPatternMatcher.h"
+
+#include "common/msg.h"
+
+#include <string.h>
+#include <deque>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static const uint32_t NO_STATE = 0xFFFFFFFF;
+static const uint32_t OUTPUT_FLAG = 0x80000000;
+
+
+MultiPatternMatcher::MultiPatternMatcher()
+	: requiredCount(0),
+	  forbiddenCount(0),
+	  compiled(false),
+	  classCount(0),
+	  simdFirstByteCount(0),
+	  scanNumber(0)
+{
+	memset(classes, 0, sizeof(classes));
+	memset(firstByte, 0, sizeof(firstByte));
+}
+
+/**
+ * adds a pattern, compile() must be called afterwards
+ * empty patterns are ignored, a pattern may be both required and forbidden
+ */
+void MultiPatternMatcher::addPattern(const std::string& pattern, Kind kind)
+{
+	if (pattern.empty()) return;
+	compiled = false;
+
+	size_t i;
+	for (i = 0; i < patterns.size(); i++) {
+		if (patterns[i].bytes == pattern) break;
+	}
+	if (i == patterns.size()) {
+		Pattern p;
+		p.bytes = pattern;
+		p.required = false;
+		p.forbidden = false;
+		patterns.push_back(p);
+	}
+	if (kind == Required && !patterns[i].required) {
+		patterns[i].required = true;
+		requiredCount++;
+	} else if (kind == Forbidden && !patterns[i].forbidden) {
+		patterns[i].forbidden = true;
+		forbiddenCount++;
+	}
+}
+
+/**
+ * builds the automaton for all patterns added so far
+ */
+void MultiPatternMatcher::compile()
+{
+	// bytes which do not occur in any pattern share class 0
+	memset(classes, 0, sizeof(classes));
+	classCount = 1;
+	for (size_t i = 0; i < patterns.size(); i++) {
+		for (size_t j = 0; j < patterns[i].bytes.size(); j++) {
+			uint8_t b = patterns[i].bytes[j];
+			if (classes[b] == 0) classes[b] = classCount++;
+		}
+	}
+
+	// trie of all patterns
+	transitions.assign(classCount, NO_STATE);
+	Output none;
+	none.pattern = -1;
+	none.next = 0;
+	outputs.assign(1, none);
+	for (size_t i = 0; i < patterns.size(); i++) {
+		uint32_t state = 0;
+		for (size_t j = 0; j < patterns[i].bytes.size(); j++) {
+			uint32_t& next = transitions[state*classCount+classes[(uint8_t)patterns[i].bytes[j]]];
+			if (next == NO_STATE) {
+				next = outputs.size();
+				outputs.push_back(none);
+				transitions.resize(transitions.size()+classCount, NO_STATE);
+			}
+			state = transitions[state*classCount+classes[(uint8_t)patterns[i].bytes[j]]];
+		}
+		outputs[state].pattern = i;
+	}
+
+	// breadth first traversal to complete transitions using failure links
+	std::vector<uint32_t> fail(outputs.size(), 0);
+	std::deque<uint32_t> queue;
+	for (uint32_t c = 0; c < classCount; c++) {
+		uint32_t& next = transitions[c];
+		if (next == NO_STATE) {
+			next = 0;
+		} else {
+			queue.push_back(next);
+		}
+	}
+	while (!queue.empty()) {
+		uint32_t state = queue.front();
+		queue.pop_front();
+		for (uint32_t c = 0; c < classCount; c++) {
+			uint32_t& next = transitions[state*classCount+c];
+			uint32_t fallback = transitions[fail[state]*classCount+c];
+			if (next == NO_STATE) {
+				next = fallback;
+			} else {
+				fail[next] = fallback;
+				outputs[next].next = outputs[fallback].pattern >= 0 ? fallback : outputs[fallback].next;
+				queue.push_back(next);
+			}
+		}
+	}
+
+	// bytes which leave the initial state
+	simdFirstByteCount = 0;
+	uint32_t firstBytes = 0;
+	for (uint32_t b = 0; b < 256; b++) {
+		firstByte[b] = transitions[classes[b]] != 0;
+		if (!firstByte[b]) continue;
+		if (firstBytes < MAX_SIMD_FIRST_BYTES) simdFirstBytes[firstBytes] = b;
+		firstBytes++;
+	}
+#ifdef __SSE2__
+	if (firstBytes <= MAX_SIMD_FIRST_BYTES) simdFirstByteCount = firstBytes;
+#endif
+
+	// store offsets of rows instead of states and mark states with an output,
+	// so that matches() needs neither a multiplication nor a lookup of outputs per byte
+	for (size_t i = 0; i < transitions.size(); i++) {
+		uint32_t next = transitions[i];
+		bool output = outputs[next].pattern >= 0 || outputs[next].next != 0;
+		transitions[i] = next*classCount | (output ? OUTPUT_FLAG : 0);
+	}
+
+	seen.assign(patterns.size(), 0);
+	scanNumber = 0;
+	compiled = true;
+
+	DPRINTF_INFO("compiled %zu patterns into %zu states with %u byte classes", patterns.size(), outputs.size(), classCount);
+}
+
+/**
+ * @returns position of the next byte starting with pos which may start a pattern, or length
+ */
+inline size_t MultiPatternMatcher::skip(const uint8_t* data, size_t pos, size_t length) const
+{
+#ifdef __SSE2__
+	if (simdFirstByteCount > 0) {
+		__m128i needles[MAX_SIMD_FIRST_BYTES];
+		for (uint32_t i = 0; i < simdFirstByteCount; i++) {
+			needles[i] = _mm_set1_epi8(simdFirstBytes[i]);
+		}
+		while (pos+16 <= length) {
+			__m128i block = _mm_loadu_si128((const __m128i*)(data+pos));
+			__m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+			for (uint32_t i = 1; i < simdFirstByteCount; i++) {
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+			}
+			int mask = _mm_movemask_epi8(hits);
+			if (mask) return pos+__builtin_ctz(mask);
+			pos += 16;
+		}
+	}
+#endif
+	while (pos < length && !firstByte[data[pos]]) pos++;
+	return pos;
+}
+
+/**
+ * @returns true if data contains all required and none of the forbidden patterns
+ */
+bool MultiPatternMatcher::matches(const uint8_t* data, size_t length)
+{
+	if (!compiled) THROWEXCEPTION("MultiPatternMatcher: compile() must be called before matches()");
+	if (patterns.empty()) return true;
+
+	if (++scanNumber == 0) {
+		// counter wrapped, entries of seen might be mistaken as current
+		seen.assign(patterns.size(), 0);
+		scanNumber = 1;
+	}
+
+	uint32_t found = 0;
+	uint32_t row = 0;
+	size_t pos = 0;
+	while (pos < length) {
+		if (row == 0) {
+			pos = skip(data, pos, length);
+			if (pos == length) break;
+		}
+		uint32_t next = transitions[row+classes[data[pos]]];
+		pos++;
+		row = next & ~OUTPUT_FLAG;
+		if (!(next & OUTPUT_FLAG)) continue;
+
+		const Output* out = &outputs[row/classCount];
+		if (out->pattern < 0) out = &outputs[out->next];
+		while (true) {
+			const Pattern& p = patterns[out->pattern];
+			if (p.forbidden) return false;
+			if (seen[out->pattern] != scanNumber) {
+				seen[out->pattern] = scanNumber;
+				found++;
+				if (found == requiredCount && forbiddenCount == 0) return true;
+			}
+			if (out->next == 0) break;
+			out = &outputs[out->next];
+		}
+	}
+	return found == requiredCount;
+}
+
+uint32_t MultiPatternMatcher::getPatternCount() const
+{
+	return patterns.size();
+}
+
+uint32_t MultiPatternMatcher::getStateCount() const
+{
+	return outputs.size();
+}
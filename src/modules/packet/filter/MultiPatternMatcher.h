@@ -0,0 +1,99 @@
+/*
+ * Vermont Packet Filter
+ * Copyright (C) 2009  Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/** @file
+ * Matches a set of byte strings against packet payload in a single pass
+ */
+
+#ifndef MULTIPATTERNMATCHER_H
+#define MULTIPATTERNMATCHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * Aho-Corasick automaton for a set of required and forbidden byte strings.
+ *
+ * compile() builds a deterministic automaton whose transitions are stored in one table,
+ * bytes not contained in any pattern share a single column of the table. While the
+ * automaton is in its initial state, bytes which cannot start a pattern are skipped:
+ * with SSE2 16 bytes are compared at once if the patterns start with at most
+ * MAX_SIMD_FIRST_BYTES different bytes, otherwise a lookup table is used.
+ * matches() evaluates all patterns in one pass over the data and stops as soon as the
+ * result is known.
+ *
+ * ATTENTION: matches() is not thread-safe as it uses internal state of the matcher
+ */
+class MultiPatternMatcher
+{
+public:
+	enum Kind {
+		Required, /**< pattern must be contained in data */
+		Forbidden /**< pattern must not be contained in data */
+	};
+
+	MultiPatternMatcher();
+
+	void addPattern(const std::string& pattern, Kind kind);
+	void compile();
+	bool matches(const uint8_t* data, size_t length);
+
+	uint32_t getPatternCount() const;
+	uint32_t getStateCount() const;
+
+private:
+	static const uint32_t MAX_SIMD_FIRST_BYTES = 4;
+
+	struct Pattern {
+		std::string bytes;
+		bool required;
+		bool forbidden;
+	};
+
+	/**
+	 * output of a state of the automaton
+	 */
+	struct Output {
+		int32_t pattern; /**< index of the pattern ending in this state, -1 if none */
+		uint32_t next; /**< next state on the suffix chain with an output, 0 if none */
+	};
+
+	std::vector<Pattern> patterns;
+	uint32_t requiredCount;
+	uint32_t forbiddenCount;
+	bool compiled;
+
+	uint8_t classes[256]; /**< column of each byte in the transition table */
+	uint32_t classCount;
+	std::vector<uint32_t> transitions; /**< next state for each state and byte class */
+	std::vector<Output> outputs;
+	bool firstByte[256]; /**< bytes which start at least one pattern */
+	uint8_t simdFirstBytes[MAX_SIMD_FIRST_BYTES];
+	uint32_t simdFirstByteCount; /**< 0 if the lookup table is used for skipping */
+
+	std::vector<uint32_t> seen; /**< number of last scan in which each pattern was found */
+	uint32_t scanNumber;
+
+	size_t skip(const uint8_t* data, size_t pos, size_t length) const;
+};
+
+#endif
@@ -0,0 +1,731 @@
+/*
+ * Vermont Packet Filter
+ * Copyright (C) 2009  Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "MultiRegexMatcher.h"
+
+#include "common/msg.h"
+
+#include <algorithm>
+#include <string.h>
+
+static const uint32_t NO_NODE = 0xFFFFFFFF;
+static const uint32_t UNKNOWN = 0xFFFFFFFF;
+static const uint32_t ACCEPT_FLAG = 0x80000000;
+static const uint32_t MAX_NODES = 100000; /**< expressions exceeding this are matched with boost::regex */
+static const int MAX_REPEAT = 1000;
+
+
+/**
+ * node of the syntax tree of an expression
+ */
+struct MultiRegexMatcher::AstNode {
+	enum Kind { Bytes, Concat, Alt, Repeat, Begin, End };
+
+	Kind kind;
+	uint32_t set; /**< index in sets for Bytes */
+	int min;
+	int max; /**< -1 for unbounded repetitions */
+	std::vector<uint32_t> children;
+};
+
+/**
+ * recursive descent parser for the supported subset of Perl syntax
+ * throws Unsupported for everything else, including syntax errors which are reported by boost::regex
+ */
+class MultiRegexMatcher::Parser
+{
+public:
+	Parser(const std::string& expression, std::vector<ByteSet>& sets, std::vector<AstNode>& ast)
+		: expr(expression), pos(0), sets(sets), ast(ast)
+	{
+	}
+
+	uint32_t parse()
+	{
+		uint32_t root = parseAlternation();
+		if (pos != expr.size()) throw Unsupported();
+		return root;
+	}
+
+private:
+	const std::string& expr;
+	size_t pos;
+	std::vector<ByteSet>& sets;
+	std::vector<AstNode>& ast;
+
+	bool atEnd() const { return pos >= expr.size(); }
+	char peek() const { return expr[pos]; }
+
+	uint32_t newNode(AstNode::Kind kind)
+	{
+		AstNode n;
+		n.kind = kind;
+		n.set = 0;
+		n.min = n.max = 0;
+		ast.push_back(n);
+		return ast.size()-1;
+	}
+
+	uint32_t newBytes(const ByteSet& set)
+	{
+		uint32_t n = newNode(AstNode::Bytes);
+		for (size_t i = 0; i < sets.size(); i++) {
+			if (sets[i] == set) {
+				ast[n].set = i;
+				return n;
+			}
+		}
+		sets.push_back(set);
+		ast[n].set = sets.size()-1;
+		return n;
+	}
+
+	uint32_t parseAlternation()
+	{
+		uint32_t first = parseConcatenation();
+		if (atEnd() || peek() != '|') return first;
+		uint32_t alt = newNode(AstNode::Alt);
+		ast[alt].children.push_back(first);
+		while (!atEnd() && peek() == '|') {
+			pos++;
+			uint32_t c = parseConcatenation();
+			ast[alt].children.push_back(c);
+		}
+		return alt;
+	}
+
+	uint32_t parseConcatenation()
+	{
+		uint32_t concat = newNode(AstNode::Concat);
+		while (!atEnd() && peek() != '|' && peek() != ')') {
+			uint32_t c = parseRepetition();
+			ast[concat].children.push_back(c);
+		}
+		return concat;
+	}
+
+	bool parseNumber(int& value)
+	{
+		size_t start = pos;
+		value = 0;
+		while (!atEnd() && peek() >= '0' && peek() <= '9') {
+			value = value*10 + (peek()-'0');
+			if (value > MAX_REPEAT) throw Unsupported();
+			pos++;
+		}
+		return pos > start;
+	}
+
+	uint32_t parseRepetition()
+	{
+		uint32_t atom = parseAtom();
+		while (!atEnd()) {
+			int min, max;
+			char c = peek();
+			if (c == '*') {
+				min = 0;
+				max = -1;
+				pos++;
+			} else if (c == '+') {
+				min = 1;
+				max = -1;
+				pos++;
+			} else if (c == '?') {
+				min = 0;
+				max = 1;
+				pos++;
+			} else if (c == '{') {
+				pos++;
+				if (!parseNumber(min)) throw Unsupported();
+				max = min;
+				if (!atEnd() && peek() == ',') {
+					pos++;
+					if (!parseNumber(max)) max = -1;
+				}
+				if (atEnd() || peek() != '}' || (max != -1 && max < min)) throw Unsupported();
+				pos++;
+			} else {
+				break;
+			}
+			// lazy quantifiers do not change whether an expression matches, possessive ones do
+			if (!atEnd() && peek() == '?') pos++;
+			else if (!atEnd() && peek() == '+') throw Unsupported();
+
+			AstNode::Kind kind = ast[atom].kind;
+			if (kind == AstNode::Begin || kind == AstNode::End) throw Unsupported();
+			uint32_t rep = newNode(AstNode::Repeat);
+			ast[rep].min = min;
+			ast[rep].max = max;
+			ast[rep].children.push_back(atom);
+			atom = rep;
+		}
+		return atom;
+	}
+
+	uint32_t parseAtom()
+	{
+		char c = peek();
+		pos++;
+		switch (c) {
+			case '(':
+				{
+					if (!atEnd() && peek() == '?') {
+						if (pos+1 >= expr.size() || expr[pos+1] != ':') throw Unsupported();
+						pos += 2;
+					}
+					uint32_t n = parseAlternation();
+					if (atEnd() || peek() != ')') throw Unsupported();
+					pos++;
+					return n;
+				}
+			case '*':
+			case '+':
+			case '?':
+			case '{':
+				throw Unsupported();
+			case '^':
+				return newNode(AstNode::Begin);
+			case '$':
+				return newNode(AstNode::End);
+			case '.':
+				return newBytes(ByteSet().set());
+			case '[':
+				return newBytes(parseClass());
+			case '\\':
+				{
+					ByteSet set;
+					parseEscape(set);
+					return newBytes(set);
+				}
+			default:
+				{
+					ByteSet set;
+					set.set((uint8_t)c);
+					return newBytes(set);
+				}
+		}
+	}
+
+	static int hexValue(char c)
+	{
+		if (c >= '0' && c <= '9') return c-'0';
+		if (c >= 'a' && c <= 'f') return c-'a'+10;
+		if (c >= 'A' && c <= 'F') return c-'A'+10;
+		return -1;
+	}
+
+	/**
+	 * parses an escape sequence after the backslash
+	 * @returns true if the sequence denotes a single byte
+	 */
+	bool parseEscape(ByteSet& set)
+	{
+		if (atEnd()) throw Unsupported();
+		char c = peek();
+		pos++;
+		ByteSet s;
+		bool negate = false;
+		switch (c) {
+			case 'D':
+				negate = true;
+				// fall through
+			case 'd':
+				for (int b = '0'; b <= '9'; b++) s.set(b);
+				break;
+			case 'W':
+				negate = true;
+				// fall through
+			case 'w':
+				for (int b = 0; b < 256; b++) {
+					if ((b >= 'a' && b <= 'z') || (b >= 'A' && b <= 'Z') || (b >= '0' && b <= '9') || b == '_') s.set(b);
+				}
+				break;
+			case 'S':
+				negate = true;
+				// fall through
+			case 's':
+				s.set(' ').set('\t').set('\n').set('\v').set('\f').set('\r');
+				break;
+			case 'n': s.set('\n'); break;
+			case 'r': s.set('\r'); break;
+			case 't': s.set('\t'); break;
+			case 'f': s.set('\f'); break;
+			case 'v': s.set('\v'); break;
+			case 'a': s.set('\a'); break;
+			case 'e': s.set(0x1B); break;
+			case 'x':
+				{
+					if (pos+1 >= expr.size()) throw Unsupported();
+					int hi = hexValue(expr[pos]);
+					int lo = hexValue(expr[pos+1]);
+					if (hi < 0 || lo < 0) throw Unsupported();
+					pos += 2;
+					s.set(hi*16+lo);
+					break;
+				}
+			default:
+				// back references, assertions and other escaped letters are not supported
+				if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) throw Unsupported();
+				s.set((uint8_t)c);
+				break;
+		}
+		if (negate) s.flip();
+		set |= s;
+		return s.count() == 1;
+	}
+
+	/**
+	 * parses a single byte or escape sequence inside of a character class
+	 * @returns byte value or -1 if a set of bytes was added
+	 */
+	int parseClassElement(ByteSet& set)
+	{
+		if (atEnd()) throw Unsupported();
+		char c = peek();
+		pos++;
+		if (c == '[' && !atEnd() && (peek() == ':' || peek() == '.' || peek() == '=')) throw Unsupported();
+		if (c != '\\') return (uint8_t)c;
+		ByteSet s;
+		if (!parseEscape(s)) {
+			set |= s;
+			return -1;
+		}
+		for (int b = 0; b < 256; b++) {
+			if (s.test(b)) return b;
+		}
+		return -1;
+	}
+
+	ByteSet parseClass()
+	{
+		ByteSet set;
+		bool negate = false;
+		if (!atEnd() && peek() == '^') {
+			negate = true;
+			pos++;
+		}
+		bool first = true;
+		while (true) {
+			if (atEnd()) throw Unsupported();
+			if (peek() == ']' && !first) {
+				pos++;
+				break;
+			}
+			first = false;
+			int lo = parseClassElement(set);
+			if (lo < 0) continue;
+			if (pos+1 < expr.size() && peek() == '-' && expr[pos+1] != ']') {
+				pos++;
+				int hi = parseClassElement(set);
+				if (hi < 0 || hi < lo) throw Unsupported();
+				for (int b = lo; b <= hi; b++) set.set(b);
+			} else {
+				set.set(lo);
+			}
+		}
+		if (negate) set.flip();
+		return set;
+	}
+};
+
+
+MultiRegexMatcher::MultiRegexMatcher(uint32_t maxStates)
+	: maxStates(maxStates < 3 ? 3 : maxStates),
+	  regexCount(0),
+	  compiled(false),
+	  classCount(0),
+	  cacheFlushes(0),
+	  closureNumber(0),
+	  scanNumber(0)
+{
+}
+
+MultiRegexMatcher::~MultiRegexMatcher()
+{
+	for (size_t i = 0; i < fallbacks.size(); i++) {
+		delete fallbacks[i];
+	}
+}
+
+uint32_t MultiRegexMatcher::addNode(NodeType type, uint32_t out, uint32_t out1, uint32_t arg)
+{
+	if (nodes.size() >= MAX_NODES) throw Unsupported();
+	Node n;
+	n.type = type;
+	n.out = out;
+	n.out1 = out1;
+	n.arg = arg;
+	nodes.push_back(n);
+	return nodes.size()-1;
+}
+
+/**
+ * creates the nodes for the given subtree which continue with node next
+ * @returns first node of the subtree
+ */
+uint32_t MultiRegexMatcher::emit(const std::vector<AstNode>& ast, uint32_t index, uint32_t next)
+{
+	const AstNode& n = ast[index];
+	switch (n.kind) {
+		case AstNode::Bytes:
+			return addNode(NODE_BYTES, next, NO_NODE, n.set);
+		case AstNode::Begin:
+			return addNode(NODE_BEGIN, next, NO_NODE, 0);
+		case AstNode::End:
+			return addNode(NODE_END, next, NO_NODE, 0);
+		case AstNode::Concat:
+			for (size_t i = n.children.size(); i > 0; i--) {
+				next = emit(ast, n.children[i-1], next);
+			}
+			return next;
+		case AstNode::Alt:
+			{
+				uint32_t entry = emit(ast, n.children.back(), next);
+				for (size_t i = n.children.size()-1; i > 0; i--) {
+					entry = addNode(NODE_SPLIT, emit(ast, n.children[i-1], next), entry, 0);
+				}
+				return entry;
+			}
+		case AstNode::Repeat:
+			{
+				uint32_t tail = next;
+				if (n.max < 0) {
+					// the loop node is patched after its body was created
+					tail = addNode(NODE_SPLIT, NO_NODE, next, 0);
+					uint32_t body = emit(ast, n.children[0], tail);
+					nodes[tail].out = body;
+				} else {
+					for (int i = n.min; i < n.max; i++) {
+						tail = addNode(NODE_SPLIT, emit(ast, n.children[0], tail), next, 0);
+					}
+				}
+				for (int i = 0; i < n.min; i++) {
+					tail = emit(ast, n.children[0], tail);
+				}
+				return tail;
+			}
+	}
+	return next;
+}
+
+/**
+ * adds a regular expression
+ * @returns index of the expression, used in the result of scan()
+ */
+uint32_t MultiRegexMatcher::addRegex(const std::string& expression)
+{
+	if (compiled) THROWEXCEPTION("MultiRegexMatcher: expressions must be added before compile() is called");
+
+	uint32_t index = regexCount++;
+	size_t nodeCount = nodes.size();
+	size_t setCount = sets.size();
+	try {
+		std::vector<AstNode> ast;
+		Parser parser(expression, sets, ast);
+		uint32_t root = parser.parse();
+		uint32_t match = addNode(NODE_MATCH, NO_NODE, NO_NODE, index);
+		starts.push_back(emit(ast, root, match));
+	} catch (Unsupported&) {
+		nodes.resize(nodeCount);
+		sets.resize(setCount);
+
+		Fallback* f = new Fallback;
+		f->regex = index;
+		try {
+			f->expression.assign(expression);
+		} catch (boost::regex_error& e) {
+			delete f;
+			THROWEXCEPTION("MultiRegexMatcher: invalid regular expression '%s': %s", expression.c_str(), e.what());
+		}
+		fallbacks.push_back(f);
+		msg(LOG_NOTICE, "MultiRegexMatcher: expression '%s' is not supported by the automaton, using boost::regex", expression.c_str());
+	}
+	return index;
+}
+
+/**
+ * determines classes of bytes which are contained in the same sets
+ */
+void MultiRegexMatcher::computeClasses()
+{
+	memset(classes, 0, sizeof(classes));
+	classCount = 1;
+	for (size_t i = 0; i < sets.size(); i++) {
+		// split every class into the bytes inside and outside of the set
+		int map[512];
+		for (int k = 0; k < 512; k++) map[k] = -1;
+		uint32_t count = 0;
+		for (int b = 0; b < 256; b++) {
+			int key = classes[b]*2 + (sets[i].test(b) ? 1 : 0);
+			if (map[key] < 0) map[key] = count++;
+			classes[b] = map[key];
+		}
+		classCount = count;
+	}
+	for (int b = 255; b >= 0; b--) {
+		representatives[classes[b]] = b;
+	}
+}
+
+/**
+ * builds the initial state of the automaton, must be called after all expressions were added
+ */
+void MultiRegexMatcher::compile()
+{
+	if (compiled) return;
+
+	seen.assign(regexCount, 0);
+	closureMark.assign(nodes.size(), 0);
+	if (!starts.empty()) {
+		computeClasses();
+		std::vector<uint32_t> seeds = starts;
+		closure(seeds, true, false, initialNodes);
+		flush();
+		cacheFlushes = 0;
+	}
+	compiled = true;
+}
+
+/**
+ * determines all nodes reachable from seeds without consuming a byte
+ * @param seeds nodes to start from, used as stack
+ * @param atBegin nodes of type NODE_BEGIN are passed
+ * @param atEnd nodes of type NODE_END are passed
+ * @param result sorted nodes which consume a byte, match or wait for the end of data
+ */
+void MultiRegexMatcher::closure(std::vector<uint32_t>& seeds, bool atBegin, bool atEnd, std::vector<uint32_t>& result)
+{
+	if (++closureNumber == 0) {
+		closureMark.assign(nodes.size(), 0);
+		closureNumber = 1;
+	}
+	result.clear();
+	while (!seeds.empty()) {
+		uint32_t id = seeds.back();
+		seeds.pop_back();
+		if (closureMark[id] == closureNumber) continue;
+		closureMark[id] = closureNumber;
+
+		const Node& n = nodes[id];
+		switch (n.type) {
+			case NODE_SPLIT:
+				seeds.push_back(n.out1);
+				seeds.push_back(n.out);
+				break;
+			case NODE_BEGIN:
+				if (atBegin) seeds.push_back(n.out);
+				break;
+			case NODE_END:
+				if (atEnd) seeds.push_back(n.out);
+				else result.push_back(id);
+				break;
+			case NODE_BYTES:
+			case NODE_MATCH:
+				result.push_back(id);
+				break;
+		}
+	}
+	std::sort(result.begin(), result.end());
+}
+
+/**
+ * @returns index of the state consisting of the given nodes, a new state is created if needed
+ */
+uint32_t MultiRegexMatcher::getState(const std::vector<uint32_t>& stateNodes)
+{
+	std::map<std::vector<uint32_t>, uint32_t>::iterator it = stateIndex.find(stateNodes);
+	if (it != stateIndex.end()) return it->second;
+
+	State s;
+	s.nodes = stateNodes;
+	s.endComputed = false;
+	for (size_t i = 0; i < stateNodes.size(); i++) {
+		const Node& n = nodes[stateNodes[i]];
+		if (n.type == NODE_MATCH) s.accepts.push_back(n.arg);
+	}
+	states.push_back(s);
+	transitions.resize(transitions.size()+classCount, UNKNOWN);
+	stateIndex[stateNodes] = states.size()-1;
+	return states.size()-1;
+}
+
+/**
+ * removes all states except for the initial one
+ */
+void MultiRegexMatcher::flush()
+{
+	states.clear();
+	stateIndex.clear();
+	transitions.clear();
+	getState(initialNodes);
+	cacheFlushes++;
+}
+
+/**
+ * determines the transition of the state in the given row for a byte class
+ * @param row row of the current state, updated if the states were flushed
+ * @returns new entry of the transition table
+ */
+uint32_t MultiRegexMatcher::computeTransition(uint32_t& row, uint32_t cls)
+{
+	std::vector<uint32_t> current = states[row/classCount].nodes;
+	uint8_t byte = representatives[cls];
+
+	// expressions may start at every position of the data
+	std::vector<uint32_t> seeds = starts;
+	for (size_t i = 0; i < current.size(); i++) {
+		const Node& n = nodes[current[i]];
+		if (n.type == NODE_BYTES && sets[n.arg].test(byte)) seeds.push_back(n.out);
+	}
+	std::vector<uint32_t> next;
+	closure(seeds, false, false, next);
+
+	if (stateIndex.find(next) == stateIndex.end() && states.size() >= maxStates) {
+		flush();
+		row = getState(current)*classCount;
+	}
+	uint32_t target = getState(next);
+	uint32_t entry = target*classCount | (states[target].accepts.empty() ? 0 : ACCEPT_FLAG);
+	transitions[row+cls] = entry;
+	return entry;
+}
+
+void MultiRegexMatcher::report(const std::vector<uint32_t>& accepts)
+{
+	for (size_t i = 0; i < accepts.size(); i++) {
+		uint32_t r = accepts[i];
+		if (seen[r] == scanNumber) continue;
+		seen[r] = scanNumber;
+		matches.push_back(r);
+	}
+}
+
+/**
+ * matches all expressions against data in one pass
+ * the indices of matching expressions are available with getMatches() afterwards
+ * @param complete true if data ends where the original data ends, otherwise $ does not match
+ * @returns number of matching expressions
+ */
+uint32_t MultiRegexMatcher::scan(const uint8_t* data, size_t length, bool complete)
+{
+	if (!compiled) THROWEXCEPTION("MultiRegexMatcher: compile() must be called before scan()");
+
+	if (++scanNumber == 0) {
+		seen.assign(regexCount, 0);
+		scanNumber = 1;
+	}
+	matches.clear();
+
+	if (!starts.empty()) {
+		uint32_t automatonRegexes = regexCount-fallbacks.size();
+		uint32_t row = 0;
+		report(states[0].accepts);
+
+		size_t pos = 0;
+		while (pos < length && matches.size() < automatonRegexes) {
+			uint32_t cls = classes[data[pos]];
+			uint32_t next = transitions[row+cls];
+			pos++;
+			if (!(next & ACCEPT_FLAG)) {
+				row = next;
+				continue;
+			}
+			if (next == UNKNOWN) next = computeTransition(row, cls);
+			row = next & ~ACCEPT_FLAG;
+			if (next & ACCEPT_FLAG) report(states[row/classCount].accepts);
+		}
+
+		if (pos == length && complete && matches.size() < automatonRegexes) {
+			State& s = states[row/classCount];
+			std::vector<uint32_t> seeds;
+			for (size_t i = 0; i < s.nodes.size(); i++) {
+				if (nodes[s.nodes[i]].type == NODE_END) seeds.push_back(nodes[s.nodes[i]].out);
+			}
+			if (length == 0) {
+				// ^ and $ both match in empty data, these accepts are not cached in the state
+				std::vector<uint32_t> result;
+				std::vector<uint32_t> accepts;
+				closure(seeds, true, true, result);
+				for (size_t i = 0; i < result.size(); i++) {
+					if (nodes[result[i]].type == NODE_MATCH) accepts.push_back(nodes[result[i]].arg);
+				}
+				report(accepts);
+			} else {
+				if (!s.endComputed) {
+					std::vector<uint32_t> result;
+					closure(seeds, false, true, result);
+					for (size_t i = 0; i < result.size(); i++) {
+						if (nodes[result[i]].type == NODE_MATCH) s.endAccepts.push_back(nodes[result[i]].arg);
+					}
+					s.endComputed = true;
+				}
+				report(s.endAccepts);
+			}
+		}
+	}
+
+	boost::match_flag_type flags = boost::match_default | boost::match_single_line;
+	if (!complete) flags |= boost::match_not_eol;
+	for (size_t i = 0; i < fallbacks.size(); i++) {
+		const char* begin = (const char*)data;
+		if (boost::regex_search(begin, begin+length, fallbacks[i]->expression, flags)) {
+			matches.push_back(fallbacks[i]->regex);
+		}
+	}
+
+	return matches.size();
+}
+
+/**
+ * @returns indices of the expressions which matched in the last call of scan()
+ */
+const std::vector<uint32_t>& MultiRegexMatcher::getMatches() const
+{
+	return matches;
+}
+
+uint32_t MultiRegexMatcher::getRegexCount() const
+{
+	return regexCount;
+}
+
+/**
+ * @returns number of expressions which are matched with boost::regex
+ */
+uint32_t MultiRegexMatcher::getFallbackCount() const
+{
+	return fallbacks.size();
+}
+
+/**
+ * @returns number of states of the automaton which are currently built
+ */
+uint32_t MultiRegexMatcher::getStateCount() const
+{
+	return states.size();
+}
+
+/**
+ * @returns number of times the states were discarded because maxStates was reached
+ */
+uint64_t MultiRegexMatcher::getCacheFlushes() const
+{
+	return cacheFlushes;
+}
@@ -0,0 +1,144 @@
+/*
+ * Vermont Packet Filter
+ * Copyright (C) 2009  Vermont Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/** @file
+ * Matches a set of regular expressions against packet payload in a single pass
+ */
+
+#ifndef MULTIREGEXMATCHER_H
+#define MULTIREGEXMATCHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <bitset>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/regex.hpp>
+
+/**
+ * Lazily built deterministic automaton for a set of regular expressions.
+ *
+ * All expressions are translated into one nondeterministic automaton (Thompson construction).
+ * States of the deterministic automaton are sets of its states and are created on demand
+ * while data is scanned, so only states which are actually reached are built. Their
+ * transitions are stored in one table with a column per byte class. If more than maxStates
+ * states are needed, the table is flushed and rebuilt from the current state, which bounds
+ * the memory used by expressions with a large deterministic automaton.
+ *
+ * Supported is the common subset of Perl syntax: literals, escapes (\\d \\w \\s \\xHH ...),
+ * character classes, '.', grouping, alternation and the quantifiers * + ? {n,m}. '.' matches
+ * any byte, ^ and $ match at the start and the end of the data only. Expressions which use
+ * other features (e.g. back references or assertions) are matched with boost::regex on the
+ * same data instead.
+ *
+ * ATTENTION: scan() is not thread-safe as it extends the automaton
+ */
+class MultiRegexMatcher
+{
+public:
+	static const uint32_t DEFAULT_MAX_STATES = 2000;
+
+	MultiRegexMatcher(uint32_t maxStates = DEFAULT_MAX_STATES);
+	~MultiRegexMatcher();
+
+	uint32_t addRegex(const std::string& expression);
+	void compile();
+	uint32_t scan(const uint8_t* data, size_t length, bool complete);
+	const std::vector<uint32_t>& getMatches() const;
+
+	uint32_t getRegexCount() const;
+	uint32_t getFallbackCount() const;
+	uint32_t getStateCount() const;
+	uint64_t getCacheFlushes() const;
+
+private:
+	typedef std::bitset<256> ByteSet;
+
+	enum NodeType {
+		NODE_BYTES, /**< consumes a byte contained in sets[arg] */
+		NODE_SPLIT, /**< continues with out and out1 */
+		NODE_BEGIN, /**< continues with out at start of data */
+		NODE_END, /**< continues with out at end of data */
+		NODE_MATCH /**< expression arg matched */
+	};
+
+	struct Node {
+		NodeType type;
+		uint32_t out;
+		uint32_t out1;
+		uint32_t arg;
+	};
+
+	/**
+	 * state of the deterministic automaton
+	 */
+	struct State {
+		std::vector<uint32_t> nodes; /**< sorted nodes of types NODE_BYTES, NODE_END and NODE_MATCH */
+		std::vector<uint32_t> accepts; /**< expressions matched when entering this state */
+		std::vector<uint32_t> endAccepts; /**< expressions matched when data ends in this state */
+		bool endComputed;
+	};
+
+	struct AstNode;
+	class Parser;
+	class Unsupported {};
+
+	struct Fallback {
+		uint32_t regex;
+		boost::regex expression;
+	};
+
+	uint32_t maxStates;
+	uint32_t regexCount;
+	bool compiled;
+
+	std::vector<Node> nodes;
+	std::vector<ByteSet> sets;
+	std::vector<uint32_t> starts; /**< first node of each expression */
+	std::vector<Fallback*> fallbacks;
+
+	uint8_t classes[256]; /**< column of each byte in the transition table */
+	uint8_t representatives[256]; /**< a byte of each class */
+	uint32_t classCount;
+
+	std::vector<State> states;
+	std::map<std::vector<uint32_t>, uint32_t> stateIndex;
+	std::vector<uint32_t> transitions; /**< row of next state for each state and byte class */
+	std::vector<uint32_t> initialNodes;
+	uint64_t cacheFlushes;
+
+	std::vector<uint32_t> closureMark;
+	uint32_t closureNumber;
+	std::vector<uint32_t> seen; /**< number of last scan in which each expression matched */
+	uint32_t scanNumber;
+	std::vector<uint32_t> matches;
+
+	uint32_t addNode(NodeType type, uint32_t out, uint32_t out1, uint32_t arg);
+	uint32_t emit(const std::vector<AstNode>& ast, uint32_t index, uint32_t next);
+	void computeClasses();
+	void closure(std::vector<uint32_t>& seeds, bool atBegin, bool atEnd, std::vector<uint32_t>& result);
+	uint32_t getState(const std::vector<uint32_t>& nodes);
+	void flush();
+	uint32_t computeTransition(uint32_t& row, uint32_t cls);
+	void report(const std::vector<uint32_t>& accepts);
+};
+
+#endif
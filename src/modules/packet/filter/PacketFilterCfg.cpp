@@ -258,6 +258,7 @@ Module* PacketStringFilterCfg::getInstance()
 			continue;
 		}
 	}
+	instance->compile();
 
 	return (Module*)instance;
 }
@@ -287,17 +288,42 @@ bool PacketStringFilterCfg::deriveFrom(PacketStringFilterCfg* old)
 
 Module* PacketRegexFilterCfg::getInstance()
 {
-	if (!instance)
-		instance = new RegExFilter();
+	if (!instance) {
+		instance = new RegExFilter(getInt("scanDepth", 0));
+
+		std::vector<std::string> patterns = getPatterns();
+		if (patterns.empty())
+			THROWEXCEPTION("regexBased filter needs at least one matchPattern");
+		for (size_t i = 0; i < patterns.size(); i++) {
+			instance->addRegex(patterns[i]);
+		}
+		instance->compile();
+	}
 
-	instance->match = get("matchPattern");
-	instance->regcre();
 	return (Module*)instance;
 }
 
+/**
+ * @returns expressions of all matchPattern elements
+ */
+std::vector<std::string> PacketRegexFilterCfg::getPatterns()
+{
+	std::vector<std::string> patterns;
+	XMLNode::XMLSet<XMLElement*> set = _elem->getElementChildren();
+	for (XMLNode::XMLSet<XMLElement*>::iterator it = set.begin(); it != set.end(); it++) {
+		XMLElement* e = *it;
+		if (e->matches("matchPattern")) {
+			patterns.push_back(e->getFirstText());
+		} else if (!e->matches("scanDepth")) {
+			msg(LOG_CRIT, "Unkown regex packet filter config %s\n", e->getName().c_str());
+		}
+	}
+	return patterns;
+}
+
 bool PacketRegexFilterCfg::deriveFrom(PacketRegexFilterCfg* old)
 {
-	if (get("matchPattern") == old->get("matchPattern"))
+	if (getPatterns() == old->getPatterns() && getInt("scanDepth", 0) == old->getInt("scanDepth", 0))
 		return true;
 
 	return false;
@@ -337,14 +363,16 @@ Module* PacketConnectionFilterCfg::getInstance()
 				getInt("timeout", 3),
 				getInt("bytes", 100),
 				getInt("hashFunctions", 3),
-				getInt("filterSize", 1000));
+				getInt("filterSize", 1000),
+				getLayout());
 		} else {
 			instance = new ConnectionFilter(
 				getInt("timeout", 3),
 				getInt("bytes", 100),
 				getInt("hashFunctions", 3),
 				getInt("filterSize", 1000),
-				seed);
+				seed,
+				getLayout());
 		}
 		instance->setExportControlPackets(getBool("exportControlPackets", true));
 	}
@@ -353,12 +381,27 @@ Module* PacketConnectionFilterCfg::getInstance()
 
 }
 
+/**
+ * @returns layout of the Bloom filters, the blocked layout accesses one cache line per filter and packet
+ */
+BloomFilterLayout PacketConnectionFilterCfg::getLayout()
+{
+	std::string layout = get("layout");
+	if (layout == "" || layout == "standard")
+		return BLOOM_LAYOUT_STANDARD;
+	if (layout == "blocked")
+		return BLOOM_LAYOUT_BLOCKED;
+	THROWEXCEPTION("unknown Bloom filter layout '%s', use standard or blocked", layout.c_str());
+	return BLOOM_LAYOUT_STANDARD;
+}
+
 bool PacketConnectionFilterCfg::deriveFrom(PacketConnectionFilterCfg* old)
 {
 	if (get("timeout") == old->get("timeout") &&
 	    get("bytes") == old->get("bytes") &&
 	    get("hashFunctions") == old->get("hashFunctions") &&
-	    get("filterSize") == old->get("filterSize")) {
+	    get("filterSize") == old->get("filterSize") &&
+	    get("layout") == old->get("layout")) {
 		return true;
 	}
 	return false;
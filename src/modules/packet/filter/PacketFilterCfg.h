@@ -28,6 +28,10 @@
 #include <vector>
 #include <algorithm>
 
+#ifdef HAVE_CONNECTION_FILTER
+#include "common/bloom/BloomFilterBase.h"
+#endif
+
 // forward declaration of instances
 class RegExFilter;
 class HostFilter;
@@ -275,6 +279,8 @@ public:
 	}
 
 	virtual bool deriveFrom(PacketRegexFilterCfg* old);
+
+	std::vector<std::string> getPatterns();
 protected:
 	PacketRegexFilterCfg(XMLElement *e): PacketFilterHelperCfg(e), instance(NULL) { };
 
@@ -341,6 +347,8 @@ public:
 	}
 
 	virtual bool deriveFrom(PacketConnectionFilterCfg* old);
+
+	BloomFilterLayout getLayout();
 protected:
 	PacketConnectionFilterCfg(XMLElement *e): PacketFilterHelperCfg(e), instance(NULL) { };
 
@@ -21,32 +21,78 @@
 
 #include "RegExFilter.h"
 
+#include <sstream>
 
-inline bool RegExFilter::compare(char *pdata)
+
+RegExFilter::RegExFilter(uint32_t scanDepth)
+	: scanDepth(scanDepth),
+	  scannedPackets(0),
+	  truncatedPackets(0)
 {
+}
 
-	if (boost::regex_search(pdata, rexp)) {
-		return true;
-	} 
+RegExFilter::~RegExFilter()
+{
+}
 
-	return false;
+void RegExFilter::addRegex(const std::string& expression)
+{
+	matcher.addRegex(expression);
+	matchCounts.push_back(0);
+}
 
+/**
+ * prepares the matcher for all expressions added so far, must be called before packets are processed
+ */
+void RegExFilter::compile()
+{
+	matcher.compile();
+	msg(LOG_INFO, "RegExFilter: %u expressions, %u of them matched by boost::regex, scan depth %u bytes",
+			matcher.getRegexCount(), matcher.getFallbackCount(), scanDepth);
 }
 
 bool RegExFilter::processPacket(Packet* p)
 {
 	const unsigned char* pdata;
 	unsigned int payloadOffset;
-	bool result;
+	unsigned int plength;
+	bool complete = true;
 
 	payloadOffset = p->payloadOffset;
 	if( payloadOffset == 0) return false;
 	pdata = p->data.netHeader + payloadOffset;
+	// data_length counts from the start of the layer 2 header
+	const unsigned char* pend = p->layer2Start + p->data_length;
+	plength = pend > pdata ? pend - pdata : 0;
 
-	if(pdata == NULL) return false;
+	if (scanDepth > 0 && plength > scanDepth) {
+		plength = scanDepth;
+		complete = false;
+		truncatedPackets++;
+	}
+	scannedPackets++;
 
-	result = compare((char*)pdata);
+	if (matcher.scan(pdata, plength, complete) == 0) return false;
 
-	return result;
+	const std::vector<uint32_t>& matches = matcher.getMatches();
+	for (size_t i = 0; i < matches.size(); i++) {
+		matchCounts[matches[i]]++;
+	}
+	return true;
+}
+
+std::string RegExFilter::getStatisticsXML(double interval)
+{
+	std::ostringstream oss;
 
+	oss << "<RegExFilter>";
+	oss << "<scannedPackets>" << scannedPackets << "</scannedPackets>";
+	oss << "<truncatedPackets>" << truncatedPackets << "</truncatedPackets>";
+	oss << "<automatonStates>" << matcher.getStateCount() << "</automatonStates>";
+	oss << "<automatonFlushes>" << matcher.getCacheFlushes() << "</automatonFlushes>";
+	for (size_t i = 0; i < matchCounts.size(); i++) {
+		oss << "<regex index=\"" << i << "\"><matches>" << matchCounts[i] << "</matches></regex>";
+	}
+	oss << "</RegExFilter>";
+	return oss.str();
 }
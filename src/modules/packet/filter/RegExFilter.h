@@ -25,43 +25,38 @@
 #ifndef REGEXFILTER_H
 #define REGEXFILTER_H
 
-#include <list>
 #include <string>
-#include <string.h>
+#include <vector>
 #include "common/msg.h"
 #include "PacketProcessor.h"
-#include <sys/types.h>
-#include <boost/regex.hpp>
-
+#include "MultiRegexMatcher.h"
 
 
+/**
+ * passes packets whose payload matches at least one of the configured regular expressions
+ * all expressions are matched in one pass over at most scanDepth bytes of the payload
+ */
 class RegExFilter
 	: public PacketProcessor
 {
 
 public:
 
-  RegExFilter ()
-  {
-  };
+  RegExFilter(uint32_t scanDepth = 0);
+  virtual ~RegExFilter();
 
-  virtual ~RegExFilter ()
-  {
-  };
-
-  void regcre()
-  {
-  	rexp.assign(match);
-  };
+  void addRegex(const std::string& expression);
+  void compile();
 
   virtual bool processPacket (Packet * p);
-
-  int filtertype;
-  std::string match;
-  boost::regex rexp;
+  virtual std::string getStatisticsXML(double interval);
 
 protected:
-  bool compare (char *data);
+  uint32_t scanDepth; /**< maximum number of payload bytes which are scanned, 0 for the whole payload */
+  MultiRegexMatcher matcher;
+  std::vector<uint64_t> matchCounts; /**< number of packets matched by each expression */
+  uint64_t scannedPackets;
+  uint64_t truncatedPackets; /**< packets whose payload was longer than scanDepth */
 
 };
 
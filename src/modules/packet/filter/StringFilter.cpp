@@ -36,14 +36,18 @@ StringFilter::~StringFilter()
 
 void StringFilter::addandFilter(std::string string)
 {
-    if(string.size()>0)
+    if(string.size()>0) {
 	andFilters.push_back (string);
+	matcher.addPattern(string, MultiPatternMatcher::Required);
+    }
 }
 
 void StringFilter::addnotFilter(std::string string)
 {
-    if(string.size()>0)
+    if(string.size()>0) {
 	notFilters.push_back (string);
+	matcher.addPattern(string, MultiPatternMatcher::Forbidden);
+    }
 }
 
 std::string StringFilter::hexparser(const std::string input) 
@@ -66,66 +70,33 @@ std::string StringFilter::hexparser(const std::string input)
 }
 
 /**
- * compare given String to packet data and check for a match
- * @param pdata Packet payload
- * @param toMatch the String to be matched against the packet
- * @param plength The packetlength
- * @return true on match false otherwise
+ * builds the matcher for all filters added so far, must be called before packets are processed
  */
-inline bool StringFilter::compare(unsigned char *pdata, std::string toMatch, unsigned int plength)
+void StringFilter::compile()
 {
-    unsigned counter=0;
-    char* tmp;
-    unsigned i=0;
-
-    while(i + toMatch.size() <=  plength) 
-    {
-	if ((char)pdata[i] == toMatch[0]) 
-	{
-	    counter = 1;
-	    tmp = (char*)&pdata[i];
-	    for( unsigned int j=1; j < toMatch.size(); j++) 
-	    {
-		if(tmp[j] != toMatch[j]) 
-		    break;
-		counter++;
-	    }
-	    if(counter == toMatch.size())
-		return true;
-	}
-	i++;
-    }
-    return false;
-
+    matcher.compile();
+    msg(LOG_INFO, "StringFilter: %u patterns compiled into %u states", matcher.getPatternCount(), matcher.getStateCount());
 }
 
 /**
- * prepare the Packet for comparefucntion
- * set Pointer to Payload
+ * matches the payload of the packet against all filters
  * @param p Packet data
- * @return true if packet contains string false otherwise
+ * @return true if packet contains all andFilters and none of the notFilters
  */
 bool StringFilter::processPacket(Packet *p)
 {
     unsigned char* pdata;
     unsigned int plength;
     unsigned int payloadOffset;
-    std::vector<std::string>::iterator iti;
 
     payloadOffset = p->payloadOffset;
     if( payloadOffset == 0) return false;
     pdata = (unsigned char*)p->data.netHeader + payloadOffset;
-    plength = p->data_length - payloadOffset;
+    // data_length counts from the start of the layer 2 header
+    unsigned char* pend = p->layer2Start + p->data_length;
+    plength = pend > pdata ? pend - pdata : 0;
 
     if(pdata == NULL) return false;
 
-    for(iti = andFilters.begin(); iti != andFilters.end(); ++iti)
-	if(!compare(pdata, *iti, plength)) 
-	    return false;
-
-    for(iti = notFilters.begin(); iti != notFilters.end(); ++iti)
-	if(compare(pdata, *iti, plength)) 
-	    return false;
-
-    return true;
+    return matcher.matches(pdata, plength);
 }
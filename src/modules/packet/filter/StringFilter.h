@@ -29,6 +29,7 @@
 #include <string>
 #include "common/msg.h"
 #include "PacketProcessor.h"
+#include "MultiPatternMatcher.h"
 
 
 
@@ -42,12 +43,13 @@ public:
 	virtual bool processPacket (Packet * p);
 	void addandFilter(std::string string);
 	void addnotFilter(std::string string);
+	void compile();
 
 protected:
 	std::vector<std::string> andFilters;
 	std::vector<std::string> notFilters;
 
-	bool compare (unsigned char *data, std::string toMatch, unsigned int plength);
+	MultiPatternMatcher matcher; /**< evaluates all andFilters and notFilters in one pass */
 };
 
 #endif
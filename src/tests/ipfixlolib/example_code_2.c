@@ -517,6 +517,37 @@ int main(int argc, char **argv)
 	fprintf(stderr, "ipfix_send failed!\n");
     /* Now, we can recycle the memory in which we stored the data. */
     my_meter_data_next_free = 0;
+
+
+    /* Data can also be copied to the send buffer. Then, it does not have
+     * to stay valid until ipfix_send() is called. */
+    ret=ipfix_start_data_set(my_exporter, my_n_template2_id);
+
+    if (ret != 0 ) {
+	fprintf(stderr, "ipfix_start_data_set failed!\n");
+	goto out;
+    }
+    {
+	meter_data md;
+	get_sample_data1(&md);
+	ipfix_put_data_field_copy(my_exporter, &md.ip_src_addr, 4);
+	ipfix_put_data_field_copy(my_exporter, &md.ip_dst_addr, 4);
+
+	/* Copied fields may be deleted up to the marker as well */
+	ipfix_set_data_field_marker(my_exporter);
+	ipfix_put_data_field_copy(my_exporter, &md.src_port, 2);
+	ipfix_delete_data_fields_upto_marker(my_exporter);
+
+	ipfix_put_data_field_copy(my_exporter, &md.src_port, 2);
+	ipfix_put_data_field_copy(my_exporter, &md.dst_port, 2);
+    }
+    ret = ipfix_end_data_set(my_exporter,1);
+    if (ret != 0)
+	fprintf(stderr, "ipfix_end_data_set failed!\n");
+
+    ret = ipfix_send(my_exporter);
+    if (ret != 0)
+	fprintf(stderr, "ipfix_send failed!\n");
 out:
 
     /* if you no longer need the exporter: free resources */
@@ -28,7 +28,10 @@
 #include "core/ConnectionQueue.h"
 #include "modules/ipfix/aggregator/PacketAggregator.h"
 #include "CounterDestination.h"
+#include "common/ipfixlolib/ipfix.h"
 
+#include <netinet/in.h>
+#include <string.h>
 #include <sys/time.h>
 #include <time.h>
 
@@ -93,16 +96,15 @@ Rules* AggregationPerfTest::createRules()
 	return rules;
 }
 
-Test::TestResult AggregationPerfTest::execTest()
+/**
+ * @param shards number of aggregation threads of the aggregator, 1 disables sharding
+ */
+void AggregationPerfTest::testAggregator(uint32_t shards)
 {
-
-	// create a packet sampler which lets only half of the packets through
-	// NOTICE: the sampler will be destroyed by the d'tor of FilterModule
-
 	ConnectionQueue<Packet*> queue1(10);
 	TestQueue<IpfixRecord*> tqueue;
 
-	PacketAggregator agg(1);
+	PacketAggregator agg(1, FlowHash::DEFAULT_ENGINE, true, shards);
 	Rules* rules = createRules();
 	agg.buildAggregator(rules, 0, 0, 16);
 
@@ -125,11 +127,270 @@ Test::TestResult AggregationPerfTest::execTest()
 	REQUIRE(gettimeofday(&stoptime, 0) == 0);
 	struct timeval difftime;
 	REQUIRE(timeval_subtract(&difftime, &stoptime, &starttime) == 0);
-	printf("Aggregator: needed time for processing %d packets: %d.%06d seconds\n", numPackets, (int)difftime.tv_sec, (int)difftime.tv_usec);
+	printf("Aggregator (%u shards): needed time for processing %d packets: %d.%06d seconds\n", shards, numPackets, (int)difftime.tv_sec, (int)difftime.tv_usec);
 
 
 	queue1.shutdown();
 	agg.shutdown();
+}
+
+/**
+ * creates a unidirectional rule with packet and octet counters and a biflow rule without
+ * counters, both rules aggregate source and destination addresses to /24 networks
+ */
+Rules* AggregationPerfTest::createMaskedRules()
+{
+	// masked addresses must not be the first flow key, PacketHashtable uses index 0 for unmasked addresses
+	const char* keyfields[] = { "protocolidentifier", "sourcetransportport", "destinationtransportport",
+								"sourceipv4address", "destinationipv4address", 0 };
+	const char* countfields[] = { "packetdeltacount", "octetdeltacount", 0 };
+
+	Rules* rules = new Rules();
+	for (int r=0; r < 2; r++) {
+		Rule* rule = new Rule();
+		rule->id = 2222+r;
+		rule->biflowAggregation = r;
+		for (int i=0; keyfields[i] != 0; i++) {
+			Rule::Field* field = createRuleField(keyfields[i]);
+			if ((field->type.id == IPFIX_TYPEID_sourceIPv4Address)
+					|| (field->type.id == IPFIX_TYPEID_destinationIPv4Address)) {
+				field->modifier = (Rule::Field::Modifier)((int)Rule::Field::MASK_START + 24);
+			}
+			rule->field[rule->fieldCount++] = field;
+		}
+		// counters of IANA elements have no reverse elements, so biflows are only counted
+		for (int i=0; !rule->biflowAggregation && countfields[i] != 0; i++) {
+			Rule::Field* field = createRuleField(countfields[i]);
+			field->modifier = Rule::Field::AGGREGATE;
+			rule->field[rule->fieldCount++] = field;
+		}
+		rules->rule[r] = rule;
+	}
+	rules->count = 2;
+
+	return rules;
+}
+
+/**
+ * creates an ethernet frame containing a TCP or UDP packet, addresses and ports are given in host byte order
+ */
+Packet* AggregationPerfTest::createPacket(uint32_t srcIp, uint32_t dstIp, uint16_t srcPort, uint16_t dstPort,
+		uint8_t protocol, uint16_t payloadLen)
+{
+	unsigned char data[14+20+20+60];
+	uint32_t thlen = (protocol == IPPROTO_TCP) ? 20 : 8;
+	uint32_t len = 14+20+thlen+payloadLen;
+	REQUIRE(len <= sizeof(data));
+	memset(data, 0, sizeof(data));
+	data[12] = 0x08; // ethertype IPv4
+
+	unsigned char* ip = data+14;
+	ip[0] = 0x45;
+	uint16_t iplen = htons(20+thlen+payloadLen);
+	memcpy(ip+2, &iplen, 2);
+	ip[8] = 64;
+	ip[9] = protocol;
+	uint32_t addr = htonl(srcIp);
+	memcpy(ip+12, &addr, 4);
+	addr = htonl(dstIp);
+	memcpy(ip+16, &addr, 4);
+
+	unsigned char* th = ip+20;
+	uint16_t port = htons(srcPort);
+	memcpy(th, &port, 2);
+	port = htons(dstPort);
+	memcpy(th+2, &port, 2);
+	if (protocol == IPPROTO_TCP) {
+		th[12] = 0x50; // data offset
+		th[13] = 0x10; // ACK
+	} else {
+		uint16_t udplen = htons(8+payloadLen);
+		memcpy(th+4, &udplen, 2);
+	}
+	memset(th+thlen, 'x', payloadLen);
+
+	struct timeval curtime;
+	REQUIRE(gettimeofday(&curtime, 0) == 0);
+	Packet* packet = packetManager.getNewInstance();
+	packet->init((char*)data, len, curtime, 0, len, DLT_EN10MB);
+	return packet;
+}
+
+uint16_t AggregationPerfTest::getPayloadLen(uint32_t flow, uint32_t packet)
+{
+	return (flow*7 + packet*13) % 60;
+}
+
+/**
+ * sends NUM_BIFLOWS biflows with BIFLOW_PACKETS packets each, odd packets are sent in reverse direction.
+ * All packets of one side of a biflow have different addresses within one /24 network, so they
+ * only end up in the same flow if the shard key is masked like the flow key.
+ * The packets are created in advance, so that they are passed faster than the shards aggregate them.
+ * The first half of the packets is passed by receive(), the second half by receiveBatch().
+ */
+void AggregationPerfTest::sendBiflowsTo(PacketAggregator* agg)
+{
+	std::vector<Packet*> packets;
+	for (uint32_t j = 0; j < BIFLOW_PACKETS; j++) {
+		for (uint32_t i = 0; i < NUM_BIFLOWS; i++) {
+			uint32_t hostA = 0x0A000000 | ((i%16) << 8) | (1+j);   // 10.0.x.0/24
+			uint32_t hostB = 0xC0A80000 | ((i%16) << 8) | (100+j); // 192.168.x.0/24
+			uint16_t portA = 1024+i;
+			uint16_t portB = 80 + i%3;
+			uint8_t protocol = (i%2) ? IPPROTO_UDP : IPPROTO_TCP;
+			if (j%2 == 0) {
+				packets.push_back(createPacket(hostA, hostB, portA, portB, protocol, getPayloadLen(i, j)));
+			} else {
+				packets.push_back(createPacket(hostB, hostA, portB, portA, protocol, getPayloadLen(i, j)));
+			}
+		}
+	}
+
+	size_t half = packets.size()/2;
+	for (size_t i = 0; i < half; i++) {
+		agg->receive(packets[i]);
+	}
+	std::vector<Packet*> batch;
+	for (size_t i = half; i < packets.size(); i++) {
+		batch.push_back(packets[i]);
+		if (batch.size() == 32 || i+1 == packets.size()) {
+			agg->receiveBatch(batch);
+			batch.clear();
+		}
+	}
+}
+
+static const unsigned char* getField(IpfixDataRecord* record, uint16_t id, uint32_t enterprise)
+{
+	TemplateInfo::FieldInfo* fi = record->getFieldInfo(id, enterprise);
+	REQUIRE(fi != NULL);
+	return record->data + fi->offset;
+}
+
+static uint64_t getCounter(IpfixDataRecord* record, uint16_t id, uint32_t enterprise)
+{
+	uint64_t value;
+	memcpy(&value, getField(record, id, enterprise), 8);
+	return ntohll(value);
+}
+
+/**
+ * collects the Data Records exported by an aggregator, unlike TestQueue it never blocks the exporter
+ */
+class CollectedRecords : public Destination<IpfixRecord*>
+{
+public:
+	std::vector<IpfixDataRecord*> records;
+
+	virtual void receive(IpfixRecord* record)
+	{
+		IpfixDataRecord* dr = dynamic_cast<IpfixDataRecord*>(record);
+		if (dr) records.push_back(dr);
+		else record->removeReference();
+	}
+};
+
+/**
+ * aggregates the packets of sendBiflowsTo() and collects the exported flows of both rules
+ * the aggregator is shut down right after the last packet was passed, so that packets
+ * which are still queued for the shards must be aggregated and exported on shutdown
+ */
+void AggregationPerfTest::aggregateBiflows(uint32_t shards, FlowMap& flows, FlowMap& biflows)
+{
+	CollectedRecords collected;
+
+	PacketAggregator agg(1, FlowHash::DEFAULT_ENGINE, true, shards);
+	// timeouts are long enough that no flow is exported before shutdown
+	agg.buildAggregator(createMaskedRules(), 600, 600, 10);
+	agg.connectTo(&collected);
+	agg.start();
+
+	sendBiflowsTo(&agg);
+	agg.shutdown(true, true);
+
+	for (size_t i = 0; i < collected.records.size(); i++) {
+		IpfixDataRecord* record = collected.records[i];
+		uint16_t srcPort, dstPort;
+		memcpy(&srcPort, getField(record, IPFIX_TYPEID_sourceTransportPort, 0), 2);
+		memcpy(&dstPort, getField(record, IPFIX_TYPEID_destinationTransportPort, 0), 2);
+		std::pair<uint16_t, uint16_t> ports(ntohs(srcPort), ntohs(dstPort));
+
+		bool biflow = record->getFieldInfo(IPFIX_TYPEID_packetDeltaCount, 0) == NULL;
+		FlowMap& map = biflow ? biflows : flows;
+		ASSERT(map.find(ports) == map.end(), "flow was exported more than once");
+
+		FlowCounters& counters = map[ports];
+		memcpy(&counters.srcNet, getField(record, IPFIX_TYPEID_sourceIPv4Address, 0), 4);
+		counters.srcNet = ntohl(counters.srcNet);
+		memcpy(&counters.dstNet, getField(record, IPFIX_TYPEID_destinationIPv4Address, 0), 4);
+		counters.dstNet = ntohl(counters.dstNet);
+		counters.packets = biflow ? 0 : getCounter(record, IPFIX_TYPEID_packetDeltaCount, 0);
+		counters.octets = biflow ? 0 : getCounter(record, IPFIX_TYPEID_octetDeltaCount, 0);
+		record->removeReference();
+	}
+}
+
+/**
+ * checks that an aggregator with several shards exports the same flows as an aggregator
+ * without shards, which requires that all packets of a masked flow and both directions
+ * of a biflow are aggregated by the same shard
+ */
+void AggregationPerfTest::testShardedAggregation()
+{
+	FlowMap flows[2];
+	FlowMap biflows[2];
+	aggregateBiflows(1, flows[0], biflows[0]);
+	aggregateBiflows(4, flows[1], biflows[1]);
+
+	for (int k = 0; k < 2; k++) {
+		REQUIRE(flows[k].size() == 2*NUM_BIFLOWS);
+		REQUIRE(biflows[k].size() == NUM_BIFLOWS);
+
+		for (uint32_t i = 0; i < NUM_BIFLOWS; i++) {
+			uint32_t netA = 0x0A000000 | ((i%16) << 8);
+			uint32_t netB = 0xC0A80000 | ((i%16) << 8);
+			std::pair<uint16_t, uint16_t> ports(1024+i, 80 + i%3);
+			std::pair<uint16_t, uint16_t> revPorts(ports.second, ports.first);
+			uint64_t octets = 0;
+			uint64_t revOctets = 0;
+			uint32_t thlen = (i%2) ? 8 : 20;
+			for (uint32_t j = 0; j < BIFLOW_PACKETS; j++) {
+				if (j%2 == 0) {
+					octets += 20+thlen+getPayloadLen(i, j);
+				} else {
+					revOctets += 20+thlen+getPayloadLen(i, j);
+				}
+			}
+
+			FlowMap::iterator f = flows[k].find(ports);
+			REQUIRE(f != flows[k].end());
+			REQUIRE(f->second.srcNet == netA);
+			REQUIRE(f->second.dstNet == netB);
+			REQUIRE(f->second.packets == BIFLOW_PACKETS/2);
+			REQUIRE(f->second.octets == octets);
+
+			FlowMap::iterator r = flows[k].find(revPorts);
+			REQUIRE(r != flows[k].end());
+			REQUIRE(r->second.srcNet == netB);
+			REQUIRE(r->second.dstNet == netA);
+			REQUIRE(r->second.packets == BIFLOW_PACKETS/2);
+			REQUIRE(r->second.octets == revOctets);
+
+			// the biflow is keyed by the direction of its first packet
+			FlowMap::iterator b = biflows[k].find(ports);
+			REQUIRE(b != biflows[k].end());
+			REQUIRE(b->second.srcNet == netA);
+			REQUIRE(b->second.dstNet == netB);
+		}
+	}
+}
+
+Test::TestResult AggregationPerfTest::execTest()
+{
+	testShardedAggregation();
+
+	testAggregator(1);
+	testAggregator(4);
 
 	return PASSED;
 }
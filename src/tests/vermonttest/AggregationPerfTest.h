@@ -26,6 +26,10 @@
 
 #include "TestSuiteBase.h"
 
+#include <map>
+
+class PacketAggregator;
+
 class AggregationPerfTest : public Test
 {
 	public:
@@ -36,9 +40,32 @@ class AggregationPerfTest : public Test
 	private:
 		static InstanceManager<Packet> packetManager;
 
+		/**
+		 * fields of one exported flow
+		 */
+		struct FlowCounters {
+			uint32_t srcNet; /**< exported source address, masked to /24 */
+			uint32_t dstNet;
+			uint64_t packets;
+			uint64_t octets;
+		};
+		typedef std::map<std::pair<uint16_t, uint16_t>, FlowCounters> FlowMap; /**< flows by source and destination port */
+
+		static const uint32_t NUM_BIFLOWS = 200;
+		static const uint32_t BIFLOW_PACKETS = 64;
+
 		Rule::Field* createRuleField(const std::string& typeId);
 		Rules* createRules();
 		void sendPacketsTo(Destination<Packet*>* dest, uint32_t numpackets);
+		void testAggregator(uint32_t shards);
+
+		Rules* createMaskedRules();
+		Packet* createPacket(uint32_t srcIp, uint32_t dstIp, uint16_t srcPort, uint16_t dstPort,
+				uint8_t protocol, uint16_t payloadLen);
+		uint16_t getPayloadLen(uint32_t flow, uint32_t packet);
+		void sendBiflowsTo(PacketAggregator* agg);
+		void aggregateBiflows(uint32_t shards, FlowMap& flows, FlowMap& biflows);
+		void testShardedAggregation();
 
 		int numPackets;
 };
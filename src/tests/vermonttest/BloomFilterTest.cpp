@@ -1,5 +1,3 @@
-#ifdef HAVE_CONNECTION_FILTER
-
 #include "BloomFilterTest.h"
 #include <common/bloom/BloomFilter.h>
 #include <common/bloom/AgeBloomFilter.h>
@@ -9,11 +7,16 @@
 #include <iostream>
 
 #include <ctime>
+#include <sys/time.h>
 
 static QuintupleKey key1;
 static QuintupleKey key2;
 
-BloomFilterTestSuite::BloomFilterTestSuite()
+/**
+ * @param fast determines if the benchmark uses few keys or enough keys for performance measurements
+ */
+BloomFilterTestSuite::BloomFilterTestSuite(bool fast)
+	: benchmarkKeys(fast ? 100000 : 5000000)
 {
 }
 
@@ -113,6 +116,91 @@ static void testAgeBloomFilter()
 	delete bf;
 }
 
+static void setKey(QuintupleKey& key, uint32_t n)
+{
+	key.reset();
+	key.getQuintuple()->srcIp = 0x0a000000 + n;
+	key.getQuintuple()->dstIp = 0xc0a80001;
+	key.getQuintuple()->proto = 6;
+	key.getQuintuple()->srcPort = n*7;
+	key.getQuintuple()->dstPort = 80;
+}
+
+/**
+ * inserts keys and checks that no inserted key is missing and that the false positive rate
+ * is close to the theoretical one
+ */
+static void testFalsePositives(BloomFilterLayout layout, bool CMS)
+{
+	const uint32_t keys = 10000;
+	HashParams hashParams(4, 1);
+	BloomFilter bf(&hashParams, keys*16, CMS, layout);
+	QuintupleKey key;
+
+	for (uint32_t i = 0; i < keys; i++) {
+		setKey(key, i);
+		bf.set(key.data, key.len);
+	}
+	for (uint32_t i = 0; i < keys; i++) {
+		setKey(key, i);
+		REQUIRE(bf.get(key.data, key.len));
+	}
+	uint32_t falsePositives = 0;
+	for (uint32_t i = keys; i < 11*keys; i++) {
+		setKey(key, i);
+		if (bf.get(key.data, key.len)) falsePositives++;
+	}
+	// about 0.24% for 16 bits per key and 4 hash functions, the blocked layout is somewhat worse
+	double rate = (double)falsePositives/(10*keys);
+	std::cout << "false positive rate with " << (layout == BLOOM_LAYOUT_BLOCKED ? "blocked" : "standard")
+		<< " layout: " << rate*100 << "%" << std::endl;
+	REQUIRE(rate < 0.01);
+}
+
+static double elapsed(const struct timeval& start)
+{
+	struct timeval end;
+	gettimeofday(&end, NULL);
+	return (end.tv_sec-start.tv_sec) + (end.tv_usec-start.tv_usec)/1000000.0;
+}
+
+/**
+ * probes three filters per key like ConnectionFilter, once hashing the key for every filter
+ * and once reusing a single hash value
+ */
+static void benchmarkFilters(BloomFilterLayout layout, uint32_t keys)
+{
+	HashParams hashParams(3, 1);
+	// much larger than the CPU caches, so that every probe of the standard layout is a cache miss
+	AgeBloomFilter syn(&hashParams, 4000000, false, layout);
+	CountBloomFilter exp(&hashParams, 4000000, false, layout);
+	AgeBloomFilter conn(&hashParams, 4000000, false, layout);
+	QuintupleKey key;
+	long sum = 0;
+
+	struct timeval start;
+	gettimeofday(&start, NULL);
+	for (uint32_t i = 0; i < keys; i++) {
+		setKey(key, i*2654435761u);
+		syn.set(key.data, key.len, i);
+		sum += exp.get(key.data, key.len) + conn.get(key.data, key.len);
+	}
+	double separate = elapsed(start);
+
+	gettimeofday(&start, NULL);
+	for (uint32_t i = 0; i < keys; i++) {
+		setKey(key, i*2654435761u);
+		BloomHash h = syn.hash(key.data, key.len);
+		syn.set(h, i);
+		sum += exp.get(h) + conn.get(h);
+	}
+	double shared = elapsed(start);
+
+	std::cout << (layout == BLOOM_LAYOUT_BLOCKED ? "blocked" : "standard") << " layout: "
+		<< separate*1e9/keys << " ns per packet, " << shared*1e9/keys << " ns with a shared hash value"
+		<< " (" << sum << ")" << std::endl;
+}
+
 Test::TestResult  BloomFilterTestSuite::execTest()
 {
 	std::cout << "Running tests on BloomFilter classes" << std::endl;
@@ -129,9 +217,16 @@ Test::TestResult  BloomFilterTestSuite::execTest()
 	std::cout << "Testing CountBloomFilter..." << std::endl;
 	testCountBloomFilter();
 
+	std::cout << "Testing false positive rates..." << std::endl;
+	testFalsePositives(BLOOM_LAYOUT_STANDARD, true);
+	testFalsePositives(BLOOM_LAYOUT_STANDARD, false);
+	testFalsePositives(BLOOM_LAYOUT_BLOCKED, true);
+
+	std::cout << "Benchmarking filters of ConnectionFilter..." << std::endl;
+	benchmarkFilters(BLOOM_LAYOUT_STANDARD, benchmarkKeys);
+	benchmarkFilters(BLOOM_LAYOUT_BLOCKED, benchmarkKeys);
+
 	std::cout << "All tests on all BloomFilter classes passed" << std::endl;
 
 	return PASSED;
 }
-
-#endif
@@ -1,5 +1,3 @@
-#ifdef HAVE_CONNECTION_FILTER
-
 #ifndef _BLOOMFILTER_TEST_H_
 #define _BLOOMFILTER_TEST_H_
 
@@ -8,11 +6,12 @@
 class BloomFilterTestSuite : public Test
 {
 	public:
-		BloomFilterTestSuite();
+		BloomFilterTestSuite(bool fast);
 		virtual TestResult execTest();
-};
 
+	private:
+		uint32_t benchmarkKeys;
+};
 
-#endif
 
 #endif
@@ -0,0 +1,156 @@
+#include "ConcurrentQueueTest.h"
+
+#include "common/Time.h"
+
+#include <pthread.h>
+#include <iostream>
+
+static const uintptr_t ELEMENTS_PER_PRODUCER = 100000;
+
+struct ProducerArgs {
+	ConcurrentQueue<uintptr_t>* queue;
+	uintptr_t id;
+};
+
+/**
+ * pushes ELEMENTS_PER_PRODUCER elements, alternating single pushes and batches
+ * every element encodes producer id and sequence number
+ */
+static void* producerThread(void* arg)
+{
+	ProducerArgs* args = (ProducerArgs*)arg;
+	std::vector<uintptr_t> batch;
+	for (uintptr_t i = 0; i < ELEMENTS_PER_PRODUCER; i++) {
+		uintptr_t e = (args->id << 32) | i;
+		if (i % 2) {
+			args->queue->push(e);
+		} else {
+			batch.push_back(e);
+			if (batch.size() == 23) {
+				// elements of a batch are pushed after the single elements in between
+				// so we only check ordering for the batched elements
+				args->queue->pushBatch(batch);
+				batch.clear();
+			}
+		}
+	}
+	args->queue->pushBatch(batch);
+	return NULL;
+}
+
+ConcurrentQueueTest::ConcurrentQueueTest()
+{
+}
+
+ConcurrentQueueTest::~ConcurrentQueueTest()
+{
+}
+
+void ConcurrentQueueTest::testProducers(ConcurrentQueue<uintptr_t>::Implementation impl, int producers)
+{
+	ConcurrentQueue<uintptr_t> queue(16, impl);
+	std::vector<pthread_t> threads(producers);
+	std::vector<ProducerArgs> args(producers);
+	std::vector<uintptr_t> received(producers, 0);
+	std::vector<uintptr_t> lastBatched(producers, 0);
+
+	for (int i = 0; i < producers; i++) {
+		args[i].queue = &queue;
+		args[i].id = i;
+		REQUIRE(pthread_create(&threads[i], NULL, producerThread, &args[i]) == 0);
+	}
+
+	std::vector<uintptr_t> batch;
+	uintptr_t total = 0;
+	while (total < ELEMENTS_PER_PRODUCER*producers) {
+		batch.clear();
+		REQUIRE(queue.popBatch(batch, 7));
+		REQUIRE(batch.size() >= 1 && batch.size() <= 7);
+		for (size_t j = 0; j < batch.size(); j++) {
+			uintptr_t id = batch[j] >> 32;
+			uintptr_t seq = batch[j] & 0xFFFFFFFF;
+			REQUIRE(id < (uintptr_t)producers);
+			if (seq % 2 == 0) {
+				// elements pushed as batch by one producer must arrive in order
+				REQUIRE(seq == 0 || seq > lastBatched[id]);
+				lastBatched[id] = seq;
+			}
+			received[id]++;
+		}
+		total += batch.size();
+	}
+
+	for (int i = 0; i < producers; i++) {
+		pthread_join(threads[i], NULL);
+		REQUIRE(received[i] == ELEMENTS_PER_PRODUCER);
+	}
+	REQUIRE(queue.getCount() == 0);
+}
+
+void ConcurrentQueueTest::testTimeout(ConcurrentQueue<uintptr_t>::Implementation impl)
+{
+	ConcurrentQueue<uintptr_t> queue(4, impl);
+	uintptr_t e = 1;
+
+	REQUIRE(!queue.pop(20, &e));
+
+	struct timespec timeout;
+	addToCurTime(&timeout, 20);
+	REQUIRE(!queue.popAbs(timeout, &e));
+	REQUIRE(e == 0);
+
+	queue.push(42);
+	REQUIRE(queue.getCount() == 1);
+	REQUIRE(queue.pop(20, &e));
+	REQUIRE(e == 42);
+}
+
+static void* shutdownThread(void* arg)
+{
+	ConcurrentQueue<uintptr_t>* queue = (ConcurrentQueue<uintptr_t>*)arg;
+	timespec req;
+	req.tv_sec = 0;
+	req.tv_nsec = 50000000;
+	nanosleep(&req, &req);
+	queue->notifyShutdown();
+	return NULL;
+}
+
+void ConcurrentQueueTest::testShutdown(ConcurrentQueue<uintptr_t>::Implementation impl)
+{
+	ConcurrentQueue<uintptr_t> queue(4, impl);
+	pthread_t thread;
+	uintptr_t e;
+
+	// a blocking pop must return when the queue is shut down
+	REQUIRE(pthread_create(&thread, NULL, shutdownThread, &queue) == 0);
+	REQUIRE(!queue.pop(&e));
+	pthread_join(thread, NULL);
+
+	queue.restart();
+	queue.push(1);
+	REQUIRE(queue.pop(&e));
+	REQUIRE(e == 1);
+}
+
+Test::TestResult ConcurrentQueueTest::execTest()
+{
+	ConcurrentQueue<uintptr_t>::Implementation impls[] = {
+		ConcurrentQueue<uintptr_t>::LOCKED,
+		ConcurrentQueue<uintptr_t>::SPSC,
+		ConcurrentQueue<uintptr_t>::MPSC
+	};
+	const char* names[] = { "locked", "spsc", "mpsc" };
+
+	for (int i = 0; i < 3; i++) {
+		std::cout << "Testing " << names[i] << " ConcurrentQueue..." << std::endl;
+		testProducers(impls[i], 1);
+		if (impls[i] != ConcurrentQueue<uintptr_t>::SPSC)
+			testProducers(impls[i], 4);
+		testTimeout(impls[i]);
+		testShutdown(impls[i]);
+	}
+
+	std::cout << "All tests on ConcurrentQueue passed" << std::endl;
+	return PASSED;
+}
@@ -0,0 +1,22 @@
+#ifndef CONCURRENTQUEUETEST_H_
+#define CONCURRENTQUEUETEST_H_
+
+#include "common/ConcurrentQueue.h"
+
+#include "TestSuiteBase.h"
+
+class ConcurrentQueueTest : public Test
+{
+public:
+	ConcurrentQueueTest();
+	~ConcurrentQueueTest();
+
+	virtual TestResult execTest();
+
+private:
+	void testProducers(ConcurrentQueue<uintptr_t>::Implementation impl, int producers);
+	void testTimeout(ConcurrentQueue<uintptr_t>::Implementation impl);
+	void testShutdown(ConcurrentQueue<uintptr_t>::Implementation impl);
+};
+
+#endif /*CONCURRENTQUEUETEST_H_*/
@@ -0,0 +1,191 @@
+#include "ConnectionTest.h"
+
+#include "modules/ipfix/Connection.h"
+#include "common/ipfixlolib/ipfix.h"
+#include "common/defs.h"
+
+#include <iostream>
+#include <string.h>
+#include <vector>
+
+ConnectionTest::ConnectionTest()
+{
+}
+
+ConnectionTest::~ConnectionTest()
+{
+}
+
+namespace {
+
+struct TestField {
+	InformationElement::IeId id;
+	InformationElement::IeEnterpriseNumber enterprise;
+	uint16_t length;
+};
+
+/**
+ * creates a template containing the given fields in this order
+ */
+boost::shared_ptr<TemplateInfo> createTemplate(uint16_t templateId, const TestField* fields, uint16_t count)
+{
+	boost::shared_ptr<TemplateInfo> ti(new TemplateInfo());
+	ti->templateId = templateId;
+	ti->setId = TemplateInfo::IpfixTemplate;
+	ti->fieldCount = count;
+	ti->fieldInfo = (TemplateInfo::FieldInfo*)calloc(count, sizeof(TemplateInfo::FieldInfo));
+	int32_t offset = 0;
+	for (uint16_t i = 0; i < count; i++) {
+		ti->fieldInfo[i].type = InformationElement::IeInfo(fields[i].id, fields[i].enterprise, fields[i].length);
+		ti->fieldInfo[i].offset = offset;
+		offset += fields[i].length;
+	}
+	return ti;
+}
+
+void writeField(IpfixDataRecord* record, InformationElement::IeId id, InformationElement::IeEnterpriseNumber enterprise,
+		const void* value, uint16_t length)
+{
+	TemplateInfo::FieldInfo* fi = record->getFieldInfo(id, enterprise);
+	memcpy(record->data + fi->offset, value, length);
+}
+
+}
+
+/**
+ * checks that Connection reads the same values through cached plans as directly from the
+ * record, that unrequested fields are 0, and that plans follow variable-length layouts and
+ * templates reusing a unique id
+ */
+Test::TestResult ConnectionTest::execTest()
+{
+	static InstanceManager<IpfixDataRecord> dataIM("IpfixDataRecord");
+
+	std::cout << "Testing Connection..." << std::endl;
+
+	const TestField fields[] = {
+		{ IPFIX_TYPEID_sourceIPv4Address, 0, 4 },
+		{ IPFIX_TYPEID_destinationIPv4Address, 0, 4 },
+		{ IPFIX_TYPEID_sourceTransportPort, 0, 2 },
+		{ IPFIX_TYPEID_protocolIdentifier, 0, 1 },
+		{ IPFIX_TYPEID_flowStartSeconds, 0, 4 },
+		{ IPFIX_TYPEID_flowStartMilliseconds, 0, 8 },
+		{ IPFIX_TYPEID_tcpControlBits, 0, 1 },
+		{ IPFIX_TYPEID_octetDeltaCount, 0, 8 },
+		{ IPFIX_ETYPEID_frontPayload, IPFIX_PEN_vermont, 5 }
+	};
+	boost::shared_ptr<TemplateInfo> ti = createTemplate(256, fields, ARRAY_SIZE(fields));
+
+	IpfixDataRecord* record = dataIM.getNewInstance();
+	record->templateInfo = ti;
+	record->message.reset(new IpfixRecord::Data[64]);
+	record->data = record->message.get();
+	memset(record->data, 0, 64);
+	uint32_t srcIP = htonl(0x0a000001);
+	uint32_t dstIP = htonl(0x0a000002);
+	uint16_t srcPort = htons(1234);
+	uint8_t protocol = 6;
+	uint32_t startSeconds = htonl(1000);
+	uint64_t startMilliseconds = htonll(1000123);
+	uint8_t tcpControlBits = 0x12;
+	uint64_t octets = htonll(4711);
+	writeField(record, IPFIX_TYPEID_sourceIPv4Address, 0, &srcIP, 4);
+	writeField(record, IPFIX_TYPEID_destinationIPv4Address, 0, &dstIP, 4);
+	writeField(record, IPFIX_TYPEID_sourceTransportPort, 0, &srcPort, 2);
+	writeField(record, IPFIX_TYPEID_protocolIdentifier, 0, &protocol, 1);
+	writeField(record, IPFIX_TYPEID_flowStartSeconds, 0, &startSeconds, 4);
+	writeField(record, IPFIX_TYPEID_flowStartMilliseconds, 0, &startMilliseconds, 8);
+	writeField(record, IPFIX_TYPEID_tcpControlBits, 0, &tcpControlBits, 1);
+	writeField(record, IPFIX_TYPEID_octetDeltaCount, 0, &octets, 8);
+	writeField(record, IPFIX_ETYPEID_frontPayload, IPFIX_PEN_vermont, "hello", 5);
+
+	ConnectionExtractor all;
+	for (int i = 0; i < 2; i++) {
+		// second round uses the cached plan
+		Connection c(record, all);
+		REQUIRE(c.srcIP == srcIP);
+		REQUIRE(c.dstIP == dstIP);
+		REQUIRE(c.srcPort == srcPort);
+		REQUIRE(c.dstPort == 0);
+		REQUIRE(c.protocol == 6);
+		REQUIRE(c.srcTimeStart == 1000123);
+		REQUIRE(c.srcTimeEnd == 0);
+		REQUIRE(c.srcTcpControlBits == htons(0x12));
+		REQUIRE(c.srcOctets == octets);
+		REQUIRE(c.srcPayloadLen == 5);
+		REQUIRE(memcmp(c.srcPayload, "hello", 5) == 0);
+		REQUIRE(c.dstPayload == NULL);
+		REQUIRE(c.srcPayloadPktCount == 0);
+	}
+
+	// default extractor of the one argument constructor
+	Connection d(record);
+	REQUIRE(d.srcIP == srcIP && d.srcOctets == octets && d.srcPayloadLen == 5);
+
+	// only requested fields are read
+	ConnectionExtractor addresses(Connection::ADDRESSES|Connection::TCP_FLAGS);
+	Connection a(record, addresses);
+	REQUIRE(a.srcIP == srcIP);
+	REQUIRE(a.dstIP == dstIP);
+	REQUIRE(a.srcTcpControlBits == htons(0x12));
+	REQUIRE(a.srcPort == 0);
+	REQUIRE(a.protocol == 0);
+	REQUIRE(a.srcTimeStart == 0);
+	REQUIRE(a.srcOctets == 0);
+	REQUIRE(a.srcPayload == NULL);
+
+	// variable-length record: payload is shorter, following fields move
+	IpfixDataRecord* varRecord = dataIM.getNewInstance();
+	varRecord->templateInfo = ti;
+	varRecord->message.reset(new IpfixRecord::Data[64]);
+	varRecord->data = varRecord->message.get();
+	memset(varRecord->data, 0, 64);
+	varRecord->recordFieldInfo.assign(ti->fieldInfo, ti->fieldInfo+ti->fieldCount);
+	for (uint16_t i = 0; i < ti->fieldCount; i++) varRecord->recordFieldInfo[i].offset += 3;
+	varRecord->recordFieldInfo[ARRAY_SIZE(fields)-1].type.length = 2;
+	uint32_t otherIP = htonl(0xc0a80001);
+	writeField(varRecord, IPFIX_TYPEID_sourceIPv4Address, 0, &otherIP, 4);
+	writeField(varRecord, IPFIX_ETYPEID_frontPayload, IPFIX_PEN_vermont, "hi", 2);
+	Connection v(varRecord, all);
+	REQUIRE(v.srcIP == otherIP);
+	REQUIRE(v.srcPayloadLen == 2);
+	REQUIRE(memcmp(v.srcPayload, "hi", 2) == 0);
+	varRecord->removeReference();
+	varRecord->templateInfo.reset();
+
+	// a new template reusing the unique id of a freed one gets a new plan
+	uint16_t uniqueId = ti->getUniqueId();
+	record->templateInfo.reset();
+	ti.reset();
+	const TestField otherFields[] = {
+		{ IPFIX_TYPEID_protocolIdentifier, 0, 1 },
+		{ IPFIX_TYPEID_destinationTransportPort, 0, 2 },
+		{ IPFIX_TYPEID_sourceIPv4Address, 0, 4 }
+	};
+	// lower unique ids which are free are assigned first, keep them in use
+	std::vector<boost::shared_ptr<TemplateInfo> > spare;
+	boost::shared_ptr<TemplateInfo> ti2 = createTemplate(257, otherFields, ARRAY_SIZE(otherFields));
+	while (ti2->getUniqueId() != uniqueId) {
+		spare.push_back(ti2);
+		ti2 = createTemplate(257, otherFields, ARRAY_SIZE(otherFields));
+	}
+	record->templateInfo = ti2;
+	memset(record->data, 0, 64);
+	uint16_t dstPort = htons(80);
+	protocol = 17;
+	writeField(record, IPFIX_TYPEID_protocolIdentifier, 0, &protocol, 1);
+	writeField(record, IPFIX_TYPEID_destinationTransportPort, 0, &dstPort, 2);
+	writeField(record, IPFIX_TYPEID_sourceIPv4Address, 0, &srcIP, 4);
+	Connection r(record, all);
+	REQUIRE(r.protocol == 17);
+	REQUIRE(r.dstPort == dstPort);
+	REQUIRE(r.srcPort == 0);
+	REQUIRE(r.srcIP == srcIP);
+	REQUIRE(r.srcOctets == 0);
+	REQUIRE(r.srcPayload == NULL);
+	record->removeReference();
+	record->templateInfo.reset();
+
+	std::cout << "All tests on Connection passed" << std::endl;
+	return PASSED;
+}
@@ -0,0 +1,15 @@
+#ifndef CONNECTIONTEST_H_
+#define CONNECTIONTEST_H_
+
+#include "TestSuiteBase.h"
+
+class ConnectionTest : public Test
+{
+public:
+	ConnectionTest();
+	~ConnectionTest();
+
+	virtual TestResult execTest();
+};
+
+#endif /*CONNECTIONTEST_H_*/
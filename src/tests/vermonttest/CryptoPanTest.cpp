@@ -0,0 +1,61 @@
+#include "CryptoPanTest.h"
+
+#include "common/cryptopan/panonymizer.h"
+
+#include <iostream>
+#include <stdlib.h>
+
+CryptoPanTest::CryptoPanTest()
+{
+}
+
+CryptoPanTest::~CryptoPanTest()
+{
+}
+
+/**
+ * compares the software and AES-NI implementations with addresses from the sample
+ * of the original Crypto-PAn distribution and with each other, also when results
+ * are taken from the prefix and address caches
+ */
+Test::TestResult CryptoPanTest::execTest()
+{
+	std::cout << "Testing CryptoPan..." << std::endl;
+
+	const UINT8 key[32] = {
+		21, 34, 23, 141, 51, 164, 207, 128, 19, 10, 91, 22, 73, 144, 125, 16,
+		216, 152, 143, 131, 121, 121, 101, 39, 98, 87, 76, 45, 42, 132, 34, 2
+	};
+	// 128.11.68.132 -> 135.242.180.132, 129.118.74.4 -> 134.136.186.123,
+	// 130.132.252.244 -> 133.68.164.234, 141.223.7.43 -> 141.167.8.160
+	const UINT32 orig[] = { 0x800B4484, 0x81764A04, 0x8284FCF4, 0x8DDF072B };
+	const UINT32 anon[] = { 0x87F2B484, 0x8688BA7B, 0x8544A4EA, 0x8DA708A0 };
+
+	PAnonymizer software(key, false);
+	PAnonymizer fast(key);
+	REQUIRE(!software.usesAesNi());
+	std::cout << "AES-NI is " << (fast.usesAesNi() ? "" : "not ") << "available" << std::endl;
+
+	for (int round = 0; round < 2; round++) {
+		for (int i = 0; i < 4; i++) {
+			REQUIRE(software.anonymize(orig[i]) == anon[i]);
+			REQUIRE(fast.anonymize(orig[i]) == anon[i]);
+		}
+	}
+
+	// many addresses with few different prefixes and collisions in the address cache
+	srand(1);
+	for (int i = 0; i < 20000; i++) {
+		UINT32 addr = (orig[i%4] & 0xFFFF0000) | (rand() & 0xFFFF);
+		REQUIRE(software.anonymize(addr) == fast.anonymize(addr));
+	}
+
+	// prefixes must be preserved
+	UINT32 a = fast.anonymize(0x0A000001);
+	UINT32 b = fast.anonymize(0x0A0000FE);
+	REQUIRE((a & 0xFFFFFF00) == (b & 0xFFFFFF00));
+	REQUIRE(a != b);
+
+	std::cout << "All tests on CryptoPan passed" << std::endl;
+	return PASSED;
+}
@@ -0,0 +1,15 @@
+#ifndef CRYPTOPANTEST_H_
+#define CRYPTOPANTEST_H_
+
+#include "TestSuiteBase.h"
+
+class CryptoPanTest : public Test
+{
+public:
+	CryptoPanTest();
+	~CryptoPanTest();
+
+	virtual TestResult execTest();
+};
+
+#endif /*CRYPTOPANTEST_H_*/
@@ -0,0 +1,230 @@
+#include "ExpiryWheelTest.h"
+
+#include "modules/ipfix/aggregator/FlowHashtable.h"
+#include "common/ipfixlolib/ipfix.h"
+#include "common/Time.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <iostream>
+
+static const uint32_t NODES = 5000;
+static const uint32_t ROUNDS = 2000;
+static const time_t START_TIME = 1000000000;
+
+ExpiryWheelTest::ExpiryWheelTest()
+{
+}
+
+ExpiryWheelTest::~ExpiryWheelTest()
+{
+}
+
+/**
+ * returns random deadline relative to now, covering all levels of the wheel and beyond
+ */
+static time_t randomDeadline(time_t now)
+{
+	switch (rand() % 5) {
+		case 0: return now - rand()%10;
+		case 1: return now + rand()%256;
+		case 2: return now + rand()%20000;
+		case 3: return now + rand()%2000000;
+		default: return now + (time_t)(rand()%4)*50000000 + rand()%1000;
+	}
+}
+
+/**
+ * schedules, reschedules and cancels nodes randomly while the wheel advances by
+ * up to maxStep seconds per round, every node must become due exactly in the round
+ * in which its deadline has been reached
+ */
+void ExpiryWheelTest::testRandomSchedule(uint32_t maxStep)
+{
+	ExpiryWheel wheel(START_TIME);
+	std::vector<BucketListElement*> nodes;
+	for (uint32_t i = 0; i < NODES; i++) {
+		nodes.push_back(new BucketListElement(NULL));
+	}
+
+	time_t now = START_TIME;
+	uint32_t scheduled = 0;
+	for (uint32_t round = 0; round < ROUNDS; round++) {
+		for (uint32_t j = 0; j < 50; j++) {
+			BucketListElement* node = nodes[rand()%NODES];
+			if (rand()%4 == 0) {
+				if (node->list) scheduled--;
+				wheel.cancel(node);
+				REQUIRE(node->list == NULL);
+			} else {
+				if (!node->list) scheduled++;
+				wheel.schedule(node, randomDeadline(now));
+				REQUIRE(node->list != NULL);
+			}
+		}
+		REQUIRE(wheel.getEntries() == scheduled);
+
+		now += rand()%(maxStep+1);
+		wheel.advance(now);
+		REQUIRE(wheel.getCurrentTime() == now);
+
+		BucketListElement* node;
+		while ((node = wheel.popDue()) != NULL) {
+			REQUIRE(node->expireTime <= now);
+			REQUIRE(node->list == NULL);
+			scheduled--;
+		}
+		REQUIRE(wheel.getDueEntries() == 0);
+		REQUIRE(wheel.getEntries() == scheduled);
+		for (uint32_t i = 0; i < NODES; i++) {
+			if (nodes[i]->list) REQUIRE(nodes[i]->expireTime > now);
+		}
+	}
+
+	for (uint32_t i = 0; i < NODES; i++) {
+		delete nodes[i];
+	}
+}
+
+void ExpiryWheelTest::testExpireAll()
+{
+	ExpiryWheel wheel(START_TIME);
+	std::vector<BucketListElement*> nodes;
+	for (uint32_t i = 0; i < NODES; i++) {
+		nodes.push_back(new BucketListElement(NULL));
+		wheel.schedule(nodes[i], randomDeadline(START_TIME));
+	}
+	wheel.expireAll();
+	REQUIRE(wheel.getDueEntries() == NODES);
+	uint32_t popped = 0;
+	while (wheel.popDue() != NULL) popped++;
+	REQUIRE(popped == NODES);
+	REQUIRE(wheel.getEntries() == 0);
+
+	for (uint32_t i = 0; i < NODES; i++) {
+		delete nodes[i];
+	}
+}
+
+/**
+ * collects the Data Records exported by a hashtable
+ */
+class ExportedRecords : public Destination<IpfixRecord*>
+{
+public:
+	std::vector<IpfixDataRecord*> records;
+
+	virtual void receive(IpfixRecord* record)
+	{
+		IpfixDataRecord* dr = dynamic_cast<IpfixDataRecord*>(record);
+		if (dr) records.push_back(dr);
+		else record->removeReference();
+	}
+
+	void clear()
+	{
+		for (size_t i = 0; i < records.size(); i++) records[i]->removeReference();
+		records.clear();
+	}
+};
+
+/**
+ * waits until the next second of unixtime() has started
+ */
+static time_t waitForNextSecond()
+{
+	time_t start = unixtime().tv_sec;
+	time_t now;
+	while ((now = unixtime().tv_sec) == start) usleep(10000);
+	return now;
+}
+
+/**
+ * a flow which is updated so that its inactive timeout reaches its active timeout must
+ * be rescheduled, it may not be exported at its former inactive timeout
+ */
+void ExpiryWheelTest::testFlowHashtableUpdate()
+{
+	static InstanceManager<IpfixDataRecord> dataIM("IpfixDataRecord");
+
+	Rule rule;
+	Rule::Field* port = new Rule::Field();
+	port->type = InformationElement::IeInfo(IPFIX_TYPEID_sourceTransportPort, 0, 2);
+	port->modifier = Rule::Field::KEEP;
+	rule.field[rule.fieldCount++] = port;
+	Rule::Field* packets = new Rule::Field();
+	packets->type = InformationElement::IeInfo(IPFIX_TYPEID_packetDeltaCount, 0, 8);
+	packets->modifier = Rule::Field::AGGREGATE;
+	rule.field[rule.fieldCount++] = packets;
+
+	ExportedRecords exported;
+	Source<IpfixRecord*> source;
+	source.connectTo(&exported);
+	// inactive timeout of 1s, active timeout of 2s
+	FlowHashtable ht(&source, &rule, 1, 2, 8);
+
+	boost::shared_ptr<TemplateInfo> ti(new TemplateInfo());
+	ti->templateId = 256;
+	ti->setId = TemplateInfo::IpfixTemplate;
+	ti->fieldCount = 2;
+	ti->fieldInfo = (TemplateInfo::FieldInfo*)calloc(2, sizeof(TemplateInfo::FieldInfo));
+	ti->fieldInfo[0].type = InformationElement::IeInfo(IPFIX_TYPEID_sourceTransportPort, 0, 2);
+	ti->fieldInfo[0].offset = 0;
+	ti->fieldInfo[1].type = InformationElement::IeInfo(IPFIX_TYPEID_packetDeltaCount, 0, 8);
+	ti->fieldInfo[1].offset = 2;
+
+	IpfixDataRecord* record = dataIM.getNewInstance();
+	record->templateInfo = ti;
+	record->message.reset(new IpfixRecord::Data[10]);
+	record->data = record->message.get();
+	uint16_t srcPort = htons(80);
+	uint64_t one = htonll(1);
+	memcpy(record->data, &srcPort, 2);
+	memcpy(record->data+2, &one, 8);
+
+	// flow is created at t, inactive expiry t+1, active expiry t+2
+	time_t t = waitForNextSecond();
+	ht.aggregateDataRecord(record);
+	// update at t+1 moves inactive expiry to t+2
+	REQUIRE(waitForNextSecond() == t+1);
+	ht.aggregateDataRecord(record);
+	ht.expireFlows();
+	if (unixtime().tv_sec == t+1) REQUIRE(exported.records.empty());
+
+	// flow keeps receiving records until its active timeout
+	while (unixtime().tv_sec < t+2) {
+		ht.aggregateDataRecord(record);
+		ht.expireFlows();
+		if (unixtime().tv_sec < t+2) REQUIRE(exported.records.empty());
+		usleep(100000);
+	}
+	waitForNextSecond();
+	ht.expireFlows();
+	REQUIRE(!exported.records.empty());
+	uint64_t count;
+	memcpy(&count, exported.records[0]->data+2, 8);
+	REQUIRE(ntohll(count) >= 3);
+
+	ht.expireFlows(true);
+	exported.clear();
+	record->removeReference();
+	record->templateInfo.reset();
+}
+
+Test::TestResult ExpiryWheelTest::execTest()
+{
+	srand(1);
+	std::cout << "Testing ExpiryWheel with small time steps..." << std::endl;
+	testRandomSchedule(3);
+	std::cout << "Testing ExpiryWheel with large time steps..." << std::endl;
+	testRandomSchedule(100000);
+	std::cout << "Testing ExpiryWheel expiry of all elements..." << std::endl;
+	testExpireAll();
+	std::cout << "Testing rescheduling of updated flows in FlowHashtable..." << std::endl;
+	testFlowHashtableUpdate();
+
+	std::cout << "All tests on ExpiryWheel passed" << std::endl;
+	return PASSED;
+}
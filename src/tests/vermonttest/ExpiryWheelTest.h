@@ -0,0 +1,22 @@
+#ifndef EXPIRYWHEELTEST_H_
+#define EXPIRYWHEELTEST_H_
+
+#include "modules/ipfix/aggregator/ExpiryWheel.h"
+
+#include "TestSuiteBase.h"
+
+class ExpiryWheelTest : public Test
+{
+public:
+	ExpiryWheelTest();
+	~ExpiryWheelTest();
+
+	virtual TestResult execTest();
+
+private:
+	void testRandomSchedule(uint32_t maxStep);
+	void testExpireAll();
+	void testFlowHashtableUpdate();
+};
+
+#endif /*EXPIRYWHEELTEST_H_*/
@@ -0,0 +1,112 @@
+#include "FlowTableTest.h"
+
+#include "common/crc.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <iostream>
+
+static const uint32_t KEY_LENGTH = 13;
+static const uint32_t KEY_RANGE = 50000;
+static const uint32_t OPERATIONS = 1000000;
+
+FlowTableTest::FlowTableTest()
+{
+}
+
+FlowTableTest::~FlowTableTest()
+{
+}
+
+static void buildKey(uint32_t n, uint8_t* key)
+{
+	memset(key, 0xAB, KEY_LENGTH);
+	memcpy(key, &n, sizeof(n));
+}
+
+static HashtableBucket* toBucket(uint32_t n)
+{
+	return reinterpret_cast<HashtableBucket*>((uintptr_t)(n+1)*8);
+}
+
+/**
+ * performs random inserts, lookups and removals and compares results with std::map
+ * hash values are restricted by hashMask to enforce equal hashes for different keys
+ */
+void FlowTableTest::testRandomOperations(uint32_t hashMask)
+{
+	FlowTable table(KEY_LENGTH, 4);
+	std::map<uint32_t, HashtableBucket*> reference;
+	uint8_t key[KEY_LENGTH];
+	unsigned int seed = 42;
+
+	for (uint32_t i = 0; i < OPERATIONS; i++) {
+		// grow during the first half, shrink during the second one
+		uint32_t n = rand_r(&seed) % KEY_RANGE;
+		bool insertPhase = i < OPERATIONS/2;
+		buildKey(n, key);
+		uint32_t hash = (crc32(0, KEY_LENGTH, (const char*)key) & hashMask) * 2654435761u;
+
+		HashtableBucket* bucket = table.find(hash, key);
+		std::map<uint32_t, HashtableBucket*>::iterator iter = reference.find(n);
+		REQUIRE((iter == reference.end() && bucket == NULL) || (iter != reference.end() && bucket == iter->second));
+
+		if (bucket == NULL && (insertPhase || rand_r(&seed) % 4 == 0)) {
+			table.insert(hash, key, toBucket(n));
+			reference[n] = toBucket(n);
+		} else if (bucket != NULL && (!insertPhase || rand_r(&seed) % 4 == 0)) {
+			table.remove(hash, bucket);
+			reference.erase(n);
+		}
+		REQUIRE(table.getEntries() == reference.size());
+	}
+
+	std::vector<HashtableBucket*> buckets;
+	table.getBuckets(buckets);
+	REQUIRE(buckets.size() == reference.size());
+	REQUIRE(table.statResizes > 0);
+}
+
+/**
+ * checks hash functions against reference values and hardware against software CRC32C
+ */
+void FlowTableTest::testHashFunctions()
+{
+	const char* check = "123456789";
+	REQUIRE(FlowHash(FlowHash::CRC32C).hash(check, 9) == 0xE3069283);
+	REQUIRE(FlowHash(FlowHash::XXHASH).hash(check, 0) == 0x02CC5D05);
+	REQUIRE(FlowHash(FlowHash::XXHASH).hash("abc", 3) == 0x32D153FF);
+
+	std::cout << "CRC32C implementation: " << FlowHash(FlowHash::CRC32C).getDescription() << std::endl;
+
+	// all engines must depend on every byte of the key
+	FlowHash::Engine engines[] = { FlowHash::CRC32, FlowHash::CRC32C, FlowHash::MIX64, FlowHash::XXHASH };
+	uint8_t key[40];
+	memset(key, 0, sizeof(key));
+	for (int e = 0; e < 4; e++) {
+		FlowHash hash(engines[e]);
+		for (uint32_t len = 1; len <= sizeof(key); len++) {
+			uint32_t h = hash.hash(key, len);
+			for (uint32_t i = 0; i < len; i++) {
+				key[i] ^= 0x10;
+				REQUIRE(hash.hash(key, len) != h);
+				key[i] ^= 0x10;
+			}
+		}
+	}
+}
+
+Test::TestResult FlowTableTest::execTest()
+{
+	std::cout << "Testing FlowHash..." << std::endl;
+	testHashFunctions();
+	std::cout << "Testing FlowTable with good hash values..." << std::endl;
+	testRandomOperations(0xFFFFFFFF);
+	std::cout << "Testing FlowTable with colliding hash values..." << std::endl;
+	testRandomOperations(0xFFF);
+
+	std::cout << "All tests on FlowTable passed" << std::endl;
+	return PASSED;
+}
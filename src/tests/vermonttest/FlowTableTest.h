@@ -0,0 +1,22 @@
+#ifndef FLOWTABLETEST_H_
+#define FLOWTABLETEST_H_
+
+#include "modules/ipfix/aggregator/FlowTable.h"
+#include "common/FlowHash.h"
+
+#include "TestSuiteBase.h"
+
+class FlowTableTest : public Test
+{
+public:
+	FlowTableTest();
+	~FlowTableTest();
+
+	virtual TestResult execTest();
+
+private:
+	void testRandomOperations(uint32_t hashMask);
+	void testHashFunctions();
+};
+
+#endif /*FLOWTABLETEST_H_*/
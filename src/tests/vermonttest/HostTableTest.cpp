@@ -0,0 +1,100 @@
+#include "HostTableTest.h"
+
+#include "common/HostTable.h"
+#include "common/DestinationSet.h"
+
+#include <iostream>
+#include <map>
+#include <stdlib.h>
+
+HostTableTest::HostTableTest()
+{
+}
+
+HostTableTest::~HostTableTest()
+{
+}
+
+/**
+ * compares HostTable with std::map during random inserts, erases and sweeps
+ * and checks all representations of DestinationSet
+ */
+Test::TestResult HostTableTest::execTest()
+{
+	std::cout << "Testing HostTable..." << std::endl;
+
+	HostTable<uint32_t> table(4);
+	std::map<uint32_t, uint32_t> reference;
+	srand(1);
+	for (uint32_t i = 0; i < 100000; i++) {
+		// small key range, so that inserts and erases of existing keys are frequent
+		uint32_t key = (rand() % 5000) << 12;
+		if (rand() % 3) {
+			bool created;
+			uint32_t& value = table.get(key, &created);
+			REQUIRE(created == (reference.find(key) == reference.end()));
+			value++;
+			reference[key]++;
+		} else {
+			REQUIRE(table.erase(key) == (reference.erase(key) == 1));
+		}
+		if (i % 1000 == 0) {
+			// remove all entries with odd values within one complete sweep
+			while (!table.sweep(HostTable<uint32_t>::SWEEP_STEP, [](uint32_t, uint32_t& v) { return (v & 1) != 0; }));
+			for (std::map<uint32_t, uint32_t>::iterator it = reference.begin(); it != reference.end();) {
+				if (it->second & 1) reference.erase(it++);
+				else it++;
+			}
+		}
+	}
+	REQUIRE(table.size() == reference.size());
+	for (std::map<uint32_t, uint32_t>::iterator it = reference.begin(); it != reference.end(); it++) {
+		uint32_t* value = table.find(it->first);
+		REQUIRE(value != NULL);
+		REQUIRE(*value == it->second);
+	}
+	for (uint32_t i = 0; i < table.size(); i++) {
+		REQUIRE(reference.find(table.at(i).key) != reference.end());
+	}
+	table.clear();
+	REQUIRE(table.size() == 0);
+	REQUIRE(table.find(reference.begin()->first) == NULL);
+
+	std::cout << "Testing DestinationSet..." << std::endl;
+
+	DestinationSet set;
+	for (uint32_t i = 0; i < DestinationSet::MAX_EXACT; i++) {
+		REQUIRE(set.insert(i*7919));
+		REQUIRE(!set.insert(i*7919));
+		REQUIRE(set.size() == i+1);
+	}
+	REQUIRE(set.isExact());
+	std::vector<uint32_t> addresses;
+	set.getAddresses(addresses);
+	REQUIRE(addresses.size() == DestinationSet::MAX_EXACT);
+
+	// estimate must be within a few standard errors after switching to HyperLogLog,
+	// callers counting new addresses must follow the estimate
+	uint32_t reported = DestinationSet::MAX_EXACT;
+	for (uint32_t i = DestinationSet::MAX_EXACT; i < 100000; i++) {
+		if (set.insert(i*7919)) reported++;
+		if (i == 20000) REQUIRE(reported > 19000 && reported <= set.size());
+	}
+	REQUIRE(!set.isExact());
+	REQUIRE(set.size() > 85000 && set.size() < 115000);
+	REQUIRE(reported <= set.size() && reported > 95000);
+	// known addresses count as new at most until the estimate is reached
+	for (uint32_t i = 0; i < 100000; i++) {
+		if (set.insert(i*7919)) reported++;
+	}
+	REQUIRE(reported == set.size());
+	set.clear();
+	REQUIRE(set.isExact());
+	REQUIRE(set.size() == 0);
+	REQUIRE(set.insert(0));
+	REQUIRE(!set.insert(0));
+
+	std::cout << "All tests on HostTable passed" << std::endl;
+
+	return PASSED;
+}
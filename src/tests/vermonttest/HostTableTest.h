@@ -0,0 +1,15 @@
+#ifndef HOSTTABLETEST_H_
+#define HOSTTABLETEST_H_
+
+#include "TestSuiteBase.h"
+
+class HostTableTest : public Test
+{
+public:
+	HostTableTest();
+	~HostTableTest();
+
+	virtual TestResult execTest();
+};
+
+#endif /*HOSTTABLETEST_H_*/
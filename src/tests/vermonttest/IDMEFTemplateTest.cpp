@@ -0,0 +1,90 @@
+#include "IDMEFTemplateTest.h"
+
+#include "modules/idmef/IDMEFTemplate.h"
+#include "modules/idmef/IDMEFExporter.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+IDMEFTemplateTest::IDMEFTemplateTest()
+{
+}
+
+IDMEFTemplateTest::~IDMEFTemplateTest()
+{
+}
+
+/**
+ * renders a template with repeated, unset and invalid variables and checks the
+ * framing of messages written by IDMEFExporter in spool mode
+ */
+Test::TestResult IDMEFTemplateTest::execTest()
+{
+	std::cout << "Testing IDMEFTemplate..." << std::endl;
+
+	IDMEFTemplate tmpl("<a>%SRC%</a><b>%DST%:%SRC%</b> 100% %% %UNSET% %no-var%");
+	REQUIRE(tmpl.getVariableCount() == 3);
+	int src = tmpl.getVariableIndex("SRC");
+	int dst = tmpl.getVariableIndex("DST");
+	REQUIRE(src >= 0 && dst >= 0 && src != dst);
+	REQUIRE(tmpl.getVariableIndex("UNSET") >= 0);
+	REQUIRE(tmpl.getVariableIndex("no-var") < 0);
+
+	vector<string> values(3);
+	vector<bool> isSet(3, false);
+	values[src] = "1.2.3.4";
+	isSet[src] = true;
+	values[dst] = "5.6.7.8";
+	isSet[dst] = true;
+	string result;
+	tmpl.render(values, isSet, result);
+	REQUIRE(result == "<a>1.2.3.4</a><b>5.6.7.8:1.2.3.4</b> 100% %% %UNSET% %no-var%");
+
+	char dir[] = "/tmp/idmeftestXXXXXX";
+	REQUIRE(mkdtemp(dir) != NULL);
+
+	// templates are shared until the file is modified
+	string filename = string(dir) + "/template.xml";
+	std::ofstream(filename.c_str()) << "<id>%ANALYZER_ID%</id>";
+	const IDMEFTemplate* cached = IDMEFTemplate::get(filename);
+	REQUIRE(cached == IDMEFTemplate::get(filename));
+	REQUIRE(cached->getVariableIndex("ANALYZER_ID") == 0);
+	unlink(filename.c_str());
+
+	std::cout << "Testing IDMEFExporter spool output..." << std::endl;
+	InstanceManager<IDMEFMessage> manager("IDMEFMessage", 0);
+	IDMEFExporter exporter(dir, "http://localhost/idmef");
+	exporter.setSpoolOutput(1024*1024, 60);
+	exporter.performStart();
+	for (int i = 0; i < 3; i++) {
+		IDMEFMessage* m = manager.getNewInstance();
+		exporter.receive(m);
+	}
+	exporter.performShutdown();
+
+	// writer thread closed the spool file at shutdown, so exactly one file without leading dot exists
+	DIR* d = opendir(dir);
+	REQUIRE(d != NULL);
+	vector<string> files;
+	struct dirent* entry;
+	while ((entry = readdir(d)) != NULL) {
+		if (entry->d_name[0] != '.') files.push_back(entry->d_name);
+	}
+	closedir(d);
+	REQUIRE(files.size() == 1);
+	string path = string(dir) + "/" + files[0];
+	std::ifstream in(path.c_str());
+	std::stringstream content;
+	content << in.rdbuf();
+	REQUIRE(content.str() == "0 http://localhost/idmef\n\n0 http://localhost/idmef\n\n0 http://localhost/idmef\n\n");
+	unlink(path.c_str());
+	rmdir(dir);
+
+	std::cout << "All tests on IDMEFTemplate passed" << std::endl;
+
+	return PASSED;
+}
@@ -0,0 +1,15 @@
+#ifndef IDMEFTEMPLATETEST_H_
+#define IDMEFTEMPLATETEST_H_
+
+#include "TestSuiteBase.h"
+
+class IDMEFTemplateTest : public Test
+{
+public:
+	IDMEFTemplateTest();
+	~IDMEFTemplateTest();
+
+	virtual TestResult execTest();
+};
+
+#endif /*IDMEFTEMPLATETEST_H_*/
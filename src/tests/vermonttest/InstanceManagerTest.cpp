@@ -0,0 +1,236 @@
+#include "InstanceManagerTest.h"
+
+#include "core/InstanceManager.h"
+#include "common/ManagedInstance.h"
+#include "common/ConcurrentQueue.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+static const uint32_t MAGAZINE_SIZE = 64; // batch size of InstanceManager
+static const uint32_t ALLOCATORS = 4;
+static const uint32_t RELEASERS = 2;
+static const uint32_t INSTANCES_PER_ALLOCATOR = 50000;
+
+/**
+ * managed type for the tests, inUse detects instances which are handed out twice
+ */
+class TestInstance : public ManagedInstance<TestInstance>
+{
+public:
+	TestInstance(InstanceManager<TestInstance>* im) : ManagedInstance<TestInstance>(im), inUse(0) {}
+
+	std::atomic<int> inUse;
+};
+
+static TestInstance* acquire(InstanceManager<TestInstance>& im)
+{
+	TestInstance* instance = im.getNewInstance();
+	REQUIRE(instance->inUse.exchange(1) == 0);
+	return instance;
+}
+
+static void release(TestInstance* instance)
+{
+	REQUIRE(instance->inUse.exchange(0) == 1);
+	instance->removeReference();
+}
+
+/**
+ * @returns value of the given element of the manager's statistics
+ */
+static uint64_t getStat(InstanceManager<TestInstance>& im, const char* name)
+{
+	std::string xml = im.getStatisticsXML(1);
+	std::string tag = std::string("<") + name + ">";
+	size_t pos = xml.find(tag);
+	REQUIRE(pos != std::string::npos);
+	return strtoull(xml.c_str()+pos+tag.size(), NULL, 10);
+}
+
+struct ThreadArgs {
+	InstanceManager<TestInstance>* im;
+	ConcurrentQueue<TestInstance*>* queue; /**< instances which are released by a releaser thread */
+};
+
+/**
+ * gets instances and holds a varying number of them, so that its magazine runs empty and full
+ * every second instance is released by a releaser thread, NULL tells the releaser to stop
+ */
+static void* allocatorThread(void* arg)
+{
+	ThreadArgs* args = (ThreadArgs*)arg;
+	std::vector<TestInstance*> held;
+	for (uint32_t i = 0; i < INSTANCES_PER_ALLOCATOR; i++) {
+		held.push_back(acquire(*args->im));
+		if (held.size() > i % 300) {
+			for (size_t j = 0; j < held.size(); j++) {
+				if (j % 2) args->queue->push(held[j]);
+				else release(held[j]);
+			}
+			held.clear();
+		}
+	}
+	for (size_t j = 0; j < held.size(); j++) {
+		release(held[j]);
+	}
+	args->queue->push(NULL);
+	return NULL;
+}
+
+/**
+ * releases instances of ALLOCATORS/RELEASERS allocator threads
+ */
+static void* releaserThread(void* arg)
+{
+	ThreadArgs* args = (ThreadArgs*)arg;
+	uint32_t stopped = 0;
+	while (stopped < ALLOCATORS/RELEASERS) {
+		TestInstance* instance;
+		REQUIRE(args->queue->pop(&instance));
+		if (instance) release(instance);
+		else stopped++;
+	}
+	return NULL;
+}
+
+InstanceManagerTest::InstanceManagerTest()
+{
+}
+
+InstanceManagerTest::~InstanceManagerTest()
+{
+}
+
+/**
+ * checks transfers between a thread's magazine and the depot at the batch boundaries
+ */
+void InstanceManagerTest::testBatchBoundary()
+{
+	const uint32_t prealloc = 3*MAGAZINE_SIZE+10;
+	InstanceManager<TestInstance> im("TestInstance", prealloc);
+	std::vector<TestInstance*> instances;
+
+	// the first instance moves a batch from the depot into the empty magazine
+	instances.push_back(acquire(im));
+	REQUIRE(getStat(im, "threadCaches") == 1);
+	REQUIRE(getStat(im, "cacheMisses") == 1);
+	REQUIRE(getStat(im, "depotRefills") == 1);
+	REQUIRE(getStat(im, "freeInstances") == prealloc-MAGAZINE_SIZE);
+
+	// the rest of the batch is taken from the magazine
+	while (instances.size() < MAGAZINE_SIZE) instances.push_back(acquire(im));
+	REQUIRE(getStat(im, "cacheHits") == MAGAZINE_SIZE-1);
+	REQUIRE(getStat(im, "cacheMisses") == 1);
+	REQUIRE(getStat(im, "freeInstances") == prealloc-MAGAZINE_SIZE);
+
+	// the next instance crosses the batch boundary
+	instances.push_back(acquire(im));
+	REQUIRE(getStat(im, "cacheMisses") == 2);
+	REQUIRE(getStat(im, "depotRefills") == 2);
+	REQUIRE(getStat(im, "freeInstances") == prealloc-2*MAGAZINE_SIZE);
+
+	// the last refill gets the remaining 10 instances, afterwards new instances are created
+	while (instances.size() < prealloc+1) instances.push_back(acquire(im));
+	REQUIRE(getStat(im, "depotRefills") == 4);
+	REQUIRE(getStat(im, "cacheMisses") == 5);
+	REQUIRE(getStat(im, "cacheHits")+getStat(im, "cacheMisses") == prealloc+1);
+	REQUIRE(getStat(im, "freeInstances") == 0);
+	REQUIRE(getStat(im, "createdInstances") == prealloc+1);
+
+	// the magazine takes two batches, the next instance returns one batch to the depot
+	for (uint32_t i = 0; i < 2*MAGAZINE_SIZE; i++) {
+		release(instances.back());
+		instances.pop_back();
+	}
+	REQUIRE(getStat(im, "depotReturns") == 0);
+	REQUIRE(getStat(im, "freeInstances") == 0);
+	release(instances.back());
+	instances.pop_back();
+	REQUIRE(getStat(im, "depotReturns") == 1);
+	REQUIRE(getStat(im, "freeInstances") == MAGAZINE_SIZE);
+
+	while (!instances.empty()) {
+		release(instances.back());
+		instances.pop_back();
+	}
+	REQUIRE(getStat(im, "depotReturns") == 2);
+	REQUIRE(getStat(im, "freeInstances") == 2*MAGAZINE_SIZE);
+
+	// released instances are reused from the magazine
+	TestInstance* instance = acquire(im);
+	REQUIRE(getStat(im, "depotRefills") == 4);
+	REQUIRE(getStat(im, "createdInstances") == prealloc+1);
+	release(instance);
+}
+
+/**
+ * gets and releases instances in several threads, half of them are released by other threads
+ * afterwards the magazines of the terminated threads must be reclaimed
+ */
+void InstanceManagerTest::testThreads()
+{
+	const uint32_t prealloc = 100;
+	InstanceManager<TestInstance> im("TestInstance", prealloc);
+	std::vector<ConcurrentQueue<TestInstance*>*> queues;
+	std::vector<ThreadArgs> args(ALLOCATORS+RELEASERS);
+	std::vector<pthread_t> threads(ALLOCATORS+RELEASERS);
+
+	for (uint32_t i = 0; i < RELEASERS; i++) {
+		queues.push_back(new ConcurrentQueue<TestInstance*>());
+	}
+	for (uint32_t i = 0; i < ALLOCATORS+RELEASERS; i++) {
+		args[i].im = &im;
+		args[i].queue = queues[i%RELEASERS];
+		REQUIRE(pthread_create(&threads[i], NULL, i < ALLOCATORS ? allocatorThread : releaserThread, &args[i]) == 0);
+	}
+	for (uint32_t i = 0; i < ALLOCATORS+RELEASERS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	for (uint32_t i = 0; i < RELEASERS; i++) {
+		REQUIRE(queues[i]->getCount() == 0);
+		delete queues[i];
+	}
+
+#if !defined(DEBUG) && !defined(IM_DISABLE)
+	uint64_t gets = ALLOCATORS*INSTANCES_PER_ALLOCATOR;
+	uint64_t created = getStat(im, "createdInstances");
+	REQUIRE(getStat(im, "cacheHits")+getStat(im, "cacheMisses") == gets);
+	// every miss either moves a batch from the depot or creates one instance
+	REQUIRE(getStat(im, "cacheMisses") == getStat(im, "depotRefills")+created-prealloc);
+	REQUIRE(getStat(im, "threadCaches") <= ALLOCATORS+RELEASERS);
+	// the releasers' magazines still contain instances
+	REQUIRE(getStat(im, "freeInstances") < created);
+
+	// all instances are free, so they are handed out again without creating new ones,
+	// this is only possible if the magazines of the terminated threads are reclaimed
+	std::vector<TestInstance*> instances;
+	while (instances.size() < created) instances.push_back(acquire(im));
+	REQUIRE(getStat(im, "createdInstances") == created);
+	REQUIRE(getStat(im, "threadCaches") == 1);
+	REQUIRE(getStat(im, "cacheHits")+getStat(im, "cacheMisses") == gets+created);
+	REQUIRE(getStat(im, "cacheMisses") == getStat(im, "depotRefills")+created-prealloc);
+
+	for (size_t i = 0; i < instances.size(); i++) {
+		release(instances[i]);
+	}
+#endif
+}
+
+Test::TestResult InstanceManagerTest::execTest()
+{
+	std::cout << "Testing InstanceManager..." << std::endl;
+
+	// in DEBUG mode all instances go through the depot, so there are no magazines to test
+#if !defined(DEBUG) && !defined(IM_DISABLE)
+	testBatchBoundary();
+#endif
+	testThreads();
+
+	std::cout << "All tests on InstanceManager passed" << std::endl;
+
+	return PASSED;
+}
@@ -0,0 +1,19 @@
+#ifndef INSTANCEMANAGERTEST_H_
+#define INSTANCEMANAGERTEST_H_
+
+#include "TestSuiteBase.h"
+
+class InstanceManagerTest : public Test
+{
+public:
+	InstanceManagerTest();
+	~InstanceManagerTest();
+
+	virtual TestResult execTest();
+
+private:
+	void testBatchBoundary();
+	void testThreads();
+};
+
+#endif /*INSTANCEMANAGERTEST_H_*/
@@ -0,0 +1,126 @@
+#include "MsgAsyncTest.h"
+
+#include "common/msg.h"
+
+#include <iostream>
+#include <pthread.h>
+#include <unistd.h>
+
+MsgAsyncTest::MsgAsyncTest()
+{
+}
+
+MsgAsyncTest::~MsgAsyncTest()
+{
+}
+
+namespace {
+
+const uint32_t THREADS = 4;
+const uint32_t MESSAGES = 1000;
+
+void* logMessages(void* arg)
+{
+	uintptr_t id = (uintptr_t)arg;
+	for (uint32_t i = 0; i < MESSAGES; i++) {
+		msg(LOG_NOTICE, "MsgAsyncTest: thread %u, message %u", (uint32_t)id, i);
+	}
+	return NULL;
+}
+
+/**
+ * logs a message when the thread exits, after the ring of the thread was released
+ */
+struct TeardownLogger {
+	bool active;
+	bool writtenSynchronously;
+
+	TeardownLogger() : active(false), writtenSynchronously(false) {}
+	~TeardownLogger()
+	{
+		if (!active) return;
+		uint64_t written, dropped, suppressed, written2;
+		msg_get_async_stats(&written, &dropped, &suppressed);
+		msg(LOG_NOTICE, "MsgAsyncTest: thread exits");
+		msg_get_async_stats(&written2, &dropped, &suppressed);
+		teardownResult = written2-written == 1;
+	}
+
+	static bool teardownResult;
+};
+
+bool TeardownLogger::teardownResult = false;
+thread_local TeardownLogger teardownLogger;
+
+void* logOnTeardown(void*)
+{
+	// constructed before the ring of this thread, so it is destroyed after it
+	teardownLogger.active = true;
+	uint64_t written, dropped, suppressed, written2;
+	msg_get_async_stats(&written, &dropped, &suppressed);
+	msg(LOG_NOTICE, "MsgAsyncTest: thread starts");
+	do {
+		usleep(1000);
+		msg_get_async_stats(&written2, &dropped, &suppressed);
+	} while (written2 == written);
+	return NULL;
+}
+
+}
+
+/**
+ * logs from several threads in asynchronous mode, messages of the same call site must be
+ * rate limited and every message must be either written, dropped or suppressed
+ */
+Test::TestResult MsgAsyncTest::execTest()
+{
+	std::cout << "Testing asynchronous logging..." << std::endl;
+
+	int level = msg_getlevel();
+	bool quiet = msg_getquiet();
+	bool syslog = msg_get_syslog();
+	bool journald = msg_get_journald();
+	msg_setlevel(LOG_UPTO(LOG_NOTICE));
+	msg_setquiet(true);
+	msg_set_syslog(false);
+	msg_set_journald(false);
+
+	uint64_t written, dropped, suppressed;
+	msg_get_async_stats(&written, &dropped, &suppressed);
+
+	msg_set_async(true);
+	REQUIRE(msg_get_async());
+	pthread_t threads[THREADS];
+	for (uintptr_t i = 0; i < THREADS; i++) {
+		REQUIRE(pthread_create(&threads[i], NULL, logMessages, (void*)i) == 0);
+	}
+	for (uint32_t i = 0; i < THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	// writes all buffered messages
+	msg_set_async(false);
+	REQUIRE(!msg_get_async());
+
+	uint64_t written2, dropped2, suppressed2;
+	msg_get_async_stats(&written2, &dropped2, &suppressed2);
+	REQUIRE(written2-written+dropped2-dropped+suppressed2-suppressed == THREADS*MESSAGES);
+	REQUIRE(written2-written >= 10);
+	REQUIRE(suppressed2-suppressed > 0);
+
+	std::cout << "Testing asynchronous logging on thread exit..." << std::endl;
+	msg_set_async(true);
+	pthread_t thread;
+	REQUIRE(pthread_create(&thread, NULL, logOnTeardown, NULL) == 0);
+	pthread_join(thread, NULL);
+	msg_set_async(false);
+	// messages after the ring of a thread was released are written synchronously
+	REQUIRE(TeardownLogger::teardownResult);
+
+	msg_setlevel(level);
+	msg_setquiet(quiet);
+	msg_set_syslog(syslog);
+	msg_set_journald(journald);
+
+	std::cout << "All tests on asynchronous logging passed" << std::endl;
+	return PASSED;
+}
@@ -0,0 +1,15 @@
+#ifndef MSGASYNCTEST_H_
+#define MSGASYNCTEST_H_
+
+#include "TestSuiteBase.h"
+
+class MsgAsyncTest : public Test
+{
+public:
+	MsgAsyncTest();
+	~MsgAsyncTest();
+
+	virtual TestResult execTest();
+};
+
+#endif /*MSGASYNCTEST_H_*/
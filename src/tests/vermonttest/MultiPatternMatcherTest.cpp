@@ -0,0 +1,104 @@
+#include "MultiPatternMatcherTest.h"
+
+#include "modules/packet/filter/MultiPatternMatcher.h"
+
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+
+MultiPatternMatcherTest::MultiPatternMatcherTest()
+{
+}
+
+MultiPatternMatcherTest::~MultiPatternMatcherTest()
+{
+}
+
+/**
+ * @returns true if data contains pattern, like the former byte-by-byte scan of StringFilter
+ */
+static bool contains(const std::string& data, const std::string& pattern)
+{
+	return std::search(data.begin(), data.end(), pattern.begin(), pattern.end()) != data.end();
+}
+
+/**
+ * compares the matcher with a naive evaluation of random patterns on random data
+ * @param alphabet number of different bytes in patterns and data, small values produce many matches
+ * @param patternCount number of required and forbidden patterns
+ */
+void MultiPatternMatcherTest::testRandom(uint32_t alphabet, uint32_t patternCount)
+{
+	for (int run = 0; run < 50; run++) {
+		MultiPatternMatcher matcher;
+		std::vector<std::string> required, forbidden;
+		for (uint32_t i = 0; i < patternCount; i++) {
+			std::string p;
+			size_t len = 1+rand()%4;
+			for (size_t j = 0; j < len; j++) p += (char)('a'+rand()%alphabet);
+			if (rand()%2) {
+				required.push_back(p);
+				matcher.addPattern(p, MultiPatternMatcher::Required);
+			} else {
+				forbidden.push_back(p);
+				matcher.addPattern(p, MultiPatternMatcher::Forbidden);
+			}
+		}
+		matcher.compile();
+
+		for (int i = 0; i < 200; i++) {
+			std::string data;
+			size_t len = rand()%100;
+			for (size_t j = 0; j < len; j++) data += (char)('a'+rand()%alphabet);
+
+			bool expected = true;
+			for (size_t j = 0; j < required.size(); j++) {
+				if (!contains(data, required[j])) expected = false;
+			}
+			for (size_t j = 0; j < forbidden.size(); j++) {
+				if (contains(data, forbidden[j])) expected = false;
+			}
+			REQUIRE(matcher.matches((const uint8_t*)data.data(), data.size()) == expected);
+		}
+	}
+}
+
+Test::TestResult MultiPatternMatcherTest::execTest()
+{
+	std::cout << "Testing MultiPatternMatcher..." << std::endl;
+
+	MultiPatternMatcher empty;
+	empty.compile();
+	REQUIRE(empty.matches((const uint8_t*)"abc", 3));
+
+	// overlapping patterns and patterns which are suffixes of others
+	MultiPatternMatcher m;
+	m.addPattern("he", MultiPatternMatcher::Required);
+	m.addPattern("she", MultiPatternMatcher::Required);
+	m.addPattern("hers", MultiPatternMatcher::Required);
+	m.addPattern("his", MultiPatternMatcher::Forbidden);
+	m.addPattern("", MultiPatternMatcher::Forbidden);
+	m.compile();
+	REQUIRE(m.getPatternCount() == 4);
+	std::string text = "ushers and more text to exceed one block of sixteen bytes";
+	REQUIRE(m.matches((const uint8_t*)text.data(), text.size()));
+	text += " his";
+	REQUIRE(!m.matches((const uint8_t*)text.data(), text.size()));
+	REQUIRE(!m.matches((const uint8_t*)"she", 3));
+
+	// binary data including zero bytes
+	MultiPatternMatcher bin;
+	bin.addPattern(std::string("\x00\xff", 2), MultiPatternMatcher::Required);
+	bin.compile();
+	const uint8_t data[] = { 1, 2, 0, 0xff, 3 };
+	REQUIRE(bin.matches(data, sizeof(data)));
+	REQUIRE(!bin.matches(data, 3));
+
+	srand(1);
+	testRandom(2, 3);
+	testRandom(4, 8);
+	testRandom(26, 40);
+
+	std::cout << "All tests on MultiPatternMatcher passed" << std::endl;
+	return PASSED;
+}
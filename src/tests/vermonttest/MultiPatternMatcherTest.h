@@ -0,0 +1,21 @@
+#ifndef MULTIPATTERNMATCHERTEST_H_
+#define MULTIPATTERNMATCHERTEST_H_
+
+#include "TestSuiteBase.h"
+
+#include <string>
+#include <vector>
+
+class MultiPatternMatcherTest : public Test
+{
+public:
+	MultiPatternMatcherTest();
+	~MultiPatternMatcherTest();
+
+	virtual TestResult execTest();
+
+private:
+	void testRandom(uint32_t alphabet, uint32_t patternCount);
+};
+
+#endif /*MULTIPATTERNMATCHERTEST_H_*/
@@ -0,0 +1,140 @@
+#include "MultiRegexMatcherTest.h"
+
+#include "modules/packet/filter/MultiRegexMatcher.h"
+
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+#include <boost/regex.hpp>
+
+MultiRegexMatcherTest::MultiRegexMatcherTest()
+{
+}
+
+MultiRegexMatcherTest::~MultiRegexMatcherTest()
+{
+}
+
+static bool matches(MultiRegexMatcher& m, const std::string& data, uint32_t regex)
+{
+	m.scan((const uint8_t*)data.data(), data.size(), true);
+	const std::vector<uint32_t>& result = m.getMatches();
+	return std::find(result.begin(), result.end(), regex) != result.end();
+}
+
+/**
+ * @returns random expression over the bytes a, b and c
+ */
+std::string MultiRegexMatcherTest::randomRegex(uint32_t depth)
+{
+	static const char* atoms[] = { "a", "b", "c", ".", "[ab]", "[^a]", "\\x61", "(?:ab)" };
+	static const char* quantifiers[] = { "*", "+", "?", "{2}", "{1,3}", "{2,}", "*?" };
+
+	uint32_t choice = depth == 0 ? 0 : rand()%4;
+	switch (choice) {
+		case 0:
+			return atoms[rand()%8];
+		case 1:
+			return randomRegex(depth-1) + randomRegex(depth-1);
+		case 2:
+			return "(" + randomRegex(depth-1) + "|" + randomRegex(depth-1) + ")";
+		default:
+			return "(" + randomRegex(depth-1) + ")" + quantifiers[rand()%7];
+	}
+}
+
+/**
+ * compares the matcher with boost::regex for a set of random expressions on random data
+ */
+void MultiRegexMatcherTest::testRandom(uint32_t maxStates)
+{
+	for (int run = 0; run < 20; run++) {
+		MultiRegexMatcher m(maxStates);
+		std::vector<boost::regex> expected;
+		for (int i = 0; i < 8; i++) {
+			std::string r = randomRegex(3);
+			if (rand()%4 == 0) r = "^" + r;
+			if (rand()%4 == 0) r += "$";
+			m.addRegex(r);
+			expected.push_back(boost::regex(r));
+		}
+		m.compile();
+		REQUIRE(m.getFallbackCount() == 0);
+
+		for (int i = 0; i < 100; i++) {
+			std::string data;
+			size_t len = rand()%20;
+			for (size_t j = 0; j < len; j++) data += (char)('a'+rand()%3);
+
+			for (uint32_t j = 0; j < expected.size(); j++) {
+				bool found = boost::regex_search(data, expected[j], boost::match_default | boost::match_single_line);
+				REQUIRE(matches(m, data, j) == found);
+			}
+		}
+	}
+}
+
+Test::TestResult MultiRegexMatcherTest::execTest()
+{
+	std::cout << "Testing MultiRegexMatcher..." << std::endl;
+
+	MultiRegexMatcher m;
+	uint32_t get = m.addRegex("GET /[a-z]+\\.php\\?id=\\d{1,5}");
+	uint32_t begin = m.addRegex("^abc");
+	uint32_t end = m.addRegex("xyz$");
+	uint32_t zero = m.addRegex("a\\x00b");
+	uint32_t backref = m.addRegex("(ab)\\1");
+	m.compile();
+	REQUIRE(m.getRegexCount() == 5);
+	REQUIRE(m.getFallbackCount() == 1);
+
+	REQUIRE(matches(m, "xx GET /index.php?id=42 HTTP/1.1", get));
+	REQUIRE(!matches(m, "xx GET /index.html?id=42", get));
+	REQUIRE(matches(m, "abcd", begin));
+	REQUIRE(!matches(m, "xabc", begin));
+	REQUIRE(matches(m, "..xyz", end));
+	REQUIRE(!matches(m, "xyz..", end));
+	REQUIRE(matches(m, "abab", backref));
+
+	// zero bytes must neither end the data nor be skipped
+	std::string binary("\x00\x00" "a\x00" "b xyz", 9);
+	REQUIRE(matches(m, binary, zero));
+	REQUIRE(matches(m, binary, end));
+	REQUIRE(m.getMatches().size() == 2);
+
+	// only the given length is scanned, $ does not match at the end of incomplete data
+	const uint8_t* data = (const uint8_t*)"abcxyzGET /a.php?id=1";
+	REQUIRE(m.scan(data, 6, false) == 1);
+	REQUIRE(m.getMatches()[0] == begin);
+	REQUIRE(m.scan(data, 6, true) == 2);
+	REQUIRE(m.scan(data, 5, true) == 1);
+
+	// end of empty data must not change the end matches of the initial state
+	MultiRegexMatcher anchored;
+	uint32_t spaces = anchored.addRegex("\\s*$");
+	uint32_t optional = anchored.addRegex("(abc)?$");
+	anchored.compile();
+	const char* sequence[] = { "zz", "", "zz", "x", "", "x" };
+	for (int i = 0; i < 6; i++) {
+		REQUIRE(matches(anchored, sequence[i], spaces));
+		REQUIRE(matches(anchored, sequence[i], optional));
+	}
+
+	// syntax errors are reported by boost::regex
+	MultiRegexMatcher invalid;
+	bool thrown = false;
+	try {
+		invalid.addRegex("(a");
+	} catch (std::exception&) {
+		thrown = true;
+	}
+	REQUIRE(thrown);
+
+	srand(1);
+	testRandom(MultiRegexMatcher::DEFAULT_MAX_STATES);
+	// small cache which is flushed frequently
+	testRandom(3);
+
+	std::cout << "All tests on MultiRegexMatcher passed" << std::endl;
+	return PASSED;
+}
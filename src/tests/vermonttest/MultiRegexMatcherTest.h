@@ -0,0 +1,21 @@
+#ifndef MULTIREGEXMATCHERTEST_H_
+#define MULTIREGEXMATCHERTEST_H_
+
+#include "TestSuiteBase.h"
+
+#include <string>
+
+class MultiRegexMatcherTest : public Test
+{
+public:
+	MultiRegexMatcherTest();
+	~MultiRegexMatcherTest();
+
+	virtual TestResult execTest();
+
+private:
+	std::string randomRegex(uint32_t depth);
+	void testRandom(uint32_t maxStates);
+};
+
+#endif /*MULTIREGEXMATCHERTEST_H_*/
@@ -0,0 +1,99 @@
+#include "PayloadFilterTest.h"
+
+#include "modules/packet/filter/RegExFilter.h"
+#include "modules/packet/filter/StringFilter.h"
+
+#include <sys/time.h>
+#include <pcap.h>
+#include <string.h>
+#include <iostream>
+
+PayloadFilterTest::PayloadFilterTest()
+	: packetManager("Packet")
+{
+}
+
+PayloadFilterTest::~PayloadFilterTest()
+{
+}
+
+/**
+ * creates an ethernet frame containing a UDP packet with the given payload, the packet
+ * buffer behind the captured data is filled with other bytes
+ */
+Packet* PayloadFilterTest::createPacket(const char* payload)
+{
+	unsigned char data[14+20+8+64];
+	uint32_t plen = strlen(payload);
+	uint32_t len = 14+20+8+plen;
+	memset(data, 0, sizeof(data));
+	data[12] = 0x08; // ethertype IPv4
+
+	unsigned char* ip = data+14;
+	ip[0] = 0x45;
+	ip[2] = 0;
+	ip[3] = 20+8+plen;
+	ip[8] = 64;
+	ip[9] = 17;
+	ip[12] = 10;
+	ip[15] = 1;
+	ip[16] = 10;
+	ip[19] = 2;
+	unsigned char* udp = ip+20;
+	udp[1] = 53;
+	udp[3] = 53;
+	udp[5] = 8+plen;
+	memcpy(udp+8, payload, plen);
+
+	struct timeval now;
+	gettimeofday(&now, 0);
+	Packet* p = packetManager.getNewInstance();
+	p->init((char*)data, len, now, 0, len, DLT_EN10MB);
+	// bytes which are not part of the packet must never be scanned
+	memcpy(p->layer2Start+p->data_length, "zzzzMARKERzzzzzz", 16);
+	return p;
+}
+
+/**
+ * filters must scan the payload up to the end of the captured data, which is
+ * counted from the start of the layer 2 header
+ */
+Test::TestResult PayloadFilterTest::execTest()
+{
+	std::cout << "Testing payload filters with layer 2 headers..." << std::endl;
+
+	Packet* p = createPacket("abc");
+	REQUIRE(p->layer2HeaderLen == 14);
+	REQUIRE(p->payloadOffset == 28);
+
+	RegExFilter regexFilter;
+	regexFilter.addRegex("abc$");
+	regexFilter.compile();
+	REQUIRE(regexFilter.processPacket(p));
+
+	RegExFilter markerRegexFilter;
+	markerRegexFilter.addRegex("MARKER");
+	markerRegexFilter.compile();
+	REQUIRE(!markerRegexFilter.processPacket(p));
+
+	StringFilter andFilter;
+	andFilter.addandFilter("MARKER");
+	andFilter.compile();
+	REQUIRE(!andFilter.processPacket(p));
+
+	StringFilter notFilter;
+	notFilter.addandFilter("abc");
+	notFilter.addnotFilter("MARKER");
+	notFilter.compile();
+	REQUIRE(notFilter.processPacket(p));
+	p->removeReference();
+
+	// empty payload
+	p = createPacket("");
+	REQUIRE(!regexFilter.processPacket(p));
+	REQUIRE(!andFilter.processPacket(p));
+	p->removeReference();
+
+	std::cout << "All tests on payload filters passed" << std::endl;
+	return PASSED;
+}
@@ -0,0 +1,23 @@
+#ifndef PAYLOADFILTERTEST_H_
+#define PAYLOADFILTERTEST_H_
+
+#include "modules/packet/Packet.h"
+#include "core/InstanceManager.h"
+
+#include "TestSuiteBase.h"
+
+class PayloadFilterTest : public Test
+{
+public:
+	PayloadFilterTest();
+	~PayloadFilterTest();
+
+	virtual TestResult execTest();
+
+private:
+	InstanceManager<Packet> packetManager;
+
+	Packet* createPacket(const char* payload);
+};
+
+#endif /*PAYLOADFILTERTEST_H_*/
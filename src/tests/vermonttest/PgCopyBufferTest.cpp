@@ -0,0 +1,89 @@
+#include "PgCopyBufferTest.h"
+
+#include "modules/ipfix/database/PgCopyBuffer.hpp"
+#include "common/ipfixlolib/ipfix.h"
+
+#include <iostream>
+#include <string.h>
+
+PgCopyBufferTest::PgCopyBufferTest()
+{
+}
+
+PgCopyBufferTest::~PgCopyBufferTest()
+{
+}
+
+/**
+ * encodes one row containing the IPFIX types supported by IpfixDbWriterPg and
+ * compares it with the binary COPY format expected by PostgreSQL
+ */
+Test::TestResult PgCopyBufferTest::execTest()
+{
+	std::cout << "Testing PgCopyBuffer..." << std::endl;
+
+	REQUIRE(memcmp(PgCopyBuffer::HEADER, "PGCOPY\n\377\r\n\0", 11) == 0);
+	REQUIRE(PgCopyBuffer::getType(IPFIX_TYPE_unsigned8) == PgCopyBuffer::Int2);
+	REQUIRE(PgCopyBuffer::getType(IPFIX_TYPE_unsigned16) == PgCopyBuffer::Int4);
+	REQUIRE(PgCopyBuffer::getType(IPFIX_TYPE_unsigned32) == PgCopyBuffer::Int8);
+	REQUIRE(PgCopyBuffer::getType(IPFIX_TYPE_ipv6Address) == PgCopyBuffer::Inet);
+
+	const uint8_t port[] = { 0x01, 0xBB };
+	const uint8_t negative[] = { 0xFE };
+	const uint8_t reducedCount[] = { 0x00, 0x01, 0x00, 0x00 };
+	const uint8_t ipv4[] = { 192, 168, 1, 2 };
+	const uint8_t ipv6[] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+	const uint8_t mac[] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+	const uint8_t boolFalse[] = { 2 };
+	const uint8_t text[] = { 'e', 't', 'h', '0', 0, 0 };
+	const uint8_t float32[] = { 0x3F, 0xC0, 0x00, 0x00 }; // 1.5
+
+	PgCopyBuffer row;
+	row.beginRow(11);
+	row.addIpfixValue(PgCopyBuffer::Int4, IPFIX_TYPE_unsigned16, port, 2);
+	row.addIpfixValue(PgCopyBuffer::Int2, IPFIX_TYPE_signed8, negative, 1);
+	row.addIpfixValue(PgCopyBuffer::Int8, IPFIX_TYPE_unsigned64, reducedCount, 4);
+	row.addIpfixValue(PgCopyBuffer::Inet, IPFIX_TYPE_ipv4Address, ipv4, 4);
+	row.addIpfixValue(PgCopyBuffer::Inet, IPFIX_TYPE_ipv6Address, ipv6, 16);
+	row.addIpfixValue(PgCopyBuffer::MacAddr, IPFIX_TYPE_macAddress, mac, 6);
+	row.addIpfixValue(PgCopyBuffer::Bool, IPFIX_TYPE_boolean, boolFalse, 1);
+	row.addIpfixValue(PgCopyBuffer::Text, IPFIX_TYPE_string, text, 6);
+	row.addIpfixValue(PgCopyBuffer::Float8, IPFIX_TYPE_float64, float32, 4);
+	row.addInteger(PgCopyBuffer::Int8, 42);
+	row.addNull();
+
+	const uint8_t expected[] = {
+		0x00, 0x0B,
+		0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x01, 0xBB,
+		0x00, 0x00, 0x00, 0x02, 0xFF, 0xFE,
+		0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x08, 2, 32, 0, 4, 192, 168, 1, 2,
+		0x00, 0x00, 0x00, 0x14, 3, 128, 0, 16, 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+		0x00, 0x00, 0x00, 0x06, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55,
+		0x00, 0x00, 0x00, 0x01, 0x00,
+		0x00, 0x00, 0x00, 0x04, 'e', 't', 'h', '0',
+		0x00, 0x00, 0x00, 0x08, 0x3F, 0xF8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2A,
+		0xFF, 0xFF, 0xFF, 0xFF
+	};
+	REQUIRE(row.size() == sizeof(expected));
+	REQUIRE(memcmp(row.data(), expected, sizeof(expected)) == 0);
+
+	// values which do not fit the column type are stored as NULL
+	PgCopyBuffer invalid;
+	invalid.addIpfixValue(PgCopyBuffer::Inet, IPFIX_TYPE_ipv4Address, ipv6, 6);
+	invalid.addIpfixValue(PgCopyBuffer::Int8, IPFIX_TYPE_unsigned64, ipv6, 16);
+	const uint8_t nulls[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	REQUIRE(invalid.size() == sizeof(nulls));
+	REQUIRE(memcmp(invalid.data(), nulls, sizeof(nulls)) == 0);
+
+	PgCopyBuffer batch;
+	batch.append(row);
+	batch.append(row);
+	REQUIRE(batch.size() == 2*row.size());
+	batch.clear();
+	REQUIRE(batch.size() == 0);
+
+	std::cout << "All tests on PgCopyBuffer passed" << std::endl;
+	return PASSED;
+}
@@ -0,0 +1,15 @@
+#ifndef PGCOPYBUFFERTEST_H_
+#define PGCOPYBUFFERTEST_H_
+
+#include "TestSuiteBase.h"
+
+class PgCopyBufferTest : public Test
+{
+public:
+	PgCopyBufferTest();
+	~PgCopyBufferTest();
+
+	virtual TestResult execTest();
+};
+
+#endif /*PGCOPYBUFFERTEST_H_*/
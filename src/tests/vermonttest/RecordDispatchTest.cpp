@@ -0,0 +1,102 @@
+#include "RecordDispatchTest.h"
+
+#include "modules/ipfix/IpfixRecordDestination.h"
+
+#include <iostream>
+#include <vector>
+
+/**
+ * logs all records in the order the handler functions were called
+ */
+class DispatchLogger : public IpfixRecordDestination
+{
+public:
+	std::vector<IpfixRecord*> records;
+	std::vector<size_t> chunks; /**< sizes of the chunks passed to onDataRecords() */
+
+protected:
+	virtual void onTemplate(IpfixTemplateRecord* record)
+	{
+		records.push_back(record);
+		record->removeReference();
+	}
+
+	virtual void onDataRecord(IpfixDataRecord* record)
+	{
+		records.push_back(record);
+		record->removeReference();
+	}
+
+	virtual void onDataRecords(IpfixDataRecord** records, size_t count)
+	{
+		chunks.push_back(count);
+		IpfixRecordDestination::onDataRecords(records, count);
+	}
+
+	virtual void onTemplateDestruction(IpfixTemplateDestructionRecord* record)
+	{
+		records.push_back(record);
+		record->removeReference();
+	}
+};
+
+RecordDispatchTest::RecordDispatchTest()
+{
+}
+
+RecordDispatchTest::~RecordDispatchTest()
+{
+}
+
+/**
+ * a batch of mixed records must be dispatched in its original order, consecutive
+ * Data Records are passed in chunks which are split at every other record
+ */
+Test::TestResult RecordDispatchTest::execTest()
+{
+	static InstanceManager<IpfixTemplateRecord> templateIM("IpfixTemplateRecord");
+	static InstanceManager<IpfixDataRecord> dataIM("IpfixDataRecord");
+	static InstanceManager<IpfixTemplateDestructionRecord> destructionIM("IpfixTemplateDestructionRecord");
+
+	std::cout << "Testing dispatch of IpfixRecord batches..." << std::endl;
+
+	boost::shared_ptr<TemplateInfo> ti(new TemplateInfo());
+	std::vector<IpfixRecord*> batch;
+
+	IpfixTemplateRecord* tr = templateIM.getNewInstance();
+	tr->templateInfo = ti;
+	batch.push_back(tr);
+	for (int i = 0; i < 150; i++) {
+		IpfixDataRecord* dr = dataIM.getNewInstance();
+		dr->templateInfo = ti;
+		batch.push_back(dr);
+	}
+	IpfixTemplateDestructionRecord* tdr = destructionIM.getNewInstance();
+	tdr->templateInfo = ti;
+	batch.push_back(tdr);
+	IpfixDataRecord* dr = dataIM.getNewInstance();
+	dr->templateInfo = ti;
+	batch.push_back(dr);
+
+	REQUIRE(tr->recordType == IpfixRecord::TemplateRecord);
+	REQUIRE(dr->recordType == IpfixRecord::DataRecord);
+	REQUIRE(tdr->recordType == IpfixRecord::TemplateDestructionRecord);
+
+	std::vector<IpfixRecord*> expected = batch;
+	DispatchLogger logger;
+	logger.receiveBatch(batch);
+
+	REQUIRE(logger.records == expected);
+	size_t chunkSizes[] = { 64, 64, 22, 1 };
+	REQUIRE(logger.chunks == std::vector<size_t>(chunkSizes, chunkSizes+4));
+
+	// single records take the same path as before
+	IpfixDataRecord* single = dataIM.getNewInstance();
+	single->templateInfo = ti;
+	logger.receive(single);
+	REQUIRE(logger.records.back() == single);
+	REQUIRE(logger.chunks.size() == 4);
+
+	std::cout << "All tests on IpfixRecordDestination passed" << std::endl;
+	return PASSED;
+}
@@ -0,0 +1,15 @@
+#ifndef RECORDDISPATCHTEST_H_
+#define RECORDDISPATCHTEST_H_
+
+#include "TestSuiteBase.h"
+
+class RecordDispatchTest : public Test
+{
+public:
+	RecordDispatchTest();
+	~RecordDispatchTest();
+
+	virtual TestResult execTest();
+};
+
+#endif /*RECORDDISPATCHTEST_H_*/
@@ -0,0 +1,214 @@
+#include "RuleMatcherTest.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <pcap.h>
+#include <iostream>
+
+static const uint32_t RULES = 70;
+static const uint32_t PACKETS = 20000;
+
+RuleMatcherTest::RuleMatcherTest()
+	: packetManager("Packet")
+{
+}
+
+RuleMatcherTest::~RuleMatcherTest()
+{
+}
+
+Rule::Field* RuleMatcherTest::createField(uint16_t id, uint16_t length)
+{
+	Rule::Field* f = new Rule::Field();
+	f->modifier = Rule::Field::KEEP;
+	f->type.id = id;
+	f->type.length = length;
+	return f;
+}
+
+/**
+ * creates rules with random patterns on addresses, ports and protocol, some rules
+ * also contain patterns which are not compiled by RuleMatcher
+ */
+Rules* RuleMatcherTest::createRandomRules(uint32_t count)
+{
+	const char* protocols[] = { "TCP", "UDP", "ICMP" };
+	const char* flags[] = { "SYN", "ACK", "SYN,ACK" };
+	const uint8_t prefixes[] = { 0, 8, 16, 24, 30, 32 };
+	char buf[64];
+
+	Rules* rules = new Rules();
+	for (uint32_t i = 0; i < count; i++) {
+		Rule* rule = new Rule();
+		rule->id = 1000+i;
+
+		for (int dir = 0; dir < 2; dir++) {
+			Rule::Field* f = createField(dir ? IPFIX_TYPEID_destinationIPv4Address : IPFIX_TYPEID_sourceIPv4Address, 4);
+			if (rand()%2) {
+				snprintf(buf, sizeof(buf), "10.0.%d.%d/%d", rand()%4, rand()%4, prefixes[rand()%6]);
+				REQUIRE(parseIPv4Pattern(buf, &f->pattern, &f->type.length) == 0);
+			}
+			rule->field[rule->fieldCount++] = f;
+
+			f = createField(dir ? IPFIX_TYPEID_destinationTransportPort : IPFIX_TYPEID_sourceTransportPort, 2);
+			if (rand()%2) {
+				int start = 1000+rand()%8;
+				if (rand()%2) {
+					snprintf(buf, sizeof(buf), "%d", start);
+				} else {
+					snprintf(buf, sizeof(buf), "%d:%d,%d", start, start+rand()%4, 50+rand()%8);
+				}
+				REQUIRE(parsePortPattern(buf, &f->pattern, &f->type.length) == 0);
+			}
+			rule->field[rule->fieldCount++] = f;
+		}
+
+		if (rand()%3 == 0) {
+			Rule::Field* f = createField(IPFIX_TYPEID_protocolIdentifier, 1);
+			REQUIRE(parseProtoPattern(protocols[rand()%3], &f->pattern, &f->type.length) == 0);
+			rule->field[rule->fieldCount++] = f;
+		}
+		if (rand()%5 == 0) {
+			Rule::Field* f = createField(IPFIX_TYPEID_tcpControlBits, 1);
+			strcpy(buf, flags[rand()%3]);
+			REQUIRE(parseTcpFlags(buf, &f->pattern, &f->type.length) == 0);
+			rule->field[rule->fieldCount++] = f;
+		}
+		if (rand()%8 == 0) {
+			// second pattern for the same field
+			Rule::Field* f = createField(IPFIX_TYPEID_sourceIPv4Address, 4);
+			snprintf(buf, sizeof(buf), "10.0.%d.0/24", rand()%4);
+			REQUIRE(parseIPv4Pattern(buf, &f->pattern, &f->type.length) == 0);
+			rule->field[rule->fieldCount++] = f;
+		}
+		rule->field[rule->fieldCount++] = createField(IPFIX_TYPEID_packetDeltaCount, 8);
+
+		rule->initialize();
+		rules->rule[rules->count++] = rule;
+	}
+	return rules;
+}
+
+/**
+ * creates an ethernet frame containing a TCP, UDP or ICMP packet with random addresses and ports
+ */
+Packet* RuleMatcherTest::createRandomPacket()
+{
+	unsigned char data[14+20+20];
+	memset(data, 0, sizeof(data));
+	data[12] = 0x08; // ethertype IPv4
+
+	unsigned char* ip = data+14;
+	uint8_t protocols[] = { 6, 17, 1 };
+	uint8_t proto = protocols[rand()%3];
+	uint32_t translen = (proto == 6) ? 20 : 8;
+	ip[0] = 0x45;
+	ip[2] = 0;
+	ip[3] = 20+translen;
+	ip[8] = 64;
+	ip[9] = proto;
+	for (int i = 0; i < 2; i++) {
+		ip[12+4*i] = 10;
+		ip[13+4*i] = 0;
+		ip[14+4*i] = rand()%4;
+		ip[15+4*i] = rand()%4;
+	}
+
+	unsigned char* trans = ip+20;
+	uint16_t ports[] = { 50, 53, 57, 1000, 1001, 1003, 1007, 1010, 80 };
+	uint16_t sport = ports[rand()%9];
+	uint16_t dport = ports[rand()%9];
+	trans[0] = sport >> 8;
+	trans[1] = sport & 0xFF;
+	trans[2] = dport >> 8;
+	trans[3] = dport & 0xFF;
+	if (proto == 6) {
+		trans[12] = 0x50;
+		trans[13] = rand()%2 ? 0x02 : 0x12;
+	} else if (proto == 17) {
+		trans[5] = 8;
+	}
+
+	struct timeval now;
+	gettimeofday(&now, 0);
+	uint32_t len = 14+20+translen;
+	Packet* p = packetManager.getNewInstance();
+	p->init((char*)data, len, now, 0, len, DLT_EN10MB);
+	return p;
+}
+
+/**
+ * a pattern with prefix /0 matches all addresses, both compiled and uncompiled
+ */
+void RuleMatcherTest::testZeroPrefix()
+{
+	char buf[64];
+	Rules* rules = new Rules();
+	for (uint32_t i = 0; i < 2; i++) {
+		Rule* rule = new Rule();
+		rule->id = 1+i;
+		Rule::Field* f = createField(IPFIX_TYPEID_sourceIPv4Address, 4);
+		strcpy(buf, "192.168.1.1/0");
+		REQUIRE(parseIPv4Pattern(buf, &f->pattern, &f->type.length) == 0);
+		rule->field[rule->fieldCount++] = f;
+		if (i == 1) {
+			// second pattern for the same field prevents compilation
+			f = createField(IPFIX_TYPEID_sourceIPv4Address, 4);
+			strcpy(buf, "0.0.0.0/0");
+			REQUIRE(parseIPv4Pattern(buf, &f->pattern, &f->type.length) == 0);
+			rule->field[rule->fieldCount++] = f;
+		}
+		rule->field[rule->fieldCount++] = createField(IPFIX_TYPEID_packetDeltaCount, 8);
+		rule->initialize();
+		rules->rule[rules->count++] = rule;
+	}
+	RuleMatcher matcher(rules);
+	REQUIRE(matcher.getUncompiledRuleCount() == 1);
+
+	uint16_t result[MAX_RULES];
+	for (uint32_t i = 0; i < 100; i++) {
+		Packet* p = createRandomPacket();
+		REQUIRE(rules->rule[0]->ExptemplateDataMatches(p));
+		REQUIRE(rules->rule[1]->ExptemplateDataMatches(p));
+		REQUIRE(matcher.getMatchingRules(p, result) == 2);
+		p->removeReference();
+	}
+	delete rules;
+}
+
+Test::TestResult RuleMatcherTest::execTest()
+{
+	srand(2);
+	std::cout << "Testing RuleMatcher against Rule::ExptemplateDataMatches..." << std::endl;
+
+	Rules* rules = createRandomRules(RULES);
+	RuleMatcher matcher(rules);
+	REQUIRE(matcher.getUncompiledRuleCount() > 0);
+
+	uint16_t result[MAX_RULES];
+	uint32_t matches = 0;
+	for (uint32_t i = 0; i < PACKETS; i++) {
+		Packet* p = createRandomPacket();
+		uint32_t n = matcher.getMatchingRules(p, result);
+		uint32_t j = 0;
+		for (uint32_t r = 0; r < rules->count; r++) {
+			if (rules->rule[r]->ExptemplateDataMatches(p)) {
+				REQUIRE(j < n);
+				REQUIRE(result[j] == r);
+				j++;
+			}
+		}
+		REQUIRE(j == n);
+		matches += n;
+		p->removeReference();
+	}
+	REQUIRE(matches > 0);
+	delete rules;
+
+	std::cout << "Testing IPv4 patterns with prefix /0..." << std::endl;
+	testZeroPrefix();
+
+	std::cout << "All tests on RuleMatcher passed (" << matches << " matches)" << std::endl;
+	return PASSED;
+}
@@ -0,0 +1,26 @@
+#ifndef RULEMATCHERTEST_H_
+#define RULEMATCHERTEST_H_
+
+#include "modules/ipfix/aggregator/RuleMatcher.h"
+#include "core/InstanceManager.h"
+
+#include "TestSuiteBase.h"
+
+class RuleMatcherTest : public Test
+{
+public:
+	RuleMatcherTest();
+	~RuleMatcherTest();
+
+	virtual TestResult execTest();
+
+private:
+	InstanceManager<Packet> packetManager;
+
+	Rules* createRandomRules(uint32_t count);
+	Rule::Field* createField(uint16_t id, uint16_t length);
+	Packet* createRandomPacket();
+	void testZeroPrefix();
+};
+
+#endif /*RULEMATCHERTEST_H_*/
@@ -0,0 +1,176 @@
+#include "UdpBatchTest.h"
+
+#include "modules/ipfix/IpfixSender.hpp"
+#include "core/Timer.h"
+#include "common/Time.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <iostream>
+
+static const uint32_t BATCH_SIZE = 8;
+static const uint32_t BATCH_DELAY = 50; // milliseconds
+
+/**
+ * records timeouts instead of triggering them
+ */
+class TimeoutRecorder : public Timer
+{
+public:
+	struct Entry {
+		Notifiable* n;
+		timespec ts;
+		void* dataPtr;
+	};
+	std::vector<Entry> timeouts;
+
+	virtual void addTimeout(Notifiable* n, struct timespec& ts, void* dataPtr = 0)
+	{
+		Entry e = { n, ts, dataPtr };
+		timeouts.push_back(e);
+	}
+
+	virtual void removeTimeout(void* = 0)
+	{
+	}
+};
+
+/**
+ * @returns ts plus the given number of milliseconds
+ */
+static timespec addMilliseconds(timespec ts, long ms)
+{
+	ts.tv_sec += ms/1000;
+	ts.tv_nsec += (ms%1000)*1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	return ts;
+}
+
+UdpBatchTest::UdpBatchTest()
+{
+}
+
+UdpBatchTest::~UdpBatchTest()
+{
+}
+
+/**
+ * receives all pending IPFIX messages from the given socket
+ * @returns number of received messages containing Data Sets
+ */
+static int receiveDataMessages(int sock, int timeout_ms)
+{
+	int dataMessages = 0;
+	char buf[2048];
+	struct pollfd pfd;
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+	while (poll(&pfd, 1, timeout_ms) > 0) {
+		ssize_t len = recv(sock, buf, sizeof(buf), 0);
+		REQUIRE(len >= 20);
+		uint16_t setId;
+		memcpy(&setId, buf+16, 2);
+		if (ntohs(setId) >= 256) dataMessages++;
+		timeout_ms = 0;
+	}
+	return dataMessages;
+}
+
+/**
+ * a batch which does not reach its maximum number of messages must be sent
+ * when the delay of its first message is over, not only on the next beat
+ */
+void UdpBatchTest::testPartialBatchDelay()
+{
+	static InstanceManager<IpfixTemplateRecord> templateIM("IpfixTemplateRecord");
+	static InstanceManager<IpfixDataRecord> dataIM("IpfixDataRecord");
+
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+	REQUIRE(sock >= 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	REQUIRE(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+	socklen_t addrlen = sizeof(addr);
+	REQUIRE(getsockname(sock, (struct sockaddr*)&addr, &addrlen) == 0);
+
+	TimeoutRecorder timer;
+	IpfixSender* sender = new IpfixSender(1);
+	sender->useTimer(&timer);
+	sender->addCollector("127.0.0.1", ntohs(addr.sin_port), UDP, NULL, "");
+	sender->setUdpBatching(BATCH_SIZE, BATCH_DELAY);
+
+	boost::shared_ptr<TemplateInfo> ti(new TemplateInfo());
+	ti->templateId = 256;
+	ti->setId = TemplateInfo::IpfixTemplate;
+	ti->fieldCount = 2;
+	ti->fieldInfo = (TemplateInfo::FieldInfo*)calloc(2, sizeof(TemplateInfo::FieldInfo));
+	ti->fieldInfo[0].type = InformationElement::IeInfo(IPFIX_TYPEID_sourceTransportPort, 0, 2);
+	ti->fieldInfo[0].offset = 0;
+	ti->fieldInfo[1].type = InformationElement::IeInfo(IPFIX_TYPEID_packetDeltaCount, 0, 8);
+	ti->fieldInfo[1].offset = 2;
+
+	IpfixTemplateRecord* templateRecord = templateIM.getNewInstance();
+	templateRecord->templateInfo = ti;
+	sender->onTemplate(templateRecord);
+
+	IpfixDataRecord* record = dataIM.getNewInstance();
+	record->templateInfo = ti;
+	record->message.reset(new IpfixRecord::Data[10]);
+	record->data = record->message.get();
+	record->dataLength = 10;
+	memset(record->data, 0, 10);
+
+	// add records until the first message is completed and queued in the batch
+	timespec before, after;
+	addToCurTime(&before, 0);
+	after = before;
+	for (uint32_t i = 0; i < 1000 && timer.timeouts.empty(); i++) {
+		addToCurTime(&before, 0);
+		record->addReference();
+		sender->onDataRecord(record);
+		addToCurTime(&after, 0);
+	}
+	REQUIRE(timer.timeouts.size() == 1);
+	TimeoutRecorder::Entry e = timer.timeouts[0];
+	REQUIRE(e.n == sender);
+	timer.timeouts.clear();
+
+	// timeout is due when the delay of the queued message is over
+	REQUIRE(compareTime(e.ts, addMilliseconds(before, BATCH_DELAY)) >= 0);
+	REQUIRE(compareTime(e.ts, addMilliseconds(after, BATCH_DELAY)) <= 0);
+	REQUIRE(receiveDataMessages(sock, 0) == 0);
+
+	// the batch is sent by the timeout
+	timespec now;
+	addToCurTime(&now, 0);
+	while (compareTime(now, e.ts) < 0) {
+		usleep(1000);
+		addToCurTime(&now, 0);
+	}
+	sender->onTimeout(e.dataPtr);
+	REQUIRE(receiveDataMessages(sock, 1000) == 1);
+	REQUIRE(timer.timeouts.empty());
+
+	delete sender;
+	record->removeReference();
+	close(sock);
+}
+
+Test::TestResult UdpBatchTest::execTest()
+{
+	std::cout << "Testing delay of partial UDP batches in IpfixSender..." << std::endl;
+	testPartialBatchDelay();
+
+	std::cout << "All tests on UdpBatch passed" << std::endl;
+	return PASSED;
+}
@@ -0,0 +1,18 @@
+#ifndef UDPBATCHTEST_H_
+#define UDPBATCHTEST_H_
+
+#include "TestSuiteBase.h"
+
+class UdpBatchTest : public Test
+{
+public:
+	UdpBatchTest();
+	~UdpBatchTest();
+
+	virtual TestResult execTest();
+
+private:
+	void testPartialBatchDelay();
+};
+
+#endif /*UDPBATCHTEST_H_*/
@@ -7,6 +7,22 @@
 #include "ConnectionFilterTest.h"
 #include "test_concentrator.h"
 #include "ConfigTester.h"
+#include "ConcurrentQueueTest.h"
+#include "FlowTableTest.h"
+#include "ExpiryWheelTest.h"
+#include "RuleMatcherTest.h"
+#include "RecordDispatchTest.h"
+#include "PgCopyBufferTest.h"
+#include "IDMEFTemplateTest.h"
+#include "HostTableTest.h"
+#include "ConnectionTest.h"
+#include "MsgAsyncTest.h"
+#include "CryptoPanTest.h"
+#include "MultiPatternMatcherTest.h"
+#include "MultiRegexMatcherTest.h"
+#include "UdpBatchTest.h"
+#include "PayloadFilterTest.h"
+#include "InstanceManagerTest.h"
 
 #include "TestSuiteBase.h"
 
@@ -46,11 +62,27 @@ int main(int argc, char* argv[])
 	
 	TestSuite testSuite;
 
+	testSuite.add(new ConcurrentQueueTest());
+	testSuite.add(new FlowTableTest());
+	testSuite.add(new ExpiryWheelTest());
+	testSuite.add(new RuleMatcherTest());
+	testSuite.add(new RecordDispatchTest());
+	testSuite.add(new PgCopyBufferTest());
+	testSuite.add(new IDMEFTemplateTest());
+	testSuite.add(new HostTableTest());
+	testSuite.add(new ConnectionTest());
+	testSuite.add(new MsgAsyncTest());
+	testSuite.add(new CryptoPanTest());
+	testSuite.add(new MultiPatternMatcherTest());
+	testSuite.add(new MultiRegexMatcherTest());
+	testSuite.add(new UdpBatchTest());
+	testSuite.add(new PayloadFilterTest());
+	testSuite.add(new InstanceManagerTest());
 	testSuite.add(new ReconfTest());
 	testSuite.add(new AggregationPerfTest(!perftest));
 	testSuite.add(new ConcentratorTestSuite());
+	testSuite.add(new BloomFilterTestSuite(!perftest));
 #ifdef HAVE_CONNECTION_FILTER
-	testSuite.add(new BloomFilterTestSuite());
 	testSuite.add(new ConnectionFilterTestSuite());
 #endif
 	testSuite.add(new ConfigTester(config_dir));
@@ -51,6 +51,7 @@ struct parameters {
 	uid_t uid;
 	gid_t gid;
 	bool daemon_mode;
+	bool async_log;
 };
 
 
@@ -158,6 +159,9 @@ usage (int status)
 			" -u, --user USER            Change user to USER (use with -b)\n"
 			" -g, --group GROUP          Change group to GROUP (use with -b)\n"
 			" -s, --syslog               Log to syslog\n"
+			" -a, --async-log            Write log messages from a separate thread,\n"
+			"                            messages of each call site are limited\n"
+			"                            to 10 per second\n"
 #ifdef JOURNALD_SUPPORT_ENABLED
 			" -j, --journald             Log to journald\n"
 #endif
@@ -187,10 +191,11 @@ parse_args (int argc, char **argv, struct parameters *params)
 			{ "journald",     no_argument,       NULL, 'j' },
 #endif
 			{ "syslog",       no_argument,       NULL, 's' },
+			{ "async-log",    no_argument,       NULL, 'a' },
 			{ NULL, 0, NULL, 0}
 	};
 
-	while ((opt = getopt_long(argc, argv, "hbp:u:g:df:ql:js", long_opts,
+	while ((opt = getopt_long(argc, argv, "hbp:u:g:df:ql:jsa", long_opts,
 			&option_index)) != EOF) {
 		switch (opt) {
 		case 'b':
@@ -263,6 +268,10 @@ parse_args (int argc, char **argv, struct parameters *params)
 			msg_set_syslog(true);
 			break;
 
+		case 'a':
+			params->async_log = true;
+			break;
+
 		default:
 			usage(EXIT_FAILURE);
 			break;
@@ -313,6 +322,11 @@ int main(int ac, char **dc)
 		daemonise(parameters.pid_file, parameters.uid, parameters.gid);
 	}
 
+	// logger thread must be started after fork
+	if (parameters.async_log) {
+		msg_set_async(true);
+	}
+
 	/**< Wrapper for the main thread's signal handlers*/
 	MainSignalHandler main_signal_handler;
 
@@ -56,17 +56,34 @@ chdir $dir || die "failed to change to directory $dir: $!";
 while (1) {
 	opendir(DIR, ".") || die "failed to open directory $dir: $!";
 	while ($_ = readdir(DIR)) {
-		next if (/^\.\.?$/);
+		# files starting with a dot are still written by vermont
+		next if (/^\./);
 		my $file = $_;
 		open(MSG, "<$_") || die "failed to open file $_: $!";
 		flock(MSG, LOCK_EX);
-		my @idmefdata = <MSG>;
-		$_ = shift @idmefdata;
-		chomp;
-		my $url = $_;
-		my $msg = join("", @idmefdata);
-		print "Sending file $file ...\n";
-		send_idmef($url, $msg);
+		if ($file =~ /\.spool$/) {
+			# spool file: each message is preceded by a line containing its length and the URL
+			binmode MSG;
+			local $/;
+			my $data = <MSG>;
+			my $pos = 0;
+			print "Sending spool file $file ...\n";
+			while ($pos < length($data)) {
+				my $eol = index($data, "\n", $pos);
+				die "invalid record header in spool file $file" if ($eol < 0);
+				my ($len, $url) = split(/ /, substr($data, $pos, $eol-$pos), 2);
+				send_idmef($url, substr($data, $eol+1, $len));
+				$pos = $eol+1+$len+1;
+			}
+		} else {
+			my @idmefdata = <MSG>;
+			$_ = shift @idmefdata;
+			chomp;
+			my $url = $_;
+			my $msg = join("", @idmefdata);
+			print "Sending file $file ...\n";
+			send_idmef($url, $msg);
+		}
 		flock(MSG, LOCK_UN);
 		close MSG;
 		unlink $file || die "failed to delete file $file: $!";